@@ -0,0 +1,165 @@
+#include "StarAssetPatchCache.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarFile.hpp"
+#include "StarLogging.hpp"
+#include "StarTime.hpp"
+#include "StarVersion.hpp"
+
+namespace Star {
+
+static char const* const PatchCacheMagic = "SBPatchCache2";
+
+AssetPatchCache::AssetPatchCache(String cacheFile)
+  : m_cacheFile(std::move(cacheFile)), m_changed(false), m_lastChangeTime(0.0) {
+  try {
+    load();
+  } catch (std::exception const& e) {
+    Logger::warn("Ignoring unreadable asset patch cache '{}': {}", m_cacheFile, outputException(e, false));
+    m_mapping.reset();
+    m_entries.clear();
+  }
+}
+
+Maybe<Json> AssetPatchCache::get(String const& path, uint64_t key) const {
+  MutexLocker locker(m_mutex);
+  auto entry = m_entries.ptr(path);
+  if (!entry || entry->key != key)
+    return {};
+
+  // Decode outside of the lock, holding on to the mapping in case the cache
+  // is saved in the meantime.
+  auto mapping = m_mapping;
+  ByteArray data = entry->data;
+  size_t offset = entry->offset;
+  size_t size = entry->size;
+  locker.unlock();
+
+  try {
+    Json json;
+    if (data.empty()) {
+      DataStreamExternalBuffer ds(mapping->data() + offset, size);
+      ds.read(json);
+    } else {
+      DataStreamBuffer ds(std::move(data));
+      ds.read(json);
+    }
+    return json;
+  } catch (std::exception const& e) {
+    Logger::warn("Ignoring broken asset patch cache entry for '{}': {}", path, outputException(e, false));
+    return {};
+  }
+}
+
+void AssetPatchCache::set(String const& path, uint64_t key, Json const& json) {
+  ByteArray data = DataStreamBuffer::serialize(json);
+
+  MutexLocker locker(m_mutex);
+  m_entries[path] = Entry{key, 0, data.size(), std::move(data)};
+  m_changed = true;
+  m_lastChangeTime = Time::monotonicTime();
+}
+
+void AssetPatchCache::save(function<bool(String const&)> const& keep) {
+  MutexLocker locker(m_mutex);
+  if (!m_changed)
+    return;
+
+  List<pair<String, Entry const*>> entries;
+  for (auto const& pair : m_entries) {
+    if (keep(pair.first))
+      entries.append({pair.first, &pair.second});
+  }
+  entries.sort([](auto const& a, auto const& b) { return a.first < b.first; });
+
+  DataStreamBuffer index;
+  index.writeData(PatchCacheMagic, strlen(PatchCacheMagic));
+  index.write(String(xSbVersionString));
+  index.writeVlqU(entries.size());
+
+  size_t offset = 0;
+  for (auto const& pair : entries) {
+    index.write(pair.first);
+    index.write(pair.second->key);
+    index.writeVlqU(offset);
+    index.writeVlqU(pair.second->size);
+    offset += pair.second->size;
+  }
+
+  ByteArray contents = index.takeData();
+  contents.reserve(contents.size() + offset);
+  for (auto const& pair : entries) {
+    if (pair.second->data.empty())
+      contents.append(m_mapping->data() + pair.second->offset, pair.second->size);
+    else
+      contents.append(pair.second->data);
+  }
+
+  // Windows cannot replace a file that is still mapped.
+  m_mapping.reset();
+  m_entries.clear();
+  try {
+    File::overwriteFileWithRename(contents, m_cacheFile);
+    Logger::info("Saved {} patched assets to the asset patch cache", entries.size());
+  } catch (std::exception const& e) {
+    Logger::warn("Could not save asset patch cache '{}': {}", m_cacheFile, outputException(e, false));
+  }
+
+  try {
+    load();
+  } catch (std::exception const& e) {
+    Logger::warn("Could not reload asset patch cache '{}': {}", m_cacheFile, outputException(e, false));
+    m_mapping.reset();
+    m_entries.clear();
+  }
+  m_changed = false;
+}
+
+void AssetPatchCache::saveIfSettled(double settleTime, function<bool(String const&)> const& keep) {
+  {
+    MutexLocker locker(m_mutex);
+    if (!m_changed || Time::monotonicTime() - m_lastChangeTime < settleTime)
+      return;
+  }
+  save(keep);
+}
+
+void AssetPatchCache::load() {
+  m_mapping.reset();
+  m_entries.clear();
+  if (!File::isFile(m_cacheFile))
+    return;
+
+  auto mapping = MemoryMappedFile::open(m_cacheFile);
+  DataStreamExternalBuffer ds(mapping->data(), mapping->size());
+
+  size_t magicSize = strlen(PatchCacheMagic);
+  if (mapping->size() < magicSize || memcmp(mapping->data(), PatchCacheMagic, magicSize) != 0)
+    throw IOException("Unrecognized asset patch cache format");
+  ds.seek(magicSize);
+
+  if (ds.read<String>() != xSbVersionString) {
+    Logger::info("Asset patch cache was written by a different version, ignoring it");
+    return;
+  }
+
+  size_t count = ds.readVlqU();
+  for (size_t i = 0; i < count; ++i) {
+    auto path = ds.read<String>();
+    Entry entry;
+    entry.key = ds.read<uint64_t>();
+    entry.offset = ds.readVlqU();
+    entry.size = ds.readVlqU();
+    m_entries.set(std::move(path), std::move(entry));
+  }
+
+  size_t dataStart = ds.pos();
+  for (auto& pair : m_entries) {
+    pair.second.offset += dataStart;
+    if (pair.second.offset > mapping->size() || pair.second.size > mapping->size() - pair.second.offset)
+      throw IOException("Truncated asset patch cache");
+  }
+
+  m_mapping = std::move(mapping);
+}
+
+}
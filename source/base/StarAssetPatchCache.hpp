@@ -0,0 +1,60 @@
+#ifndef STAR_ASSET_PATCH_CACHE_HPP
+#define STAR_ASSET_PATCH_CACHE_HPP
+
+#include "StarJson.hpp"
+#include "StarMemoryMappedFile.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+STAR_CLASS(AssetPatchCache);
+
+// An on-disk cache of fully patched JSON assets, so that patched assets do
+// not have to be parsed and patched all over again on every start.  Entries
+// are keyed by a hash of the contents of the asset and of every patch applied
+// to it, so changing any of those only invalidates the entries it affects.
+// Assets patched by scripts are never cached, since scripts may read other
+// assets or configuration that the key does not cover.
+//
+// The cache file is mapped and entries are decoded from it as they are asked
+// for.  New entries are kept in memory until the cache is saved.  Thread
+// safe.
+class AssetPatchCache {
+public:
+  // Loads the given cache file, if it exists and was written by this version.
+  AssetPatchCache(String cacheFile);
+
+  Maybe<Json> get(String const& path, uint64_t key) const;
+  void set(String const& path, uint64_t key, Json const& json);
+
+  // Writes out the cache file if there are new entries, keeping only the
+  // entries for paths that 'keep' returns true for.
+  void save(function<bool(String const&)> const& keep);
+  // Same, but only once no new entries have been set for the given number of
+  // seconds, so that the file is not rewritten over and over while assets are
+  // still being loaded.
+  void saveIfSettled(double settleTime, function<bool(String const&)> const& keep);
+
+private:
+  struct Entry {
+    uint64_t key;
+    // Serialized Json, either in the cache file mapping or in 'data'.
+    size_t offset;
+    size_t size;
+    ByteArray data;
+  };
+
+  void load();
+
+  String m_cacheFile;
+
+  mutable Mutex m_mutex;
+  MemoryMappedFilePtr m_mapping;
+  StringMap<Entry> m_entries;
+  bool m_changed;
+  double m_lastChangeTime;
+};
+
+}
+
+#endif
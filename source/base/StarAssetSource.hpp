@@ -28,8 +28,14 @@ public:
 
   // Read the entirety of the given path into a buffer.
   virtual ByteArray read(String const& path) = 0;
+
+  // Hints that the assets with the given extension are about to be read, so
+  // that a source may start loading them ahead of time.
+  virtual void prefetchExtension(String const& extension);
 };
 
+inline void AssetSource::prefetchExtension(String const&) {}
+
 }
 
 #endif
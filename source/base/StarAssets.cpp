@@ -1,4 +1,5 @@
 #include "StarAssets.hpp"
+#include "StarAssetPatchCache.hpp"
 #include "StarAssetPath.hpp"
 #include "StarAudio.hpp"
 #include "StarCasting.hpp"
@@ -24,6 +25,8 @@
 #include "StarSha256.hpp"
 #include "StarTime.hpp"
 #include "StarUtilityLuaBindings.hpp"
+#include "StarWorkerPool.hpp"
+#include "StarXXHash.hpp"
 
 #if defined TRACY_ENABLE
 #include "tracy/Tracy.hpp"
@@ -34,6 +37,17 @@
 
 namespace Star {
 
+// Seconds without newly patched assets before the patch cache is saved.
+static double const PatchCacheSettleTime = 10.0;
+
+static bool isScriptPatched(List<pair<String, AssetSourcePtr>> const& patchSources) {
+  for (auto const& pair : patchSources) {
+    if (pair.first.endsWith(".lua") || pair.first.endsWith(".pluto"))
+      return true;
+  }
+  return false;
+}
+
 static void validateBasePath(std::string_view const& basePath) {
   if (basePath.empty() || basePath[0] != '/')
     throw AssetException(strf("Path '{}' must be absolute", basePath));
@@ -514,55 +528,140 @@ Assets::Assets(Settings settings, StringList assetSources) {
     }
     // Kae: Clear any cached files that may have been added by preprocessing scripts, as they may no longer be valid.
     m_framesSpecifications.clear();
-    m_assetsCache.clear();
+    clearCachedAssets();
   };
 
-  for (auto& sourcePath : m_assetSources) {
-    Logger::info("Loading assets from: '{}'", sourcePath);
-    AssetSourcePtr source;
-    if (File::isDirectory(sourcePath))
-      source = std::make_shared<DirectoryAssetSource>(sourcePath, m_settings.pathIgnore);
-    else
-      source = std::make_shared<PackedAssetSource>(sourcePath);
+  // Scanning a source walks its whole directory tree or reads its packed
+  // index, independently of every other source, so all of them are scanned up
+  // front in parallel.  Adding them and running their load scripts still
+  // happens in load order.
+  List<AssetSourcePtr> scannedSources(m_assetSources.size());
+  List<double> scanTimes(m_assetSources.size(), 0.0);
+  WorkerPool::shared().parallelFor(m_assetSources.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      auto const& sourcePath = m_assetSources[i];
+      double start = Time::monotonicTime();
+      if (File::isDirectory(sourcePath))
+        scannedSources[i] = std::make_shared<DirectoryAssetSource>(sourcePath, m_settings.pathIgnore);
+      else
+        scannedSources[i] = std::make_shared<PackedAssetSource>(sourcePath);
+      scanTimes[i] = Time::monotonicTime() - start;
+    }
+  });
 
-    addSource(sourcePath, source);
-    sources.append(make_pair(sourcePath, source));
+  List<double> loadScriptTimes(m_assetSources.size(), 0.0);
+  for (size_t i = 0; i < m_assetSources.size(); ++i) {
+    auto const& sourcePath = m_assetSources[i];
+    Logger::info("Loading assets from: '{}'", sourcePath);
+    addSource(sourcePath, scannedSources[i]);
+    sources.append(make_pair(sourcePath, scannedSources[i]));
 
-    runLoadScripts("onLoad", sourcePath, source, sources);
+    double start = Time::monotonicTime();
+    runLoadScripts("onLoad", sourcePath, scannedSources[i], sources);
+    loadScriptTimes[i] += Time::monotonicTime() - start;
   }
 
-  for (auto& pair : sources)
-    runLoadScripts("postLoad", pair.first, pair.second, sources);
+  for (size_t i = 0; i < sources.size(); ++i) {
+    double start = Time::monotonicTime();
+    runLoadScripts("postLoad", sources[i].first, sources[i].second, sources);
+    loadScriptTimes[i] += Time::monotonicTime() - start;
+  }
 
-  Sha256Hasher digest;
+  // Opening every file for its size dominates the digest with directory
+  // sources, so the sizes are gathered in parallel and hashed in order after.
+  auto assetPaths = m_files.keys().sorted();
+  List<List<StreamOffset>> digestSizes(assetPaths.size());
+  WorkerPool::shared().parallelFor(assetPaths.size(), 256, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      bool digestFile = true;
+      for (auto const& pattern : m_settings.digestIgnore) {
+        if (assetPaths[i].regexMatch(pattern, false, false)) {
+          digestFile = false;
+          break;
+        }
+      }
 
-  for (auto const& assetPath : m_files.keys().sorted()) {
-    bool digestFile = true;
-    for (auto const& pattern : m_settings.digestIgnore) {
-      if (assetPath.regexMatch(pattern, false, false)) {
-        digestFile = false;
-        break;
+      if (digestFile) {
+        auto const& descriptor = m_files.get(assetPaths[i]);
+        digestSizes[i].append(descriptor.source->open(descriptor.sourceName)->size());
+        for (auto const& pair : descriptor.patchSources)
+          digestSizes[i].append(pair.second->open(pair.first)->size());
       }
     }
+  });
 
-    auto const& descriptor = m_files.get(assetPath);
+  Sha256Hasher digest;
 
-    if (digestFile) {
-      digest.push(assetPath);
-      digest.push(DataStreamBuffer::serialize(descriptor.source->open(descriptor.sourceName)->size()));
-      for (auto const& pair : descriptor.patchSources)
-        digest.push(DataStreamBuffer::serialize(pair.second->open(pair.first)->size()));
+  for (size_t i = 0; i < assetPaths.size(); ++i) {
+    if (!digestSizes[i].empty()) {
+      digest.push(assetPaths[i]);
+      for (auto size : digestSizes[i])
+        digest.push(DataStreamBuffer::serialize(size));
     }
   }
 
   m_digest = digest.compute();
 
+  if (m_settings.patchCacheFile)
+    m_patchCache = make_shared<AssetPatchCache>(*m_settings.patchCacheFile);
+
   for (auto const& filename : m_files.keys())
     m_filesByExtension[AssetPath::extension(filename).toLower()].add(filename);
 
   int workerPoolSize = m_settings.workerPoolSize;
   for (int i = 0; i < workerPoolSize; i++)
     m_workerThreads.append(Thread::invoke("Assets::workerMain", mem_fn(&Assets::workerMain), this));
+
+  if (m_settings.preloadPatchedJson) {
+    // Queued for the worker threads, while this thread works through them in
+    // order as well.  Assets blocked on one another being loaded are put off
+    // by the queue until that one is done.  They are kept loaded for good, or
+    // else cleanup would just drop them again before they are ever used.
+    double start = Time::monotonicTime();
+    List<AssetId> patchedJson;
+    for (auto const& pair : m_files) {
+      if (!pair.second.patchSources.empty())
+        patchedJson.append(AssetId{AssetType::Json, {pair.first, {}, {}}});
+    }
+    queueAssets(patchedJson, true);
+
+    size_t failed = 0;
+    for (auto const& id : patchedJson) {
+      try {
+        getAsset(id, true);
+      } catch (std::exception const&) {
+        // Already logged by whichever thread tried to load it.
+        ++failed;
+      }
+    }
+    Logger::info("Built {} patched JSON assets in {:.1f}ms, {} failed", patchedJson.size() - failed, (Time::monotonicTime() - start) * 1000, failed);
+  }
+
+  HashMap<AssetSource const*, size_t> patchCounts;
+  for (auto const& pair : m_files) {
+    for (auto const& patch : pair.second.patchSources)
+      ++patchCounts[patch.second.get()];
+  }
+
+  List<size_t> slowestSources;
+  for (size_t i = 0; i < sources.size(); ++i)
+    slowestSources.append(i);
+  slowestSources.sort([&](size_t a, size_t b) {
+    return scanTimes[a] + loadScriptTimes[a] > scanTimes[b] + loadScriptTimes[b];
+  });
+  Logger::info("Asset source load times, slowest first:");
+  for (size_t i : slowestSources) {
+    auto const& source = sources[i].second;
+    auto name = source->metadata().value("name", File::baseName(sources[i].first));
+    String patchTime;
+    if (m_settings.preloadPatchedJson) {
+      MutexLocker patchTimesLocker(m_patchTimesMutex);
+      patchTime = strf(", applied in {:.1f}ms", m_patchTimes.value(source.get()) * 1000);
+    }
+    Logger::info("  {}: scanned {} files in {:.1f}ms, load scripts {:.1f}ms, {} patches{}",
+        name.isType(Json::Type::String) ? name.toString() : name.repr(), source->assetPaths().size(),
+        scanTimes[i] * 1000, loadScriptTimes[i] * 1000, patchCounts.value(source.get()), patchTime);
+  }
 }
 
 Assets::~Assets() {
@@ -577,11 +676,14 @@ Assets::~Assets() {
 
   // Join them all
   m_workerThreads.clear();
+
+  if (m_patchCache)
+    m_patchCache->save(bind(&Assets::patchCacheable, this, _1));
 }
 
 void Assets::hotReload() {
   MutexLocker assetsLocker(m_assetsMutex);
-  m_assetsCache.clear();
+  clearCachedAssets();
   m_queue.clear();
   m_framesSpecifications.clear();
 }
@@ -681,7 +783,13 @@ const CaseInsensitiveStringSet NullExtensionScan;
 
 CaseInsensitiveStringSet Assets::scanExtension(String const& extension) const {
   auto find = m_filesByExtension.find(extension.beginsWith(".") ? extension.substr(1) : extension);
-  return find != m_filesByExtension.end() ? find->second : NullExtensionScan;
+  if (find == m_filesByExtension.end())
+    return NullExtensionScan;
+
+  // Scanned extensions are usually about to be loaded in full.
+  for (auto const& pair : m_assetSourcePaths)
+    pair.second->prefetchExtension(find->first);
+  return find->second;
 }
 
 Json Assets::json(String const& path, bool forcePersistence) const {
@@ -902,7 +1010,7 @@ void Assets::allowExpiry(String const& path) {
   if (assetToFind == m_assetsCache.end())
     assetToFind = m_assetsCache.find(AssetId{AssetType::Bytes, components});
   if (assetToFind != m_assetsCache.end())
-    assetToFind->second->overridePersistence = false;
+    assetToFind->second->overridePersistence.store(false, std::memory_order_relaxed);
 }
 
 IODevicePtr Assets::openFile(String const& path) const {
@@ -920,12 +1028,17 @@ void Assets::clearCache() {
   while (it.hasNext()) {
     auto const& pair = it.next();
     // Don't clean up queued, persistent, or broken assets.
-    if (pair.second && !pair.second->shouldPersist() && !m_queue.contains(pair.first))
+    if (pair.second && !pair.second->shouldPersist() && !m_queue.contains(pair.first)) {
+      unpublishLoadedAsset(pair.first);
       it.remove();
+    }
   }
 }
 
 void Assets::cleanup() {
+  if (m_patchCache)
+    m_patchCache->saveIfSettled(PatchCacheSettleTime, bind(&Assets::patchCacheable, this, _1));
+
   MutexLocker assetsLocker(m_assetsMutex);
 
   double time = Time::monotonicTime();
@@ -935,13 +1048,15 @@ void Assets::cleanup() {
     auto pair = it.next();
     // Don't clean up broken assets or queued assets.
     if (pair.second && !m_queue.contains(pair.first)) {
-      double liveTime = time - pair.second->time;
+      double liveTime = time - pair.second->time.load(std::memory_order_relaxed);
       if (liveTime > m_settings.assetTimeToLive) {
         // If the asset should persist, just refresh the access time.
-        if (pair.second->shouldPersist())
-          pair.second->time = time;
-        else
+        if (pair.second->shouldPersist()) {
+          pair.second->time.store(time, std::memory_order_relaxed);
+        } else {
+          unpublishLoadedAsset(pair.first);
           it.remove();
+        }
       }
     }
   }
@@ -1069,10 +1184,18 @@ FramesSpecification Assets::parseFramesSpecification(Json const& frameConfig, St
 }
 
 void Assets::queueAssets(List<AssetId> const& assetIds, bool forcePersistence) const {
+  List<AssetId const*> missing;
+  for (auto const& id : assetIds) {
+    if (!loadedAsset(id, forcePersistence))
+      missing.append(&id);
+  }
+  if (missing.empty())
+    return;
+
   MutexLocker assetsLocker(m_assetsMutex);
 
-  for (auto const& id : assetIds)
-    queueAsset(id, forcePersistence);
+  for (auto id : missing)
+    queueAsset(*id, forcePersistence);
 }
 
 void Assets::queueAsset(AssetId const& assetId, bool forcePersistence) const {
@@ -1080,7 +1203,7 @@ void Assets::queueAsset(AssetId const& assetId, bool forcePersistence) const {
   if (i != m_assetsCache.end()) {
     if (i->second) {
       freshen(i->second);
-      if (forcePersistence) i->second->overridePersistence = true;
+      if (forcePersistence) i->second->overridePersistence.store(true, std::memory_order_relaxed);
     }
   } else {
     auto j = m_queue.find(assetId);
@@ -1092,13 +1215,16 @@ void Assets::queueAsset(AssetId const& assetId, bool forcePersistence) const {
 }
 
 shared_ptr<Assets::AssetData> Assets::tryAsset(AssetId const& id, bool forcePersistence) const {
+  if (auto asset = loadedAsset(id, forcePersistence))
+    return asset;
+
   MutexLocker assetsLocker(m_assetsMutex);
 
   auto i = m_assetsCache.find(id);
   if (i != m_assetsCache.end()) {
     if (i->second) {
       freshen(i->second);
-      if (forcePersistence) i->second->overridePersistence = true;
+      if (forcePersistence) i->second->overridePersistence.store(true, std::memory_order_relaxed);
       return i->second;
     } else {
       throw AssetException::format("Error loading asset {}", id.path);
@@ -1114,6 +1240,9 @@ shared_ptr<Assets::AssetData> Assets::tryAsset(AssetId const& id, bool forcePers
 }
 
 shared_ptr<Assets::AssetData> Assets::getAsset(AssetId const& id, bool forcePersistence) const {
+  if (auto asset = loadedAsset(id, forcePersistence))
+    return asset;
+
   MutexLocker assetsLocker(m_assetsMutex);
 
   while (true) {
@@ -1122,7 +1251,7 @@ shared_ptr<Assets::AssetData> Assets::getAsset(AssetId const& id, bool forcePers
       if (j->second) {
         auto asset = j->second;
         freshen(asset);
-        if (forcePersistence) asset->overridePersistence = true;
+        if (forcePersistence) asset->overridePersistence.store(true, std::memory_order_relaxed);
         return asset;
       } else {
         throw AssetException::format("Error loading asset {}", id.path);
@@ -1136,6 +1265,20 @@ shared_ptr<Assets::AssetData> Assets::getAsset(AssetId const& id, bool forcePers
   }
 }
 
+shared_ptr<Assets::AssetData> Assets::loadedAsset(AssetId const& id, bool forcePersistence) const {
+  auto& shard = loadedAssetShard(id);
+  MutexLocker shardLocker(shard.mutex);
+  auto asset = shard.assets.value(id);
+  shardLocker.unlock();
+
+  if (asset) {
+    freshen(asset);
+    if (forcePersistence)
+      asset->overridePersistence.store(true, std::memory_order_relaxed);
+  }
+  return asset;
+}
+
 void Assets::workerMain() {
   while (true) {
     if (m_stopThreads)
@@ -1381,17 +1524,50 @@ Json Assets::checkPatchArray(String const& path, AssetSourcePtr const& source, J
   return newResult;
 }
 
+bool Assets::patchCacheable(String const& path) const {
+  auto descriptor = m_files.ptr(path);
+  return descriptor && !descriptor->patchSources.empty() && !isScriptPatched(descriptor->patchSources);
+}
+
 Json Assets::readJson(String const& path) const {
   ByteArray streamData = read(path);
   try {
-    Json result = inputUtf8Json(streamData.begin(), streamData.end(), false);
     // FezzedOne: Minor optimisation.
     auto& patchSources = m_files.get(path).patchSources;
-    if (patchSources.empty()) return result;
-    for (auto const& pair : patchSources) {
+    if (patchSources.empty())
+      return inputUtf8Json(streamData.begin(), streamData.end(), false);
+
+    List<ByteArray> patchStreams;
+    for (auto const& pair : patchSources)
+      patchStreams.append(pair.second->read(pair.first));
+
+    // Patched assets are cached by the contents of the asset and its patches.
+    // Patch scripts can read anything, so what they produce is never cached.
+    bool cacheable = m_patchCache && !isScriptPatched(patchSources);
+    uint64_t cacheKey = 0;
+    if (cacheable) {
+      XXHash3 hasher;
+      hasher.push(path.utf8Ptr(), path.utf8Size() + 1);
+      hasher.push(streamData.ptr(), streamData.size());
+      for (size_t i = 0; i < patchSources.size(); ++i) {
+        auto const& patchPath = patchSources[i].first;
+        hasher.push(patchPath.utf8Ptr(), patchPath.utf8Size() + 1);
+        xxHash3Push(hasher, (uint64_t)patchStreams[i].size());
+        hasher.push(patchStreams[i].ptr(), patchStreams[i].size());
+      }
+      cacheKey = hasher.digest();
+
+      if (auto cached = m_patchCache->get(path, cacheKey))
+        return cached.take();
+    }
+
+    Json result = inputUtf8Json(streamData.begin(), streamData.end(), false);
+    for (size_t i = 0; i < patchSources.size(); ++i) {
+      auto const& pair = patchSources[i];
       auto& patchPath = pair.first;
       auto& patchSource = pair.second;
-      auto patchStream = patchSource->read(patchPath);
+      auto const& patchStream = patchStreams[i];
+      double patchStart = Time::monotonicTime();
       // FezzedOne: Patches that return an invalid result or throw errors are now ignored, allowing the patched asset file to load.
       if (patchPath.endsWith(".lua") || patchPath.endsWith(".pluto")) {
         RecursiveMutexLocker luaLocker(m_luaMutex);
@@ -1464,7 +1640,14 @@ Json Assets::readJson(String const& path) const {
         if (newPatchResult.isType(Json::Type::Array) || newPatchResult.isType(Json::Type::Object))
           result = std::move(newPatchResult);
       }
+
+      double patchTime = Time::monotonicTime() - patchStart;
+      MutexLocker patchTimesLocker(m_patchTimesMutex);
+      m_patchTimes[patchSource.get()] += patchTime;
     }
+
+    if (cacheable)
+      m_patchCache->set(path, cacheKey, result);
     return result;
   } catch (std::exception const& e) {
     throw JsonParsingException(strf("Cannot parse JSON file: {}", path), e);
@@ -1484,7 +1667,7 @@ bool Assets::doLoad(AssetId const& id, bool forcePersistence) const {
 
   // There was an exception, remove the asset from the queue and fill the cache
   // with null so that getAsset will throw.
-  m_assetsCache[id] = {};
+  setCachedAsset(id, {});
   m_assetsDone.broadcast();
   m_queue.remove(id);
   return true;
@@ -1505,9 +1688,9 @@ bool Assets::doPost(AssetId const& id, bool forcePersistence) const {
   m_queue.remove(id);
   if (assetData) {
     assetData->needsPostProcessing = false;
-    m_assetsCache[id] = assetData;
+    setCachedAsset(id, assetData);
     freshen(assetData);
-    if (forcePersistence) assetData->overridePersistence = true;
+    if (forcePersistence) assetData->overridePersistence.store(true, std::memory_order_relaxed);
     m_assetsDone.broadcast();
   }
 
@@ -1538,7 +1721,7 @@ shared_ptr<Assets::AssetData> Assets::loadAsset(AssetId const& id, bool forcePer
         assetData = loadBytes(id.path);
       }
 
-      if (forcePersistence) assetData->overridePersistence = true;
+      if (forcePersistence) assetData->overridePersistence.store(true, std::memory_order_relaxed);
 
     } catch (StarException const& e) {
       if (id.type == AssetType::Image && m_settings.missingImage) {
@@ -1557,7 +1740,7 @@ shared_ptr<Assets::AssetData> Assets::loadAsset(AssetId const& id, bool forcePer
         m_queue[id] = QueuePriority::PostProcess;
       else
         m_queue.remove(id);
-      m_assetsCache[id] = assetData;
+      setCachedAsset(id, assetData);
       m_assetsDone.broadcast();
       freshen(assetData);
 
@@ -1574,7 +1757,7 @@ shared_ptr<Assets::AssetData> Assets::loadAsset(AssetId const& id, bool forcePer
 
   } catch (...) {
     m_queue.remove(id);
-    m_assetsCache[id] = {};
+    setCachedAsset(id, {});
     m_assetsDone.broadcast();
     throw;
   }
@@ -1740,7 +1923,39 @@ shared_ptr<Assets::AssetData> Assets::postProcessAudio(shared_ptr<AssetData> con
 }
 
 void Assets::freshen(shared_ptr<AssetData> const& asset) const {
-  asset->time = Time::monotonicTime();
+  asset->time.store(Time::monotonicTime(), std::memory_order_relaxed);
+}
+
+void Assets::setCachedAsset(AssetId const& id, shared_ptr<AssetData> const& asset) const {
+  m_assetsCache[id] = asset;
+
+  auto& shard = loadedAssetShard(id);
+  MutexLocker shardLocker(shard.mutex);
+  if (asset)
+    shard.assets[id] = asset;
+  else
+    shard.assets.remove(id);
+}
+
+void Assets::unpublishLoadedAsset(AssetId const& id) const {
+  auto& shard = loadedAssetShard(id);
+  MutexLocker shardLocker(shard.mutex);
+  shard.assets.remove(id);
+}
+
+void Assets::clearCachedAssets() const {
+  m_assetsCache.clear();
+  for (auto& shard : m_loadedAssets) {
+    MutexLocker shardLocker(shard.mutex);
+    shard.assets.clear();
+  }
+}
+
+Assets::LoadedAssetShard& Assets::loadedAssetShard(AssetId const& id) const {
+  // The shard maps hash with the same function, so pick the shard from the
+  // high bits of a remixed hash to keep each shard's own buckets well spread.
+  uint64_t hash = (uint64_t)AssetIdHash()(id) * 0x9E3779B97F4A7C15ull;
+  return m_loadedAssets[(hash >> 32) % LoadedAssetShardCount];
 }
 
 } // namespace Star
@@ -17,6 +17,7 @@ STAR_CLASS(Audio);
 STAR_CLASS(Image);
 STAR_STRUCT(FramesSpecification);
 STAR_CLASS(Assets);
+STAR_CLASS(AssetPatchCache);
 STAR_CLASS(LuaContext);
 
 STAR_EXCEPTION(AssetException, StarException);
@@ -44,15 +45,16 @@ struct FramesSpecification {
 // Assets is thread safe and performs TTL caching.
 class Assets {
 public:
+  // Defaults match the base assets settings the root loader starts from.
   struct Settings {
     // TTL for cached assets
-    float assetTimeToLive;
+    float assetTimeToLive = 30;
 
     // Audio under this length will be automatically decompressed
-    float audioDecompressLimit;
+    float audioDecompressLimit = 4.0f;
 
     // Number of background worker threads
-    unsigned workerPoolSize;
+    unsigned workerPoolSize = 2;
 
     // If given, if an image is unable to load, will log the error and load
     // this path instead
@@ -70,10 +72,18 @@ public:
     StringList digestIgnore;
 
     // FezzedOne: The Lua garbage collector pause value.
-    float luaGcPause;
+    float luaGcPause = 1.2f;
 
     // FezzedOne: The Lua garbage collector step multiplier value.
-    float luaGcStepMultiplier;
+    float luaGcStepMultiplier = 2.0f;
+
+    // If given, fully patched JSON assets are cached in this file between
+    // runs.
+    Maybe<String> patchCacheFile;
+
+    // Build every patched JSON asset on the worker threads before the
+    // constructor returns, rather than on first use, and keep them loaded.
+    bool preloadPatchedJson = false;
   };
 
   enum class AssetType {
@@ -111,9 +121,11 @@ public:
     // the cache.
     virtual bool shouldPersist() const = 0;
 
-    double time = 0.0;
+    // Last access time and persistence override are touched by readers
+    // without the assets mutex held, so are only ever accessed relaxed.
+    atomic<double> time{0.0};
     bool needsPostProcessing = false;
-    bool overridePersistence = false;
+    atomic<bool> overridePersistence{false};
   };
 
   struct JsonData : AssetData {
@@ -282,6 +294,11 @@ private: // FezzedOne: These all should be private!
   shared_ptr<AssetData> tryAsset(AssetId const& id, bool forcePersistence = false) const;
   shared_ptr<AssetData> getAsset(AssetId const& id, bool forcePersistence = false) const;
 
+  // Looks up an already loaded asset without taking the assets mutex, and
+  // freshens it.  Returns null if the asset is not loaded, is still loading,
+  // or failed to load.
+  shared_ptr<AssetData> loadedAsset(AssetId const& id, bool forcePersistence) const;
+
   void workerMain();
 
   // All methods below assume that the asset mutex is locked when calling.
@@ -303,6 +320,9 @@ private: // FezzedOne: These all should be private!
   Json checkPatchArray(String const& path, AssetSourcePtr const& source, Json const result, JsonArray const patchData) const;
 
   Json readJson(String const& basePath) const;
+  // Whether the given asset has patches, none of them scripts, and so has its
+  // patched JSON kept in the patch cache.
+  bool patchCacheable(String const& path) const;
 
   // Load / post process an asset and log any exception.  Returns true if the
   // work was performed (whether successful or not), false if the work is
@@ -325,6 +345,14 @@ private: // FezzedOne: These all should be private!
 
   shared_ptr<AssetData> postProcessAudio(shared_ptr<AssetData> const& original) const;
 
+  // Sets an entry in m_assetsCache and publishes it to the loaded asset
+  // shards, or withdraws it from them if the asset failed to load.
+  void setCachedAsset(AssetId const& id, shared_ptr<AssetData> const& asset) const;
+  // Withdraws an asset from the loaded asset shards only, for callers that
+  // remove it from m_assetsCache themselves.
+  void unpublishLoadedAsset(AssetId const& id) const;
+  void clearCachedAssets() const;
+
   // Updates time on the given asset (with smearing).
   void freshen(shared_ptr<AssetData> const& asset) const;
 
@@ -338,6 +366,23 @@ private: // FezzedOne: These all should be private!
   mutable ConditionVariable m_assetsDone;
   mutable HashMap<AssetId, shared_ptr<AssetData>, AssetIdHash> m_assetsCache;
 
+  // Every successfully loaded asset in m_assetsCache, split by hash across
+  // shards that each have their own short lived lock, so that lookups of
+  // loaded assets never wait on m_assetsMutex and rarely on each other.  Only
+  // modified with m_assetsMutex held.
+  struct LoadedAssetShard {
+    mutable Mutex mutex;
+    HashMap<AssetId, shared_ptr<AssetData>, AssetIdHash> assets;
+  };
+  static size_t const LoadedAssetShardCount = 32;
+  LoadedAssetShard& loadedAssetShard(AssetId const& id) const;
+  mutable LoadedAssetShard m_loadedAssets[LoadedAssetShardCount];
+
+  // Time spent applying the patches from each asset source, for the boot
+  // report.
+  mutable Mutex m_patchTimesMutex;
+  mutable HashMap<AssetSource const*, double> m_patchTimes;
+
   mutable StringMap<String> m_bestFramesFiles;
   mutable StringMap<FramesSpecificationConstPtr> m_framesSpecifications;
 
@@ -360,6 +405,8 @@ private: // FezzedOne: These all should be private!
 
   ByteArray m_digest;
 
+  AssetPatchCachePtr m_patchCache;
+
   List<ThreadFunction<void>> m_workerThreads;
   atomic<bool> m_stopThreads;
 };
@@ -2,7 +2,8 @@
 #define STAR_CELLULAR_LIGHT_ARRAY_HPP
 
 #include "StarList.hpp"
-#include "StarVector.hpp"
+#include "StarRect.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -60,6 +61,12 @@ public:
   void setParameters(unsigned spreadPasses, float spreadMaxAir, float spreadMaxObstacle,
       float pointMaxAir, float pointMaxObstacle, float pointObstacleBoost);
 
+  // Split the spread and point lighting calculations into tiles of the given
+  // size and run them on the given pool.  Tiles are scheduled in dependency
+  // order, so the result is identical to the serial calculation.  A null pool
+  // turns this off.  The pool must outlive any calls to calculate().
+  void setParallel(WorkerPool* pool, size_t tileSize);
+
   // The border around the target lighting array where initial lighting / light
   // source data is required.  Based on parameters.
   size_t borderCells() const;
@@ -98,14 +105,44 @@ public:
   // are not inclusive, the range is [xMin, xMax) and [yMin, yMax).
   void calculate(size_t xMin, size_t yMin, size_t xMax, size_t yMax);
 
+  // Like calculate(), but reuses the results of the previous call to
+  // calculateIncremental() wherever nothing that could affect them has
+  // changed.  previousOrigin is where index (0, 0) of the previous call lies
+  // in the current index space, and changedRegions are where light sources
+  // were added, removed or changed since then.  Changed cells are found by
+  // comparing against the cells of the previous call.  Everything within
+  // borderCells() of a change is recalculated, and if too much has changed
+  // this is the same as calculate().
+  void calculateIncremental(size_t xMin, size_t yMin, size_t xMax, size_t yMax,
+      Vec2I const& previousOrigin, List<RectI> const& changedRegions);
+
+  // Drops the results kept for calculateIncremental().
+  void clearPreviousResults();
+
 private:
   // Set 4 points based on interpolated light position and free space
   // attenuation.
   void setSpreadLightingPoints();
 
+  // Spread and point lighting for the given sub-rect, once the spread light
+  // points are set.
+  void calculateRegion(size_t xMin, size_t yMin, size_t xMax, size_t yMax);
+
   // Spreads light out in an octagonal based cellular automata
   void calculateLightSpread(size_t xmin, size_t ymin, size_t xmax, size_t ymax);
 
+  // One pass of the spread in each direction over part of a single column,
+  // the cells in [yMin, yMax) spread light into their neighbours.
+  void spreadForward(size_t x, size_t yMin, size_t yMax);
+  void spreadBackward(size_t x, size_t yMin, size_t yMax);
+
+  // Runs spread passes over the given range in tiles on the worker pool.
+  void calculateLightSpreadParallel(size_t xMin, size_t yMin, size_t xMax, size_t yMax);
+
+  // Runs the given jobs on the worker pool and the calling thread, and waits
+  // for all of them to finish.
+  void runParallel(List<function<void()>> const& jobs);
+
   // Loops through each light and adds light strength based on distance and
   // obstacle attenuation.  Calculates within the given sub-rect
   void calculatePointLighting(size_t xmin, size_t ymin, size_t xmax, size_t ymax);
@@ -127,6 +164,16 @@ private:
   float m_pointMaxAir;
   float m_pointMaxObstacle;
   float m_pointObstacleBoost;
+
+  WorkerPool* m_workerPool = nullptr;
+  size_t m_tileSize = 0;
+
+  // Input cells and results of the last calculateIncremental() call.
+  bool m_hasPrevious = false;
+  Vec2I m_previousSize;
+  RectI m_previousRegion;
+  List<Cell> m_previousCells;
+  List<LightValue> m_previousLights;
 };
 
 typedef CellularLightArray<ColoredLightTraits> ColoredCellularLightArray;
@@ -201,6 +248,13 @@ void CellularLightArray<LightTraits>::setParameters(unsigned spreadPasses, float
   m_pointMaxAir = pointMaxAir;
   m_pointMaxObstacle = pointMaxObstacle;
   m_pointObstacleBoost = pointObstacleBoost;
+  clearPreviousResults();
+}
+
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::setParallel(WorkerPool* pool, size_t tileSize) {
+  m_workerPool = pool;
+  m_tileSize = max<size_t>(tileSize, 1);
 }
 
 template <typename LightTraits>
@@ -291,8 +345,152 @@ auto CellularLightArray<LightTraits>::cellAtIndex(size_t index) -> Cell & {
 template <typename LightTraits>
 void CellularLightArray<LightTraits>::calculate(size_t xMin, size_t yMin, size_t xMax, size_t yMax) {
   setSpreadLightingPoints();
+  calculateRegion(xMin, yMin, xMax, yMax);
+}
+
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::calculateIncremental(size_t xMin, size_t yMin, size_t xMax, size_t yMax,
+    Vec2I const& previousOrigin, List<RectI> const& changedRegions) {
+  // Changed cells are tracked in square chunks this many cells wide.
+  int const ChunkSize = 16;
+
+  RectI region(xMin, yMin, xMax, yMax);
+  List<Cell> cells(m_cells.get(), m_cells.get() + m_width * m_height);
+  int border = borderCells();
+
+  bool full = !m_hasPrevious;
+  List<RectI> dirtyRegions;
+  if (!full) {
+    RectI previousArray = RectI::withSize(previousOrigin, m_previousSize);
+    RectI previousRegion = m_previousRegion.translated(previousOrigin);
+
+    // Results outside of the previous region are always calculated.
+    dirtyRegions.append(RectI(region.xMin(), region.yMin(), min(region.xMax(), previousRegion.xMin()), region.yMax()));
+    dirtyRegions.append(RectI(max(region.xMin(), previousRegion.xMax()), region.yMin(), region.xMax(), region.yMax()));
+    dirtyRegions.append(RectI(region.xMin(), region.yMin(), region.xMax(), min(region.yMax(), previousRegion.yMin())));
+    dirtyRegions.append(RectI(region.xMin(), max(region.yMin(), previousRegion.yMax()), region.xMax(), region.yMax()));
+
+    Vec2I chunkCount((m_width + ChunkSize - 1) / ChunkSize, (m_height + ChunkSize - 1) / ChunkSize);
+    List<bool> dirtyChunks(chunkCount[0] * chunkCount[1], false);
+    for (size_t x = 0; x < m_width; ++x) {
+      for (size_t y = 0; y < m_height; ++y) {
+        size_t chunkIndex = x / ChunkSize * chunkCount[1] + y / ChunkSize;
+        if (dirtyChunks[chunkIndex])
+          continue;
+
+        Vec2I previous = Vec2I(x, y) - previousOrigin;
+        if (!previousArray.belongs(Vec2I(x, y))) {
+          dirtyChunks[chunkIndex] = true;
+        } else {
+          Cell const& cell = cells[x * m_height + y];
+          Cell const& previousCell = m_previousCells[previous[0] * m_previousSize[1] + previous[1]];
+          dirtyChunks[chunkIndex] = cell.obstacle != previousCell.obstacle || cell.light != previousCell.light;
+        }
+      }
+    }
+
+    RectI arrayRegion(0, 0, m_width, m_height);
+    for (auto const& changed : changedRegions) {
+      RectI chunkRegion = changed.overlap(arrayRegion);
+      for (int x = chunkRegion.xMin() / ChunkSize; x * ChunkSize < chunkRegion.xMax(); ++x) {
+        for (int y = chunkRegion.yMin() / ChunkSize; y * ChunkSize < chunkRegion.yMax(); ++y)
+          dirtyChunks[x * chunkCount[1] + y] = true;
+      }
+    }
+
+    // Anything within the border of a changed chunk may have changed.
+    for (int x = 0; x < chunkCount[0]; ++x) {
+      for (int y = 0; y < chunkCount[1]; ++y) {
+        if (dirtyChunks[x * chunkCount[1] + y])
+          dirtyRegions.append(RectI::withSize(Vec2I(x, y) * ChunkSize, Vec2I::filled(ChunkSize)).padded(border));
+      }
+    }
+
+    for (auto& dirtyRegion : dirtyRegions)
+      dirtyRegion = dirtyRegion.overlap(region);
+    dirtyRegions.filter([](RectI const& dirtyRegion) { return !dirtyRegion.isEmpty(); });
+
+    // Each region is calculated on its own, so any regions that would read
+    // cells the other one writes to are merged.
+    for (size_t i = 0; i < dirtyRegions.size();) {
+      bool merged = false;
+      for (size_t j = i + 1; j < dirtyRegions.size(); ++j) {
+        if (dirtyRegions[i].padded(2 * border).intersects(dirtyRegions[j], false)) {
+          dirtyRegions[i].combine(dirtyRegions[j]);
+          dirtyRegions.eraseAt(j);
+          merged = true;
+          break;
+        }
+      }
+      if (merged)
+        i = 0;
+      else
+        ++i;
+    }
+
+    size_t dirtyVolume = 0;
+    for (auto const& dirtyRegion : dirtyRegions)
+      dirtyVolume += dirtyRegion.padded(border).overlap(arrayRegion).volume();
+    full = dirtyVolume * 2 > m_width * m_height;
+  }
+
+  if (full) {
+    calculate(xMin, yMin, xMax, yMax);
+  } else {
+    List<bool> reused(region.volume(), true);
+    setSpreadLightingPoints();
+    for (auto const& dirtyRegion : dirtyRegions) {
+      calculateRegion(dirtyRegion.xMin(), dirtyRegion.yMin(), dirtyRegion.xMax(), dirtyRegion.yMax());
+      for (int x = dirtyRegion.xMin(); x < dirtyRegion.xMax(); ++x) {
+        for (int y = dirtyRegion.yMin(); y < dirtyRegion.yMax(); ++y)
+          reused[(x - region.xMin()) * region.height() + y - region.yMin()] = false;
+      }
+    }
+
+    for (int x = region.xMin(); x < region.xMax(); ++x) {
+      for (int y = region.yMin(); y < region.yMax(); ++y) {
+        if (reused[(x - region.xMin()) * region.height() + y - region.yMin()]) {
+          Vec2I previous = Vec2I(x, y) - previousOrigin - m_previousRegion.min();
+          setLight(x, y, m_previousLights[previous[0] * m_previousRegion.height() + previous[1]]);
+        }
+      }
+    }
+  }
+
+  m_previousLights.resize(region.volume());
+  for (int x = region.xMin(); x < region.xMax(); ++x) {
+    for (int y = region.yMin(); y < region.yMax(); ++y)
+      m_previousLights[(x - region.xMin()) * region.height() + y - region.yMin()] = getLight(x, y);
+  }
+  m_previousCells = std::move(cells);
+  m_previousSize = Vec2I(m_width, m_height);
+  m_previousRegion = region;
+  m_hasPrevious = true;
+}
+
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::clearPreviousResults() {
+  m_hasPrevious = false;
+  m_previousCells.clear();
+  m_previousLights.clear();
+}
+
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::calculateRegion(size_t xMin, size_t yMin, size_t xMax, size_t yMax) {
   calculateLightSpread(xMin, yMin, xMax, yMax);
-  calculatePointLighting(xMin, yMin, xMax, yMax);
+
+  if (m_workerPool && xMax - xMin > m_tileSize) {
+    // Each cell only sees the lights in the same order as it would serially,
+    // so columns can be split up freely.
+    List<function<void()>> jobs;
+    for (size_t x = xMin; x < xMax; x += m_tileSize) {
+      size_t stripMax = min(x + m_tileSize, xMax);
+      jobs.append([=]() { calculatePointLighting(x, yMin, stripMax, yMax); });
+    }
+    runParallel(jobs);
+  } else {
+    calculatePointLighting(xMin, yMin, xMax, yMax);
+  }
 }
 
 template <typename LightTraits>
@@ -337,64 +535,167 @@ template <typename LightTraits>
 void CellularLightArray<LightTraits>::calculateLightSpread(size_t xMin, size_t yMin, size_t xMax, size_t yMax) {
   starAssert(m_width > 0 && m_height > 0);
 
-  float dropoffAir = 1.0f / m_spreadMaxAir;
-  float dropoffObstacle = 1.0f / m_spreadMaxObstacle;
-  float dropoffAirDiag = 1.0f / m_spreadMaxAir * Constants::sqrt2;
-  float dropoffObstacleDiag = 1.0f / m_spreadMaxObstacle * Constants::sqrt2;
-
   // enlarge x/y min/max taking into ambient spread of light
   xMin = xMin - min(xMin, (size_t)ceil(m_spreadMaxAir));
   yMin = yMin - min(yMin, (size_t)ceil(m_spreadMaxAir));
   xMax = min(m_width, xMax + (size_t)ceil(m_spreadMaxAir));
   yMax = min(m_height, yMax + (size_t)ceil(m_spreadMaxAir));
 
+  if (xMax - xMin < 3 || yMax - yMin < 3)
+    return;
+
+  if (m_workerPool && (xMax - xMin > 2 * m_tileSize || yMax - yMin > 2 * m_tileSize)) {
+    calculateLightSpreadParallel(xMin + 1, yMin + 1, xMax - 1, yMax - 1);
+    return;
+  }
+
   for (unsigned p = 0; p < m_spreadPasses; ++p) {
-    // Spread right and up and diag up right / diag down right
-    for (size_t x = xMin + 1; x < xMax - 1; ++x) {
-      size_t xCellOffset = x * m_height;
-      size_t xRightCellOffset = (x + 1) * m_height;
-
-      for (size_t y = yMin + 1; y < yMax - 1; ++y) {
-        auto cell = cellAtIndex(xCellOffset + y);
-        auto& cellRight = cellAtIndex(xRightCellOffset + y);
-        auto& cellUp = cellAtIndex(xCellOffset + y + 1);
-        auto& cellRightUp = cellAtIndex(xRightCellOffset + y + 1);
-        auto& cellRightDown = cellAtIndex(xRightCellOffset + y - 1);
-
-        float straightDropoff = cell.obstacle ? dropoffObstacle : dropoffAir;
-        float diagDropoff = cell.obstacle ? dropoffObstacleDiag : dropoffAirDiag;
-
-        cellRight.light = LightTraits::spread(cell.light, cellRight.light, straightDropoff);
-        cellUp.light = LightTraits::spread(cell.light, cellUp.light, straightDropoff);
-
-        cellRightUp.light = LightTraits::spread(cell.light, cellRightUp.light, diagDropoff);
-        cellRightDown.light = LightTraits::spread(cell.light, cellRightDown.light, diagDropoff);
-      }
-    }
+    for (size_t x = xMin + 1; x < xMax - 1; ++x)
+      spreadForward(x, yMin + 1, yMax - 1);
+    for (size_t x = xMax - 2; x > xMin; --x)
+      spreadBackward(x, yMin + 1, yMax - 1);
+  }
+}
+
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::spreadForward(size_t x, size_t yMin, size_t yMax) {
+  float dropoffAir = 1.0f / m_spreadMaxAir;
+  float dropoffObstacle = 1.0f / m_spreadMaxObstacle;
+  float dropoffAirDiag = 1.0f / m_spreadMaxAir * Constants::sqrt2;
+  float dropoffObstacleDiag = 1.0f / m_spreadMaxObstacle * Constants::sqrt2;
+
+  // Spread right and up and diag up right / diag down right
+  size_t xCellOffset = x * m_height;
+  size_t xRightCellOffset = (x + 1) * m_height;
+
+  for (size_t y = yMin; y < yMax; ++y) {
+    auto cell = cellAtIndex(xCellOffset + y);
+    auto& cellRight = cellAtIndex(xRightCellOffset + y);
+    auto& cellUp = cellAtIndex(xCellOffset + y + 1);
+    auto& cellRightUp = cellAtIndex(xRightCellOffset + y + 1);
+    auto& cellRightDown = cellAtIndex(xRightCellOffset + y - 1);
+
+    float straightDropoff = cell.obstacle ? dropoffObstacle : dropoffAir;
+    float diagDropoff = cell.obstacle ? dropoffObstacleDiag : dropoffAirDiag;
+
+    cellRight.light = LightTraits::spread(cell.light, cellRight.light, straightDropoff);
+    cellUp.light = LightTraits::spread(cell.light, cellUp.light, straightDropoff);
+
+    cellRightUp.light = LightTraits::spread(cell.light, cellRightUp.light, diagDropoff);
+    cellRightDown.light = LightTraits::spread(cell.light, cellRightDown.light, diagDropoff);
+  }
+}
 
-    // Spread left and down and diag up left / diag down left
-    for (size_t x = xMax - 2; x > xMin; --x) {
-      size_t xCellOffset = x * m_height;
-      size_t xLeftCellOffset = (x - 1) * m_height;
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::spreadBackward(size_t x, size_t yMin, size_t yMax) {
+  float dropoffAir = 1.0f / m_spreadMaxAir;
+  float dropoffObstacle = 1.0f / m_spreadMaxObstacle;
+  float dropoffAirDiag = 1.0f / m_spreadMaxAir * Constants::sqrt2;
+  float dropoffObstacleDiag = 1.0f / m_spreadMaxObstacle * Constants::sqrt2;
 
-      for (size_t y = yMax - 2; y > yMin; --y) {
-        auto cell = cellAtIndex(xCellOffset + y);
-        auto& cellLeft = cellAtIndex(xLeftCellOffset + y);
-        auto& cellDown = cellAtIndex(xCellOffset + y - 1);
-        auto& cellLeftUp = cellAtIndex(xLeftCellOffset + y + 1);
-        auto& cellLeftDown = cellAtIndex(xLeftCellOffset + y - 1);
+  // Spread left and down and diag up left / diag down left
+  size_t xCellOffset = x * m_height;
+  size_t xLeftCellOffset = (x - 1) * m_height;
 
-        float straightDropoff = cell.obstacle ? dropoffObstacle : dropoffAir;
-        float diagDropoff = cell.obstacle ? dropoffObstacleDiag : dropoffAirDiag;
+  for (size_t y = yMax; y-- > yMin;) {
+    auto cell = cellAtIndex(xCellOffset + y);
+    auto& cellLeft = cellAtIndex(xLeftCellOffset + y);
+    auto& cellDown = cellAtIndex(xCellOffset + y - 1);
+    auto& cellLeftUp = cellAtIndex(xLeftCellOffset + y + 1);
+    auto& cellLeftDown = cellAtIndex(xLeftCellOffset + y - 1);
 
-        cellLeft.light = LightTraits::spread(cell.light, cellLeft.light, straightDropoff);
-        cellDown.light = LightTraits::spread(cell.light, cellDown.light, straightDropoff);
+    float straightDropoff = cell.obstacle ? dropoffObstacle : dropoffAir;
+    float diagDropoff = cell.obstacle ? dropoffObstacleDiag : dropoffAirDiag;
 
-        cellLeftUp.light = LightTraits::spread(cell.light, cellLeftUp.light, diagDropoff);
-        cellLeftDown.light = LightTraits::spread(cell.light, cellLeftDown.light, diagDropoff);
+    cellLeft.light = LightTraits::spread(cell.light, cellLeft.light, straightDropoff);
+    cellDown.light = LightTraits::spread(cell.light, cellDown.light, straightDropoff);
+
+    cellLeftUp.light = LightTraits::spread(cell.light, cellLeftUp.light, diagDropoff);
+    cellLeftDown.light = LightTraits::spread(cell.light, cellLeftDown.light, diagDropoff);
+  }
+}
+
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::calculateLightSpreadParallel(size_t xMin, size_t yMin, size_t xMax, size_t yMax) {
+  // In a forward pass a cell takes light from its left, lower, lower left and
+  // upper left neighbours, always by taking the max, so it comes out the same
+  // as long as all of those are final before the cell itself is visited (and
+  // the mirror of this holds for backward passes).  The upper left neighbour
+  // rules out plain rectangular tiles, so tiles are instead cut along x and
+  // along x + y, which makes every neighbour a cell gets light from lie in the
+  // same tile, or the tile before it on either axis.  Tile (x, v) then runs in
+  // wave 2 * x + v, which also keeps tiles of the same wave from ever writing
+  // to the same cell.
+  size_t vMin = xMin + yMin;
+  size_t vMax = xMax + yMax - 1;
+  size_t tilesWide = (xMax - xMin + m_tileSize - 1) / m_tileSize;
+  size_t tilesHigh = (vMax - vMin + m_tileSize - 1) / m_tileSize;
+  size_t waveCount = 2 * (tilesWide - 1) + tilesHigh;
+
+  auto runWaves = [&](bool forward) {
+    for (size_t wave = 0; wave < waveCount; ++wave) {
+      List<function<void()>> jobs;
+      for (size_t tx = 0; tx < tilesWide && 2 * tx <= wave; ++tx) {
+        size_t tv = wave - 2 * tx;
+        if (tv >= tilesHigh)
+          continue;
+
+        // Backward passes start from the top right tile.
+        size_t tileX = forward ? tx : tilesWide - 1 - tx;
+        size_t tileV = forward ? tv : tilesHigh - 1 - tv;
+        size_t x0 = xMin + tileX * m_tileSize;
+        size_t x1 = min(x0 + m_tileSize, xMax);
+        size_t v0 = vMin + tileV * m_tileSize;
+        size_t v1 = v0 + m_tileSize;
+        // Tiles in the corners of the region may be empty.
+        if (v0 >= x1 - 1 + yMax || v1 <= x0 + yMin)
+          continue;
+
+        jobs.append([=]() {
+            if (forward) {
+              for (size_t x = x0; x < x1; ++x)
+                spreadForward(x, max(yMin, v0 - min(v0, x)), min(yMax, v1 - min(v1, x)));
+            } else {
+              for (size_t x = x1; x-- > x0;)
+                spreadBackward(x, max(yMin, v0 - min(v0, x)), min(yMax, v1 - min(v1, x)));
+            }
+          });
       }
+      runParallel(jobs);
+    }
+  };
+
+  for (unsigned p = 0; p < m_spreadPasses; ++p) {
+    runWaves(true);
+    runWaves(false);
+  }
+}
+
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::runParallel(List<function<void()>> const& jobs) {
+  if (jobs.empty())
+    return;
+
+  List<WorkerPoolHandle> handles;
+  for (size_t i = 1; i < jobs.size(); ++i)
+    handles.append(m_workerPool->addWork(jobs[i]));
+
+  std::exception_ptr exception;
+  try {
+    jobs[0]();
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  for (auto const& handle : handles) {
+    try {
+      handle.finish();
+    } catch (...) {
+      if (!exception)
+        exception = std::current_exception();
     }
   }
+  if (exception)
+    std::rethrow_exception(exception);
 }
 
 template <typename LightTraits>
@@ -9,7 +9,7 @@
 
 namespace Star {
 
-CellularLightingCalculator::CellularLightingCalculator(bool monochrome) {
+CellularLightingCalculator::CellularLightingCalculator(bool monochrome) : m_incremental(false) {
   setMonochrome(monochrome);
 }
 
@@ -29,6 +29,21 @@ void CellularLightingCalculator::setMonochrome(bool monochrome) {
 
 void CellularLightingCalculator::setParameters(Json const& config) {
   m_config = config;
+
+  auto parallelConfig = config.get("parallel", JsonObject());
+  if (parallelConfig.getBool("enabled", false)) {
+    unsigned threadCount = parallelConfig.getUInt("threads", 2);
+    if (!m_workerPool)
+      m_workerPool = make_unique<WorkerPool>("CellularLightingCalculator", threadCount);
+    else if (m_workerPool->getWorkerCount() != threadCount)
+      m_workerPool->start(threadCount);
+  } else {
+    m_workerPool.reset();
+  }
+  size_t tileSize = parallelConfig.getUInt("tileSize", 64);
+  m_incremental = config.getBool("incremental", false);
+  m_previousLights.clear();
+
   if (m_monochrome)
     m_lightArray.right().setParameters(
         config.getInt("spreadPasses"),
@@ -47,10 +62,16 @@ void CellularLightingCalculator::setParameters(Json const& config) {
         config.getFloat("pointMaxObstacle"),
         config.getFloat("pointObstacleBoost")
       );
+
+  if (m_monochrome)
+    m_lightArray.right().setParallel(m_workerPool.get(), tileSize);
+  else
+    m_lightArray.left().setParallel(m_workerPool.get(), tileSize);
 }
 
 void CellularLightingCalculator::begin(RectI const& queryRegion) {
   m_queryRegion = queryRegion;
+  m_lights.clear();
   if (m_monochrome) {
     m_calculationRegion = RectI(queryRegion).padded((int)m_lightArray.right().borderCells());
     m_lightArray.right().begin(m_calculationRegion.width(), m_calculationRegion.height());
@@ -65,6 +86,9 @@ RectI CellularLightingCalculator::calculationRegion() const {
 }
 
 void CellularLightingCalculator::addSpreadLight(Vec2F const& position, Vec3F const& light) {
+  if (m_incremental)
+    m_lights.append(Light{position, light, false, 0.0f, 0.0f, 0.0f});
+
   Vec2F arrayPosition = position - Vec2F(m_calculationRegion.min());
   if (m_monochrome)
     m_lightArray.right().addSpreadLight({arrayPosition, light.max()});
@@ -73,6 +97,9 @@ void CellularLightingCalculator::addSpreadLight(Vec2F const& position, Vec3F con
 }
 
 void CellularLightingCalculator::addPointLight(Vec2F const& position, Vec3F const& light, float beam, float beamAngle, float beamAmbience) {
+  if (m_incremental)
+    m_lights.append(Light{position, light, true, beam, beamAngle, beamAmbience});
+
   Vec2F arrayPosition = position - Vec2F(m_calculationRegion.min());
   if (m_monochrome)
     m_lightArray.right().addPointLight({arrayPosition, light.max(), beam, beamAngle, beamAmbience});
@@ -86,10 +113,21 @@ void CellularLightingCalculator::calculate(Image& output) {
   Vec2S arrayMin = Vec2S(m_queryRegion.min() - m_calculationRegion.min());
   Vec2S arrayMax = Vec2S(m_queryRegion.max() - m_calculationRegion.min());
 
-  if (m_monochrome)
+  if (m_incremental) {
+    Vec2I previousOrigin = m_previousCalculationRegion.min() - m_calculationRegion.min();
+    List<RectI> changedRegions = changedLightRegions();
+    if (m_monochrome)
+      m_lightArray.right().calculateIncremental(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1], previousOrigin, changedRegions);
+    else
+      m_lightArray.left().calculateIncremental(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1], previousOrigin, changedRegions);
+
+    m_previousLights = take(m_lights);
+    m_previousCalculationRegion = m_calculationRegion;
+  } else if (m_monochrome) {
     m_lightArray.right().calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
-  else
+  } else {
     m_lightArray.left().calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
+  }
 
   output.reset(arrayMax[0] - arrayMin[0], arrayMax[1] - arrayMin[1], PixelFormat::RGB24);
 
@@ -110,6 +148,46 @@ void CellularLightingCalculator::setupImage(Image& image, PixelFormat format) co
   image.reset(arrayMax[0] - arrayMin[0], arrayMax[1] - arrayMin[1], format);
 }
 
+bool CellularLightingCalculator::Light::operator==(Light const& rhs) const {
+  return tie(position, light, pointLight, beam, beamAngle, beamAmbience)
+      == tie(rhs.position, rhs.light, rhs.pointLight, rhs.beam, rhs.beamAngle, rhs.beamAmbience);
+}
+
+bool CellularLightingCalculator::Light::operator<(Light const& rhs) const {
+  return tie(position, light, pointLight, beam, beamAngle, beamAmbience)
+      < tie(rhs.position, rhs.light, rhs.pointLight, rhs.beam, rhs.beamAngle, rhs.beamAmbience);
+}
+
+List<RectI> CellularLightingCalculator::changedLightRegions() {
+  List<RectI> changedRegions;
+  auto addChanged = [&](Light const& light) {
+    // The cells a light is first applied to, the light array pads this out
+    // to everything the light could reach.
+    Vec2I cell = Vec2I::floor(light.position) - m_calculationRegion.min();
+    changedRegions.append(RectI::withSize(cell - Vec2I(1, 1), Vec2I(3, 3)));
+  };
+
+  // The previous lights were sorted the same way, so one walk over both finds
+  // every light that has appeared or gone away.
+  sort(m_lights);
+  auto previous = m_previousLights.begin();
+  for (auto const& light : m_lights) {
+    while (previous != m_previousLights.end() && *previous < light)
+      addChanged(*previous++);
+    if (previous != m_previousLights.end() && *previous == light)
+      ++previous;
+    else
+      addChanged(light);
+  }
+  for (; previous != m_previousLights.end(); ++previous)
+    addChanged(*previous);
+
+  return changedRegions;
+}
+
+CellularLightIntensityCalculator::CellularLightIntensityCalculator()
+  : m_cacheEnabled(false), m_cacheEnvironmentTolerance(0.0f), m_revision(0) {}
+
 void CellularLightIntensityCalculator::setParameters(Json const& config) {
   m_lightArray.setParameters(
       config.getInt("spreadPasses"),
@@ -119,12 +197,21 @@ void CellularLightIntensityCalculator::setParameters(Json const& config) {
       config.getFloat("pointMaxObstacle"),
       config.getFloat("pointObstacleBoost")
     );
+  clearCache();
+}
+
+void CellularLightIntensityCalculator::setCacheParameters(Json const& config) {
+  m_cacheEnabled = config.getBool("enabled", false);
+  m_cacheEnvironmentTolerance = config.getFloat("environmentTolerance", 0.0f);
+  m_cache.setMaxSize(config.getUInt("maxEntries", 4096));
+  clearCache();
 }
 
 void CellularLightIntensityCalculator::begin(Vec2F const& queryPosition) {
   m_queryPosition = queryPosition;
   m_queryRegion = RectI::withSize(Vec2I::floor(queryPosition - Vec2F::filled(0.5f)), Vec2I(2, 2));
   m_calculationRegion = RectI(m_queryRegion).padded((int)m_lightArray.borderCells());
+  m_lights.clear();
 
   m_lightArray.begin(m_calculationRegion.width(), m_calculationRegion.height());
 }
@@ -146,31 +233,97 @@ void CellularLightIntensityCalculator::setCellColumn(Vec2I const& position, Cell
 void CellularLightIntensityCalculator::addSpreadLight(Vec2F const& position, float light) {
   Vec2F arrayPosition = position - Vec2F(m_calculationRegion.min());
   m_lightArray.addSpreadLight({arrayPosition, light});
+  if (m_cacheEnabled)
+    m_lights.append({position, light, false, 0.0f, 0.0f, 0.0f});
 }
 
 void CellularLightIntensityCalculator::addPointLight(Vec2F const& position, float light, float beam, float beamAngle, float beamAmbience) {
   Vec2F arrayPosition = position - Vec2F(m_calculationRegion.min());
   m_lightArray.addPointLight({arrayPosition, light, beam, beamAngle, beamAmbience});
+  if (m_cacheEnabled)
+    m_lights.append({position, light, true, beam, beamAngle, beamAmbience});
 }
 
+Maybe<float> CellularLightIntensityCalculator::cachedCalculate(float environmentLight) {
+  if (!m_cacheEnabled)
+    return {};
 
-float CellularLightIntensityCalculator::calculate() {
+  auto entry = m_cache.ptr(m_queryRegion.min());
+  if (!entry)
+    return {};
+
+  bool valid = entry->lights == m_lights;
+  if (valid && entry->environmentLight)
+    valid = fabs(*entry->environmentLight - environmentLight) <= m_cacheEnvironmentTolerance;
+
+  RectI chunks = cacheChunks(m_calculationRegion);
+  for (int x = chunks.xMin(); valid && x < chunks.xMax(); ++x) {
+    for (int y = chunks.yMin(); valid && y < chunks.yMax(); ++y)
+      valid = m_chunkRevisions.value(Vec2I(x, y), 0) <= entry->revision;
+  }
+
+  if (!valid) {
+    m_cache.remove(m_queryRegion.min());
+    return {};
+  }
+
+  return interpolate(entry->corners);
+}
+
+float CellularLightIntensityCalculator::calculate(Maybe<float> environmentLight) {
   Vec2S arrayMin = Vec2S(m_queryRegion.min() - m_calculationRegion.min());
   Vec2S arrayMax = Vec2S(m_queryRegion.max() - m_calculationRegion.min());
 
   m_lightArray.calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
 
-  // Do 2d lerp to find lighting intensity
+  Array<float, 4> corners = {
+    m_lightArray.getLight(arrayMin[0], arrayMin[1]),
+    m_lightArray.getLight(arrayMin[0] + 1, arrayMin[1]),
+    m_lightArray.getLight(arrayMin[0], arrayMin[1] + 1),
+    m_lightArray.getLight(arrayMin[0] + 1, arrayMin[1] + 1)
+  };
 
-  float ll = m_lightArray.getLight(arrayMin[0], arrayMin[1]);
-  float lr = m_lightArray.getLight(arrayMin[0] + 1, arrayMin[1]);
-  float ul = m_lightArray.getLight(arrayMin[0], arrayMin[1] + 1);
-  float ur = m_lightArray.getLight(arrayMin[0] + 1, arrayMin[1] + 1);
+  if (m_cacheEnabled)
+    m_cache.set(m_queryRegion.min(), CacheEntry{m_revision, std::move(m_lights), environmentLight, corners});
 
+  return interpolate(corners);
+}
+
+void CellularLightIntensityCalculator::invalidate(RectI const& region) {
+  if (!m_cacheEnabled || region.isEmpty())
+    return;
+
+  ++m_revision;
+  RectI chunks = cacheChunks(region);
+  for (int x = chunks.xMin(); x < chunks.xMax(); ++x) {
+    for (int y = chunks.yMin(); y < chunks.yMax(); ++y)
+      m_chunkRevisions[Vec2I(x, y)] = m_revision;
+  }
+}
+
+void CellularLightIntensityCalculator::clearCache() {
+  m_cache.clear();
+  m_chunkRevisions.clear();
+  m_revision = 0;
+}
+
+bool CellularLightIntensityCalculator::CachedLight::operator==(CachedLight const& rhs) const {
+  return tie(position, light, pointLight, beam, beamAngle, beamAmbience)
+      == tie(rhs.position, rhs.light, rhs.pointLight, rhs.beam, rhs.beamAngle, rhs.beamAmbience);
+}
+
+RectI CellularLightIntensityCalculator::cacheChunks(RectI const& region) {
+  Vec2I min = Vec2I::floor(Vec2F(region.min()) / CacheChunkSize);
+  Vec2I max = Vec2I::floor(Vec2F(region.max() - Vec2I(1, 1)) / CacheChunkSize);
+  return RectI(min, max + Vec2I(1, 1));
+}
+
+float CellularLightIntensityCalculator::interpolate(Array<float, 4> const& corners) const {
+  // Do 2d lerp to find lighting intensity
   float xl = m_queryPosition[0] - 0.5f - m_queryRegion.xMin();
   float yl = m_queryPosition[1] - 0.5f - m_queryRegion.yMin();
 
-  return lerp(yl, lerp(xl, ll, lr), lerp(xl, ul, ur));
+  return lerp(yl, lerp(xl, corners[0], corners[1]), lerp(xl, corners[2], corners[3]));
 }
 
 }
@@ -8,6 +8,7 @@
 #include "StarColor.hpp"
 #include "StarInterpolation.hpp"
 #include "StarCellularLightArray.hpp"
+#include "StarLruCache.hpp"
 #include "StarThread.hpp"
 
 namespace Star {
@@ -23,6 +24,10 @@ public:
 
   void setMonochrome(bool monochrome);
 
+  // Besides the light array parameters, reads an optional "parallel" object
+  // which, if enabled, calculates the light array in tiles on a worker pool,
+  // and an "incremental" flag which reuses the results of the previous
+  // calculation where no cells or lights nearby have changed.
   void setParameters(Json const& config);
 
   // Call 'begin' to start a calculation for the given region
@@ -48,22 +53,58 @@ public:
 
   void setupImage(Image& image, PixelFormat format = PixelFormat::RGB24) const;
 private:
+  struct Light {
+    bool operator==(Light const& rhs) const;
+    bool operator<(Light const& rhs) const;
+
+    Vec2F position;
+    Vec3F light;
+    bool pointLight;
+    float beam;
+    float beamAngle;
+    float beamAmbience;
+  };
+
+  // Regions of the current light array where lights differ from the previous
+  // calculation.
+  List<RectI> changedLightRegions();
+
   Json m_config;
   bool m_monochrome;
+  bool m_incremental;
+  unique_ptr<WorkerPool> m_workerPool;
   Either<ColoredCellularLightArray, ScalarCellularLightArray> m_lightArray;
   RectI m_queryRegion;
   RectI m_calculationRegion;
+
+  List<Light> m_lights;
+  List<Light> m_previousLights;
+  RectI m_previousCalculationRegion;
 };
 
 // Produce light intensity values using the same algorithm as
 // CellularLightingCalculator.  Only calculates a single point at a time, and
 // uses scalar lights with no color calculation.
+//
+// Can optionally cache the results of recent queries.  A query is served from
+// the cache when it falls between the same four cells as an earlier one, the
+// same lights were added since begin(), and no part of its calculation region
+// has been invalidated since.  Cells lit by the environment keep their cached
+// result while the environment light stays within a configured tolerance, the
+// result can then be off by up to that tolerance.
 class CellularLightIntensityCalculator {
 public:
   typedef ScalarCellularLightArray::Cell Cell;
 
+  CellularLightIntensityCalculator();
+
   void setParameters(Json const& config);
 
+  // Enables the cache if config has "enabled" set, with "maxEntries" cached
+  // queries and the given "environmentTolerance".  Whoever enables it must
+  // call invalidate() for every change to the cells.
+  void setCacheParameters(Json const& config);
+
   void begin(Vec2F const& queryPosition);
 
   RectI calculationRegion() const;
@@ -74,13 +115,58 @@ public:
   void addSpreadLight(Vec2F const& position, float light);
   void addPointLight(Vec2F const& position, float light, float beam, float beamAngle, float beamAmbience);
 
-  float calculate();
+  // Once every light has been added, returns the cached result of an
+  // identical earlier query, if there is one.  The cells do not need to be set
+  // to check.
+  Maybe<float> cachedCalculate(float environmentLight);
+
+  // If the cache is enabled, environmentLight should be the environment light
+  // level that was added to any of the cells, or none if no cell was lit by
+  // the environment.
+  float calculate(Maybe<float> environmentLight = {});
+
+  // Drops cached results that depend on any cell in the given region.
+  void invalidate(RectI const& region);
+  void clearCache();
 
 private:
+  // Cells are invalidated in square chunks of this size.
+  static int const CacheChunkSize = 32;
+
+  struct CachedLight {
+    bool operator==(CachedLight const& rhs) const;
+
+    Vec2F position;
+    float light;
+    bool pointLight;
+    float beam;
+    float beamAngle;
+    float beamAmbience;
+  };
+
+  struct CacheEntry {
+    uint64_t revision;
+    List<CachedLight> lights;
+    Maybe<float> environmentLight;
+    Array<float, 4> corners;
+  };
+
+  // The chunks that any cell in the given region falls in.
+  static RectI cacheChunks(RectI const& region);
+
+  float interpolate(Array<float, 4> const& corners) const;
+
   ScalarCellularLightArray m_lightArray;
   Vec2F m_queryPosition;
   RectI m_queryRegion;;
   RectI m_calculationRegion;
+
+  bool m_cacheEnabled;
+  float m_cacheEnvironmentTolerance;
+  List<CachedLight> m_lights;
+  HashLruCache<Vec2I, CacheEntry> m_cache;
+  HashMap<Vec2I, uint64_t> m_chunkRevisions;
+  uint64_t m_revision;
 };
 
 inline bool CellularLightingCalculator::validIndex(Vec2I const& position) {
@@ -8,6 +8,7 @@
 #include "StarOrderedSet.hpp"
 #include "StarRandom.hpp"
 #include "StarBlockAllocator.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -84,6 +85,17 @@ public:
   List<RectI> noProcessingLimitRegions() const;
   void setNoProcessingLimitRegions(List<RectI> noProcessingLimitRegions);
 
+  // With at least minimumCells cells to update, splits the active cells into
+  // groups that do not reach any of the same cells, batches those into
+  // regions of at least regionCells and updates the regions on the given
+  // pool.  Each region draws from its own random source, seeded from the step
+  // and the region's first cell, and interactions, collisions and newly active
+  // cells are applied afterwards in region order, so the results do not depend
+  // on the number of threads.  The world's
+  // drainLevel is still called from the updating thread.  A null pool turns
+  // this off.  The pool must outlive any calls to update().
+  void setParallel(WorkerPool* pool, size_t minimumCells, size_t regionCells);
+
   void visitLocation(Vec2I const& location);
   void visitRegion(RectI const& region);
 
@@ -101,6 +113,8 @@ private:
     Top
   };
 
+  struct WorkingBlock;
+
   struct WorkingCell {
     Vec2I position;
     Maybe<LiquidId> liquid;
@@ -108,10 +122,53 @@ private:
     float level;
     float pressure;
 
+    WorkingBlock* block;
     WorkingCell* leftCell;
     WorkingCell* rightCell;
     WorkingCell* topCell;
     WorkingCell* bottomCell;
+    // One bit per Adjacency, set once the matching pointer above has been
+    // looked up, as it stays null where there is no liquid cell.
+    uint8_t adjacentLoaded;
+    // Read from the world on first use.
+    Maybe<float> drain;
+    // Set once the cell has been added to the next active cells.
+    bool nextActive;
+    // The active cell this one is grouped with while splitting regions.
+    size_t group;
+  };
+
+  // Working cells are read from the world into dense square blocks, so that
+  // finding a neighbour in the same block is just an index.  Blocks are kept
+  // and reused from one update to the next, but as each one is large the pool
+  // is trimmed back to the most recently used number every so many clears,
+  // so that a single busy update does not keep its blocks around for good.
+  static constexpr int WorkingBlockSize = 32;
+  static constexpr size_t MinimumPooledBlocks = 16;
+  static constexpr unsigned BlockPoolTrimInterval = 120;
+
+  struct WorkingBlock {
+    Vec2I origin;
+    // One bit per cell and one word per column, set for the cells that have
+    // been read from the world, and for those of them that can hold liquid.
+    Array<uint32_t, WorkingBlockSize> loaded;
+    Array<uint32_t, WorkingBlockSize> liquid;
+    // Set once a cell has been added back to m_activeCells, so that repeats
+    // skip the hash set.
+    Array<uint32_t, WorkingBlockSize> active;
+    WorkingCell cells[WorkingBlockSize * WorkingBlockSize];
+  };
+
+  // Active cells that share no working cells with those of any other region,
+  // along with everything their update does outside of the working cells,
+  // which is applied afterwards.
+  struct WorkingRegion {
+    List<WorkingCell*> cells;
+    RandomSource* random;
+    RandomSource regionRandom;
+    List<WorkingCell*> nextActiveCells;
+    List<tuple<Vec2I, LiquidId, Vec2I, LiquidId>> liquidInteractions;
+    List<tuple<Vec2I, LiquidId, Vec2I>> liquidCollisions;
   };
 
   template <typename Key, typename Value>
@@ -124,22 +181,32 @@ private:
   using BAOrderedHashSet = OrderedHashSet<Value, hash<Value>, std::equal_to<Value>, BlockAllocator<Value, 4096>>;
 
   void setup();
-  void applyPressure();
-  void spreadPressure();
-  void limitPressure();
-  void pressureMove();
-  void spreadOverfill();
-  void levelMove();
-  void findInteractions();
+  void splitRegions();
+  void updateRegion(WorkingRegion& region);
+  void applyPressure(WorkingRegion& region);
+  void spreadPressure(WorkingRegion& region);
+  void limitPressure(WorkingRegion& region);
+  void pressureMove(WorkingRegion& region);
+  void spreadOverfill(WorkingRegion& region);
+  void levelMove(WorkingRegion& region);
+  void findInteractions(WorkingRegion& region);
+  void mergeRegion(WorkingRegion& region);
   void finish();
 
+  WorkingRegion& addRegion();
+
   WorkingCell* workingCell(Vec2I p);
+  // Position must already be unique and within the given block.
+  WorkingCell* blockCell(WorkingBlock& block, Vec2I const& p);
   WorkingCell* adjacentCell(WorkingCell* cell, Adjacency adjacency);
+  float drainLevel(WorkingCell& cell);
+  void clearWorkingCells();
 
-  void setPressure(float pressure, WorkingCell& cell);
-  void transferPressure(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse);
-  void transferLevel(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse);
-  void setLevel(float level, WorkingCell& cell);
+  void setNextActive(WorkingRegion& region, WorkingCell& cell);
+  void setPressure(WorkingRegion& region, float pressure, WorkingCell& cell);
+  void transferPressure(WorkingRegion& region, float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse);
+  void transferLevel(WorkingRegion& region, float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse);
+  void setLevel(WorkingRegion& region, float level, WorkingCell& cell);
 
   RandomSource m_random;
   LiquidCellEngineParameters m_engineParameters;
@@ -151,7 +218,26 @@ private:
   List<RectI> m_noProcessingLimitRegions;
   uint64_t m_step;
 
-  BAHashMap<Vec2I, Maybe<WorkingCell>> m_workingCells;
+  WorkerPool* m_workerPool;
+  size_t m_parallelMinimumCells;
+  size_t m_parallelRegionCells;
+  List<unique_ptr<WorkingRegion>> m_regions;
+  size_t m_usedRegions;
+  // Union find parents of the active cells, then the region of each group.
+  List<size_t> m_regionGroups;
+  List<size_t> m_groupRegions;
+
+  BAHashMap<Vec2I, WorkingBlock*> m_workingBlocks;
+  // Most lookups land in the same block as the one before.
+  Vec2I m_lastBlockPosition;
+  WorkingBlock* m_lastBlock;
+  List<unique_ptr<WorkingBlock>> m_blockPool;
+  size_t m_usedBlocks;
+  // Most blocks used at once since the pool was last trimmed.
+  size_t m_peakUsedBlocks;
+  unsigned m_clearsSinceTrim;
+  // Every working cell that can hold liquid, in the order they were read.
+  List<WorkingCell*> m_workingCells;
   List<WorkingCell*> m_currentActiveCells;
   BAHashSet<Vec2I> m_nextActiveCells;
   BAHashSet<tuple<Vec2I, LiquidId, Vec2I, LiquidId>> m_liquidInteractions;
@@ -179,7 +265,9 @@ void CellularLiquidWorld<LiquidId>::liquidCollision(Vec2I const&, LiquidId, Vec2
 
 template <typename LiquidId>
 LiquidCellEngine<LiquidId>::LiquidCellEngine(LiquidCellEngineParameters parameters, CellularLiquidWorldPtr cellWorld)
-  : m_engineParameters(parameters), m_cellWorld(cellWorld), m_step(0) {}
+  : m_engineParameters(parameters), m_cellWorld(cellWorld), m_step(0), m_workerPool(nullptr), m_parallelMinimumCells(0),
+    m_parallelRegionCells(1), m_usedRegions(0), m_lastBlock(nullptr), m_usedBlocks(0),
+    m_peakUsedBlocks(0), m_clearsSinceTrim(0) {}
 
 template <typename LiquidId>
 unsigned LiquidCellEngine<LiquidId>::liquidTickDelta(LiquidId liquid) {
@@ -206,6 +294,13 @@ void LiquidCellEngine<LiquidId>::setNoProcessingLimitRegions(List<RectI> noProce
   m_noProcessingLimitRegions = noProcessingLimitRegions;
 }
 
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::setParallel(WorkerPool* pool, size_t minimumCells, size_t regionCells) {
+  m_workerPool = pool;
+  m_parallelMinimumCells = minimumCells;
+  m_parallelRegionCells = max<size_t>(regionCells, 1);
+}
+
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::visitLocation(Vec2I const& p) {
   m_nextActiveCells.add(p);
@@ -222,13 +317,23 @@ void LiquidCellEngine<LiquidId>::visitRegion(RectI const& region) {
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::update() {
   setup();
-  applyPressure();
-  spreadPressure();
-  limitPressure();
-  pressureMove();
-  spreadOverfill();
-  levelMove();
-  findInteractions();
+
+  if (m_workerPool && m_currentActiveCells.size() >= m_parallelMinimumCells) {
+    splitRegions();
+    m_workerPool->parallelFor(m_usedRegions, 1, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+          updateRegion(*m_regions[i]);
+      });
+  } else {
+    auto& region = addRegion();
+    swap(region.cells, m_currentActiveCells);
+    region.random = &m_random;
+    updateRegion(region);
+  }
+
+  for (size_t i = 0; i < m_usedRegions; ++i)
+    mergeRegion(*m_regions[i]);
+
   finish();
 
   ++m_step;
@@ -260,8 +365,9 @@ template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::setup() {
   // In case an exception occurred during the last update, clear potentially
   // stale data here
-  m_workingCells.clear();
+  clearWorkingCells();
   m_currentActiveCells.clear();
+  m_usedRegions = 0;
 
   for (auto& activeCellsPair : m_activeCells) {
     unsigned tickDelta = liquidTickDelta(activeCellsPair.first);
@@ -303,30 +409,105 @@ void LiquidCellEngine<LiquidId>::setup() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::applyPressure() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::splitRegions() {
+  // Each active cell only reaches itself and its neighbours, so active cells
+  // that reach any of the same cells are joined into one group.  Anything the
+  // update reads from the world is read here, before the regions start.
+  m_regionGroups.clear();
+  auto findGroup = [this](size_t i) {
+    while (m_regionGroups[i] != i) {
+      m_regionGroups[i] = m_regionGroups[m_regionGroups[i]];
+      i = m_regionGroups[i];
+    }
+    return i;
+  };
+
+  for (size_t i = 0; i < m_currentActiveCells.size(); ++i) {
+    m_regionGroups.append(i);
+
+    auto join = [&](WorkingCell* cell) {
+      if (!cell)
+        return;
+      if (cell->group == NPos) {
+        cell->group = i;
+      } else {
+        // Groups are named after their first cell, so that they stay in the
+        // order of the active cells.
+        size_t a = findGroup(cell->group);
+        size_t b = findGroup(i);
+        m_regionGroups[max(a, b)] = min(a, b);
+      }
+    };
+
+    auto selfCell = m_currentActiveCells[i];
+    drainLevel(*selfCell);
+    join(selfCell);
+    for (auto adjacency : {Adjacency::Left, Adjacency::Right, Adjacency::Bottom, Adjacency::Top})
+      join(adjacentCell(selfCell, adjacency));
+  }
+
+  m_groupRegions.clear();
+  m_groupRegions.resize(m_currentActiveCells.size(), 0);
+  for (size_t i = 0; i < m_currentActiveCells.size(); ++i)
+    ++m_groupRegions[findGroup(i)];
+
+  // Whole groups are batched into regions in order, so that small groups do
+  // not each pay for a region of their own.
+  size_t regionCells = m_parallelRegionCells;
+  for (size_t i = 0; i < m_currentActiveCells.size(); ++i) {
+    if (m_regionGroups[i] != i)
+      continue;
+
+    if (regionCells >= m_parallelRegionCells) {
+      auto& region = addRegion();
+      region.regionRandom.init(hashOf(m_step, m_currentActiveCells[i]->position));
+      region.random = &region.regionRandom;
+      regionCells = 0;
+    }
+    regionCells += m_groupRegions[i];
+    m_groupRegions[i] = m_usedRegions - 1;
+  }
+
+  for (size_t i = 0; i < m_currentActiveCells.size(); ++i)
+    m_regions[m_groupRegions[findGroup(i)]]->cells.append(m_currentActiveCells[i]);
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::updateRegion(WorkingRegion& region) {
+  applyPressure(region);
+  spreadPressure(region);
+  limitPressure(region);
+  pressureMove(region);
+  spreadOverfill(region);
+  levelMove(region);
+  findInteractions(region);
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::applyPressure(WorkingRegion& region) {
+  for (auto const& selfCell : region.cells) {
     if (!selfCell->liquid || selfCell->sourceCell)
       continue;
 
     auto topCell = adjacentCell(selfCell, Adjacency::Top);
     if (topCell && selfCell->liquid == topCell->liquid)
-      setPressure(max(selfCell->pressure, topCell->pressure + min(topCell->level, 1.0f)), *selfCell);
+      setPressure(region, max(selfCell->pressure, topCell->pressure + min(topCell->level, 1.0f)), *selfCell);
   }
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::spreadPressure() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::spreadPressure(WorkingRegion& region) {
+  for (auto const& selfCell : region.cells) {
     if (!selfCell->liquid)
       continue;
 
     auto spreadPressure = [&](Adjacency adjacency, float bias) {
       auto targetCell = adjacentCell(selfCell, adjacency);
       if (targetCell && !targetCell->sourceCell)
-        transferPressure((selfCell->pressure + bias - targetCell->pressure) * m_engineParameters.pressureEqualizeFactor, *selfCell, *targetCell, true);
+        transferPressure(region, (selfCell->pressure + bias - targetCell->pressure) * m_engineParameters.pressureEqualizeFactor, *selfCell, *targetCell, true);
     };
 
-    if (m_random.randb()) {
+    if (region.random->randb()) {
       spreadPressure(Adjacency::Left, 0.0f);
       spreadPressure(Adjacency::Right, 0.0f);
     } else {
@@ -340,23 +521,23 @@ void LiquidCellEngine<LiquidId>::spreadPressure() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::limitPressure() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::limitPressure(WorkingRegion& region) {
+  for (auto const& selfCell : region.cells) {
     float level = min(selfCell->level, 1.0f);
     auto topCell = adjacentCell(selfCell, Adjacency::Top);
 
     // Force the pressure to the cell level if there is empty space above,
     // otherwise simply make sure the pressure is at least the level
     if (topCell && !topCell->liquid)
-      setPressure(level, *selfCell);
+      setPressure(region, level, *selfCell);
     else
-      setPressure(max(selfCell->pressure, level), *selfCell);
+      setPressure(region, max(selfCell->pressure, level), *selfCell);
   }
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::pressureMove() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::pressureMove(WorkingRegion& region) {
+  for (auto const& selfCell : region.cells) {
     if (!selfCell->liquid)
       continue;
 
@@ -366,11 +547,11 @@ void LiquidCellEngine<LiquidId>::pressureMove() {
         float amount = (selfCell->pressure - targetCell->pressure) * m_engineParameters.pressureMoveFactor;
         amount = min(amount, selfCell->level - (1.0f - m_engineParameters.maximumPressureLevelImbalance));
         amount = min(amount, (1.0f + m_engineParameters.maximumPressureLevelImbalance) - targetCell->level);
-        transferLevel(amount, *selfCell, *targetCell, false);
+        transferLevel(region, amount, *selfCell, *targetCell, false);
       }
     };
 
-    if (m_random.randb()) {
+    if (region.random->randb()) {
       pressureMove(Adjacency::Left);
       pressureMove(Adjacency::Right);
     } else {
@@ -381,8 +562,8 @@ void LiquidCellEngine<LiquidId>::pressureMove() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::spreadOverfill() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::spreadOverfill(WorkingRegion& region) {
+  for (auto const& selfCell : region.cells) {
     if (!selfCell->liquid || selfCell->sourceCell)
       continue;
 
@@ -391,13 +572,13 @@ void LiquidCellEngine<LiquidId>::spreadOverfill() {
       if (overfill > 0.0f) {
         auto targetCell = adjacentCell(selfCell, adjacency);
         if (targetCell)
-          transferLevel(min(overfill, (selfCell->level - targetCell->level)) * factor, *selfCell, *targetCell, false);
+          transferLevel(region, min(overfill, (selfCell->level - targetCell->level)) * factor, *selfCell, *targetCell, false);
       }
     };
 
     spreadOverfill(Adjacency::Top, m_engineParameters.spreadOverfillUpFactor);
 
-    if (m_random.randb()) {
+    if (region.random->randb()) {
       spreadOverfill(Adjacency::Left, m_engineParameters.spreadOverfillLateralFactor);
       spreadOverfill(Adjacency::Right, m_engineParameters.spreadOverfillLateralFactor);
     } else {
@@ -410,24 +591,24 @@ void LiquidCellEngine<LiquidId>::spreadOverfill() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::levelMove() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::levelMove(WorkingRegion& region) {
+  for (auto const& selfCell : region.cells) {
     if (!selfCell->liquid)
       continue;
 
     auto belowCell = adjacentCell(selfCell, Adjacency::Bottom);
     if (belowCell)
-      transferLevel(min(1.0f - belowCell->level, selfCell->level), *selfCell, *belowCell, false);
+      transferLevel(region, min(1.0f - belowCell->level, selfCell->level), *selfCell, *belowCell, false);
 
-    setLevel(selfCell->level * (1.0f - m_cellWorld->drainLevel(selfCell->position)), *selfCell);
+    setLevel(region, selfCell->level * (1.0f - drainLevel(*selfCell)), *selfCell);
 
     auto lateralMove = [&](Adjacency adjacency) {
       auto targetCell = adjacentCell(selfCell, adjacency);
       if (targetCell)
-        transferLevel((selfCell->level - targetCell->level) * m_engineParameters.lateralMoveFactor, *selfCell, *targetCell, false);
+        transferLevel(region, (selfCell->level - targetCell->level) * m_engineParameters.lateralMoveFactor, *selfCell, *targetCell, false);
     };
 
-    if (m_random.randb()) {
+    if (region.random->randb()) {
       lateralMove(Adjacency::Left);
       lateralMove(Adjacency::Right);
     } else {
@@ -438,8 +619,8 @@ void LiquidCellEngine<LiquidId>::levelMove() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::findInteractions() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::findInteractions(WorkingRegion& region) {
+  for (auto const& selfCell : region.cells) {
     if (!selfCell->liquid)
       continue;
 
@@ -455,7 +636,7 @@ void LiquidCellEngine<LiquidId>::findInteractions() {
           adjacentPos += Vec2I(0, -1);
         else if (adjacency == Adjacency::Top)
           adjacentPos += Vec2I(0, 1);
-        m_liquidCollisions.add(make_tuple(selfCell->position, *selfCell->liquid, adjacentPos));
+        region.liquidCollisions.append(make_tuple(selfCell->position, *selfCell->liquid, adjacentPos));
 
       } else if (targetCell->liquid && *targetCell->liquid != *selfCell->liquid) {
         if (targetCell->level <= m_engineParameters.interactTransformationLevel
@@ -468,37 +649,48 @@ void LiquidCellEngine<LiquidId>::findInteractions() {
           // Make sure to add the point pair in a predictable order so that any
           // combination of Vec2I points will be unique in m_liquidInteractions
           if (selfCell->position < targetCell->position)
-            m_liquidInteractions.add(make_tuple(selfCell->position, *selfCell->liquid, targetCell->position, *targetCell->liquid));
+            region.liquidInteractions.append(make_tuple(selfCell->position, *selfCell->liquid, targetCell->position, *targetCell->liquid));
           else
-            m_liquidInteractions.add(make_tuple(targetCell->position, *targetCell->liquid, selfCell->position, *selfCell->liquid));
+            region.liquidInteractions.append(make_tuple(targetCell->position, *targetCell->liquid, selfCell->position, *selfCell->liquid));
         }
       }
     }
   }
 }
 
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::mergeRegion(WorkingRegion& region) {
+  for (auto cell : region.nextActiveCells)
+    m_nextActiveCells.add(cell->position);
+  for (auto const& interaction : region.liquidInteractions)
+    m_liquidInteractions.add(interaction);
+  for (auto const& collision : region.liquidCollisions)
+    m_liquidCollisions.add(collision);
+}
+
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::finish() {
   m_currentActiveCells.clear();
 
-  for (auto& workingCellPair : take(m_workingCells)) {
-    if (workingCellPair.second && !workingCellPair.second->sourceCell) {
-      if (workingCellPair.second->liquid) {
-        if (workingCellPair.second->level < m_engineParameters.minimumLiquidLevel)
-          workingCellPair.second->level = 0.0f;
+  for (auto cell : m_workingCells) {
+    if (!cell->sourceCell) {
+      if (cell->liquid) {
+        if (cell->level < m_engineParameters.minimumLiquidLevel)
+          cell->level = 0.0f;
       } else {
-        workingCellPair.second->level = 0.0f;
+        cell->level = 0.0f;
       }
 
-      if (workingCellPair.second->level == 0.0f) {
-        workingCellPair.second->liquid = {};
-        workingCellPair.second->pressure = 0.0f;
+      if (cell->level == 0.0f) {
+        cell->liquid = {};
+        cell->pressure = 0.0f;
       }
 
-      m_cellWorld->setFlow(workingCellPair.second->position, CellularLiquidFlowCell<LiquidId>{
-          workingCellPair.second->liquid, workingCellPair.second->level, workingCellPair.second->pressure});
+      m_cellWorld->setFlow(cell->position, CellularLiquidFlowCell<LiquidId>{cell->liquid, cell->level, cell->pressure});
     }
   }
+  // Cells visited below must be read again after the flow changes.
+  clearWorkingCells();
 
   for (auto const& interaction : take(m_liquidInteractions))
     m_cellWorld->liquidInteraction(get<0>(interaction), get<1>(interaction), get<2>(interaction), get<3>(interaction));
@@ -510,8 +702,14 @@ void LiquidCellEngine<LiquidId>::finish() {
     auto visit = [this](Vec2I p) {
       p = m_cellWorld->uniqueLocation(p);
       auto cell = workingCell(p);
-      if (cell && cell->liquid)
-        m_activeCells[*cell->liquid].add(p);
+      if (cell && cell->liquid) {
+        unsigned x = p[0] - cell->block->origin[0];
+        uint32_t bit = 1u << (p[1] - cell->block->origin[1]);
+        if (!(cell->block->active[x] & bit)) {
+          cell->block->active[x] |= bit;
+          m_activeCells[*cell->liquid].add(p);
+        }
+      }
     };
 
     visit(c);
@@ -530,24 +728,69 @@ template <typename LiquidId>
 typename LiquidCellEngine<LiquidId>::WorkingCell* LiquidCellEngine<LiquidId>::workingCell(Vec2I p) {
   p = m_cellWorld->uniqueLocation(p);
 
-  auto res = m_workingCells.insert(make_pair(p, Maybe<WorkingCell>()));
-  if (res.second) {
+  auto blockFor = [](int c) {
+    return c >= 0 ? c / WorkingBlockSize : (c + 1) / WorkingBlockSize - 1;
+  };
+  Vec2I blockPos(blockFor(p[0]), blockFor(p[1]));
+
+  if (!m_lastBlock || m_lastBlockPosition != blockPos) {
+    auto& block = m_workingBlocks[blockPos];
+    if (!block) {
+      if (m_usedBlocks == m_blockPool.size())
+        m_blockPool.append(make_unique<WorkingBlock>());
+      block = m_blockPool[m_usedBlocks++].get();
+      block->origin = blockPos * WorkingBlockSize;
+      block->loaded.fill(0);
+      block->liquid.fill(0);
+      block->active.fill(0);
+    }
+    m_lastBlockPosition = blockPos;
+    m_lastBlock = block;
+  }
+
+  return blockCell(*m_lastBlock, p);
+}
+
+template <typename LiquidId>
+typename LiquidCellEngine<LiquidId>::WorkingCell* LiquidCellEngine<LiquidId>::blockCell(WorkingBlock& block, Vec2I const& p) {
+  unsigned x = p[0] - block.origin[0];
+  unsigned y = p[1] - block.origin[1];
+  uint32_t bit = 1u << y;
+  WorkingCell& cell = block.cells[x * WorkingBlockSize + y];
+
+  if (!(block.loaded[x] & bit)) {
+    block.loaded[x] |= bit;
+
     auto cellData = m_cellWorld->cell(p);
     if (auto flowCell = cellData.template ptr<CellularLiquidFlowCell<LiquidId>>())
-      res.first->second = WorkingCell{p, flowCell->liquid, false, flowCell->level, flowCell->pressure, nullptr, nullptr, nullptr, nullptr};
+      cell = WorkingCell{p, flowCell->liquid, false, flowCell->level, flowCell->pressure, &block, nullptr, nullptr, nullptr, nullptr, 0, {}, false, NPos};
     else if (auto sourceCell = cellData.template ptr<CellularLiquidSourceCell<LiquidId>>())
-      res.first->second = WorkingCell{p, sourceCell->liquid, true, 1.0f, sourceCell->pressure, nullptr, nullptr, nullptr, nullptr};
+      cell = WorkingCell{p, sourceCell->liquid, true, 1.0f, sourceCell->pressure, &block, nullptr, nullptr, nullptr, nullptr, 0, {}, false, NPos};
+    else
+      return nullptr;
+
+    block.liquid[x] |= bit;
+    m_workingCells.append(&cell);
   }
-  return res.first->second.ptr();
+
+  return (block.liquid[x] & bit) ? &cell : nullptr;
 }
 
 template <typename LiquidId>
 typename LiquidCellEngine<LiquidId>::WorkingCell* LiquidCellEngine<LiquidId>::adjacentCell(
     WorkingCell* cell, Adjacency adjacency) {
-  auto getCell = [this](WorkingCell*& cellptr, Vec2I cellPos) {
-    if (cellptr)
+  auto getCell = [this, cell, adjacency](WorkingCell*& cellptr, Vec2I cellPos) {
+    uint8_t loadedBit = 1 << (int)adjacency;
+    if (cell->adjacentLoaded & loadedBit)
       return cellptr;
-    cellptr = workingCell(cellPos);
+    cell->adjacentLoaded |= loadedBit;
+
+    Vec2I blockPos = cellPos - cell->block->origin;
+    if (blockPos[0] >= 0 && blockPos[0] < WorkingBlockSize && blockPos[1] >= 0 && blockPos[1] < WorkingBlockSize
+        && m_cellWorld->uniqueLocation(cellPos) == cellPos)
+      cellptr = blockCell(*cell->block, cellPos);
+    else
+      cellptr = workingCell(cellPos);
     return cellptr;
   };
 
@@ -564,19 +807,63 @@ typename LiquidCellEngine<LiquidId>::WorkingCell* LiquidCellEngine<LiquidId>::ad
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::setPressure(float pressure, WorkingCell& cell) {
+float LiquidCellEngine<LiquidId>::drainLevel(WorkingCell& cell) {
+  if (!cell.drain)
+    cell.drain = m_cellWorld->drainLevel(cell.position);
+  return *cell.drain;
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::clearWorkingCells() {
+  m_workingBlocks.clear();
+  m_lastBlock = nullptr;
+  m_workingCells.clear();
+
+  m_peakUsedBlocks = max(m_peakUsedBlocks, m_usedBlocks);
+  m_usedBlocks = 0;
+  if (++m_clearsSinceTrim >= BlockPoolTrimInterval) {
+    size_t keepBlocks = max(m_peakUsedBlocks, MinimumPooledBlocks);
+    if (m_blockPool.size() > keepBlocks)
+      m_blockPool.resize(keepBlocks);
+    m_peakUsedBlocks = 0;
+    m_clearsSinceTrim = 0;
+  }
+}
+
+template <typename LiquidId>
+typename LiquidCellEngine<LiquidId>::WorkingRegion& LiquidCellEngine<LiquidId>::addRegion() {
+  if (m_usedRegions == m_regions.size())
+    m_regions.append(make_unique<WorkingRegion>());
+  auto& region = *m_regions[m_usedRegions++];
+  region.cells.clear();
+  region.nextActiveCells.clear();
+  region.liquidInteractions.clear();
+  region.liquidCollisions.clear();
+  return region;
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::setNextActive(WorkingRegion& region, WorkingCell& cell) {
+  if (!cell.nextActive) {
+    cell.nextActive = true;
+    region.nextActiveCells.append(&cell);
+  }
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::setPressure(WorkingRegion& region, float pressure, WorkingCell& cell) {
   if (!cell.liquid || cell.sourceCell)
     return;
 
   if (fabs(cell.pressure - pressure) > m_engineParameters.minimumLivenPressureChange)
-    m_nextActiveCells.add(cell.position);
+    setNextActive(region, cell);
   cell.pressure = pressure;
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::transferPressure(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse) {
+void LiquidCellEngine<LiquidId>::transferPressure(WorkingRegion& region, float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse) {
   if (amount < 0.0f && allowReverse) {
-    return transferPressure(-amount, dest, source, false);
+    return transferPressure(region, -amount, dest, source, false);
   } else if (amount > 0.0f) {
     if (!source.liquid)
       return;
@@ -596,19 +883,19 @@ void LiquidCellEngine<LiquidId>::transferPressure(float amount, WorkingCell& sou
       dest.pressure += amount;
 
     if (amount > m_engineParameters.minimumLivenPressureChange) {
-      m_nextActiveCells.add(source.position);
-      m_nextActiveCells.add(dest.position);
+      setNextActive(region, source);
+      setNextActive(region, dest);
     }
   }
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::setLevel(float level, WorkingCell& cell) {
+void LiquidCellEngine<LiquidId>::setLevel(WorkingRegion& region, float level, WorkingCell& cell) {
   if (!cell.liquid || cell.sourceCell)
     return;
 
   if (fabs(cell.level - level) > m_engineParameters.minimumLivenLevelChange)
-    m_nextActiveCells.add(cell.position);
+    setNextActive(region, cell);
 
   cell.level = level;
 
@@ -620,9 +907,9 @@ void LiquidCellEngine<LiquidId>::setLevel(float level, WorkingCell& cell) {
 
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::transferLevel(
-    float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse) {
+    WorkingRegion& region, float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse) {
   if (amount < 0.0f && allowReverse) {
-    transferLevel(-amount, dest, source, false);
+    transferLevel(region, -amount, dest, source, false);
 
   } else if (amount > 0.0f) {
     if (!source.liquid)
@@ -647,8 +934,8 @@ void LiquidCellEngine<LiquidId>::transferLevel(
       source.liquid = {};
 
     if (amount > m_engineParameters.minimumLivenLevelChange) {
-      m_nextActiveCells.add(source.position);
-      m_nextActiveCells.add(dest.position);
+      setNextActive(region, source);
+      setNextActive(region, dest);
     }
   }
 }
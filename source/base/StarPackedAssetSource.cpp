@@ -5,6 +5,7 @@
 #include "StarDataStreamExtra.hpp"
 #include "StarSha256.hpp"
 #include "StarFile.hpp"
+#include "StarAssetPath.hpp"
 
 namespace Star {
 
@@ -68,41 +69,18 @@ void PackedAssetSource::build(DirectoryAssetSource& directorySource, String cons
   ds.write(indexStart);
 }
 
-PackedAssetSource::PackedAssetSource(String const& filename) {
-  m_packedFile = File::open(filename, IOMode::Read);
-
-  DataStreamIODevice ds(m_packedFile);
-  if (ds.readBytes(8) != ByteArray("SBAsset6", 8))
-    throw AssetSourceException("Packed assets file format unrecognized!");
-
-  uint64_t indexStart = ds.read<uint64_t>();
-
-  ds.seek(indexStart);
-  ByteArray header = ds.readBytes(5);
-  if (header != ByteArray("INDEX", 5))
-    throw AssetSourceException("No index header found!");
-  ds.read(m_metadata);
-  ds.read(m_index);
-}
-
-JsonObject PackedAssetSource::metadata() const {
-  return m_metadata;
-}
-
-StringList PackedAssetSource::assetPaths() const {
-  return m_index.keys();
-}
-
-IODevicePtr PackedAssetSource::open(String const& path) {
-  struct AssetReader : public IODevice {
-    AssetReader(FilePtr file, String path, StreamOffset offset, StreamOffset size)
-      : file(file), path(path), fileOffset(offset), assetSize(size), assetPos(0) {
+namespace {
+  // Reads a region of a mapped packed file, keeping the mapping alive for as
+  // long as the device is.
+  struct MappedReader : public IODevice {
+    MappedReader(MemoryMappedFilePtr file, String path, StreamOffset offset, StreamOffset size)
+      : file(std::move(file)), path(std::move(path)), fileOffset(offset), assetSize(size), assetPos(0) {
       setMode(IOMode::Read);
     }
 
     size_t read(char* data, size_t len) override {
       len = min<StreamOffset>(len, assetSize - assetPos);
-      file->readFullAbsolute(fileOffset + assetPos, data, len);
+      memcpy(data, file->data() + fileOffset + assetPos, len);
       assetPos += len;
       return len;
     }
@@ -120,7 +98,7 @@ IODevicePtr PackedAssetSource::open(String const& path) {
     }
 
     String deviceName() const override {
-      return strf("{}:{}", file->deviceName(), path);
+      return strf("{}:{}", file->fileName(), path);
     }
 
     bool atEnd() override {
@@ -129,25 +107,76 @@ IODevicePtr PackedAssetSource::open(String const& path) {
 
     void seek(StreamOffset p, IOSeek mode) override {
       if (mode == IOSeek::Absolute)
-        assetPos = p;
+        assetPos = clamp<StreamOffset>(p, 0, assetSize);
       else if (mode == IOSeek::Relative)
         assetPos = clamp<StreamOffset>(assetPos + p, 0, assetSize);
       else
         assetPos = clamp<StreamOffset>(assetSize - p, 0, assetSize);
     }
 
-    FilePtr file;
+    MemoryMappedFilePtr file;
     String path;
     StreamOffset fileOffset;
     StreamOffset assetSize;
     StreamOffset assetPos;
   };
+}
+
+PackedAssetSource::PackedAssetSource(String const& filename) {
+  m_packedFile = MemoryMappedFile::open(filename);
+
+  DataStreamIODevice ds(make_shared<MappedReader>(m_packedFile, "", 0, m_packedFile->size()));
+  if (ds.readBytes(8) != ByteArray("SBAsset6", 8))
+    throw AssetSourceException("Packed assets file format unrecognized!");
 
+  uint64_t indexStart = ds.read<uint64_t>();
+
+  ds.seek(indexStart);
+  ByteArray header = ds.readBytes(5);
+  if (header != ByteArray("INDEX", 5))
+    throw AssetSourceException("No index header found!");
+  ds.read(m_metadata);
+  ds.read(m_index);
+
+  uint64_t fileSize = m_packedFile->size();
+  for (auto const& entry : m_index) {
+    // Written so that corrupt offsets and sizes cannot overflow past the check.
+    if (entry.second.first > fileSize || entry.second.second > fileSize - entry.second.first)
+      throw AssetSourceException::format("Packed asset '{}' extends past the end of the packed assets file", entry.first);
+  }
+
+  // Packed files built with an extension sorting keep the assets of each
+  // sorted extension together, so most extensions only need a few ranges.
+  StringMap<List<pair<uint64_t, uint64_t>>> extensionAssets;
+  for (auto const& entry : m_index)
+    extensionAssets[AssetPath::extension(entry.first).toLower()].append(entry.second);
+
+  for (auto& pair : extensionAssets) {
+    sort(pair.second);
+    auto& ranges = m_extensionRanges[pair.first];
+    for (auto const& asset : pair.second) {
+      if (!ranges.empty() && asset.first <= ranges.last().first + ranges.last().second + ExtensionRangeGap)
+        ranges.last().second = max(ranges.last().second, asset.first + asset.second - ranges.last().first);
+      else
+        ranges.append(asset);
+    }
+  }
+}
+
+JsonObject PackedAssetSource::metadata() const {
+  return m_metadata;
+}
+
+StringList PackedAssetSource::assetPaths() const {
+  return m_index.keys();
+}
+
+IODevicePtr PackedAssetSource::open(String const& path) {
   auto p = m_index.ptr(path);
   if (!p)
     throw AssetSourceException::format("Requested file '{}' does not exist in the packed assets file", path);
 
-  return make_shared<AssetReader>(m_packedFile, path, p->first, p->second);
+  return make_shared<MappedReader>(m_packedFile, path, p->first, p->second);
 }
 
 ByteArray PackedAssetSource::read(String const& path) {
@@ -155,9 +184,23 @@ ByteArray PackedAssetSource::read(String const& path) {
   if (!p)
     throw AssetSourceException::format("Requested file '{}' does not exist in the packed assets file", path);
 
-  ByteArray data(p->second, 0);
-  m_packedFile->readFullAbsolute(p->first, data.ptr(), p->second);
-  return data;
+  return ByteArray(m_packedFile->data() + p->first, p->second);
+}
+
+void PackedAssetSource::prefetchExtension(String const& extension) {
+  auto ranges = m_extensionRanges.ptr(extension.toLower());
+  // Unsorted packed files scatter an extension all over, and reading ahead
+  // on every scattered range would pull in as much as it saves.
+  if (!ranges || ranges->size() > MaxPrefetchRanges)
+    return;
+
+  MutexLocker locker(m_prefetchMutex);
+  if (!m_prefetchedExtensions.add(extension.toLower()))
+    return;
+  locker.unlock();
+
+  for (auto const& range : *ranges)
+    m_packedFile->advise(range.first, range.second, MemoryMappedFile::Advice::WillNeed);
 }
 
 }
@@ -3,6 +3,8 @@
 
 #include "StarOrderedMap.hpp"
 #include "StarFile.hpp"
+#include "StarMemoryMappedFile.hpp"
+#include "StarThread.hpp"
 #include "StarDirectoryAssetSource.hpp"
 
 namespace Star {
@@ -31,13 +33,29 @@ public:
   JsonObject metadata() const override;
   StringList assetPaths() const override;
 
+  // Assets are read straight from a memory mapping of the packed file, so
+  // reads from any number of threads never wait on each other.
   IODevicePtr open(String const& path) override;
   ByteArray read(String const& path) override;
 
+  // Starts reading the byte ranges holding the given extension into memory,
+  // the first time it is asked for.
+  void prefetchExtension(String const& extension) override;
+
 private:
-  FilePtr m_packedFile;
+  // Assets separated by less than this are prefetched as a single range.
+  static uint64_t const ExtensionRangeGap = 64 * 1024;
+  static size_t const MaxPrefetchRanges = 64;
+
+  MemoryMappedFilePtr m_packedFile;
   JsonObject m_metadata;
   OrderedHashMap<String, pair<uint64_t, uint64_t>> m_index;
+
+  // Byte ranges of the packed file holding the assets of each lower case
+  // extension.
+  StringMap<List<pair<uint64_t, uint64_t>>> m_extensionRanges;
+  Mutex m_prefetchMutex;
+  StringSet m_prefetchedExtensions;
 };
 
 }
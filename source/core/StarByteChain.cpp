@@ -0,0 +1,85 @@
+#include "StarByteChain.hpp"
+
+namespace Star {
+
+// Arrays up to this size are copied rather than taken over as a slice.
+static size_t const SmallAppendSize = 256;
+// Copied data is added onto the last slice while it stays under this size.
+static size_t const CoalescedSliceSize = 4096;
+
+ByteChain::ByteChain() : m_size(0) {}
+
+ByteChain::ByteChain(ByteArray bytes) : ByteChain() {
+  append(std::move(bytes));
+}
+
+void ByteChain::append(ByteArray bytes) {
+  if (bytes.size() <= SmallAppendSize) {
+    append(bytes.ptr(), bytes.size());
+    return;
+  }
+
+  size_t len = bytes.size();
+  m_slices.append(Slice{make_shared<ByteArray>(std::move(bytes)), 0, len});
+  m_size += len;
+}
+
+void ByteChain::append(char const* data, size_t len) {
+  if (len == 0)
+    return;
+
+  if (!m_slices.empty()) {
+    auto& last = m_slices.last();
+    // Only unshared storage that the last slice reaches the end of can grow.
+    if (last.storage.use_count() == 1 && last.offset + last.size == last.storage->size()
+        && last.storage->size() + len <= CoalescedSliceSize) {
+      last.storage->append(data, len);
+      last.size += len;
+      m_size += len;
+      return;
+    }
+  }
+
+  auto storage = make_shared<ByteArray>(ByteArray::withReserve(max(len, SmallAppendSize)));
+  storage->append(data, len);
+  m_slices.append(Slice{std::move(storage), 0, len});
+  m_size += len;
+}
+
+void ByteChain::append(ByteChain const& chain) {
+  m_slices.appendAll(chain.m_slices);
+  m_size += chain.m_size;
+}
+
+void ByteChain::trimLeft(size_t len) {
+  if (len >= m_size) {
+    clear();
+    return;
+  }
+
+  m_size -= len;
+  while (len > 0) {
+    auto& first = m_slices.first();
+    if (len < first.size) {
+      first.offset += len;
+      first.size -= len;
+      break;
+    }
+    len -= first.size;
+    m_slices.removeFirst();
+  }
+}
+
+void ByteChain::clear() {
+  m_slices.clear();
+  m_size = 0;
+}
+
+ByteArray ByteChain::toByteArray() const {
+  ByteArray bytes = ByteArray::withReserve(m_size);
+  for (auto const& slice : m_slices)
+    bytes.append(slice.ptr(), slice.size);
+  return bytes;
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef STAR_BYTE_CHAIN_HPP
+#define STAR_BYTE_CHAIN_HPP
+
+#include "StarByteArray.hpp"
+#include "StarList.hpp"
+
+namespace Star {
+
+STAR_CLASS(ByteChain);
+
+// A queue of bytes held as a chain of slices into reference counted buffers,
+// rather than as one contiguous ByteArray.  Appending a ByteArray takes it
+// over without copying, consuming from the front only moves the first slice
+// along, and the slices can be handed as they are to scatter / gather I/O
+// such as TcpSocket::send.  Small pieces are copied together into shared
+// slices instead, so that headers and the like do not each cost an allocation
+// and a slice of their own.
+class ByteChain {
+public:
+  struct Slice {
+    char const* ptr() const;
+
+    // Must not be modified through here, it may be shared with other chains.
+    shared_ptr<ByteArray> storage;
+    size_t offset;
+    size_t size;
+  };
+
+  ByteChain();
+  ByteChain(ByteArray bytes);
+
+  size_t size() const;
+  bool empty() const;
+
+  Deque<Slice> const& slices() const;
+
+  // Takes over the given bytes as a new slice, without copying them, unless
+  // they are small enough to be copied onto the end of the last slice.
+  void append(ByteArray bytes);
+  void append(char const* data, size_t len);
+  // Shares the slices of the given chain, the underlying data is not copied.
+  void append(ByteChain const& chain);
+
+  // Drops the given number of bytes from the front of the chain.
+  void trimLeft(size_t len);
+  void clear();
+
+  // Copies the entire chain into one contiguous ByteArray.
+  ByteArray toByteArray() const;
+
+private:
+  Deque<Slice> m_slices;
+  size_t m_size;
+};
+
+inline char const* ByteChain::Slice::ptr() const {
+  return storage->ptr() + offset;
+}
+
+inline size_t ByteChain::size() const {
+  return m_size;
+}
+
+inline bool ByteChain::empty() const {
+  return m_size == 0;
+}
+
+inline Deque<ByteChain::Slice> const& ByteChain::slices() const {
+  return m_slices;
+}
+
+}
+
+#endif
@@ -1,13 +1,70 @@
 #include "StarCompression.hpp"
 #include "StarFormat.hpp"
 #include "StarLexicalCast.hpp"
+#include "StarLogging.hpp"
+#include "StarThread.hpp"
 
 #include <zlib.h>
 #include <errno.h>
 #include <string.h>
 
+#ifdef STAR_USE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
 namespace Star {
 
+EnumMap<CompressionCodec> const CompressionCodecNames{
+  {CompressionCodec::Zlib, "zlib"},
+  {CompressionCodec::Zstd, "zstd"}
+};
+
+bool compressionCodecAvailable(CompressionCodec codec) {
+#ifdef STAR_USE_ZSTD
+  return true;
+#else
+  return codec == CompressionCodec::Zlib;
+#endif
+}
+
+// The zstd frame magic number, 0xFD2FB528 in little endian.  As a zlib header
+// it fails the header checksum, so the two can never be confused.
+static bool isZstdFrame(char const* in, size_t inLen) {
+  return inLen >= 4 && (uint8_t)in[0] == 0x28 && (uint8_t)in[1] == 0xB5 && (uint8_t)in[2] == 0x2F && (uint8_t)in[3] == 0xFD;
+}
+
+#ifdef STAR_USE_ZSTD
+// Zstd contexts are expensive to set up, so every thread keeps its own.
+struct ZstdContexts {
+  ZstdContexts() : compression(ZSTD_createCCtx()), decompression(ZSTD_createDCtx()) {}
+  ~ZstdContexts() {
+    ZSTD_freeCCtx(compression);
+    ZSTD_freeDCtx(decompression);
+  }
+
+  ZSTD_CCtx* compression;
+  ZSTD_DCtx* decompression;
+};
+static thread_local ZstdContexts s_zstdContexts;
+
+static size_t checkZstd(size_t result, char const* operation) {
+  if (ZSTD_isError(result))
+    throw IOException(strf("Zstd {} failed: {}", operation, ZSTD_getErrorName(result)));
+  return result;
+}
+#endif
+
+struct CompressionDictionaryRegistry {
+  Mutex mutex;
+  HashMap<unsigned, CompressionDictionaryConstPtr> dictionaries;
+};
+
+static CompressionDictionaryRegistry& compressionDictionaryRegistry() {
+  static CompressionDictionaryRegistry registry;
+  return registry;
+}
+
 void compressData(ByteArray const& in, ByteArray& out, CompressionLevel compression) {
   out.clear();
 
@@ -51,12 +108,49 @@ ByteArray compressData(ByteArray const& in, CompressionLevel compression) {
   return out;
 }
 
-void uncompressData(ByteArray const& in, ByteArray& out) {
+void uncompressData(char const* in, size_t inLen, ByteArray& out) {
   out.clear();
 
-  if (in.empty())
+  if (inLen == 0)
     return;
 
+  if (isZstdFrame(in, inLen)) {
+#ifdef STAR_USE_ZSTD
+    CompressionDictionaryConstPtr dictionary;
+    if (unsigned dictionaryId = ZSTD_getDictID_fromFrame(in, inLen)) {
+      dictionary = CompressionDictionary::registeredDictionary(dictionaryId);
+      if (!dictionary)
+        throw IOException(strf("Zstd data in uncompressData needs unknown dictionary {}", dictionaryId));
+    }
+
+    // Streamed rather than decompressed in one go into a buffer sized from
+    // the frame header, so that the output only grows as far as the data
+    // actually decompresses.
+    auto context = s_zstdContexts.decompression;
+    checkZstd(ZSTD_DCtx_reset(context, ZSTD_reset_session_only), "decompression");
+    checkZstd(ZSTD_DCtx_refDDict(context, dictionary ? (ZSTD_DDict const*)dictionary->m_decompressionDictionary : nullptr), "decompression");
+
+    const size_t BUFSIZE = 32 * 1024;
+    unsigned char temp_buffer[BUFSIZE];
+
+    ZSTD_inBuffer input = {in, inLen, 0};
+    size_t remaining = 0;
+    bool outputFull = false;
+    do {
+      ZSTD_outBuffer output = {temp_buffer, BUFSIZE, 0};
+      remaining = checkZstd(ZSTD_decompressStream(context, &output, &input), "decompression");
+      out.append((char const*)temp_buffer, output.pos);
+      outputFull = output.pos == BUFSIZE;
+    } while (input.pos < input.size || (outputFull && remaining != 0));
+
+    if (remaining != 0)
+      throw IOException("Truncated zstd data in uncompressData");
+    return;
+#else
+    throw IOException("Cannot uncompress zstd data, zstd is not available in this build");
+#endif
+  }
+
   const size_t BUFSIZE = 32 * 1024;
   unsigned char temp_buffer[BUFSIZE];
 
@@ -68,8 +162,8 @@ void uncompressData(ByteArray const& in, ByteArray& out) {
   if (inflate_res != Z_OK)
     throw IOException(strf("Failed to initialise inflate ({})", inflate_res));
 
-  strm.next_in = (unsigned char*)in.ptr();
-  strm.avail_in = in.size();
+  strm.next_in = (unsigned char*)in;
+  strm.avail_in = inLen;
   strm.next_out = temp_buffer;
   strm.avail_out = BUFSIZE;
 
@@ -91,12 +185,230 @@ void uncompressData(ByteArray const& in, ByteArray& out) {
   out.append((char const*)temp_buffer, BUFSIZE - strm.avail_out);
 }
 
+void uncompressData(ByteArray const& in, ByteArray& out) {
+  uncompressData(in.ptr(), in.size(), out);
+}
+
 ByteArray uncompressData(ByteArray const& in) {
   ByteArray out = ByteArray::withReserve(in.size());
   uncompressData(in, out);
   return out;
 }
 
+void compressData(ByteArray const& in, ByteArray& out, CompressionSettings const& settings) {
+  if (settings.codec == CompressionCodec::Zlib)
+    return compressData(in, out, (CompressionLevel)settings.level);
+
+#ifdef STAR_USE_ZSTD
+  out.clear();
+
+  if (in.empty())
+    return;
+
+  out.resize(ZSTD_compressBound(in.size()));
+  size_t size;
+  if (settings.dictionary)
+    size = ZSTD_compress_usingCDict(s_zstdContexts.compression, out.ptr(), out.size(), in.ptr(), in.size(),
+        (ZSTD_CDict const*)settings.dictionary->m_compressionDictionary);
+  else
+    size = ZSTD_compressCCtx(s_zstdContexts.compression, out.ptr(), out.size(), in.ptr(), in.size(), settings.level);
+  out.resize(checkZstd(size, "compression"));
+#else
+  static atomic<bool> warned(false);
+  if (!warned.exchange(true))
+    Logger::warn("Zstd compression is not available in this build, falling back to zlib");
+  compressData(in, out, MediumCompression);
+#endif
+}
+
+ByteArray compressData(ByteArray const& in, CompressionSettings const& settings) {
+  ByteArray out;
+  compressData(in, out, settings);
+  return out;
+}
+
+ByteArray CompressionDictionary::train(List<ByteArray> const& samples, size_t maxSize) {
+#ifdef STAR_USE_ZSTD
+  ByteArray sampleBuffer;
+  List<size_t> sampleSizes;
+  for (auto const& sample : samples) {
+    sampleBuffer.append(sample);
+    sampleSizes.append(sample.size());
+  }
+
+  ByteArray dictionary(maxSize, 0);
+  size_t size = ZDICT_trainFromBuffer(dictionary.ptr(), dictionary.size(), sampleBuffer.ptr(), sampleSizes.ptr(), sampleSizes.size());
+  if (ZDICT_isError(size))
+    throw IOException(strf("Failed to train zstd dictionary: {}", ZDICT_getErrorName(size)));
+  dictionary.resize(size);
+  return dictionary;
+#else
+  _unused(samples);
+  _unused(maxSize);
+  throw IOException("Zstd dictionaries are not available in this build");
+#endif
+}
+
+CompressionDictionaryConstPtr CompressionDictionary::registerDictionary(ByteArray data, int level) {
+  auto& registry = compressionDictionaryRegistry();
+  MutexLocker locker(registry.mutex);
+  for (auto const& p : registry.dictionaries) {
+    if (p.second->level() == level && p.second->data() == data)
+      return p.second;
+  }
+
+  auto dictionary = make_shared<CompressionDictionary>(std::move(data), level);
+  registry.dictionaries.set(dictionary->id(), dictionary);
+  return dictionary;
+}
+
+CompressionDictionaryConstPtr CompressionDictionary::registeredDictionary(unsigned id) {
+  auto& registry = compressionDictionaryRegistry();
+  MutexLocker locker(registry.mutex);
+  return registry.dictionaries.value(id);
+}
+
+CompressionDictionary::CompressionDictionary(ByteArray data, int level)
+  : m_data(std::move(data)), m_level(level), m_id(0), m_compressionDictionary(nullptr), m_decompressionDictionary(nullptr) {
+#ifdef STAR_USE_ZSTD
+  // Raw content dictionaries have no id, so frames made with them could not
+  // be matched back up with their dictionary.
+  m_id = ZSTD_getDictID_fromDict(m_data.ptr(), m_data.size());
+  if (m_id == 0)
+    throw IOException("Zstd dictionary has no dictionary id");
+
+  m_compressionDictionary = ZSTD_createCDict(m_data.ptr(), m_data.size(), m_level);
+  m_decompressionDictionary = ZSTD_createDDict(m_data.ptr(), m_data.size());
+  if (!m_compressionDictionary || !m_decompressionDictionary) {
+    ZSTD_freeCDict((ZSTD_CDict*)m_compressionDictionary);
+    ZSTD_freeDDict((ZSTD_DDict*)m_decompressionDictionary);
+    throw IOException("Failed to load zstd dictionary");
+  }
+#else
+  throw IOException("Zstd dictionaries are not available in this build");
+#endif
+}
+
+CompressionDictionary::~CompressionDictionary() {
+#ifdef STAR_USE_ZSTD
+  ZSTD_freeCDict((ZSTD_CDict*)m_compressionDictionary);
+  ZSTD_freeDDict((ZSTD_DDict*)m_decompressionDictionary);
+#endif
+}
+
+unsigned CompressionDictionary::id() const {
+  return m_id;
+}
+
+int CompressionDictionary::level() const {
+  return m_level;
+}
+
+ByteArray const& CompressionDictionary::data() const {
+  return m_data;
+}
+
+CompressionStream::CompressionStream(CompressionLevel compression) {
+  auto strm = new z_stream;
+  strm->zalloc = Z_NULL;
+  strm->zfree = Z_NULL;
+  strm->opaque = Z_NULL;
+  int deflate_res = deflateInit(strm, compression);
+  if (deflate_res != Z_OK) {
+    delete strm;
+    throw IOException(strf("Failed to initialise deflate ({})", deflate_res));
+  }
+  m_stream = strm;
+}
+
+CompressionStream::~CompressionStream() {
+  auto strm = (z_stream*)m_stream;
+  deflateEnd(strm);
+  delete strm;
+}
+
+void CompressionStream::compress(char const* data, size_t len, ByteArray& out, bool flush) {
+  if (len == 0 && !flush)
+    return;
+
+  const size_t BUFSIZE = 32 * 1024;
+  unsigned char temp_buffer[BUFSIZE];
+
+  auto strm = (z_stream*)m_stream;
+  strm->next_in = (unsigned char*)data;
+  strm->avail_in = len;
+  do {
+    strm->next_out = temp_buffer;
+    strm->avail_out = BUFSIZE;
+    int deflate_res = deflate(strm, flush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+    if (deflate_res != Z_OK && deflate_res != Z_BUF_ERROR)
+      throw IOException(strf("Internal error in CompressionStream::compress, deflate_res is {}", deflate_res));
+    out.append((char const*)temp_buffer, BUFSIZE - strm->avail_out);
+  } while (strm->avail_out == 0);
+}
+
+ByteArray CompressionStream::compress(ByteArray const& in) {
+  ByteArray out;
+  compress(in.ptr(), in.size(), out);
+  return out;
+}
+
+DecompressionStream::DecompressionStream() {
+  auto strm = new z_stream;
+  strm->zalloc = Z_NULL;
+  strm->zfree = Z_NULL;
+  strm->opaque = Z_NULL;
+  strm->next_in = Z_NULL;
+  strm->avail_in = 0;
+  int inflate_res = inflateInit(strm);
+  if (inflate_res != Z_OK) {
+    delete strm;
+    throw IOException(strf("Failed to initialise inflate ({})", inflate_res));
+  }
+  m_stream = strm;
+}
+
+DecompressionStream::~DecompressionStream() {
+  auto strm = (z_stream*)m_stream;
+  inflateEnd(strm);
+  delete strm;
+}
+
+void DecompressionStream::decompress(char const* data, size_t len, ByteArray& out) {
+  if (len != 0)
+    decompress(data, len, out, NPos);
+}
+
+size_t DecompressionStream::decompress(char const* data, size_t len, ByteArray& out, size_t outLimit) {
+  const size_t BUFSIZE = 32 * 1024;
+  unsigned char temp_buffer[BUFSIZE];
+
+  // Output held back by an earlier call that hit its limit is still read when
+  // there is no new input.
+  auto strm = (z_stream*)m_stream;
+  strm->next_in = (unsigned char*)data;
+  strm->avail_in = len;
+  while (out.size() < outLimit) {
+    strm->next_out = temp_buffer;
+    strm->avail_out = BUFSIZE;
+    int inflate_res = inflate(strm, Z_NO_FLUSH);
+    // The compressing side never finishes its stream, so the stream ending is
+    // as much an error as corrupt data.
+    if (inflate_res != Z_OK && inflate_res != Z_BUF_ERROR)
+      throw IOException(strf("Internal error in DecompressionStream::decompress, inflate_res is {}", inflate_res));
+    out.append((char const*)temp_buffer, BUFSIZE - strm->avail_out);
+    if (strm->avail_out != 0)
+      break;
+  }
+  return len - strm->avail_in;
+}
+
+ByteArray DecompressionStream::decompress(ByteArray const& in) {
+  ByteArray out;
+  decompress(in.ptr(), in.size(), out);
+  return out;
+}
+
 CompressedFilePtr CompressedFile::open(String const& filename, IOMode mode, CompressionLevel comp) {
   CompressedFilePtr f = make_shared<CompressedFile>(filename);
   f->open(mode, comp);
@@ -3,10 +3,12 @@
 
 #include "StarIODevice.hpp"
 #include "StarString.hpp"
+#include "StarBiMap.hpp"
 
 namespace Star {
 
 STAR_CLASS(CompressedFile);
+STAR_CLASS(CompressionDictionary);
 
 // Zlib compression level, ranges from 0 to 9
 typedef int CompressionLevel;
@@ -15,12 +17,116 @@ CompressionLevel const LowCompression = 2;
 CompressionLevel const MediumCompression = 5;
 CompressionLevel const HighCompression = 9;
 
+// Zstd is only available if built with STAR_USE_ZSTD, compressing with it
+// otherwise falls back to zlib at MediumCompression.
+enum class CompressionCodec : uint8_t {
+  Zlib,
+  Zstd
+};
+extern EnumMap<CompressionCodec> const CompressionCodecNames;
+
+bool compressionCodecAvailable(CompressionCodec codec);
+
+struct CompressionSettings {
+  CompressionCodec codec = CompressionCodec::Zlib;
+  // 0 to 9 for zlib, 1 to 22 for zstd.
+  int level = MediumCompression;
+  // Only used by zstd, must have been created at the same level.
+  CompressionDictionaryConstPtr dictionary;
+};
+
 void compressData(ByteArray const& in, ByteArray& out, CompressionLevel compression = MediumCompression);
 ByteArray compressData(ByteArray const& in, CompressionLevel compression = MediumCompression);
 
+void compressData(ByteArray const& in, ByteArray& out, CompressionSettings const& settings);
+ByteArray compressData(ByteArray const& in, CompressionSettings const& settings);
+
+// Reads data from any codec.  Zstd frames are told apart by their magic
+// number, which can never be a valid zlib header, so no separate tag is
+// stored and existing zlib data is read as it always was.  Data compressed
+// with a dictionary needs that dictionary to have been registered.
+void uncompressData(char const* in, size_t inLen, ByteArray& out);
 void uncompressData(ByteArray const& in, ByteArray& out);
 ByteArray uncompressData(ByteArray const& in);
 
+// A zstd dictionary, which greatly improves the ratio on many small, similar
+// buffers such as world sectors.
+class CompressionDictionary {
+public:
+  // Trains a dictionary of at most maxSize bytes from the given samples.
+  static ByteArray train(List<ByteArray> const& samples, size_t maxSize);
+
+  // Makes the given dictionary available to uncompressData by its id, and
+  // returns it for compression.  If the same dictionary was already
+  // registered at the same level, returns that one instead.
+  static CompressionDictionaryConstPtr registerDictionary(ByteArray data, int level);
+  static CompressionDictionaryConstPtr registeredDictionary(unsigned id);
+
+  // Throws IOException if zstd support is not available.
+  CompressionDictionary(ByteArray data, int level);
+  ~CompressionDictionary();
+
+  CompressionDictionary(CompressionDictionary const&) = delete;
+  CompressionDictionary& operator=(CompressionDictionary const&) = delete;
+
+  unsigned id() const;
+  int level() const;
+  ByteArray const& data() const;
+
+private:
+  friend void compressData(ByteArray const&, ByteArray&, CompressionSettings const&);
+  friend void uncompressData(char const*, size_t, ByteArray&);
+
+  ByteArray m_data;
+  int m_level;
+  unsigned m_id;
+  void* m_compressionDictionary;
+  void* m_decompressionDictionary;
+};
+
+// Long-lived zlib stream for a sequence of buffers with a lot of content in
+// common, such as the packets sent over one connection.  Every compress call
+// is flushed, so its output can be decompressed straight away, but it may
+// still refer back to anything compressed before it.
+class CompressionStream {
+public:
+  CompressionStream(CompressionLevel compression = LowCompression);
+  ~CompressionStream();
+
+  CompressionStream(CompressionStream const&) = delete;
+  CompressionStream& operator=(CompressionStream const&) = delete;
+
+  // Appends the compressed data to out.  Unless flushed, some of the data may
+  // be held back until a later call, which lets several pieces be compressed
+  // as one without first joining them together.
+  void compress(char const* data, size_t len, ByteArray& out, bool flush = true);
+  ByteArray compress(ByteArray const& in);
+
+private:
+  void* m_stream;
+};
+
+// Reads the output of a CompressionStream, which may be split up arbitrarily
+// as long as it is given in order.
+class DecompressionStream {
+public:
+  DecompressionStream();
+  ~DecompressionStream();
+
+  DecompressionStream(DecompressionStream const&) = delete;
+  DecompressionStream& operator=(DecompressionStream const&) = delete;
+
+  // Appends as much data as can be decompressed so far to out.
+  void decompress(char const* data, size_t len, ByteArray& out);
+  // Same, but stops once out has grown to at least outLimit bytes, and returns
+  // how much of the input was used.  The rest must be given again later.
+  size_t decompress(char const* data, size_t len, ByteArray& out, size_t outLimit);
+  ByteArray decompress(ByteArray const& in);
+
+private:
+  void* m_stream;
+};
+
 // Random access to a (potentially) compressed file.
 class CompressedFile : public IODevice {
 public:
@@ -1,6 +1,21 @@
 #include "StarJsonBuilder.hpp"
 #include "StarLexicalCast.hpp"
 
+#include <cfloat>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define STAR_JSON_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define STAR_JSON_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace Star {
 
 void JsonBuilderStream::beginObject() {
@@ -127,6 +142,625 @@ bool JsonBuilderStream::isSentry() {
   return !m_stack.empty() && !m_stack.last();
 }
 
+namespace {
+
+#if defined(STAR_JSON_SSE2) || defined(STAR_JSON_NEON)
+inline unsigned lowestSetBit(uint64_t mask) {
+#ifdef _MSC_VER
+  unsigned long index;
+#ifdef _WIN64
+  _BitScanForward64(&index, mask);
+#else
+  if (!_BitScanForward(&index, (unsigned long)mask)) {
+    _BitScanForward(&index, (unsigned long)(mask >> 32));
+    index += 32;
+  }
+#endif
+  return index;
+#else
+  return __builtin_ctzll(mask);
+#endif
+}
+#endif
+
+#ifdef STAR_JSON_NEON
+// One bit set in each nibble of the result for every byte set in the mask.
+inline uint64_t neonNibbleMask(uint8x16_t mask) {
+  return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(mask), 4)), 0);
+}
+#endif
+
+inline bool isJsonSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// First position in [p, end) that is not a space, tab, newline or carriage
+// return.
+char const* skipSpaces(char const* p, char const* end) {
+  if (p == end || !isJsonSpace(*p))
+    return p;
+
+#if defined(STAR_JSON_SSE2)
+  __m128i const space = _mm_set1_epi8(' ');
+  __m128i const tab = _mm_set1_epi8('\t');
+  __m128i const newline = _mm_set1_epi8('\n');
+  __m128i const carriageReturn = _mm_set1_epi8('\r');
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128((__m128i const*)p);
+    __m128i spaces = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriageReturn)));
+    uint32_t others = ~(uint32_t)_mm_movemask_epi8(spaces) & 0xffff;
+    if (others)
+      return p + lowestSetBit(others);
+    p += 16;
+  }
+#elif defined(STAR_JSON_NEON)
+  while (end - p >= 16) {
+    uint8x16_t chunk = vld1q_u8((uint8_t const*)p);
+    uint8x16_t spaces = vorrq_u8(
+        vorrq_u8(vceqq_u8(chunk, vdupq_n_u8(' ')), vceqq_u8(chunk, vdupq_n_u8('\t'))),
+        vorrq_u8(vceqq_u8(chunk, vdupq_n_u8('\n')), vceqq_u8(chunk, vdupq_n_u8('\r'))));
+    uint64_t others = ~neonNibbleMask(spaces);
+    if (others)
+      return p + lowestSetBit(others) / 4;
+    p += 16;
+  }
+#endif
+
+  while (p != end && isJsonSpace(*p))
+    ++p;
+  return p;
+}
+
+// First position in [p, end) holding a quote, a backslash, a NUL or a
+// non-ASCII byte, the only bytes in a string that need more than a copy.
+char const* skipPlainString(char const* p, char const* end) {
+#if defined(STAR_JSON_SSE2)
+  __m128i const quote = _mm_set1_epi8('"');
+  __m128i const backslash = _mm_set1_epi8('\\');
+  __m128i const zero = _mm_setzero_si128();
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128((__m128i const*)p);
+    __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)), _mm_cmpeq_epi8(chunk, zero));
+    // The sign bit of each byte is set for non-ASCII bytes.
+    uint32_t stops = (uint32_t)(_mm_movemask_epi8(special) | _mm_movemask_epi8(chunk));
+    if (stops)
+      return p + lowestSetBit(stops);
+    p += 16;
+  }
+#elif defined(STAR_JSON_NEON)
+  while (end - p >= 16) {
+    uint8x16_t chunk = vld1q_u8((uint8_t const*)p);
+    uint8x16_t special = vorrq_u8(
+        vorrq_u8(vceqq_u8(chunk, vdupq_n_u8('"')), vceqq_u8(chunk, vdupq_n_u8('\\'))),
+        vorrq_u8(vceqq_u8(chunk, vdupq_n_u8(0)), vcgeq_u8(chunk, vdupq_n_u8(0x80))));
+    uint64_t stops = neonNibbleMask(special);
+    if (stops)
+      return p + lowestSetBit(stops) / 4;
+    p += 16;
+  }
+#endif
+
+  while (p != end && *p != '"' && *p != '\\' && *p != 0 && (uint8_t)*p < 0x80)
+    ++p;
+  return p;
+}
+
+// Converts a JSON number of at most 15 significant digits with a decimal
+// exponent of at most 22 directly, as both the digits and the power of ten are
+// exact doubles so a single multiplication or division is correctly rounded.
+// Anything else is left to lexicalCast.
+Maybe<double> fastJsonDouble(char const* begin, char const* end) {
+#if FLT_EVAL_METHOD == 0
+  static double const PowersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  char const* c = begin;
+  bool negative = *c == '-';
+  if (negative)
+    ++c;
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  for (; c != end && *c >= '0' && *c <= '9'; ++c) {
+    if (mantissa || *c != '0') {
+      if (++digits > 15)
+        return {};
+      mantissa = mantissa * 10 + (*c - '0');
+    }
+  }
+
+  if (c != end && *c == '.') {
+    for (++c; c != end && *c >= '0' && *c <= '9'; ++c) {
+      if (mantissa || *c != '0') {
+        if (++digits > 15)
+          return {};
+        mantissa = mantissa * 10 + (*c - '0');
+      }
+      --exponent;
+    }
+  }
+
+  if (c != end) {
+    // Exponent
+    ++c;
+    bool negativeExponent = false;
+    if (c != end && (*c == '-' || *c == '+'))
+      negativeExponent = *c++ == '-';
+    if (c == end)
+      return {};
+    int writtenExponent = 0;
+    for (; c != end; ++c) {
+      writtenExponent = writtenExponent * 10 + (*c - '0');
+      if (writtenExponent > 1000)
+        return {};
+    }
+    exponent += negativeExponent ? -writtenExponent : writtenExponent;
+  }
+
+  if (exponent < -22 || exponent > 22)
+    return {};
+
+  double value = (double)mantissa;
+  if (exponent < 0)
+    value /= PowersOfTen[-exponent];
+  else
+    value *= PowersOfTen[exponent];
+  return negative ? -value : value;
+#else
+  _unused(begin);
+  _unused(end);
+  return {};
+#endif
+}
+
+// Builds Json straight from UTF-8 text.  Follows the grammar, comment
+// extension and error messages of JsonParser exactly, but only keeps a byte
+// position while parsing and works out the line and column of an error from
+// it afterwards.
+class Utf8JsonParser {
+public:
+  Utf8JsonParser(char const* begin, char const* end)
+    : m_begin(begin), m_end(end), m_current(begin) {}
+
+  Json parse(bool fragment) {
+    Json result;
+    try {
+      white();
+      result = fragment ? value() : top();
+      white();
+    } catch (ParsingException const&) {
+      throw JsonParsingException(strf("Error parsing json: {} at {}:{}", m_error, line(), column()));
+    }
+
+    if (m_current != m_end)
+      throw JsonParsingException(strf("Error extra data at end of input at {}:{}", line(), column()));
+    return result;
+  }
+
+private:
+  // Thrown internally to abort parsing.
+  class ParsingException {};
+
+  char peek() const {
+    return m_current != m_end ? *m_current : 0;
+  }
+
+  void next() {
+    if (m_current != m_end)
+      ++m_current;
+  }
+
+  Json top() {
+    char c = peek();
+    if (c == '{')
+      return object();
+    else if (c == '[')
+      return array();
+    error("expected JSON object or array at top level");
+    return {};
+  }
+
+  Json value() {
+    char c = peek();
+    switch (c) {
+      case '{':
+        return object();
+      case '[':
+        return array();
+      case '"':
+        return string();
+      case '-':
+        return number();
+      case 0:
+        error("unexpected end of stream parsing value");
+        return {};
+      default:
+        return c >= '0' && c <= '9' ? number() : word();
+    }
+  }
+
+  Json object() {
+    next();
+    white();
+    if (peek() == '}') {
+      next();
+      return JsonObject();
+    }
+
+    // Members of every object still being parsed share one stack, so each
+    // object can be built once at its final size.
+    size_t firstMember = m_members.size();
+    while (true) {
+      String key = string();
+
+      white();
+      if (peek() != ':')
+        error("bad object, should be ':'");
+      next();
+      white();
+
+      Json member = value();
+      m_members.append({std::move(key), std::move(member)});
+
+      white();
+      char c = peek();
+      if (c == '}') {
+        next();
+        break;
+      } else if (c == ',') {
+        next();
+        white();
+      } else if (c == 0) {
+        error("unexpected end of stream parsing object.");
+      } else {
+        error("bad object, should be '}' or ','");
+      }
+    }
+
+    JsonObject object;
+    object.reserve(m_members.size() - firstMember);
+    for (size_t i = firstMember; i < m_members.size(); ++i) {
+      auto inserted = object.insert(std::move(m_members[i].first), std::move(m_members[i].second));
+      if (!inserted.second)
+        throw JsonParsingException(strf("Json object contains a duplicate entry for key '{}'", inserted.first->first));
+    }
+    m_members.resize(firstMember);
+    return object;
+  }
+
+  Json array() {
+    next();
+    white();
+    if (peek() == ']') {
+      next();
+      return JsonArray();
+    }
+
+    size_t firstElement = m_elements.size();
+    while (true) {
+      m_elements.append(value());
+
+      white();
+      char c = peek();
+      if (c == ']') {
+        next();
+        break;
+      } else if (c == ',') {
+        next();
+        white();
+      } else if (c == 0) {
+        error("unexpected end of stream parsing array.");
+      } else {
+        error("bad array, should be ',' or ']'");
+      }
+    }
+
+    JsonArray array;
+    array.reserve(m_elements.size() - firstElement);
+    for (size_t i = firstElement; i < m_elements.size(); ++i)
+      array.append(std::move(m_elements[i]));
+    m_elements.resize(firstElement);
+    return array;
+  }
+
+  String string() {
+    if (peek() != '"')
+      error("bad string, should be '\"'");
+    next();
+
+    char const* run = m_current;
+    m_current = skipPlainString(m_current, m_end);
+    if (peek() == '"') {
+      next();
+      return String(run, m_current - run - 1);
+    }
+
+    std::string str(run, m_current);
+    while (true) {
+      char c = peek();
+      if (c == '"') {
+        next();
+        return String(std::move(str));
+      } else if (c == '\\') {
+        next();
+        escape(str);
+      } else if (c == 0) {
+        error("unexpected end of stream reading string!");
+      } else {
+        utf8Char(str);
+      }
+
+      run = m_current;
+      m_current = skipPlainString(m_current, m_end);
+      str.append(run, m_current);
+    }
+  }
+
+  void escape(std::string& str) {
+    char c = peek();
+    if (c == 'u') {
+      next();
+      Utf32Type codepoint = hexStringToUtf32(hexDigits());
+      if (isUtf16LeadSurrogate(codepoint)) {
+        check('\\');
+        check('u');
+        codepoint = hexStringToUtf32(hexDigits(), codepoint);
+      }
+      appendUtf8(str, codepoint);
+      return;
+    }
+
+    switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        str += c;
+        break;
+      case 'b':
+        str += '\b';
+        break;
+      case 'f':
+        str += '\f';
+        break;
+      case 'n':
+        str += '\n';
+        break;
+      case 'r':
+        str += '\r';
+        break;
+      case 't':
+        str += '\t';
+        break;
+      default:
+        error("bad string escape character");
+        break;
+    }
+    next();
+  }
+
+  std::string hexDigits() {
+    std::string hexString;
+    for (int i = 0; i < 4; ++i) {
+      hexString.push_back(peek());
+      next();
+    }
+    return hexString;
+  }
+
+  // Copies one multi-byte character into the string, with the same checks
+  // as U8ToU32Iterator.
+  void utf8Char(std::string& str) {
+    static Utf32Type const Masks[4] = {0x7Fu, 0x7FFu, 0xFFFFu, 0x1FFFFFu};
+
+    uint8_t lead = *m_current;
+    if ((lead & 0xC0u) == 0x80u)
+      throwInvalidUtf8Sequence();
+    size_t extra = lead >= 0xF0u ? 3 : lead >= 0xE0u ? 2 : 1;
+    if ((size_t)(m_end - m_current) <= extra)
+      throwInvalidUtf8Sequence();
+
+    Utf32Type codepoint = lead;
+    for (size_t i = 1; i <= extra; ++i) {
+      uint8_t continuation = m_current[i];
+      if ((continuation & 0xC0u) != 0x80u)
+        throwInvalidUtf8Sequence();
+      codepoint = (codepoint << 6) + (continuation & 0x3Fu);
+    }
+    codepoint &= Masks[extra];
+    if (codepoint > 0x10FFFFu)
+      throwInvalidUtf8Sequence();
+
+    m_current += extra + 1;
+    appendUtf8(str, codepoint);
+  }
+
+  static void appendUtf8(std::string& str, Utf32Type codepoint) {
+    char bytes[6];
+    str.append(bytes, utf8EncodeChar(bytes, codepoint));
+  }
+
+  Json number() {
+    char const* start = m_current;
+    bool isDouble = false;
+
+    if (peek() == '-')
+      next();
+
+    if (peek() == '0') {
+      next();
+    } else if (peek() > '0' && peek() <= '9') {
+      while (peek() >= '0' && peek() <= '9')
+        next();
+    } else {
+      error("bad number, must start with digit");
+    }
+
+    if (peek() == '.') {
+      isDouble = true;
+      next();
+      while (peek() >= '0' && peek() <= '9')
+        next();
+    }
+
+    if (peek() == 'e' || peek() == 'E') {
+      isDouble = true;
+      next();
+      if (peek() == '-' || peek() == '+')
+        next();
+      while (peek() >= '0' && peek() <= '9')
+        next();
+    }
+
+    if (isDouble) {
+      if (auto value = fastJsonDouble(start, m_current))
+        return *value;
+      try {
+        return lexicalCast<double>(String(start, m_current - start));
+      } catch (std::exception const& e) {
+        error(std::string("Bad double: ") + e.what());
+      }
+    } else {
+      bool negative = *start == '-';
+      uint64_t magnitude = 0;
+      bool overflow = false;
+      for (char const* c = start + negative; c != m_current; ++c) {
+        unsigned digit = *c - '0';
+        if (magnitude > (UINT64_MAX - digit) / 10) {
+          overflow = true;
+          break;
+        }
+        magnitude = magnitude * 10 + digit;
+      }
+
+      if (!overflow && magnitude <= (uint64_t)INT64_MAX)
+        return negative ? -(long long)magnitude : (long long)magnitude;
+      else if (!overflow && negative && magnitude == (uint64_t)INT64_MAX + 1)
+        return (long long)INT64_MIN;
+
+      try {
+        return lexicalCast<long long>(String(start, m_current - start));
+      } catch (std::exception const& e) {
+        error(std::string("Bad integer: ") + e.what());
+      }
+    }
+    return {};
+  }
+
+  // true, false, or null
+  Json word() {
+    switch (peek()) {
+      case 't':
+        next();
+        check('r');
+        check('u');
+        check('e');
+        return true;
+      case 'f':
+        next();
+        check('a');
+        check('l');
+        check('s');
+        check('e');
+        return false;
+      case 'n':
+        next();
+        check('u');
+        check('l');
+        check('l');
+        return {};
+      default:
+        error("unexpected character parsing word");
+        return {};
+    }
+  }
+
+  // Checks current char then moves on to the next one
+  void check(char c) {
+    if (peek() == 0)
+      error("unexpected end of stream parsing word");
+    if (peek() != c)
+      error("unexpected character in word");
+    next();
+  }
+
+  // Will skip whitespace, byte order marks and comments between tokens.
+  void white() {
+    while (true) {
+      m_current = skipSpaces(m_current, m_end);
+      if (m_current == m_end)
+        return;
+
+      uint8_t c = *m_current;
+      if (c == '/') {
+        next();
+        if (peek() == '/') {
+          // Read '//' style comments up until eol/eof.
+          auto newline = (char const*)memchr(m_current, '\n', m_end - m_current);
+          m_current = newline ? newline : m_end;
+        } else if (peek() == '*') {
+          next();
+          // Read '/*' style comments up until '*/'.
+          while (m_current != m_end) {
+            auto star = (char const*)memchr(m_current, '*', m_end - m_current);
+            if (!star) {
+              m_current = m_end;
+              error("/* comment has no matching */");
+            }
+            m_current = star + 1;
+            if (peek() == '/') {
+              next();
+              break;
+            }
+          }
+        } else {
+          // The only allowed characters following / in whitespace are / and *
+          error("/ character in whitespace is not follwed by '/' or '*', invalid comment");
+        }
+      } else if (c == 0xEF && m_end - m_current >= 3 && (uint8_t)m_current[1] == 0xBB && (uint8_t)m_current[2] == 0xBF) {
+        // BOM or ZWNBSP
+        m_current += 3;
+      } else {
+        return;
+      }
+    }
+  }
+
+  // Line and column of the current position, counting characters rather than
+  // bytes.
+  size_t line() const {
+    return std::count(m_begin, m_current, '\n') + 1;
+  }
+
+  size_t column() const {
+    char const* lineStart = m_current;
+    while (lineStart != m_begin && lineStart[-1] != '\n')
+      --lineStart;
+    return std::count_if(lineStart, m_current, [](char c) { return ((uint8_t)c & 0xC0u) != 0x80u; }) + 1;
+  }
+
+  void error(std::string msg) {
+    m_error = std::move(msg);
+    throw ParsingException();
+  }
+
+  char const* m_begin;
+  char const* m_end;
+  char const* m_current;
+  std::string m_error;
+
+  List<pair<String, Json>> m_members;
+  List<Json> m_elements;
+};
+
+}
+
+Json inputUtf8Json(char const* begin, char const* end, bool fragment) {
+  return Utf8JsonParser(begin, end).parse(fragment);
+}
+
 void JsonStreamer<Json>::toJsonStream(Json const& val, JsonStream& stream, bool sort) {
   Json::Type type = val.type();
   if (type == Json::Type::Null) {
@@ -50,23 +50,32 @@ public:
   static void toJsonStream(Json const& val, JsonStream& stream, bool sort);
 };
 
+// Parses UTF-8 JSON held in memory straight into Json values, scanning
+// whitespace and strings with SIMD where available.  Accepts the same comment
+// extension and throws the same errors as parsing through JsonParser.
+Json inputUtf8Json(char const* begin, char const* end, bool fragment);
+
 template <typename InputIterator>
 Json inputUtf8Json(InputIterator begin, InputIterator end, bool fragment) {
-  typedef U8ToU32Iterator<InputIterator> Utf32Input;
-  typedef JsonParser<Utf32Input> Parser;
-
-  JsonBuilderStream stream;
-  Parser parser(stream);
-  Utf32Input wbegin(begin);
-  Utf32Input wend(end);
-  Utf32Input pend = parser.parse(wbegin, wend, fragment);
-
-  if (parser.error())
-    throw JsonParsingException(strf("Error parsing json: {} at {}:{}", parser.error(), parser.line(), parser.column()));
-  else if (pend != wend)
-    throw JsonParsingException(strf("Error extra data at end of input at {}:{}", parser.line(), parser.column()));
-
-  return stream.takeTop();
+  if constexpr (std::is_pointer<InputIterator>::value && sizeof(*begin) == 1) {
+    return inputUtf8Json((char const*)begin, (char const*)end, fragment);
+  } else {
+    typedef U8ToU32Iterator<InputIterator> Utf32Input;
+    typedef JsonParser<Utf32Input> Parser;
+
+    JsonBuilderStream stream;
+    Parser parser(stream);
+    Utf32Input wbegin(begin);
+    Utf32Input wend(end);
+    Utf32Input pend = parser.parse(wbegin, wend, fragment);
+
+    if (parser.error())
+      throw JsonParsingException(strf("Error parsing json: {} at {}:{}", parser.error(), parser.line(), parser.column()));
+    else if (pend != wend)
+      throw JsonParsingException(strf("Error extra data at end of input at {}:{}", parser.line(), parser.column()));
+
+    return stream.takeTop();
+  }
 }
 
 template <typename OutputIterator>
@@ -13,6 +13,11 @@
 
 namespace Star {
 
+// User values of Json proxies, holding the values written into the proxy and
+// the nested containers converted when read from it.
+static int const JsonProxyWritten = 1;
+static int const JsonProxyRead = 2;
+
 std::ostream& operator<<(std::ostream& os, LuaValue const& value) {
   if (value.is<LuaBoolean>()) {
     os << (value.get<LuaBoolean>() ? "true" : "false");
@@ -106,6 +111,11 @@ void LuaContext::load(ByteArray const& contents, String const& name) {
   load(contents.ptr(), contents.size(), name.utf8Ptr());
 }
 
+void LuaContext::load(LuaFunction const& prototype) {
+  ZoneScoped;
+  engine().contextLoadPrototype(handleIndex(), prototype.handleIndex());
+}
+
 void LuaContext::setRequireFunction(RequireFunction requireFunction) {
   engine().setContextRequire(handleIndex(), std::move(requireFunction));
 }
@@ -158,11 +168,14 @@ LuaValue LuaConverter<Json>::from(LuaEngine& engine, Json const& v) {
   } else if (v.isType(Json::Type::String)) {
     return engine.createString(*v.stringPtr());
   } else {
+    auto proxyMinimumSize = engine.jsonProxyMinimumSize();
+    if (proxyMinimumSize && v.size() >= *proxyMinimumSize)
+      return engine.createJsonProxy(v);
     return LuaDetail::jsonContainerToTable(engine, v);
   }
 }
 
-Maybe<Json> LuaConverter<Json>::to(LuaEngine&, LuaValue const& v) {
+Maybe<Json> LuaConverter<Json>::to(LuaEngine& engine, LuaValue const& v) {
   if (v == LuaNil)
     return Json();
 
@@ -186,6 +199,9 @@ Maybe<Json> LuaConverter<Json>::to(LuaEngine&, LuaValue const& v) {
   if (v.is<LuaTable>())
     return LuaDetail::tableToJsonContainer(v.get<LuaTable>());
 
+  if (v.is<LuaUserData>())
+    return engine.jsonProxyValue(v);
+
   return {};
 }
 
@@ -223,6 +239,65 @@ Maybe<JsonArray> LuaConverter<JsonArray>::to(LuaEngine& engine, LuaValue v) {
   return {};
 }
 
+static thread_local LuaSampleProfiler* s_currentSampleProfiler = nullptr;
+
+LuaSampleProfiler* LuaSampleProfiler::current() {
+  return s_currentSampleProfiler;
+}
+
+void LuaSampleProfiler::setCurrent(LuaSampleProfiler* profiler) {
+  s_currentSampleProfiler = profiler;
+}
+
+LuaSampleProfiler::LuaSampleProfiler(int64_t sampleInterval)
+  : m_sampleInterval(max<int64_t>(sampleInterval, 1)), m_sampleCount(0) {}
+
+int64_t LuaSampleProfiler::sampleInterval() const {
+  return m_sampleInterval;
+}
+
+void LuaSampleProfiler::addSample(String const& script, String const& stack, uint64_t count) {
+  MutexLocker locker(m_mutex);
+  m_stacks[stack] += count;
+  m_scripts[script] += count;
+  m_sampleCount += count;
+}
+
+uint64_t LuaSampleProfiler::sampleCount() const {
+  MutexLocker locker(m_mutex);
+  return m_sampleCount;
+}
+
+String LuaSampleProfiler::foldedStacks() const {
+  MutexLocker locker(m_mutex);
+  auto stacks = m_stacks.pairs();
+  locker.unlock();
+
+  sort(stacks);
+  String folded;
+  for (auto const& p : stacks)
+    folded += strf("{} {}\n", p.first, p.second);
+  return folded;
+}
+
+List<pair<String, uint64_t>> LuaSampleProfiler::scriptTotals() const {
+  MutexLocker locker(m_mutex);
+  auto totals = m_scripts.pairs();
+  locker.unlock();
+
+  sort(totals, [](auto const& a, auto const& b) {
+      return a.second > b.second || (a.second == b.second && a.first < b.first);
+    });
+  return totals;
+}
+
+void LuaSampleProfiler::clear() {
+  MutexLocker locker(m_mutex);
+  m_stacks.clear();
+  m_scripts.clear();
+  m_sampleCount = 0;
+}
+
 LuaEnginePtr LuaEngine::create(bool safe) {
   LuaEnginePtr self(new LuaEngine);
 
@@ -232,6 +307,7 @@ LuaEnginePtr LuaEngine::create(bool safe) {
   self->m_scriptDefaultEnvRegistryId = LUA_NOREF;
   self->m_wrappedFunctionMetatableRegistryId = LUA_NOREF;
   self->m_requireFunctionMetatableRegistryId = LUA_NOREF;
+  self->m_jsonProxyMetatableRegistryId = LUA_NOREF;
 
   self->m_instructionLimit = 0;
   self->m_profilingEnabled = false;
@@ -240,6 +316,8 @@ LuaEnginePtr LuaEngine::create(bool safe) {
   self->m_recursionLevel = 0;
   self->m_recursionLimit = 0;
   self->m_nullTerminated = 0;
+  self->m_sampleProfiler = nullptr;
+  self->m_nextSampleTime = 0;
 
   if (!self->m_state)
     throw LuaException("Failed to initialize Lua");
@@ -300,6 +378,152 @@ LuaEnginePtr LuaEngine::create(bool safe) {
   LuaDetail::rawSetField(self->m_state, -2, "__metatable");
   self->m_requireFunctionMetatableRegistryId = luaL_ref(self->m_state, LUA_REGISTRYINDEX);
 
+  // Create the common metatable for Json proxies
+  lua_newtable(self->m_state);
+  lua_pushcfunction(self->m_state, [](lua_State* state) {
+    auto json = (Json*)lua_touserdata(state, 1);
+    json->~Json();
+    return 0;
+  });
+  LuaDetail::rawSetField(self->m_state, -2, "__gc");
+  lua_pushcfunction(self->m_state, [](lua_State* state) {
+    lua_settop(state, 2);
+    try {
+      pushJsonProxyEntry(state, 1, 2);
+    } catch (std::exception const& e) {
+      lua_pushstring(state, printException(e, false).c_str());
+      return lua_error(state);
+    }
+    return 1;
+  });
+  LuaDetail::rawSetField(self->m_state, -2, "__index");
+  lua_pushcfunction(self->m_state, [](lua_State* state) {
+    lua_settop(state, 3);
+    lua_checkstack(state, 3);
+    if (lua_getiuservalue(state, 1, JsonProxyWritten) != LUA_TTABLE) {
+      lua_pop(state, 1);
+      lua_newtable(state);
+      lua_pushvalue(state, -1);
+      lua_setiuservalue(state, 1, JsonProxyWritten);
+    }
+    lua_pushvalue(state, 2);
+    if (lua_isnil(state, 3))
+      lua_pushlightuserdata(state, &s_jsonProxyNilKey);
+    else
+      lua_pushvalue(state, 3);
+    lua_rawset(state, 4);
+    return 0;
+  });
+  LuaDetail::rawSetField(self->m_state, -2, "__newindex");
+  lua_pushcfunction(self->m_state, [](lua_State* state) {
+    lua_checkstack(state, 2);
+    auto json = (Json*)lua_touserdata(state, 1);
+    lua_Integer length = json->isType(Json::Type::Array) ? (lua_Integer)json->size() : 0;
+    if (lua_getiuservalue(state, 1, JsonProxyWritten) == LUA_TTABLE) {
+      // Written entries may move the border of the array part either way.
+      auto isWritten = [state](lua_Integer i, bool removed) {
+        int type = lua_rawgeti(state, -1, i);
+        bool isRemoved = type == LUA_TLIGHTUSERDATA && lua_touserdata(state, -1) == &s_jsonProxyNilKey;
+        lua_pop(state, 1);
+        return type != LUA_TNIL && isRemoved == removed;
+      };
+      while (length > 0 && isWritten(length, true))
+        --length;
+      while (isWritten(length + 1, false))
+        ++length;
+    }
+    lua_pushinteger(state, length);
+    return 1;
+  });
+  LuaDetail::rawSetField(self->m_state, -2, "__len");
+  lua_pushcfunction(self->m_state, [](lua_State* state) {
+    // Visits the entries of the Json in order, then any new keys written into
+    // the proxy, skipping entries that are nil.
+    lua_pushcfunction(state, [](lua_State* state) {
+      lua_settop(state, 2);
+      lua_checkstack(state, 4);
+      auto json = (Json*)lua_touserdata(state, 1);
+
+      try {
+        if (json->isType(Json::Type::Array)) {
+          auto array = json->arrayPtr();
+          auto isJsonKey = [&](int index) {
+            int isInteger = 0;
+            lua_Integer i = lua_type(state, index) == LUA_TNUMBER ? lua_tointegerx(state, index, &isInteger) : 0;
+            return isInteger && i >= 1 && (size_t)i <= array->size();
+          };
+
+          if (lua_isnil(state, 2) || isJsonKey(2)) {
+            for (size_t i = lua_isnil(state, 2) ? 0 : (size_t)lua_tointeger(state, 2); i < array->size(); ++i) {
+              lua_pushinteger(state, i + 1);
+              pushJsonProxyEntry(state, 1, -1);
+              if (!lua_isnil(state, -1))
+                return 2;
+              lua_pop(state, 2);
+            }
+            lua_pushnil(state);
+            lua_replace(state, 2);
+          }
+
+          if (lua_getiuservalue(state, 1, JsonProxyWritten) != LUA_TTABLE)
+            return 0;
+          lua_pushvalue(state, 2);
+          while (lua_next(state, 3) != 0) {
+            if (!isJsonKey(-2) && !(lua_islightuserdata(state, -1) && lua_touserdata(state, -1) == &s_jsonProxyNilKey))
+              return 2;
+            lua_pop(state, 1);
+          }
+          return 0;
+
+        } else {
+          auto object = json->objectPtr();
+          auto findJsonKey = [&](int index) {
+            if (lua_type(state, index) != LUA_TSTRING)
+              return object->end();
+            size_t size = 0;
+            char const* key = lua_tolstring(state, index, &size);
+            return object->find(String(key, size));
+          };
+
+          auto i = lua_isnil(state, 2) ? object->begin() : findJsonKey(2);
+          if (i != object->end()) {
+            if (!lua_isnil(state, 2))
+              ++i;
+            for (; i != object->end(); ++i) {
+              lua_pushlstring(state, i->first.utf8Ptr(), i->first.utf8Size());
+              pushJsonProxyEntry(state, 1, -1);
+              if (!lua_isnil(state, -1))
+                return 2;
+              lua_pop(state, 2);
+            }
+            lua_pushnil(state);
+            lua_replace(state, 2);
+          }
+
+          if (lua_getiuservalue(state, 1, JsonProxyWritten) != LUA_TTABLE)
+            return 0;
+          lua_pushvalue(state, 2);
+          while (lua_next(state, 3) != 0) {
+            if (findJsonKey(-2) == object->end() && !(lua_islightuserdata(state, -1) && lua_touserdata(state, -1) == &s_jsonProxyNilKey))
+              return 2;
+            lua_pop(state, 1);
+          }
+          return 0;
+        }
+      } catch (std::exception const& e) {
+        lua_pushstring(state, printException(e, false).c_str());
+        return lua_error(state);
+      }
+    });
+    lua_pushvalue(state, 1);
+    lua_pushnil(state);
+    return 3;
+  });
+  LuaDetail::rawSetField(self->m_state, -2, "__pairs");
+  lua_pushboolean(self->m_state, 0);
+  LuaDetail::rawSetField(self->m_state, -2, "__metatable");
+  self->m_jsonProxyMetatableRegistryId = luaL_ref(self->m_state, LUA_REGISTRYINDEX);
+
   // Load all base libraries and prune them of unsafe functions
 
   luaL_requiref(self->m_state, "_ENV", luaopen_base, true);
@@ -506,6 +730,14 @@ unsigned LuaEngine::recursionLimit() const {
   return m_recursionLimit;
 }
 
+void LuaEngine::setJsonProxyMinimumSize(Maybe<size_t> minimumSize) {
+  m_jsonProxyMinimumSize = minimumSize;
+}
+
+Maybe<size_t> LuaEngine::jsonProxyMinimumSize() const {
+  return m_jsonProxyMinimumSize;
+}
+
 ByteArray LuaEngine::compile(char const* contents, size_t size, char const* name) {
   ZoneScoped;
 #ifdef TRACY_ENABLE
@@ -535,6 +767,45 @@ ByteArray LuaEngine::compile(ByteArray const& contents, String const& name) {
   return compile(contents.ptr(), contents.size(), name.empty() ? nullptr : name.utf8Ptr());
 }
 
+ByteArray LuaEngine::compilePrototype(char const* contents, size_t size, char const* name) {
+  if (isPrecompiled(contents, size))
+    throw LuaException::format("Cannot compile precompiled chunk '{}' as a prototype", name ? name : "");
+
+  // Keep the prefix on the first line so that line numbers are unchanged.
+  std::string source;
+  source.reserve(size + 64);
+  source.append("return function(_ENV, ...) ");
+  source.append(contents, size);
+  source.append("\nend");
+  return compile(source.data(), source.size(), name);
+}
+
+ByteArray LuaEngine::compilePrototype(ByteArray const& contents, String const& name) {
+  return compilePrototype(contents.ptr(), contents.size(), name.empty() ? nullptr : name.utf8Ptr());
+}
+
+bool LuaEngine::isPrecompiled(char const* contents, size_t size) {
+  return size > 0 && contents[0] == LUA_SIGNATURE[0];
+}
+
+bool LuaEngine::isPrecompiled(ByteArray const& contents) {
+  return isPrecompiled(contents.ptr(), contents.size());
+}
+
+LuaFunction LuaEngine::loadPrototype(ByteArray const& prototype, String const& name) {
+  lua_checkstack(m_state, 2);
+
+  handleError(m_state, luaL_loadbuffer(m_state, prototype.ptr(), prototype.size(), name.empty() ? nullptr : name.utf8Ptr()));
+  // Running the chunk only creates the closure it returns.
+  handleError(m_state, lua_pcall(m_state, 0, 1, 0));
+  if (lua_type(m_state, -1) != LUA_TFUNCTION) {
+    lua_pop(m_state, 1);
+    throw LuaException::format("Chunk '{}' is not a compiled prototype", name);
+  }
+
+  return LuaFunction(LuaDetail::LuaHandle(RefPtr<LuaEngine>(this), popHandle(m_state)));
+}
+
 LuaString LuaEngine::createString(std::string const& str) {
   lua_checkstack(m_state, 1);
 
@@ -683,6 +954,9 @@ void LuaEngine::countHook(lua_State* state, lua_Debug* ar) {
     lua_error(state);
   }
 
+  if (self->m_sampleProfiler)
+    self->sampleStack(state);
+
   if (self->m_profilingEnabled) {
     // find bottom of the stack
     // ar will contain the stack info from the last call that returns 1
@@ -1041,6 +1315,18 @@ void LuaEngine::contextLoad(int handleIndex, char const* contents, size_t size,
   handleError(m_state, res);
 }
 
+void LuaEngine::contextLoadPrototype(int handleIndex, int prototypeHandleIndex) {
+  lua_checkstack(m_state, 3);
+
+  pushHandle(m_state, prototypeHandleIndex);
+  pushHandle(m_state, handleIndex);
+
+  incrementRecursionLevel();
+  int res = pcallWithTraceback(m_state, 1, 0);
+  decrementRecursionLevel();
+  handleError(m_state, res);
+}
+
 LuaDetail::LuaFunctionReturn LuaEngine::contextEval(int handleIndex, String const& lua) {
   int stackSize = lua_gettop(m_state);
   lua_checkstack(m_state, 2);
@@ -1205,6 +1491,11 @@ LuaFunction LuaEngine::createWrappedFunction(LuaDetail::LuaWrappedFunction funct
         res = (*func)(*self, argumentCount, args.ptr());
       }
 
+      // Time spent in callbacks is not seen by the count hook, so catch up
+      // on samples here while the callback is still on the stack.
+      if (self->m_sampleProfiler)
+        self->sampleStack(state);
+
       if (auto val = res.ptr<LuaValue>()) {
         self->pushLuaValue(state, *val);
         return 1;
@@ -1358,6 +1649,14 @@ void LuaEngine::incrementRecursionLevel() {
   // level* function entrance, not on recursive entrances.
   if (m_recursionLevel == 0) {
     m_instructionCount = 0;
+
+    auto sampleProfiler = LuaSampleProfiler::current();
+    if (sampleProfiler != m_sampleProfiler) {
+      m_sampleProfiler = sampleProfiler;
+      updateCountHook();
+    }
+    if (m_sampleProfiler)
+      m_nextSampleTime = Time::monotonicMicroseconds() + m_sampleProfiler->sampleInterval();
   }
 
   if (m_recursionLimit != 0 && m_recursionLevel == m_recursionLimit)
@@ -1372,14 +1671,278 @@ void LuaEngine::decrementRecursionLevel() {
 }
 
 void LuaEngine::updateCountHook() {
-  if (m_instructionLimit || m_profilingEnabled)
+  if (m_instructionLimit || m_profilingEnabled || m_sampleProfiler)
     lua_sethook(m_state, &LuaEngine::countHook, LUA_MASKCOUNT, m_instructionMeasureInterval);
   else
     lua_sethook(m_state, &LuaEngine::countHook, 0, 0);
 }
 
+void LuaEngine::sampleStack(lua_State* state) {
+  int64_t now = Time::monotonicMicroseconds();
+  if (now < m_nextSampleTime)
+    return;
+
+  int64_t sampleInterval = m_sampleProfiler->sampleInterval();
+  uint64_t count = 1 + (now - m_nextSampleTime) / sampleInterval;
+  m_nextSampleTime += count * sampleInterval;
+
+  // Walk outwards from the innermost frame, the script is that of the
+  // outermost lua function.
+  int const MaxSampleDepth = 64;
+  lua_Debug ar;
+  StringList frames;
+  String script = "[C]";
+  for (int level = 0; level < MaxSampleDepth && lua_getstack(state, level, &ar) == 1; ++level) {
+    if (lua_getinfo(state, "nS", &ar) == 0)
+      break;
+
+    String name = ar.name ? String(ar.name) : strcmp(ar.what, "main") == 0 ? String("<main>") : String("<anonymous>");
+    if (strcmp(ar.what, "C") == 0) {
+      frames.append(strf("[C] {}", name.replace(";", ":")));
+    } else {
+      script = ar.short_src;
+      frames.append(String(strf("{} ({}:{})", name, ar.short_src, ar.linedefined)).replace(";", ":"));
+    }
+  }
+
+  reverse(frames);
+  m_sampleProfiler->addSample(script, frames.join(";"), count);
+}
+
+LuaUserData LuaEngine::createJsonProxy(Json const& container) {
+  pushJsonProxy(m_state, container);
+  return LuaUserData(LuaDetail::LuaHandle(RefPtr<LuaEngine>(this), popHandle(m_state)));
+}
+
+Maybe<Json> LuaEngine::jsonProxyValue(LuaValue const& value) {
+  auto userData = value.ptr<LuaUserData>();
+  if (!userData)
+    return {};
+
+  lua_checkstack(m_state, 3);
+  pushHandle(m_state, userData->handleIndex());
+  if (!toJsonProxy(m_state, -1)) {
+    lua_pop(m_state, 1);
+    return {};
+  }
+
+  try {
+    auto contents = jsonProxyContents(m_state, -1);
+    lua_pop(m_state, 1);
+    return contents;
+  } catch (...) {
+    lua_pop(m_state, 1);
+    throw;
+  }
+}
+
+Json* LuaEngine::toJsonProxy(lua_State* state, int index) {
+  if (lua_type(state, index) != LUA_TUSERDATA || lua_getmetatable(state, index) == 0)
+    return nullptr;
+
+  lua_rawgeti(state, LUA_REGISTRYINDEX, luaEnginePtr(state)->m_jsonProxyMetatableRegistryId);
+  bool isProxy = lua_rawequal(state, -1, -2);
+  lua_pop(state, 2);
+
+  return isProxy ? (Json*)lua_touserdata(state, index) : nullptr;
+}
+
+void LuaEngine::pushJsonProxyEntry(lua_State* state, int proxyIndex, int keyIndex) {
+  lua_checkstack(state, 4);
+
+  proxyIndex = lua_absindex(state, proxyIndex);
+  keyIndex = lua_absindex(state, keyIndex);
+
+  if (lua_getiuservalue(state, proxyIndex, JsonProxyWritten) == LUA_TTABLE) {
+    lua_pushvalue(state, keyIndex);
+    if (lua_rawget(state, -2) != LUA_TNIL) {
+      lua_remove(state, -2);
+      if (lua_islightuserdata(state, -1) && lua_touserdata(state, -1) == &s_jsonProxyNilKey) {
+        lua_pop(state, 1);
+        lua_pushnil(state);
+      }
+      return;
+    }
+    lua_pop(state, 1);
+  }
+  lua_pop(state, 1);
+
+  int cacheType = lua_getiuservalue(state, proxyIndex, JsonProxyRead);
+  if (cacheType == LUA_TTABLE) {
+    lua_pushvalue(state, keyIndex);
+    if (lua_rawget(state, -2) != LUA_TNIL) {
+      lua_remove(state, -2);
+      return;
+    }
+    lua_pop(state, 1);
+  }
+
+  auto json = (Json*)lua_touserdata(state, proxyIndex);
+  Json const* entry = nullptr;
+  if (json->isType(Json::Type::Array)) {
+    int isInteger = 0;
+    lua_Integer i = lua_type(state, keyIndex) == LUA_TNUMBER ? lua_tointegerx(state, keyIndex, &isInteger) : 0;
+    auto array = json->arrayPtr();
+    if (isInteger && i >= 1 && (size_t)i <= array->size())
+      entry = &(*array)[i - 1];
+  } else if (lua_type(state, keyIndex) == LUA_TSTRING) {
+    size_t size = 0;
+    char const* key = lua_tolstring(state, keyIndex, &size);
+    entry = json->objectPtr()->ptr(String(key, size));
+  }
+
+  if (!entry) {
+    lua_pushnil(state);
+  } else if (entry->isType(Json::Type::Null)) {
+    lua_pushnil(state);
+  } else if (entry->isType(Json::Type::Bool)) {
+    lua_pushboolean(state, entry->toBool());
+  } else if (entry->isType(Json::Type::Int)) {
+    lua_pushinteger(state, entry->toInt());
+  } else if (entry->isType(Json::Type::Float)) {
+    lua_pushnumber(state, entry->toDouble());
+  } else if (entry->isType(Json::Type::String)) {
+    auto string = entry->stringPtr();
+    lua_pushlstring(state, string->utf8Ptr(), string->utf8Size());
+  } else {
+    // Containers are converted once and kept, so that they keep their
+    // identity and any values written into them.
+    auto engine = luaEnginePtr(state);
+    engine->pushLuaValue(state, engine->luaFrom<Json>(*entry));
+    if (cacheType != LUA_TTABLE) {
+      lua_newtable(state);
+      lua_pushvalue(state, -1);
+      lua_setiuservalue(state, proxyIndex, JsonProxyRead);
+      lua_replace(state, -3);
+    }
+    lua_pushvalue(state, keyIndex);
+    lua_pushvalue(state, -2);
+    lua_rawset(state, -4);
+  }
+  lua_remove(state, -2);
+}
+
+void LuaEngine::pushJsonProxy(lua_State* state, Json const& container) {
+  if (!container.isType(Json::Type::Array) && !container.isType(Json::Type::Object))
+    throw LuaException("Json proxies can only be created from arrays and objects");
+
+  lua_checkstack(state, 2);
+
+  new (lua_newuserdatauv(state, sizeof(Json), 2)) Json(container);
+  lua_rawgeti(state, LUA_REGISTRYINDEX, m_jsonProxyMetatableRegistryId);
+  lua_setmetatable(state, -2);
+}
+
+// Whether both are the same shared array or object, which is much quicker to
+// check than whether they are equal.
+static bool sameJsonContainer(Json const& a, Json const& b) {
+  if (a.isType(Json::Type::Array) && b.isType(Json::Type::Array))
+    return a.arrayPtr() == b.arrayPtr();
+  if (a.isType(Json::Type::Object) && b.isType(Json::Type::Object))
+    return a.objectPtr() == b.objectPtr();
+  return false;
+}
+
+Maybe<Json> LuaEngine::jsonProxyContents(lua_State* state, int index) {
+  lua_checkstack(state, 4);
+
+  index = lua_absindex(state, index);
+  Json const& json = *(Json*)lua_touserdata(state, index);
+
+  // Take the written and read entries off the stack before converting
+  // anything, so that a failed conversion leaves the stack as it was.
+  auto takeEntries = [&](int userValue) {
+    List<pair<LuaValue, LuaValue>> entries;
+    if (lua_getiuservalue(state, index, userValue) == LUA_TTABLE) {
+      lua_pushnil(state);
+      while (lua_next(state, -2) != 0) {
+        LuaValue value = popLuaValue(state);
+        lua_pushvalue(state, -1);
+        entries.append({popLuaValue(state), std::move(value)});
+      }
+    }
+    lua_pop(state, 1);
+    return entries;
+  };
+  List<pair<LuaValue, LuaValue>> written = takeEntries(JsonProxyWritten);
+  List<pair<LuaValue, LuaValue>> read = takeEntries(JsonProxyRead);
+
+  // Nested containers that were read may have been modified through the
+  // values they were converted to, and are only applied if they were.
+  // Proxies of unmodified containers hand back the very same Json.
+  List<pair<LuaValue, Json>> modifiedReads;
+  for (auto const& p : read) {
+    if (written.any([&](auto const& w) { return w.first == p.first; }))
+      continue;
+    Json const* entry;
+    if (json.isType(Json::Type::Array))
+      entry = &json.arrayPtr()->at(*LuaDetail::asInteger(p.first) - 1);
+    else
+      entry = &json.objectPtr()->get(p.first.get<LuaString>().toString());
+    auto value = luaMaybeTo<Json>(p.second);
+    if (!value)
+      return {};
+    if (!sameJsonContainer(*value, *entry) && *value != *entry)
+      modifiedReads.append({p.first, value.take()});
+  }
+
+  if (written.empty() && modifiedReads.empty())
+    return json;
+
+  // Written entries are applied the same way tableToJsonContainer reads a
+  // table, removed entries become nulls.
+  auto entryValue = [this](LuaValue const& value) -> Maybe<Json> {
+    if (auto u = value.ptr<LuaLightUserData>()) {
+      if (*u == &s_jsonProxyNilKey)
+        return Json();
+    }
+    return luaMaybeTo<Json>(value);
+  };
+
+  if (json.isType(Json::Type::Array)) {
+    JsonArray array = json.toArray();
+    for (auto& p : modifiedReads)
+      array[*LuaDetail::asInteger(p.first) - 1] = std::move(p.second);
+    JsonObject stringEntries;
+    for (auto const& p : written) {
+      auto value = entryValue(p.second);
+      if (!value)
+        return {};
+      auto i = LuaDetail::asInteger(p.first);
+      if (i && *i >= 1) {
+        array.set(*i - 1, value.take());
+      } else {
+        auto key = luaMaybeTo<String>(p.first);
+        if (!key)
+          return {};
+        stringEntries[key.take()] = value.take();
+      }
+    }
+
+    if (stringEntries.empty())
+      return Json(std::move(array));
+    for (size_t i = 0; i < array.size(); ++i)
+      stringEntries[toString(i + 1)] = std::move(array[i]);
+    return Json(std::move(stringEntries));
+
+  } else {
+    JsonObject object = json.toObject();
+    for (auto& p : modifiedReads)
+      object[p.first.get<LuaString>().toString()] = std::move(p.second);
+    for (auto const& p : written) {
+      auto value = entryValue(p.second);
+      auto key = luaMaybeTo<String>(p.first);
+      if (!value || !key)
+        return {};
+      object[key.take()] = value.take();
+    }
+    return Json(std::move(object));
+  }
+}
+
 int LuaEngine::s_luaInstructionLimitExceptionKey = 0;
 int LuaEngine::s_luaRecursionLimitExceptionKey = 0;
+int LuaEngine::s_jsonProxyNilKey = 0;
 
 void LuaDetail::rawSetField(lua_State* state, int index, char const* key) {
   lua_checkstack(state, 1);
@@ -11,6 +11,7 @@
 #include "StarLogging.hpp"
 #include "StarRefPtr.hpp"
 #include "StarString.hpp"
+#include "StarThread.hpp"
 
 #if defined TRACY_ENABLE
 #include "tracy/Tracy.hpp"
@@ -719,6 +720,8 @@ public:
   void load(char const* contents, size_t size, char const* name = nullptr);
   void load(String const& contents, String const& name = String());
   void load(ByteArray const& contents, String const& name = String());
+  // Runs a prototype from LuaEngine::loadPrototype in this context.
+  void load(LuaFunction const& prototype);
 
   // Evaluate a piece of lua code in this context, similar to the lua repl.
   // Can evaluate both expressions and statements.
@@ -854,6 +857,53 @@ struct LuaProfileEntry {
   HashMap<tuple<String, unsigned>, shared_ptr<LuaProfileEntry>> calls;
 };
 
+STAR_CLASS(LuaSampleProfiler);
+
+// Samples the lua call stacks of every LuaEngine run on a thread it is made
+// current on.  Each time a script has run for another sample interval, the
+// engine records its call stack, ending with the C++ callback it is in, if
+// any.  Engines only check for a due sample on their instruction count hook
+// and when returning from a callback, so a sample that comes due in between
+// is taken late and weighted by the number of intervals that have passed.
+//
+// Samples can be added from several threads at once.
+class LuaSampleProfiler {
+public:
+  // The profiler engines record samples in on this thread, if any.  Only
+  // picked up by an engine on its top level entry.
+  static LuaSampleProfiler* current();
+  // Pass nullptr to stop sampling on this thread.
+  static void setCurrent(LuaSampleProfiler* profiler);
+
+  // Sample interval is in microseconds of script execution time.
+  explicit LuaSampleProfiler(int64_t sampleInterval = 1000);
+
+  int64_t sampleInterval() const;
+
+  // Adds samples of a ';' separated call stack, outermost frame first, along
+  // with the script source of its outermost lua function.
+  void addSample(String const& script, String const& stack, uint64_t count = 1);
+
+  uint64_t sampleCount() const;
+
+  // All collected stacks in the folded format read by flame graph tools, one
+  // "frame;frame;frame count" line per distinct stack.
+  String foldedStacks() const;
+
+  // Sample counts per script source, highest first.
+  List<pair<String, uint64_t>> scriptTotals() const;
+
+  void clear();
+
+private:
+  int64_t m_sampleInterval;
+
+  mutable Mutex m_mutex;
+  HashMap<String, uint64_t> m_stacks;
+  StringMap<uint64_t> m_scripts;
+  uint64_t m_sampleCount;
+};
+
 // This class represents one execution engine in lua, holding a single
 // lua_State.  Multiple contexts can be created, and they will have separate
 // global environments and cannot affect each other.  Individual LuaEngines /
@@ -904,6 +954,17 @@ public:
   void setRecursionLimit(unsigned recursionLimit = 0);
   unsigned recursionLimit() const;
 
+  // If set, Json arrays and objects with at least this many entries are
+  // converted to lazy proxy userdata rather than being deep copied into lua
+  // tables.  Proxies share the original Json, support indexing, #, pairs and
+  // ipairs, and keep any values written into them separately so that the
+  // Json is only copied again when a modified proxy is converted back.  Since
+  // proxies are not tables, scripts that check type() or use the table
+  // library on converted Json will see a difference, so this is unset by
+  // default.
+  void setJsonProxyMinimumSize(Maybe<size_t> minimumSize = {});
+  Maybe<size_t> jsonProxyMinimumSize() const;
+
   // Compile a given script into bytecode.  If name is given, then it will be
   // used as the internal name for the resulting chunk and will provide better
   // error messages.
@@ -915,6 +976,26 @@ public:
   ByteArray compile(String const& contents, String const& name = String());
   ByteArray compile(ByteArray const& contents, String const& name = String());
 
+  // Compiles a script source, which may not be bytecode, into a prototype that
+  // can be loaded with loadPrototype and then run in any number of contexts.
+  // The script is compiled as the body of a function taking the context's
+  // environment, so running it in a new context only creates the closures of
+  // its functions, while their code and constants are shared by every context
+  // run from the same prototype.  Each context still gets its own globals and
+  // top level locals, so contexts are as isolated as with compile.  Line
+  // numbers are unchanged, but tracebacks show the main chunk as a function.
+  ByteArray compilePrototype(char const* contents, size_t size, char const* name = nullptr);
+  ByteArray compilePrototype(ByteArray const& contents, String const& name = String());
+
+  // Whether the given script is already bytecode, which compilePrototype
+  // cannot take, rather than source.
+  static bool isPrecompiled(char const* contents, size_t size);
+  static bool isPrecompiled(ByteArray const& contents);
+
+  // Loads a compiled prototype into this engine, to be run in contexts with
+  // LuaContext::load.
+  LuaFunction loadPrototype(ByteArray const& prototype, String const& name = String());
+
   // Generic from/to lua conversion, calls template specialization of
   // LuaConverter for actual conversion.
   template <typename T>
@@ -969,6 +1050,13 @@ public:
   template <typename T>
   LuaUserData createUserData(T t);
 
+  // Creates a lazy proxy for a Json array or object, regardless of the
+  // configured minimum proxy size.
+  LuaUserData createJsonProxy(Json const& container);
+  // Returns the current contents of the given value if it is a Json proxy,
+  // including any values written into it from lua.
+  Maybe<Json> jsonProxyValue(LuaValue const& value);
+
   LuaContext createContext();
 
   // Global environment changes only affect newly created contexts
@@ -1017,11 +1105,25 @@ private:
   // Get the LuaEngine* out of the lua registry magic entry.  Uses 1 stack
   // space, and does not call lua_checkstack.
   static LuaEngine* luaEnginePtr(lua_State* state);
-  // Counts instructions when instruction limiting is enabled.
+  // Counts instructions when instruction limiting is enabled, and takes
+  // samples for the current LuaSampleProfiler.
   static void countHook(lua_State* state, lua_Debug* ar);
 
   static void* allocate(void* userdata, void* ptr, size_t oldSize, size_t newSize);
 
+  // Returns the Json behind the proxy userdata at the given index, or nullptr
+  // if the value there is not a Json proxy.  Uses 2 stack spaces.
+  static Json* toJsonProxy(lua_State* state, int index);
+  // Pushes the entry of the Json proxy at proxyIndex under the key at
+  // keyIndex, preferring any value written into the proxy.
+  static void pushJsonProxyEntry(lua_State* state, int proxyIndex, int keyIndex);
+  // Pushes a lazy proxy for the given Json array or object.
+  void pushJsonProxy(lua_State* state, Json const& container);
+  // Json contents of the proxy at the given index, with its written entries
+  // and any modified nested containers applied, or the original Json if there
+  // are none.  Fails if a written key or value has no Json equivalent.
+  Maybe<Json> jsonProxyContents(lua_State* state, int index);
+
   // Pops lua error from stack and throws LuaException
   void handleError(lua_State* state, int res);
 
@@ -1072,6 +1174,7 @@ private:
   void setContextRequire(int handleIndex, LuaContext::RequireFunction requireFunction);
 
   void contextLoad(int handleIndex, char const* contents, size_t size, char const* name);
+  void contextLoadPrototype(int handleIndex, int prototypeHandleIndex);
 
   LuaDetail::LuaFunctionReturn contextEval(int handleIndex, String const& lua);
 
@@ -1106,16 +1209,23 @@ private:
 
   void updateCountHook();
 
+  // Records the call stack of the given state in the active sample profiler,
+  // if a sample has come due.
+  void sampleStack(lua_State* state);
+
   // The following fields exist to use their addresses as unique lightuserdata,
   // as is recommended by the lua docs.
   static int s_luaInstructionLimitExceptionKey;
   static int s_luaRecursionLimitExceptionKey;
+  // Stored in place of nil for entries removed from a Json proxy.
+  static int s_jsonProxyNilKey;
 
   lua_State* m_state;
   int m_pcallTracebackMessageHandlerRegistryId;
   int m_scriptDefaultEnvRegistryId;
   int m_wrappedFunctionMetatableRegistryId;
   int m_requireFunctionMetatableRegistryId;
+  int m_jsonProxyMetatableRegistryId;
   HashMap<std::type_index, int> m_registeredUserDataTypes;
 
   lua_State* m_handleThread;
@@ -1130,6 +1240,9 @@ private:
   unsigned m_recursionLevel;
   unsigned m_recursionLimit;
   int m_nullTerminated;
+  Maybe<size_t> m_jsonProxyMinimumSize;
+  LuaSampleProfiler* m_sampleProfiler;
+  int64_t m_nextSampleTime;
   HashMap<tuple<String, unsigned>, shared_ptr<LuaProfileEntry>> m_profileEntries;
 };
 
@@ -0,0 +1,63 @@
+#ifndef STAR_MEMORY_MAPPED_FILE_HPP
+#define STAR_MEMORY_MAPPED_FILE_HPP
+
+#include "StarString.hpp"
+
+namespace Star {
+
+STAR_CLASS(MemoryMappedFile);
+
+// A read-only mapping of an entire file into memory.  Reading from the mapping
+// is a plain memory access, so any number of threads may read from it at once
+// without seeking, locking or system calls.  The file must not be modified
+// while it is mapped.
+class MemoryMappedFile {
+public:
+  enum class Advice {
+    Normal,
+    Sequential,
+    Random,
+    WillNeed
+  };
+
+  // Maps the whole of the given file, throws IOException on failure.
+  static MemoryMappedFilePtr open(String const& filename);
+
+  ~MemoryMappedFile();
+
+  MemoryMappedFile(MemoryMappedFile const&) = delete;
+  MemoryMappedFile& operator=(MemoryMappedFile const&) = delete;
+
+  String const& fileName() const;
+
+  // Null if the file is empty.
+  char const* data() const;
+  size_t size() const;
+
+  // Hints how the given range of the file is going to be accessed.  Ignored
+  // where unsupported.
+  void advise(size_t offset, size_t size, Advice advice) const;
+
+private:
+  MemoryMappedFile(String filename, char const* data, size_t size);
+
+  String m_filename;
+  char const* m_data;
+  size_t m_size;
+};
+
+inline String const& MemoryMappedFile::fileName() const {
+  return m_filename;
+}
+
+inline char const* MemoryMappedFile::data() const {
+  return m_data;
+}
+
+inline size_t MemoryMappedFile::size() const {
+  return m_size;
+}
+
+}
+
+#endif
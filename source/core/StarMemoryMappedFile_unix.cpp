@@ -0,0 +1,69 @@
+#include "StarMemoryMappedFile.hpp"
+#include "StarIODevice.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace Star {
+
+MemoryMappedFilePtr MemoryMappedFile::open(String const& filename) {
+  int fd = ::open(filename.utf8Ptr(), O_RDONLY);
+  if (fd < 0)
+    throw IOException::format("Could not open file '{}' for mapping: {}", filename, strerror(errno));
+
+  // The mapping stays valid after the descriptor is closed.
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    int error = errno;
+    ::close(fd);
+    throw IOException::format("Could not stat file '{}' for mapping: {}", filename, strerror(error));
+  }
+
+  size_t size = st.st_size;
+  void* data = nullptr;
+  if (size != 0) {
+    data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      int error = errno;
+      ::close(fd);
+      throw IOException::format("Could not map file '{}': {}", filename, strerror(error));
+    }
+  }
+  ::close(fd);
+
+  return MemoryMappedFilePtr(new MemoryMappedFile(filename, (char const*)data, size));
+}
+
+MemoryMappedFile::MemoryMappedFile(String filename, char const* data, size_t size)
+  : m_filename(std::move(filename)), m_data(data), m_size(size) {}
+
+MemoryMappedFile::~MemoryMappedFile() {
+  if (m_data)
+    ::munmap((void*)m_data, m_size);
+}
+
+void MemoryMappedFile::advise(size_t offset, size_t size, Advice advice) const {
+  if (!m_data || offset >= m_size)
+    return;
+
+  // madvise needs a page aligned start.
+  size_t pageSize = ::sysconf(_SC_PAGESIZE);
+  size_t start = offset - offset % pageSize;
+  size_t end = min(offset + size, m_size);
+
+  int flag = MADV_NORMAL;
+  if (advice == Advice::Sequential)
+    flag = MADV_SEQUENTIAL;
+  else if (advice == Advice::Random)
+    flag = MADV_RANDOM;
+  else if (advice == Advice::WillNeed)
+    flag = MADV_WILLNEED;
+
+  ::madvise((void*)(m_data + start), end - start, flag);
+}
+
+}
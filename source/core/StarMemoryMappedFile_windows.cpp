@@ -0,0 +1,56 @@
+#include "StarMemoryMappedFile.hpp"
+#include "StarIODevice.hpp"
+
+#include "StarString_windows.hpp"
+
+#include <windows.h>
+
+namespace Star {
+
+MemoryMappedFilePtr MemoryMappedFile::open(String const& filename) {
+  HANDLE file = CreateFileW(stringToUtf16(filename).get(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    throw IOException::format("Could not open file '{}' for mapping: {}", filename, GetLastError());
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    auto error = GetLastError();
+    CloseHandle(file);
+    throw IOException::format("Could not get the size of file '{}' for mapping: {}", filename, error);
+  }
+
+  // The view stays valid after both handles are closed.
+  size_t size = fileSize.QuadPart;
+  void* data = nullptr;
+  if (size != 0) {
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+      auto error = GetLastError();
+      CloseHandle(file);
+      throw IOException::format("Could not map file '{}': {}", filename, error);
+    }
+
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    auto error = GetLastError();
+    CloseHandle(mapping);
+    if (!data) {
+      CloseHandle(file);
+      throw IOException::format("Could not map view of file '{}': {}", filename, error);
+    }
+  }
+  CloseHandle(file);
+
+  return MemoryMappedFilePtr(new MemoryMappedFile(filename, (char const*)data, size));
+}
+
+MemoryMappedFile::MemoryMappedFile(String filename, char const* data, size_t size)
+  : m_filename(std::move(filename)), m_data(data), m_size(size) {}
+
+MemoryMappedFile::~MemoryMappedFile() {
+  if (m_data)
+    UnmapViewOfFile(m_data);
+}
+
+void MemoryMappedFile::advise(size_t, size_t, Advice) const {}
+
+}
@@ -41,6 +41,10 @@ public:
   Float get(Float x, Float y) const;
   Float get(Float x, Float y, Float z) const;
 
+  // Same as calling get(x[i], y[i]) for every point, but only dispatches on
+  // the noise type once for all of them.
+  void get(Float const* x, Float const* y, size_t count, Float* out) const;
+
   PerlinType type() const;
 
   unsigned octaves() const;
@@ -297,6 +301,26 @@ Float Perlin<Float>::get(Float x, Float y) const {
   }
 }
 
+template <typename Float>
+void Perlin<Float>::get(Float const* x, Float const* y, size_t count, Float* out) const {
+  switch (m_type) {
+    case PerlinType::Perlin:
+      for (size_t i = 0; i < count; ++i)
+        out[i] = perlin(x[i], y[i]);
+      break;
+    case PerlinType::Billow:
+      for (size_t i = 0; i < count; ++i)
+        out[i] = billow(x[i], y[i]);
+      break;
+    case PerlinType::RidgedMulti:
+      for (size_t i = 0; i < count; ++i)
+        out[i] = ridgedMulti(x[i], y[i]);
+      break;
+    default:
+      throw PerlinException("::get called on uninitialized Perlin");
+  }
+}
+
 template <typename Float>
 Float Perlin<Float>::get(Float x, Float y, Float z) const {
   switch (m_type) {
@@ -191,6 +191,7 @@ uint32_t RandomSource::gen32() {
 namespace Random {
   static Maybe<RandomSource> g_randSource;
   static Mutex g_randMutex;
+  static thread_local RandomSource* s_threadSource = nullptr;
 
   static uint64_t produceRandomSeed() {
     int64_t seed = Time::monotonicTicks();
@@ -222,6 +223,12 @@ namespace Random {
     doInit(seed);
   }
 
+  RandomSource* setThreadSource(RandomSource* source) {
+    RandomSource* previous = s_threadSource;
+    s_threadSource = source;
+    return previous;
+  }
+
   void addEntropy() {
     MutexLocker locker(g_randMutex);
     checkInit();
@@ -235,108 +242,144 @@ namespace Random {
   }
 
   uint32_t randu32() {
+    if (s_threadSource)
+      return s_threadSource->randu32();
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randu32();
   }
 
   uint64_t randu64() {
+    if (s_threadSource)
+      return s_threadSource->randu64();
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randu64();
   }
 
   int32_t randi32() {
+    if (s_threadSource)
+      return s_threadSource->randi32();
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randi32();
   }
 
   int64_t randi64() {
+    if (s_threadSource)
+      return s_threadSource->randi64();
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randi64();
   }
 
   float randf() {
+    if (s_threadSource)
+      return s_threadSource->randf();
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randf();
   }
 
   double randd() {
+    if (s_threadSource)
+      return s_threadSource->randd();
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randd();
   }
 
   float randf(float min, float max) {
+    if (s_threadSource)
+      return s_threadSource->randf(min, max);
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randf(min, max);
   }
 
   double randd(double min, double max) {
+    if (s_threadSource)
+      return s_threadSource->randd(min, max);
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randd(min, max);
   }
 
   bool randb() {
+    if (s_threadSource)
+      return s_threadSource->randb();
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randb();
   }
 
   long long randInt(long long max) {
+    if (s_threadSource)
+      return s_threadSource->randInt(max);
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randInt(max);
   }
 
   unsigned long long randUInt(unsigned long long max) {
+    if (s_threadSource)
+      return s_threadSource->randUInt(max);
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randUInt(max);
   }
 
   long long randInt(long long min, long long max) {
+    if (s_threadSource)
+      return s_threadSource->randInt(min, max);
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randInt(min, max);
   }
 
   unsigned long long randUInt(unsigned long long min, unsigned long long max) {
+    if (s_threadSource)
+      return s_threadSource->randUInt(min, max);
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randUInt(min, max);
   }
 
   float nrandf(float stddev, float mean) {
+    if (s_threadSource)
+      return s_threadSource->nrandf(stddev, mean);
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->nrandf(stddev, mean);
   }
 
   double nrandd(double stddev, double mean) {
+    if (s_threadSource)
+      return s_threadSource->nrandd(stddev, mean);
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->nrandd(stddev, mean);
   }
 
   int64_t stochasticRound(double val) {
+    if (s_threadSource)
+      return s_threadSource->stochasticRound(val);
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->stochasticRound(val);
   }
 
   void randBytes(char* buf, size_t len) {
+    if (s_threadSource)
+      return s_threadSource->randBytes(buf, len);
     MutexLocker locker(g_randMutex);
     checkInit();
     g_randSource->randBytes(buf, len);
   }
 
   ByteArray randBytes(size_t len) {
+    if (s_threadSource)
+      return s_threadSource->randBytes(len);
     MutexLocker locker(g_randMutex);
     checkInit();
     return g_randSource->randBytes(len);
@@ -94,6 +94,11 @@ namespace Random {
   void addEntropy();
   void addEntropy(uint64_t seed);
 
+  // While set, the global functions on the calling thread draw from the given
+  // source instead of the shared, mutex guarded one.  Returns the previously
+  // set source, pass nullptr to go back to the shared source.
+  RandomSource* setThreadSource(RandomSource* source);
+
   uint32_t randu32();
   uint64_t randu64();
   int32_t randi32();
@@ -6,8 +6,6 @@
 #include "StarVector.hpp"
 #include "StarWorkerPool.hpp"
 
-#include "thread"
-
 namespace Star {
 
 // Holds a sparse 2d array of data based on sector size.  Meant to be used as a
@@ -99,6 +97,10 @@ public:
       size_t minX, size_t minY, size_t width, size_t height, Function&& function, bool evalEmpty = false) const;
   template <typename Function>
   bool evalColumns(size_t minX, size_t minY, size_t width, size_t height, Function&& function, bool evalEmpty = false);
+  // Like evalColumns, but each column of sectors may be evaluated on a
+  // different thread of WorkerPool::shared(), so the function must be safe to
+  // call concurrently for different columns.  The order of evaluation is not
+  // defined, and once any call returns false the remaining columns are skipped.
   template <typename Function>
   bool evalColumnsParallel(size_t minX, size_t minY, size_t width, size_t height, Function&& function, bool evalEmpty = false) const;
   template <typename Function>
@@ -114,8 +116,6 @@ private:
   template <typename Function>
   bool evalColumnsPrivPar(size_t minX, size_t minY, size_t width, size_t height, Function&& function, bool evalEmpty);
 
-  WorkerPool& getWorkerPool() const;
-
   SectorArray m_sectors;
   HashSet<Sector> m_loadedSectors;
 };
@@ -409,70 +409,23 @@ bool SectorArray2D<ElementT, SectorSize>::evalColumnsPrivPar(
   size_t minXSector = minX / SectorSize;
   size_t maxXSector = (maxX - 1) / SectorSize;
 
-  size_t minYSector = minY / SectorSize;
-  size_t maxYSector = (maxY - 1) / SectorSize;
-
-  size_t sectorCount = maxXSector - minXSector + 1;
-
-  auto& workerPool = getWorkerPool();
-  std::vector<WorkerPoolHandle> futures;
-  futures.reserve(sectorCount);
-
-  for (size_t xSector = minXSector; xSector <= maxXSector; ++xSector) {
-    size_t minXi = 0;
-    if (xSector == minXSector)
-      minXi = minX % SectorSize;
-
-    size_t maxXi = SectorSize - 1;
-    if (xSector == maxXSector)
-      maxXi = (maxX - 1) % SectorSize;
-
-    size_t x_ = xSector * SectorSize;
-
-    futures.push_back(workerPool.addWork([=]() {
-      for (size_t ySector = minYSector; ySector <= maxYSector; ++ySector) {
-        Array* array = m_sectors(xSector, ySector).get();
-
-        if (!array && !evalEmpty)
-          continue;
-
-        size_t minYi = 0;
-        if (ySector == minYSector)
-          minYi = minY % SectorSize;
-
-        size_t maxYi = SectorSize - 1;
-        if (ySector == maxYSector)
-          maxYi = (maxY - 1) % SectorSize;
-
-        size_t y_ = ySector * SectorSize;
-
-        if (!array) {
-          for (size_t xi = minXi; xi <= maxXi; ++xi) {
-            if (!function(xi + x_, minYi + y_, nullptr, maxYi - minYi + 1))
-              return false;
-          }
-        } else {
-          for (size_t xi = minXi; xi <= maxXi; ++xi) {
-            if (!function(xi + x_, minYi + y_, &array->elements[xi * SectorSize + minYi], maxYi - minYi + 1))
-              return false;
-          }
+  // Each column of sectors is one chunk, so the work is split the same way
+  // no matter how many threads end up running it.
+  atomic<bool> aborted(false);
+  WorkerPool::shared().parallelFor(maxXSector - minXSector + 1, 1, [&](size_t begin, size_t) {
+    size_t xSector = minXSector + begin;
+    size_t sectorMinX = max(minX, xSector * SectorSize);
+    size_t sectorMaxX = min(maxX, (xSector + 1) * SectorSize);
+    evalColumnsPriv(sectorMinX, minY, sectorMaxX - sectorMinX, maxY - minY, [&](size_t x, size_t y, Element* column, size_t columnSize) {
+        if (aborted || !function(x, y, column, columnSize)) {
+          aborted = true;
+          return false;
         }
-      }
-
-      return true; // FezzedOne: Added missing return.
-    }));
-  }
-  for (const auto& f : futures) {
-    f.finish();
-  }
+        return true;
+      }, evalEmpty);
+  });
 
-  return true;
-}
-
-template <typename ElementT, size_t SectorSize>
-WorkerPool& SectorArray2D<ElementT, SectorSize>::getWorkerPool() const {
-  static WorkerPool pool("SectorArray2DWorkerPool", std::thread::hardware_concurrency());
-  return pool;
+  return !aborted;
 }
 
 } // namespace Star
@@ -74,6 +74,8 @@ public:
   void close();
 
 protected:
+  friend class SocketPoller;
+
   enum class SocketType {
     Tcp,
     Udp
@@ -0,0 +1,203 @@
+#include "StarSocketPoller.hpp"
+#include "StarNetImpl.hpp"
+#include "StarTime.hpp"
+#include "StarMathCommon.hpp"
+
+#ifdef STAR_SYSTEM_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace Star {
+
+#ifdef STAR_SYSTEM_LINUX
+
+static int const MaxEpollEvents = 256;
+
+SocketPoller::SocketPoller() : m_woken(false) {
+  m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+  if (m_epoll < 0)
+    throw NetworkException(strf("Cannot create epoll instance: {}", netErrorString()));
+
+  m_wakeEvent = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_wakeEvent < 0) {
+    ::close(m_epoll);
+    throw NetworkException(strf("Cannot create epoll wake event: {}", netErrorString()));
+  }
+
+  // The wake event is the only level-triggered entry, and the only one with
+  // no socket attached.
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeEvent, &event) != 0) {
+    ::close(m_wakeEvent);
+    ::close(m_epoll);
+    throw NetworkException(strf("Cannot add wake event to epoll instance: {}", netErrorString()));
+  }
+}
+
+SocketPoller::~SocketPoller() {
+  ::close(m_wakeEvent);
+  ::close(m_epoll);
+}
+
+void SocketPoller::add(SocketPtr socket) {
+  // Holding the socket lock keeps the descriptor from being closed and
+  // reused underneath us.
+  ReadLocker socketLocker(socket->m_mutex);
+  if (!socket->isOpen())
+    return;
+
+  MutexLocker locker(m_mutex);
+  if (m_sockets.contains(socket.get()))
+    return;
+
+  epoll_event event = {};
+  event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  event.data.ptr = socket.get();
+  if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket->m_impl->socketDesc, &event) != 0)
+    throw NetworkException(strf("Cannot add socket to epoll instance: {}", netErrorString()));
+
+  Socket const* key = socket.get();
+  m_sockets.add(key, Registration{std::move(socket), false});
+}
+
+void SocketPoller::remove(SocketPtr const& socket) {
+  ReadLocker socketLocker(socket->m_mutex);
+  MutexLocker locker(m_mutex);
+  if (!m_sockets.remove(socket.get()))
+    return;
+
+  // Closed descriptors have already been dropped by epoll.
+  if (socket->isOpen())
+    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket->m_impl->socketDesc, nullptr);
+}
+
+void SocketPoller::setWantWrite(SocketPtr const&, bool) {}
+
+List<SocketPoller::Event> SocketPoller::wait(unsigned timeout) {
+  epoll_event epollEvents[MaxEpollEvents];
+  int count = ::epoll_wait(m_epoll, epollEvents, MaxEpollEvents, (int)timeout);
+  if (count < 0) {
+    if (errno != EINTR)
+      throw NetworkException(strf("Error during call to epoll_wait, '{}'", netErrorString()));
+    count = 0;
+  }
+
+  List<Event> events;
+  {
+    MutexLocker locker(m_mutex);
+    for (int i = 0; i < count; ++i) {
+      auto const& epollEvent = epollEvents[i];
+      if (!epollEvent.data.ptr) {
+        // Cleared before reading, so that a wake racing with this is never
+        // lost, at worst the next wait returns early.
+        m_woken = false;
+        uint64_t value;
+        if (::read(m_wakeEvent, &value, sizeof(value)) < 0 && errno != EAGAIN)
+          throw NetworkException(strf("Error reading epoll wake event, '{}'", netErrorString()));
+        continue;
+      }
+
+      // Events for a socket removed since the wait returned are dropped.
+      if (auto registration = m_sockets.ptr((Socket const*)epollEvent.data.ptr)) {
+        Event event;
+        event.socket = registration->socket;
+        event.readable = epollEvent.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP);
+        event.writable = epollEvent.events & EPOLLOUT;
+        event.exception = epollEvent.events & (EPOLLERR | EPOLLHUP);
+        events.append(std::move(event));
+      }
+    }
+  }
+
+  // Same as Socket::poll, hung up sockets are shut down.
+  for (auto const& event : events) {
+    if (event.exception)
+      event.socket->shutdown();
+  }
+
+  return events;
+}
+
+void SocketPoller::wake() {
+  if (m_woken.exchange(true))
+    return;
+  uint64_t value = 1;
+  if (::write(m_wakeEvent, &value, sizeof(value)) < 0 && errno != EAGAIN)
+    throw NetworkException(strf("Error signalling epoll wake event, '{}'", netErrorString()));
+}
+
+#else
+
+// Socket::poll cannot be interrupted, so without epoll waits are split into
+// slices this long, checking for wake() in between.
+static unsigned const WaitSliceMilliseconds = 1;
+
+SocketPoller::SocketPoller() : m_woken(false) {}
+
+SocketPoller::~SocketPoller() {}
+
+void SocketPoller::add(SocketPtr socket) {
+  MutexLocker locker(m_mutex);
+  Socket const* key = socket.get();
+  if (!m_sockets.contains(key))
+    m_sockets.add(key, Registration{std::move(socket), false});
+}
+
+void SocketPoller::remove(SocketPtr const& socket) {
+  MutexLocker locker(m_mutex);
+  m_sockets.remove(socket.get());
+}
+
+void SocketPoller::setWantWrite(SocketPtr const& socket, bool wantWrite) {
+  MutexLocker locker(m_mutex);
+  if (auto registration = m_sockets.ptr(socket.get()))
+    registration->wantWrite = wantWrite;
+}
+
+List<SocketPoller::Event> SocketPoller::wait(unsigned timeout) {
+  List<Event> events;
+  int64_t endTime = Time::monotonicMilliseconds() + timeout;
+  while (!m_woken.exchange(false)) {
+    SocketPollQuery query;
+    {
+      MutexLocker locker(m_mutex);
+      for (auto const& p : m_sockets) {
+        if (p.second.socket->isOpen())
+          query.add(p.second.socket, SocketPollQueryEntry{true, p.second.wantWrite});
+      }
+    }
+
+    int64_t remaining = endTime - Time::monotonicMilliseconds();
+    unsigned slice = (unsigned)clamp<int64_t>(remaining, 0, WaitSliceMilliseconds);
+    if (query.empty()) {
+      Thread::sleep(slice);
+    } else if (auto result = Socket::poll(query, slice)) {
+      for (auto const& p : *result) {
+        if (p.second.readable || p.second.writable || p.second.exception)
+          events.append(Event{p.first, p.second.readable, p.second.writable, p.second.exception});
+      }
+      if (!events.empty())
+        break;
+    }
+
+    if (remaining <= 0)
+      break;
+  }
+  return events;
+}
+
+void SocketPoller::wake() {
+  m_woken = true;
+}
+
+#endif
+
+bool SocketPoller::contains(SocketPtr const& socket) const {
+  MutexLocker locker(m_mutex);
+  return m_sockets.contains(socket.get());
+}
+
+}
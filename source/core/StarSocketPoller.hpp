@@ -0,0 +1,68 @@
+#ifndef STAR_SOCKET_POLLER_HPP
+#define STAR_SOCKET_POLLER_HPP
+
+#include "StarSocket.hpp"
+
+namespace Star {
+
+STAR_CLASS(SocketPoller);
+
+// Waits on a persistent set of sockets.  Unlike Socket::poll, the set is not
+// rebuilt on every call, and on Linux it is kept in an edge-triggered epoll
+// instance, so waiting costs nothing for sockets that are idle.
+//
+// Being edge-triggered, a socket is only reported again after it has been read
+// or written until it would block.  Sockets that are closed while registered
+// are not reported at all, the caller is expected to notice that on its own.
+// Without epoll, sockets are polled with Socket::poll on every wait.
+class SocketPoller {
+public:
+  struct Event {
+    SocketPtr socket;
+    bool readable;
+    bool writable;
+    // The socket has had an error or has been hung up.
+    bool exception;
+  };
+
+  SocketPoller();
+  ~SocketPoller();
+
+  SocketPoller(SocketPoller const&) = delete;
+  SocketPoller& operator=(SocketPoller const&) = delete;
+
+  // Adding a socket that is already ready reports it on the next wait.
+  // Closed sockets are ignored.
+  void add(SocketPtr socket);
+  void remove(SocketPtr const& socket);
+  bool contains(SocketPtr const& socket) const;
+
+  // Asks to be told when the socket can be written to again, after a write
+  // would have blocked.  Only needed without epoll, which always reports it.
+  void setWantWrite(SocketPtr const& socket, bool wantWrite);
+
+  // Waits up to the timeout for any events, or until wake() is called.
+  List<Event> wait(unsigned timeout);
+  // Makes the current or next call to wait() return early.  May be called
+  // from any thread.
+  void wake();
+
+private:
+  struct Registration {
+    SocketPtr socket;
+    bool wantWrite;
+  };
+
+  mutable Mutex m_mutex;
+  HashMap<Socket const*, Registration> m_sockets;
+  atomic<bool> m_woken;
+
+#ifdef STAR_SYSTEM_LINUX
+  int m_epoll;
+  int m_wakeEvent;
+#endif
+};
+
+}
+
+#endif
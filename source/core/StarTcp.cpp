@@ -2,8 +2,16 @@
 #include "StarLogging.hpp"
 #include "StarNetImpl.hpp"
 
+#ifndef STAR_SYSTEM_FAMILY_WINDOWS
+#include <sys/uio.h>
+#endif
+
 namespace Star {
 
+// Most slices gathered into a single send, anything beyond is left for the
+// next call.
+static size_t const MaxGatherSlices = 64;
+
 TcpSocketPtr TcpSocket::connectTo(HostAddressWithPort const& addressWithPort, unsigned timeout) {
   auto socket = TcpSocketPtr(new TcpSocket(addressWithPort.address().mode()));
   socket->setTimeout(timeout);
@@ -75,21 +83,21 @@ size_t TcpSocket::receive(char* data, size_t size) {
   flags |= MSG_NOSIGNAL;
 #endif
 
-  auto r = ::recv(m_impl->socketDesc, data, size, flags);
-  if (r < 0) {
-    if (m_socketMode == SocketMode::Shutdown) {
-      throw SocketClosedException("Connection closed");
-    } else if (netErrorConnectionReset()) {
-      doShutdown();
-      throw SocketClosedException("Connection reset");
-    } else if (netErrorInterrupt()) {
-      r = 0;
-    } else {
-      throw NetworkException(strf("tcp recv error: {}", netErrorString()));
-    }
-  }
+  return transferResult(::recv(m_impl->socketDesc, data, size, flags), "recv");
+}
 
-  return r;
+size_t TcpSocket::receive(ByteArray& buffer, size_t size) {
+  size_t start = buffer.size();
+  buffer.resize(start + size);
+  size_t received = 0;
+  try {
+    received = receive(buffer.ptr() + start, size);
+  } catch (...) {
+    buffer.resize(start);
+    throw;
+  }
+  buffer.resize(start + received);
+  return received;
 }
 
 size_t TcpSocket::send(char const* data, size_t size) {
@@ -105,21 +113,55 @@ size_t TcpSocket::send(char const* data, size_t size) {
   flags |= MSG_NOSIGNAL;
 #endif
 
-  auto w = ::send(m_impl->socketDesc, data, size, flags);
-  if (w < 0) {
-    if (m_socketMode == SocketMode::Shutdown) {
-      throw SocketClosedException("Connection closed");
-    } else if (netErrorConnectionReset()) {
-      doShutdown();
-      throw SocketClosedException("Connection reset");
-    } else if (netErrorInterrupt()) {
-      w = 0;
-    } else {
-      throw NetworkException(strf("tcp send error: {}", netErrorString()));
-    }
+  return transferResult(::send(m_impl->socketDesc, data, size, flags), "send");
+}
+
+size_t TcpSocket::send(ByteChain const& chain) {
+  if (chain.slices().size() == 1)
+    return send(chain.slices().first().ptr(), chain.size());
+
+  ReadLocker locker(m_mutex);
+  checkOpen("TcpSocket::send");
+
+  if (m_socketMode == SocketMode::Closed)
+    throw SocketClosedException("TcpSocket not open in TcpSocket::send");
+
+  size_t count = min(chain.slices().size(), MaxGatherSlices);
+  if (count == 0)
+    return 0;
+
+#ifdef STAR_SYSTEM_FAMILY_WINDOWS
+  WSABUF buffers[MaxGatherSlices];
+  for (size_t i = 0; i < count; ++i) {
+    auto const& slice = chain.slices()[i];
+    buffers[i].buf = (char*)slice.ptr();
+    buffers[i].len = (ULONG)slice.size;
   }
 
-  return w;
+  DWORD sent = 0;
+  if (::WSASend(m_impl->socketDesc, buffers, (DWORD)count, &sent, 0, nullptr, nullptr) != 0)
+    return transferResult(-1, "send");
+  return sent;
+#else
+  iovec buffers[MaxGatherSlices];
+  for (size_t i = 0; i < count; ++i) {
+    auto const& slice = chain.slices()[i];
+    buffers[i].iov_base = (void*)slice.ptr();
+    buffers[i].iov_len = slice.size;
+  }
+
+  msghdr message = {};
+  message.msg_iov = buffers;
+  message.msg_iovlen = count;
+
+  int flags = 0;
+#ifdef STAR_SYSTEM_LINUX
+  // Don't generate sigpipe
+  flags |= MSG_NOSIGNAL;
+#endif
+
+  return transferResult(::sendmsg(m_impl->socketDesc, &message, flags), "send");
+#endif
 }
 
 HostAddressWithPort TcpSocket::localAddress() const {
@@ -132,6 +174,22 @@ HostAddressWithPort TcpSocket::remoteAddress() const {
   return m_remoteAddress;
 }
 
+size_t TcpSocket::transferResult(int64_t result, char const* operation) {
+  if (result < 0) {
+    if (m_socketMode == SocketMode::Shutdown) {
+      throw SocketClosedException("Connection closed");
+    } else if (netErrorConnectionReset()) {
+      doShutdown();
+      throw SocketClosedException("Connection reset");
+    } else if (netErrorInterrupt()) {
+      return 0;
+    } else {
+      throw NetworkException(strf("tcp {} error: {}", operation, netErrorString()));
+    }
+  }
+  return result;
+}
+
 TcpSocket::TcpSocket(NetworkMode networkMode) : Socket(SocketType::Tcp, networkMode) {}
 
 TcpSocket::TcpSocket(NetworkMode networkMode, SocketImplPtr impl) : Socket(networkMode, impl, SocketMode::Connected) {}
@@ -174,6 +232,7 @@ TcpServer::~TcpServer() {
 
 void TcpServer::stop() {
   m_listenSocket->shutdown();
+  m_acceptPoller.wake();
   m_callbackThread.finish();
   m_listenSocket->close();
 }
@@ -196,18 +255,27 @@ void TcpServer::setAcceptCallback(AcceptCallback callback, unsigned timeout) {
   MutexLocker locker(m_mutex);
   m_callback = callback;
   if (m_listenSocket->isActive() && !m_callbackThread) {
+    m_acceptPoller.add(m_listenSocket);
     m_callbackThread = Thread::invoke("TcpServer::acceptCallback", [this, timeout]() {
         try {
           while (true) {
-            TcpSocketPtr conn;
-            try {
-              conn = accept(timeout);
-            } catch (NetworkException const& e) {
-              Logger::error("TcpServer caught exception accepting connection {}", outputException(e, false));
-            }
-
-            if (conn)
+            m_acceptPoller.wait(timeout);
+
+            // The listen socket is non-blocking, so accept everything that is
+            // pending, which the edge-triggered poller expects anyway.
+            while (m_listenSocket->isActive()) {
+              TcpSocketPtr conn;
+              try {
+                conn = m_listenSocket->accept();
+              } catch (SocketClosedException const&) {
+              } catch (NetworkException const& e) {
+                Logger::error("TcpServer caught exception accepting connection {}", outputException(e, false));
+              }
+
+              if (!conn)
+                break;
               m_callback(conn);
+            }
 
             if (!m_listenSocket->isActive())
               break;
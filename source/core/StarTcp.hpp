@@ -2,7 +2,9 @@
 #define STAR_TCP_HPP
 
 #include "StarIODevice.hpp"
+#include "StarByteChain.hpp"
 #include "StarSocket.hpp"
+#include "StarSocketPoller.hpp"
 #include "StarThread.hpp"
 
 namespace Star {
@@ -23,6 +25,13 @@ public:
   size_t receive(char* data, size_t len);
   size_t send(char const* data, size_t len);
 
+  // Receives up to len bytes straight onto the end of the given buffer.
+  size_t receive(ByteArray& buffer, size_t len);
+  // Sends as much of the chain as possible with a single gather write, without
+  // first copying it into one buffer.  Returns the amount sent, which the
+  // caller is expected to trim off of the front of the chain.
+  size_t send(ByteChain const& chain);
+
   HostAddressWithPort localAddress() const;
   HostAddressWithPort remoteAddress() const;
 
@@ -31,6 +40,9 @@ private:
   TcpSocket(NetworkMode networkMode, SocketImplPtr impl);
 
   void connect(HostAddressWithPort const& address);
+  // Handles the result of a system send or receive call, returns the amount
+  // transferred.
+  size_t transferResult(int64_t result, char const* operation);
 
   HostAddressWithPort m_remoteAddress;
 };
@@ -56,9 +68,9 @@ public:
   // Rather than calling and blocking on accept(), if an AcceptCallback is set
   // here, it will be called whenever a new connection is available.
   // Exceptions thrown from the callback function will be caught and logged,
-  // and will cause the server to close.  The timeout here is the timeout that
-  // is passed to accept in the loop, the longer the timeout the slower it will
-  // shutdown on a call to close.
+  // and will cause the server to close.  The timeout here is the longest the
+  // loop waits for connections before checking whether the server has
+  // stopped, though stop() also wakes it straight away.
   void setAcceptCallback(AcceptCallback callback, unsigned timeout = 20);
 
 private:
@@ -68,6 +80,7 @@ private:
   ThreadFunction<void> m_callbackThread;
   HostAddressWithPort m_hostAddress;
   TcpSocketPtr m_listenSocket;
+  SocketPoller m_acceptPoller;
 };
 
 }
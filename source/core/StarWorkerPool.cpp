@@ -124,10 +124,96 @@ WorkerPoolHandle WorkerPool::addWork(function<void()> work) {
   return workerPoolHandleImpl;
 }
 
+struct WorkerPool::ParallelForState {
+  size_t count;
+  size_t chunkSize;
+  size_t chunkCount;
+  function<void(size_t, size_t)> const* chunkFunction;
+
+  atomic<size_t> nextChunk;
+  atomic<bool> failed;
+
+  Mutex mutex;
+  ConditionVariable condition;
+  size_t finishedChunks;
+  size_t exceptionChunk;
+  std::exception_ptr exception;
+};
+
+void WorkerPool::parallelFor(size_t count, size_t chunkSize, function<void(size_t, size_t)> const& function) {
+  if (count == 0)
+    return;
+  chunkSize = max<size_t>(chunkSize, 1);
+  size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+  size_t helpers = min(getWorkerCount(), chunkCount - 1);
+  if (helpers == 0) {
+    for (size_t begin = 0; begin < count; begin += chunkSize)
+      function(begin, min(begin + chunkSize, count));
+    return;
+  }
+
+  // Helpers may only be picked up after every chunk is already done, so the
+  // state must outlive this call.  Such late helpers find no chunk left to
+  // claim and never touch chunkFunction.
+  auto state = make_shared<ParallelForState>();
+  state->count = count;
+  state->chunkSize = chunkSize;
+  state->chunkCount = chunkCount;
+  state->chunkFunction = &function;
+  state->nextChunk = 0;
+  state->failed = false;
+  state->finishedChunks = 0;
+  state->exceptionChunk = chunkCount;
+
+  for (size_t i = 0; i < helpers; ++i)
+    queueWork([state]() { runParallelFor(*state); });
+
+  runParallelFor(*state);
+
+  MutexLocker locker(state->mutex);
+  while (state->finishedChunks != chunkCount)
+    state->condition.wait(state->mutex);
+
+  if (state->exception)
+    std::rethrow_exception(state->exception);
+}
+
 size_t WorkerPool::getWorkerCount() const {
   return m_workerThreads.size();
 }
 
+WorkerPool& WorkerPool::shared() {
+  static WorkerPool pool("SharedWorkerPool", max(Thread::numberOfProcessors(), 1u) - 1);
+  return pool;
+}
+
+void WorkerPool::runParallelFor(ParallelForState& state) {
+  while (true) {
+    size_t chunk = state.nextChunk++;
+    if (chunk >= state.chunkCount)
+      break;
+
+    if (!state.failed) {
+      size_t begin = chunk * state.chunkSize;
+      try {
+        (*state.chunkFunction)(begin, min(begin + state.chunkSize, state.count));
+      } catch (...) {
+        MutexLocker locker(state.mutex);
+        if (chunk < state.exceptionChunk) {
+          state.exceptionChunk = chunk;
+          state.exception = std::current_exception();
+        }
+        state.failed = true;
+      }
+    }
+
+    MutexLocker locker(state.mutex);
+    if (++state.finishedChunks == state.chunkCount)
+      state.condition.broadcast();
+  }
+}
+
 WorkerPool::WorkerThread::WorkerThread(WorkerPool* parent)
   : Thread(strf("WorkerThread for WorkerPool '{}'", parent->m_name)),
     parent(parent),
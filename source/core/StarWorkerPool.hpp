@@ -122,9 +122,24 @@ public:
   template <typename ResultType>
   WorkerPoolPromise<ResultType> addProducer(function<ResultType()> producer);
 
+  // Splits [0, count) into consecutive chunks of chunkSize indexes (the last
+  // may be shorter) and calls function(begin, end) once for each chunk,
+  // spreading the chunks over the worker threads.  The chunk boundaries only
+  // depend on count and chunkSize, never on the thread count.  The calling
+  // thread works through chunks as well and this returns only once every
+  // chunk is done, so it is safe to call from within work running on this
+  // same pool, or on a pool with no threads at all.  If a chunk throws, the
+  // chunks that have not started yet are skipped and the exception from the
+  // lowest failing chunk is re-thrown.
+  void parallelFor(size_t count, size_t chunkSize, function<void(size_t, size_t)> const& function);
+
   // Returns the current number of worker threads.
   size_t getWorkerCount() const;
 
+  // A process wide pool with one worker per processor beyond the first, for
+  // short parallelFor loops that do not warrant a pool of their own.
+  static WorkerPool& shared();
+
 private:
   class WorkerThread : public Thread {
   public:
@@ -139,6 +154,10 @@ private:
     atomic<bool> waiting;
   };
 
+  struct ParallelForState;
+
+  static void runParallelFor(ParallelForState& state);
+
   void queueWork(function<void()> work);
 
   String m_name;
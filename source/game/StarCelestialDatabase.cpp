@@ -131,6 +131,10 @@ CelestialMasterDatabase::CelestialMasterDatabase(Maybe<String> databaseFile) {
   for (auto const& list : namesConfig.get("systemSuffixNames").iterateArray())
     m_generationInformation.systemSuffixNames.add(list.getFloat(0), list.getString(1));
 
+  auto compressionConfig = config.get("compression", JsonObject());
+  m_compression.codec = CompressionCodecNames.getLeft(compressionConfig.getString("codec", "zlib"));
+  m_compression.level = compressionConfig.getInt("level", MediumCompression);
+
   if (databaseFile) {
     m_database.setContentIdentifier("Celestial2");
     m_database.setIODevice(File::open(*databaseFile, IOMode::ReadWrite));
@@ -361,7 +365,7 @@ void CelestialMasterDatabase::updateParameters(CelestialCoordinate const& coordi
   if (updated && m_database.isOpen()) {
     auto versioningDatabase = Root::singleton().versioningDatabase();
     auto versionedChunk = versioningDatabase->makeCurrentVersionedJson("CelestialChunk", chunk.toJson());
-    m_database.insert(DataStreamBuffer::serialize(chunkIndex), compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk)));
+    m_database.insert(DataStreamBuffer::serialize(chunkIndex), compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk), m_compression));
 
     m_chunkCache.remove(chunkIndex);
   } else {
@@ -391,7 +395,7 @@ CelestialChunk const& CelestialMasterDatabase::getChunk(Vec2I const& chunkIndex,
           if (!versioningDatabase->versionedJsonCurrent(versionedChunk)) {
             versionedChunk = versioningDatabase->updateVersionedJson(versionedChunk);
             m_database.insert(DataStreamBuffer::serialize(chunkIndex),
-                compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk)));
+                compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk), m_compression));
           }
           return CelestialChunk(versionedChunk.content);
         }
@@ -406,7 +410,7 @@ CelestialChunk const& CelestialMasterDatabase::getChunk(Vec2I const& chunkIndex,
       if (m_database.isOpen()) {
         auto versionedChunk = versioningDatabase->makeCurrentVersionedJson("CelestialChunk", newChunk.toJson());
         m_database.insert(DataStreamBuffer::serialize(chunkIndex),
-            compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk)));
+            compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk), m_compression));
       }
 
       return newChunk;
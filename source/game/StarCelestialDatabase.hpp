@@ -8,6 +8,7 @@
 #include "StarBTreeDatabase.hpp"
 #include "StarCelestialTypes.hpp"
 #include "StarPerlin.hpp"
+#include "StarCompression.hpp"
 
 namespace Star {
 
@@ -177,6 +178,7 @@ protected:
 
   HashTtlCache<Vec2I, CelestialChunk> m_chunkCache;
   BTreeSha256Database m_database;
+  CompressionSettings m_compression;
 
   float m_commitInterval;
   Timer m_commitTimer;
@@ -2,6 +2,7 @@
 #include "StarAssets.hpp"
 #include "StarChatProcessor.hpp"
 #include "StarConfiguration.hpp"
+#include "StarFile.hpp"
 #include "StarItemDatabase.hpp"
 #include "StarItemDrop.hpp"
 #include "StarJsonExtra.hpp"
@@ -14,6 +15,7 @@
 #include "StarRoot.hpp"
 #include "StarStagehand.hpp"
 #include "StarStagehandDatabase.hpp"
+#include "StarTime.hpp"
 #include "StarTreasure.hpp"
 #include "StarUniverseServer.hpp"
 #include "StarUniverseServerLuaBindings.hpp"
@@ -902,6 +904,88 @@ String CommandProcessor::setEnvironmentBiome(ConnectionId connectionId, String c
   return done ? "Set environment biome for world layer" : "Failed to set environment biome";
 }
 
+// Writes the collected stacks of a world's script profile to the Lua storage
+// directory, and summarises the most sampled scripts.
+static String writeScriptProfile(String const& worldId, LuaSampleProfiler const& profiler) {
+  String directory = Root::singleton().toStoragePath("lua");
+  if (!File::isDirectory(directory))
+    File::makeDirectory(directory);
+
+  String worldName;
+  for (auto c : worldId)
+    worldName.append(String::isAsciiLetter(c) || String::isAsciiNumber(c) ? c : '_');
+  String filename = strf("{}-{}.folded", worldName, Time::printCurrentDateAndTime("<year>-<month>-<day>-<hours>-<minutes>-<seconds>-<millis>"));
+  File::writeFile(profiler.foldedStacks(), File::relativeTo(directory, filename));
+
+  uint64_t sampleCount = profiler.sampleCount();
+  String summary = strf("{}: wrote {} samples to {}", worldId, sampleCount, filename);
+  auto scripts = profiler.scriptTotals();
+  for (size_t i = 0; i < min<size_t>(scripts.size(), 5); ++i)
+    summary += strf("\n  {:5.1f}% {}", 100.0 * scripts[i].second / sampleCount, scripts[i].first);
+  return summary;
+}
+
+String CommandProcessor::luaProfile(ConnectionId connectionId, String const& argumentString) {
+  if (auto errorMsg = adminCheck(connectionId, "profile world scripts"))
+    return *errorMsg;
+
+  auto arguments = m_parser.tokenizeToStringList(argumentString);
+  String action = arguments.empty() ? String() : arguments[0].toLower();
+
+  // From the server console or RCON every loaded world is profiled, otherwise
+  // only the world of the invoking player.
+  auto executeForWorlds = [&](function<void(WorldServer*)> worldAction) -> size_t {
+    if (connectionId == ServerConnectionId)
+      return m_universe->executeForWorlds(worldAction);
+    return m_universe->executeForClient(connectionId, [&worldAction](WorldServer* world, PlayerPtr const&) { worldAction(world); }) ? 1 : 0;
+  };
+
+  if (action == "start") {
+    double sampleInterval = 1.0;
+    if (arguments.size() > 1) {
+      try {
+        sampleInterval = lexicalCast<double>(arguments[1]);
+      } catch (BadLexicalCast const&) {
+        return strf("Could not parse the argument {} as a sample interval", arguments[1]);
+      }
+      if (sampleInterval <= 0.0)
+        return "Sample interval must be positive";
+    }
+
+    size_t count = executeForWorlds([sampleInterval](WorldServer* world) {
+      world->setScriptProfiler(make_shared<LuaSampleProfiler>((int64_t)(sampleInterval * 1000.0)));
+    });
+    return strf("Sampling scripts every {}ms on {} world(s)", sampleInterval, count);
+
+  } else if (action == "dump" || action == "stop") {
+    // Files are written after leaving the worlds, so their updates are not
+    // held up on disk access.
+    List<pair<String, LuaSampleProfilerPtr>> profiles;
+    executeForWorlds([&](WorldServer* world) {
+      if (auto profiler = world->scriptProfiler()) {
+        if (action == "stop")
+          world->setScriptProfiler({});
+        profiles.append({world->worldId(), std::move(profiler)});
+      }
+    });
+
+    if (profiles.empty())
+      return "No worlds are being profiled";
+
+    StringList results;
+    for (auto const& profile : profiles) {
+      try {
+        results.append(writeScriptProfile(profile.first, *profile.second));
+      } catch (std::exception const& e) {
+        results.append(strf("{}: failed to write profile: {}", profile.first, outputException(e, false)));
+      }
+    }
+    return results.join("\n");
+  }
+
+  return "Usage: /luaprofile start [sample interval in milliseconds] | dump | stop";
+}
+
 Maybe<ConnectionId> CommandProcessor::playerCidFromCommand(String const& player, UniverseServer* universe) {
   char const* const UsernamePrefix = "@";
   char const* const CidPrefix = "$";
@@ -1044,6 +1128,9 @@ String CommandProcessor::handleCommand(ConnectionId connectionId, String const&
   } else if (command == "setenvironmentbiome") {
     return setEnvironmentBiome(connectionId, argumentString);
 
+  } else if (command == "luaprofile") {
+    return luaProfile(connectionId, argumentString);
+
   } else if (auto res = m_scriptComponent.invoke("command", command, connectionId, jsonFromStringList(m_parser.tokenizeToStringList(argumentString)))) {
     return toString(*res);
 
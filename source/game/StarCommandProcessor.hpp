@@ -81,6 +81,7 @@ private:
   String expandBiomeRegion(ConnectionId connectionId, String const& argumentString);
   String updatePlanetType(ConnectionId connectionId, String const& argumentString);
   String setEnvironmentBiome(ConnectionId connectionId, String const& argumentString);
+  String luaProfile(ConnectionId connectionId, String const& argumentString);
 
   mutable RecursiveMutex m_mutex;
 
@@ -90,39 +90,10 @@ List<EntityId> EntityMap::entityIds() const {
 }
 
 void EntityMap::updateAllEntities(EntityCallback const& callback, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder) {
-  auto updateEntityInfo = [&](SpatialMap::Entry const& entry) {
-    auto const& entity = entry.value;
-
-    auto position = entity->position();
-    auto boundBox = entity->metaBoundBox();
-
-    if (boundBox.isNegative() || boundBox.width() > MaximumEntityBoundBox || boundBox.height() > MaximumEntityBoundBox) {
-      throw EntityMapException::format("Entity id: {} type: {} bound box is negative or beyond the maximum entity bound box size in EntityMap::addEntity",
-          entity->entityId(), (int)entity->entityType());
-    }
-
-    auto entityId = entity->entityId();
-    if (entityId == NullEntityId)
-      throw EntityMapException::format("Null entity id in EntityMap::setEntityInfo");
-
-    auto rects = m_geometry.splitRect(boundBox, position);
-    if (!containersEqual(rects, entry.rects))
-      m_spatialMap.set(entityId, rects);
-
-    auto uniqueId = entity->uniqueId();
-    if (uniqueId) {
-      if (auto existingEntityId = m_uniqueMap.maybeRight(*uniqueId)) {
-        if (entityId != *existingEntityId)
-          throw EntityMapException::format("Duplicate entity unique id on entity ids ({}) and ({})", *existingEntityId, entityId);
-      } else {
-        m_uniqueMap.removeRight(entityId);
-        m_uniqueMap.add(*uniqueId, entityId);
-      }
-    } else {
-      m_uniqueMap.removeRight(entityId);
-    }
-  };
+  updateAllEntities(callback, std::move(sortOrder), ParallelUpdate());
+}
 
+void EntityMap::updateAllEntities(EntityCallback const& callback, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder, ParallelUpdate const& parallelUpdate) {
   // Even if there is no sort order, we still copy pointers to a temporary
   // list, so that it is safe to call addEntity from the callback.
   m_entrySortBuffer.clear();
@@ -135,7 +106,22 @@ void EntityMap::updateAllEntities(EntityCallback const& callback, function<bool(
       });
   }
 
-  for (auto entry : m_entrySortBuffer) {
+  bool parallel = parallelUpdate.pool && parallelUpdate.filter && parallelUpdate.update;
+  size_t i = 0;
+  while (i < m_entrySortBuffer.size()) {
+    if (parallel && parallelUpdate.filter(m_entrySortBuffer[i]->value)) {
+      size_t runEnd = i + 1;
+      while (runEnd < m_entrySortBuffer.size() && parallelUpdate.filter(m_entrySortBuffer[runEnd]->value))
+        ++runEnd;
+
+      if (runEnd - i >= max<size_t>(parallelUpdate.minimumRunSize, 2)) {
+        updateEntitiesParallel(i, runEnd, parallelUpdate);
+        i = runEnd;
+        continue;
+      }
+    }
+
+    auto entry = m_entrySortBuffer[i++];
     if (callback)
       callback(entry->value);
     updateEntityInfo(*entry);
@@ -353,4 +339,138 @@ bool EntityMap::spaceIsOccupied(RectF const& rect, bool includesEphemeral) const
   return false;
 }
 
+void EntityMap::updateEntityInfo(SpatialMap::Entry const& entry) {
+  auto const& entity = entry.value;
+
+  auto position = entity->position();
+  auto boundBox = entity->metaBoundBox();
+
+  if (boundBox.isNegative() || boundBox.width() > MaximumEntityBoundBox || boundBox.height() > MaximumEntityBoundBox) {
+    throw EntityMapException::format("Entity id: {} type: {} bound box is negative or beyond the maximum entity bound box size in EntityMap::addEntity",
+        entity->entityId(), (int)entity->entityType());
+  }
+
+  auto entityId = entity->entityId();
+  if (entityId == NullEntityId)
+    throw EntityMapException::format("Null entity id in EntityMap::setEntityInfo");
+
+  auto rects = m_geometry.splitRect(boundBox, position);
+  if (!containersEqual(rects, entry.rects))
+    m_spatialMap.set(entityId, rects);
+
+  auto uniqueId = entity->uniqueId();
+  if (uniqueId) {
+    if (auto existingEntityId = m_uniqueMap.maybeRight(*uniqueId)) {
+      if (entityId != *existingEntityId)
+        throw EntityMapException::format("Duplicate entity unique id on entity ids ({}) and ({})", *existingEntityId, entityId);
+    } else {
+      m_uniqueMap.removeRight(entityId);
+      m_uniqueMap.add(*uniqueId, entityId);
+    }
+  } else {
+    m_uniqueMap.removeRight(entityId);
+  }
+}
+
+void EntityMap::updateEntitiesParallel(size_t begin, size_t end, ParallelUpdate const& parallelUpdate) {
+  size_t count = end - begin;
+
+  // Union every entity with the first entity seen in each spatial hash sector
+  // its padded bound box touches.
+  List<size_t> parents(count);
+  for (size_t i = 0; i < count; ++i)
+    parents[i] = i;
+  auto findRoot = [&parents](size_t i) {
+    while (parents[i] != i) {
+      parents[i] = parents[parents[i]];
+      i = parents[i];
+    }
+    return i;
+  };
+
+  List<StaticList<RectF, 2>> paddedRects(count);
+  HashMap<Vec2I, size_t> sectorOwners;
+  for (size_t i = 0; i < count; ++i) {
+    auto const& entity = m_entrySortBuffer[begin + i]->value;
+    paddedRects[i] = m_geometry.splitRect(entity->metaBoundBox().padded(parallelUpdate.islandPadding), entity->position());
+    for (auto const& rect : paddedRects[i]) {
+      Vec2I minSector = Vec2I::floor(rect.min() / EntityMapSpatialHashSectorSize);
+      Vec2I maxSector = Vec2I::floor(rect.max() / EntityMapSpatialHashSectorSize);
+      for (int x = minSector[0]; x <= maxSector[0]; ++x) {
+        for (int y = minSector[1]; y <= maxSector[1]; ++y) {
+          auto owner = sectorOwners.insert({Vec2I(x, y), i});
+          if (!owner.second) {
+            size_t a = findRoot(owner.first->second);
+            size_t b = findRoot(i);
+            if (a != b)
+              parents[max(a, b)] = min(a, b);
+          }
+        }
+      }
+    }
+  }
+
+  // Roots are always the lowest index in their island, so numbering islands
+  // in order of their roots numbers them in update order.
+  List<size_t> islandIndexes(count);
+  List<List<size_t>> islands;
+  List<List<RectF>> islandRegions;
+  for (size_t i = 0; i < count; ++i) {
+    size_t root = findRoot(i);
+    if (root == i) {
+      islandIndexes[i] = islands.size();
+      islands.append({});
+      islandRegions.append({});
+    } else {
+      islandIndexes[i] = islandIndexes[root];
+    }
+    islands[islandIndexes[i]].append(begin + i);
+    islandRegions[islandIndexes[i]].appendAll(paddedRects[i]);
+  }
+
+  if (parallelUpdate.prepare)
+    parallelUpdate.prepare(islandRegions);
+
+  // Hand out contiguous ranges of islands with roughly equal entity counts,
+  // a few per worker so that uneven islands still balance out.
+  size_t batchCount = min<size_t>(max<size_t>(parallelUpdate.pool->getWorkerCount(), 1) * 4, islands.size());
+  size_t batchTarget = (count + batchCount - 1) / batchCount;
+  List<WorkerPoolHandle> handles;
+  size_t islandBegin = 0;
+  while (islandBegin < islands.size()) {
+    size_t islandEnd = islandBegin;
+    size_t batchSize = 0;
+    while (islandEnd < islands.size() && (batchSize == 0 || batchSize + islands[islandEnd].size() <= batchTarget))
+      batchSize += islands[islandEnd++].size();
+
+    handles.append(parallelUpdate.pool->addWork([this, &islands, &parallelUpdate, islandBegin, islandEnd]() {
+        for (size_t island = islandBegin; island < islandEnd; ++island) {
+          for (size_t entry : islands[island])
+            parallelUpdate.update(m_entrySortBuffer[entry]->value, island);
+        }
+      }));
+    islandBegin = islandEnd;
+  }
+
+  // Every batch must be finished before anything is unwound, even if one of
+  // them threw.
+  std::exception_ptr exception;
+  for (auto const& handle : handles) {
+    try {
+      handle.finish();
+    } catch (...) {
+      if (!exception)
+        exception = std::current_exception();
+    }
+  }
+  if (exception)
+    std::rethrow_exception(exception);
+
+  for (size_t i = begin; i < end; ++i)
+    updateEntityInfo(*m_entrySortBuffer[i]);
+
+  if (parallelUpdate.merge)
+    parallelUpdate.merge(islands.size());
+}
+
 }
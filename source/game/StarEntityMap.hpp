@@ -3,6 +3,7 @@
 
 #include "StarSpatialHash2D.hpp"
 #include "StarEntity.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -25,6 +26,31 @@ public:
   static float const SpatialHashSectorSize;
   static int const MaximumEntityBoundBox;
 
+  // Optional parallel phase for updateAllEntities.  Runs of entities that are
+  // consecutive in the update order and selected by the filter are split into
+  // islands, where any two entities whose meta bound boxes (padded by
+  // islandPadding) touch a common spatial hash sector are in the same island.
+  // Islands are updated concurrently on the pool, and the spatial information
+  // for the whole run is updated afterwards, in update order.  Islands are
+  // numbered in the update order of their first entity, so that any work
+  // deferred by the update callback can be merged deterministically.
+  struct ParallelUpdate {
+    WorkerPool* pool = nullptr;
+    EntityFilter filter;
+    float islandPadding = 0.0f;
+    // Runs with fewer entities than this are updated serially.
+    size_t minimumRunSize = 0;
+
+    // Called on the calling thread before a run is updated, with the padded
+    // regions that each island of the run covers.
+    function<void(List<List<RectF>> const& islandRegions)> prepare;
+    // Called from the worker threads, never concurrently for entities in the
+    // same island.
+    function<void(EntityPtr const& entity, size_t islandIndex)> update;
+    // Called on the calling thread once every island in a run is updated.
+    function<void(size_t islandCount)> merge;
+  };
+
   // beginIdSpace and endIdSpace is the *inclusive* range for new entityIds.
   EntityMap(Vec2U const& worldSize, EntityId beginIdSpace, EntityId endIdSpace);
 
@@ -46,6 +72,9 @@ public:
   // Iterates through the entity map optionally in the given order, updating
   // the spatial information for each entity along the way.
   void updateAllEntities(EntityCallback const& callback = {}, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder = {});
+  // Same as above, except that entities selected by the ParallelUpdate are
+  // updated through it instead of the callback.
+  void updateAllEntities(EntityCallback const& callback, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder, ParallelUpdate const& parallelUpdate);
 
   // If the given unique entity is in this map, then return its entity id
   EntityId uniqueEntityId(String const& uniqueId) const;
@@ -119,6 +148,10 @@ public:
 private:
   typedef SpatialHash2D<EntityId, float, EntityPtr> SpatialMap;
 
+  void updateEntityInfo(SpatialMap::Entry const& entry);
+  // Updates the given range of m_entrySortBuffer through the ParallelUpdate
+  void updateEntitiesParallel(size_t begin, size_t end, ParallelUpdate const& parallelUpdate);
+
   WorldGeometry m_geometry;
 
   SpatialMap m_spatialMap;
@@ -51,6 +51,7 @@ Monster::Monster(MonsterVariant const& monsterVariant, Maybe<float> level) {
 
   m_scriptComponent.setScripts(m_monsterVariant.parameters.optArray("scripts").apply(jsonToStringList).value(m_monsterVariant.scripts));
   m_scriptComponent.setUpdateDelta(m_monsterVariant.initialScriptDelta);
+  m_scriptComponent.setUpdateDeferrable(true);
 
   auto movementParameters = ActorMovementParameters::sensibleDefaults().merge(ActorMovementParameters(monsterVariant.movementSettings));
   if (movementParameters.standingPoly)
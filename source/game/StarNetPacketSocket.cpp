@@ -1,10 +1,18 @@
 #include "StarNetPacketSocket.hpp"
+#include "StarAlgorithm.hpp"
 #include "StarCompression.hpp"
 #include "StarIterator.hpp"
 #include "StarLogging.hpp"
 
 namespace Star {
 
+// Most data read from a TcpSocket with a single receive call.
+static size_t const ReadSize = 64 * 1024;
+static uint64_t const PacketSizeLimit = 64 << 20;
+// Enough buffered input to hold the header and contents of any allowed
+// packet, past which nothing more is decompressed until packets are read.
+static size_t const DecompressedInputLimit = PacketSizeLimit + 16;
+
 PacketStatCollector::PacketStatCollector(float calculationWindow)
     : m_calculationWindow(calculationWindow), m_stats(), m_lastMixTime(0) {}
 
@@ -55,9 +63,20 @@ Maybe<PacketStats> PacketSocket::outgoingStats() const {
   return {};
 }
 
+bool PacketSocket::receivedDataPending() const {
+  return false;
+}
+
+SocketPtr PacketSocket::socket() const {
+  return {};
+}
+
 void PacketSocket::setLegacy(bool legacy) { m_legacy = legacy; }
 bool PacketSocket::legacy() const { return m_legacy; }
 
+void PacketSocket::setStreamCompression(bool streamCompression) { m_streamCompression = streamCompression; }
+bool PacketSocket::streamCompression() const { return m_streamCompression; }
+
 pair<LocalPacketSocketUPtr, LocalPacketSocketUPtr> LocalPacketSocket::openPair() {
   auto lhsIncomingPipe = make_shared<Pipe>();
   auto rhsIncomingPipe = make_shared<Pipe>();
@@ -136,8 +155,17 @@ void TcpPacketSocket::close() {
 }
 
 void TcpPacketSocket::sendPackets(List<PacketPtr> packets) {
+  if (streamCompression() && !m_compressionStream)
+    m_compressionStream = make_unique<CompressionStream>();
+
   auto it = makeSMutableIterator(packets);
 
+  // When streaming, every run of packets is fed through the compression
+  // stream as it is written, and the stream is flushed once at the end.
+  ByteArray streamOutput;
+  size_t streamedSize = 0;
+  HashMap<PacketType, size_t> streamedSizes;
+
   while (it.hasNext()) {
     PacketType currentType = it.peekNext()->type();
     PacketCompressionMode currentCompressionMode = it.peekNext()->compressionMode();
@@ -154,38 +182,67 @@ void TcpPacketSocket::sendPackets(List<PacketPtr> packets) {
     // determine packet count
     starAssert(!packetBuffer.empty());
 
+    DataStreamBuffer headerBuffer;
+    headerBuffer.write(currentType);
+
+    if (m_compressionStream) {
+      headerBuffer.writeVlqI((int)(packetBuffer.size()));
+      m_compressionStream->compress(headerBuffer.ptr(), headerBuffer.size(), streamOutput, false);
+      m_compressionStream->compress(packetBuffer.ptr(), packetBuffer.size(), streamOutput, false);
+      streamedSize += headerBuffer.size() + packetBuffer.size();
+      streamedSizes[currentType] += packetBuffer.size();
+      continue;
+    }
+
     ByteArray compressedPackets;
     bool mustCompress = currentCompressionMode == PacketCompressionMode::Enabled;
     bool perhapsCompress = currentCompressionMode == PacketCompressionMode::Automatic && packetBuffer.size() > 64;
     if (mustCompress || perhapsCompress)
       compressedPackets = compressData(packetBuffer.data());
 
-    DataStreamBuffer outBuffer;
-    outBuffer.write(currentType);
-
+    // The packet data itself is handed to the output chain as it is, never
+    // copied into a combined buffer.
     if (!compressedPackets.empty() && (mustCompress || compressedPackets.size() < packetBuffer.size())) {
-      outBuffer.writeVlqI(-(int)(compressedPackets.size()));
-      outBuffer.writeData(compressedPackets.ptr(), compressedPackets.size());
+      headerBuffer.writeVlqI(-(int)(compressedPackets.size()));
       m_outgoingStats.mix(currentType, compressedPackets.size());
+      m_outputBuffer.append(headerBuffer.takeData());
+      m_outputBuffer.append(std::move(compressedPackets));
     } else {
-      outBuffer.writeVlqI((int)(packetBuffer.size()));
-      outBuffer.writeData(packetBuffer.ptr(), packetBuffer.size());
+      headerBuffer.writeVlqI((int)(packetBuffer.size()));
       m_outgoingStats.mix(currentType, packetBuffer.size());
+      m_outputBuffer.append(headerBuffer.takeData());
+      m_outputBuffer.append(packetBuffer.takeData());
     }
-    m_outputBuffer.append(outBuffer.takeData());
+  }
+
+  if (streamedSize > 0) {
+    m_compressionStream->compress(nullptr, 0, streamOutput, true);
+    // Attribute the compressed size to each packet type in proportion to its
+    // share of the uncompressed data.
+    double ratio = (double)streamOutput.size() / streamedSize;
+    for (auto& p : streamedSizes)
+      p.second = (size_t)(p.second * ratio);
+    m_outgoingStats.mix(streamedSizes);
+    m_outputBuffer.append(std::move(streamOutput));
   }
 }
 
 List<PacketPtr> TcpPacketSocket::receivePackets() {
-  uint64_t const PacketSizeLimit = 64 << 20;
   List<PacketPtr> packets;
   try {
-    while (!m_inputBuffer.empty()) {
+    // Packets are read in place from the input buffer, which is only trimmed
+    // once at the end, past every packet that was read.
+    size_t consumed = 0;
+    auto trimInput = finally([&]() {
+        m_inputBuffer.trimLeft(consumed);
+      });
+
+    while (consumed < m_inputBuffer.size()) {
       PacketType packetType;
       uint64_t packetSize = 0;
       bool packetCompressed = false;
 
-      DataStreamBuffer ds(m_inputBuffer);
+      DataStreamExternalBuffer ds(m_inputBuffer.ptr() + consumed, m_inputBuffer.size() - consumed);
       try {
         packetType = ds.read<PacketType>();
         int64_t len = ds.readVlqI();
@@ -208,13 +265,24 @@ List<PacketPtr> TcpPacketSocket::receivePackets() {
       if (packetSize > ds.size() - ds.pos())
         break;
 
-      ByteArray packetBytes = ds.readBytes(packetSize);
-      if (packetCompressed)
-        packetBytes = uncompressData(packetBytes);
+      char const* packetData = ds.ptr() + ds.pos();
+      consumed += ds.pos() + packetSize;
 
-      m_incomingStats.mix(packetType, packetSize);
+      DataStreamExternalBuffer packetStream(packetData, packetSize);
+      ByteArray uncompressedBytes;
+      if (packetCompressed) {
+        uncompressData(packetData, packetSize, uncompressedBytes);
+        packetStream.reset(uncompressedBytes.ptr(), uncompressedBytes.size());
+      }
+
+      if (m_decompressionStream) {
+        double ratio = m_streamBytesDecompressed ? (double)m_streamBytesReceived / m_streamBytesDecompressed : 1.0;
+        m_incomingStats.mix(packetType, (size_t)(packetSize * ratio));
+        packetCompressed = true;
+      } else {
+        m_incomingStats.mix(packetType, packetSize);
+      }
 
-      DataStreamBuffer packetStream(std::move(packetBytes));
       do {
         PacketPtr packet = createPacket(packetType);
         packet->setCompressionMode(packetCompressed ? PacketCompressionMode::Enabled : PacketCompressionMode::Disabled);
@@ -224,8 +292,6 @@ List<PacketPtr> TcpPacketSocket::receivePackets() {
           packet->read(packetStream);
         packets.append(std::move(packet));
       } while (!packetStream.atEnd());
-
-      m_inputBuffer = ds.readBytes(ds.size() - ds.pos());
     }
   } catch (IOException const& e) {
     Logger::warn("I/O error in TcpPacketSocket::readPackets, closing: {}", outputException(e, false));
@@ -249,7 +315,7 @@ bool TcpPacketSocket::writeData() {
       return false;
 
     while (!m_outputBuffer.empty()) {
-      size_t writtenAmount = m_socket->send(m_outputBuffer.ptr(), m_outputBuffer.size());
+      size_t writtenAmount = m_socket->send(m_outputBuffer);
       if (writtenAmount == 0)
         break;
       dataSent = true;
@@ -265,15 +331,40 @@ bool TcpPacketSocket::writeData() {
 }
 
 bool TcpPacketSocket::readData() {
+  // Anything already in the input buffer was received before the stream
+  // started, and is parsed as it is.
+  if (streamCompression() && !m_decompressionStream)
+    m_decompressionStream = make_unique<DecompressionStream>();
+
   bool dataReceived = false;
   try {
-    char readBuffer[1024];
-    while (true) {
-      size_t readAmount = m_socket->receive(readBuffer, 1024);
-      if (readAmount == 0)
-        break;
-      dataReceived = true;
-      m_inputBuffer.append(readBuffer, readAmount);
+    if (m_decompressionStream) {
+      // Decompression is bounded so that a small amount of highly compressed
+      // data cannot fill up memory.  Once the limit is hit the rest of the
+      // received data, and anything still waiting on the socket, is left
+      // until the buffered packets have been read.
+      m_decompressionLimited = false;
+      while (true) {
+        size_t inputStart = m_inputBuffer.size();
+        size_t used = m_decompressionStream->decompress(m_compressedInput.ptr(), m_compressedInput.size(), m_inputBuffer, DecompressedInputLimit);
+        m_compressedInput.trimLeft(used);
+        m_streamBytesDecompressed += m_inputBuffer.size() - inputStart;
+        if (!m_compressedInput.empty() || m_inputBuffer.size() >= DecompressedInputLimit) {
+          m_decompressionLimited = true;
+          break;
+        }
+
+        size_t readAmount = m_socket->receive(m_compressedInput, ReadSize);
+        if (readAmount == 0)
+          break;
+        dataReceived = true;
+        m_streamBytesReceived += readAmount;
+      }
+    } else {
+      // Received straight into the input buffer, where the packets are then
+      // read from in place.
+      while (m_socket->receive(m_inputBuffer, ReadSize) != 0)
+        dataReceived = true;
     }
   } catch (SocketClosedException const& e) {
     Logger::debug("TcpPacketSocket socket closed: {}", outputException(e, false));
@@ -284,6 +375,10 @@ bool TcpPacketSocket::readData() {
   return dataReceived;
 }
 
+bool TcpPacketSocket::receivedDataPending() const {
+  return m_decompressionLimited && isOpen();
+}
+
 Maybe<PacketStats> TcpPacketSocket::incomingStats() const {
   return m_incomingStats.stats();
 }
@@ -292,6 +387,10 @@ Maybe<PacketStats> TcpPacketSocket::outgoingStats() const {
   return m_outgoingStats.stats();
 }
 
+SocketPtr TcpPacketSocket::socket() const {
+  return m_socket;
+}
+
 TcpPacketSocket::TcpPacketSocket(TcpSocketPtr socket)
     : m_socket(std::move(socket)) {}
 
@@ -358,13 +457,15 @@ List<PacketPtr> P2PPacketSocket::receivePackets() {
       bool packetCompressed = ds.read<bool>();
       size_t packetSize = ds.size() - ds.pos();
 
-      ByteArray packetBytes = ds.readBytes(packetSize);
-      if (packetCompressed)
-        packetBytes = uncompressData(packetBytes);
+      DataStreamExternalBuffer packetStream(ds.ptr() + ds.pos(), packetSize);
+      ByteArray uncompressedBytes;
+      if (packetCompressed) {
+        uncompressData(ds.ptr() + ds.pos(), packetSize, uncompressedBytes);
+        packetStream.reset(uncompressedBytes.ptr(), uncompressedBytes.size());
+      }
 
       m_incomingStats.mix(packetType, packetSize);
 
-      DataStreamBuffer packetStream(std::move(packetBytes));
       do {
         PacketPtr packet = createPacket(packetType);
         packet->setCompressionMode(packetCompressed ? PacketCompressionMode::Enabled : PacketCompressionMode::Disabled);
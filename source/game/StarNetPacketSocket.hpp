@@ -5,6 +5,7 @@
 #include "StarAtomicSharedPtr.hpp"
 #include "StarP2PNetworkingService.hpp"
 #include "StarNetPackets.hpp"
+#include "StarCompression.hpp"
 
 namespace Star {
 
@@ -67,16 +68,34 @@ public:
   // Read all data available without blocking, returns true if any data was
   // actually received.
   virtual bool readData() = 0;
+  // Returns true if the last readData call stopped short of reading all the
+  // data available, so that it should be called again once the received
+  // packets are taken, even if no new data arrives.  Default implementation
+  // returns false.
+  virtual bool receivedDataPending() const;
 
   // Should return incoming / outgoing packet stats, if they are tracked.
   // Default implementations return nothing.
   virtual Maybe<PacketStats> incomingStats() const;
   virtual Maybe<PacketStats> outgoingStats() const;
 
+  // If all of the I/O of this PacketSocket goes through a single socket,
+  // returns it, so that it can be waited on with a SocketPoller rather than
+  // polled.  Default implementation returns nothing.
+  virtual SocketPtr socket() const;
+
   void setLegacy(bool legacy);
   bool legacy() const;
+
+  // Negotiated during the handshake.  Sockets that support it send everything
+  // after this point through one long-lived compression stream per direction,
+  // instead of compressing each batch of packets on its own.  Must be enabled
+  // on both ends while no packets are in flight, and cannot be disabled again.
+  void setStreamCompression(bool streamCompression);
+  bool streamCompression() const;
 private:
   bool m_legacy = false;
+  bool m_streamCompression = false;
 };
 
 // PacketSocket for local communication.
@@ -124,10 +143,13 @@ public:
 
   bool writeData() override;
   bool readData() override;
+  bool receivedDataPending() const override;
 
   Maybe<PacketStats> incomingStats() const override;
   Maybe<PacketStats> outgoingStats() const override;
 
+  SocketPtr socket() const override;
+
 private:
   TcpPacketSocket(TcpSocketPtr socket);
 
@@ -135,8 +157,21 @@ private:
 
   PacketStatCollector m_incomingStats;
   PacketStatCollector m_outgoingStats;
-  ByteArray m_outputBuffer;
+  // Outgoing data is queued as a chain, so that packet data can be sent
+  // without first being copied together.
+  ByteChain m_outputBuffer;
   ByteArray m_inputBuffer;
+
+  // Created once stream compression is enabled.  Stats for streamed packets
+  // are scaled by the overall compression ratio of the incoming stream.
+  unique_ptr<CompressionStream> m_compressionStream;
+  unique_ptr<DecompressionStream> m_decompressionStream;
+  // Received data not yet decompressed into the input buffer, and whether
+  // decompression stopped at its limit before everything was read.
+  ByteArray m_compressedInput;
+  bool m_decompressionLimited = false;
+  uint64_t m_streamBytesReceived = 0;
+  uint64_t m_streamBytesDecompressed = 0;
 };
 
 // Wraps a P2PSocket into a PacketSocket
@@ -5,6 +5,7 @@ namespace Star {
 
 VersionNumber const StarProtocolVersion = 747;
 VersionNumber const xSbProtocolVersion = 748;
+VersionNumber const xSbStreamProtocolVersion = 749;
 
 EnumMap<PacketType> const PacketTypeNames{
     {PacketType::ProtocolRequest, "ProtocolRequest"},
@@ -882,6 +883,11 @@ void PingPacket::write(DataStream& ds) const {
 EntityCreatePacket::EntityCreatePacket(EntityType entityType, ByteArray storeData, ByteArray firstNetState, EntityId entityId)
     : entityType(entityType), storeData(std::move(storeData)), firstNetState(std::move(firstNetState)), entityId(entityId) {}
 
+EntityCreatePacket::EntityCreatePacket(EntityType entityType, shared_ptr<ByteArray const> sharedStoreData,
+    shared_ptr<ByteArray const> sharedFirstNetState, EntityId entityId)
+    : entityType(entityType), entityId(entityId), sharedStoreData(std::move(sharedStoreData)),
+      sharedFirstNetState(std::move(sharedFirstNetState)) {}
+
 void EntityCreatePacket::read(DataStream& ds) {
   ds.read(entityType);
   ds.read(storeData);
@@ -891,8 +897,8 @@ void EntityCreatePacket::read(DataStream& ds) {
 
 void EntityCreatePacket::write(DataStream& ds) const {
   ds.write(entityType);
-  ds.write(storeData);
-  ds.write(firstNetState);
+  ds.write(sharedStoreData ? *sharedStoreData : storeData);
+  ds.write(sharedFirstNetState ? *sharedFirstNetState : firstNetState);
   ds.viwrite(entityId);
 }
 
@@ -909,10 +915,15 @@ void EntityUpdateSetPacket::read(DataStream& ds) {
 
 void EntityUpdateSetPacket::write(DataStream& ds) const {
   ds.vuwrite(forConnection);
-  ds.writeMapContainer(deltas, [](DataStream& ds, EntityId const& entityId, ByteArray const& delta) {
-    ds.viwrite(entityId);
-    ds.write(delta);
-  });
+  ds.writeVlqU(deltas.size() + sharedDeltas.size());
+  for (auto const& p : deltas) {
+    ds.viwrite(p.first);
+    ds.write(p.second);
+  }
+  for (auto const& p : sharedDeltas) {
+    ds.viwrite(p.first);
+    ds.write(*p.second);
+  }
 }
 
 EntityDestroyPacket::EntityDestroyPacket() {
@@ -24,6 +24,9 @@ STAR_EXCEPTION(StarPacketException, IOException);
 
 extern VersionNumber const StarProtocolVersion;
 extern VersionNumber const xSbProtocolVersion;
+// Same packets as xSbProtocolVersion, but with stream compression enabled on
+// the connection once the protocol response has been sent.
+extern VersionNumber const xSbStreamProtocolVersion;
 
 // Packet types sent between the client and server over a NetSocket.  Does not
 // correspond to actual packets, simply logical portions of NetSocket data.
@@ -698,6 +701,8 @@ struct PingPacket : PacketBase<PacketType::Ping> {
 struct EntityCreatePacket : PacketBase<PacketType::EntityCreate> {
   EntityCreatePacket();
   EntityCreatePacket(EntityType entityType, ByteArray storeData, ByteArray firstNetState, EntityId entityId);
+  EntityCreatePacket(EntityType entityType, shared_ptr<ByteArray const> sharedStoreData,
+      shared_ptr<ByteArray const> sharedFirstNetState, EntityId entityId);
 
   void read(DataStream& ds) override;
   void write(DataStream& ds) const override;
@@ -706,6 +711,12 @@ struct EntityCreatePacket : PacketBase<PacketType::EntityCreate> {
   ByteArray storeData;
   ByteArray firstNetState;
   EntityId entityId;
+
+  // State encoded once and shared with other packets, written in place of
+  // storeData and firstNetState when set.  Never read back into, so only
+  // usable for packets that are serialized before being received.
+  shared_ptr<ByteArray const> sharedStoreData;
+  shared_ptr<ByteArray const> sharedFirstNetState;
 };
 
 // All entity deltas will be sent at the same time for the same connection
@@ -719,6 +730,8 @@ struct EntityUpdateSetPacket : PacketBase<PacketType::EntityUpdateSet> {
 
   ConnectionId forConnection;
   HashMap<EntityId, ByteArray> deltas;
+  // Written along with deltas, same as EntityCreatePacket::sharedStoreData.
+  HashMap<EntityId, shared_ptr<ByteArray const>> sharedDeltas;
 };
 
 struct EntityDestroyPacket : PacketBase<PacketType::EntityDestroy> {
@@ -61,6 +61,7 @@ Npc::Npc(NpcVariant const& npcVariant)
 
   m_scriptComponent.setScripts(m_npcVariant.scripts);
   m_scriptComponent.setUpdateDelta(m_npcVariant.initialScriptDelta);
+  m_scriptComponent.setUpdateDeferrable(true);
   auto movementParameters = ActorMovementParameters(m_npcVariant.movementParameters);
   if (!movementParameters.physicsEffectCategories)
     movementParameters.physicsEffectCategories = StringSet({"npc"});
@@ -205,6 +205,7 @@ void Object::init(World* world, EntityId entityId, EntityMode mode) {
 
     m_scriptComponent.setScripts(m_config->scripts);
     m_scriptComponent.setUpdateDelta(configValue("scriptDelta", 5).toInt());
+    m_scriptComponent.setUpdateDeferrable(true);
 
     m_scriptComponent.initScriptBindings(this);
     m_scriptComponent.initMessageBinding(this);
@@ -37,7 +37,15 @@ Json const BaseAssetsSettings = Json::parseJson(R"JSON(
       ],
 
       "luaGcPause" : 1.2,
-      "luaGcStepMultiplier" : 2.0
+      "luaGcStepMultiplier" : 2.0,
+
+      // Keep fully patched JSON assets in the storage directory between
+      // starts.
+      "patchCache" : true,
+
+      // Apply every JSON patch while loading, instead of when each patched
+      // asset is first used.
+      "preloadPatchedJson" : false
     }
   )JSON");
 
@@ -68,6 +76,7 @@ Json const BaseDefaultConfiguration = Json::parseJson(R"JSON(
       "scriptInstructionLimit" : 10000000,
       "scriptProfilingEnabled" : false,
       "scriptInstructionMeasureInterval" : 10000,
+      "scriptJsonProxyMinimumSize" : null,
 
       "allowAdminCommands" : true,
       "allowAdminCommandsFromAnyone" : false,
@@ -203,6 +212,7 @@ Root::Settings RootLoader::rootSettingsForOptions(Options const& options) const
     rootSettings.assetsSettings.digestIgnore = jsonToStringList(assetsSettings.get("digestIgnore"));
     rootSettings.assetsSettings.luaGcPause = assetsSettings.getFloat("luaGcPause");
     rootSettings.assetsSettings.luaGcStepMultiplier = assetsSettings.getFloat("luaGcStepMultiplier");
+    rootSettings.assetsSettings.preloadPatchedJson = assetsSettings.getBool("preloadPatchedJson", false);
 
 #ifdef STAR_SYSTEM_LINUX
     // FezzedOne: Substitute `${HOME}` and `$HOME` for the user's home directory, but not if the `$` is escaped (i.e., `\$`).
@@ -256,6 +266,9 @@ Root::Settings RootLoader::rootSettingsForOptions(Options const& options) const
     rootSettings.storageDirectory = bootConfig.getString("storageDirectory");
 #endif
 
+    if (assetsSettings.getBool("patchCache"))
+      rootSettings.assetsSettings.patchCacheFile = File::relativeTo(rootSettings.storageDirectory, "assets.patchcache");
+
     rootSettings.logFile = options.parameters.value("logfile").maybeFirst().orMaybe(m_defaults.logFile);
     rootSettings.logFileBackups = bootConfig.getUInt("logFileBackups", 5);
 
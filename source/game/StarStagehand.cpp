@@ -157,6 +157,7 @@ void Stagehand::readConfig(Json config) {
   if (m_scripted) {
     m_scriptComponent.setScripts(jsonToStringList(m_config.getArray("scripts", JsonArray())));
     m_scriptComponent.setUpdateDelta(m_config.getInt("scriptDelta", 5));
+    m_scriptComponent.setUpdateDeferrable(true);
 
     if (m_config.contains("scriptStorage"))
       m_scriptComponent.setScriptStorage(m_config.getObject("scriptStorage"));
@@ -19,6 +19,10 @@
 
 namespace Star {
 
+// Largest number of tiles getPoints samples per point requested, when
+// sampling the bounding box of the points as a region.
+static size_t const PointSampleOverhead = 4;
+
 TerrainSelectorParameters::TerrainSelectorParameters() {
   seed = Random::randu64();
   worldWidth = 0;
@@ -54,6 +58,37 @@ TerrainSelector::TerrainSelector(String type, Json config, TerrainSelectorParame
 
 TerrainSelector::~TerrainSelector() {}
 
+void TerrainSelector::getRegion(RectI const& region, float* out) const {
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x)
+      *out++ = get(x, y);
+  }
+}
+
+void TerrainSelector::getPoints(Vec2I const* points, size_t count, float* out) const {
+  if (count == 0)
+    return;
+
+  RectI bounds = RectI::null();
+  for (size_t i = 0; i < count; ++i)
+    bounds.combine(points[i]);
+  bounds.setMax(bounds.max() + Vec2I(1, 1));
+
+  // Sampling a few tiles too many is still much cheaper than going point by
+  // point, but points scattered over a large area are not worth it.
+  if ((size_t)bounds.volume() > count * PointSampleOverhead) {
+    for (size_t i = 0; i < count; ++i)
+      out[i] = get(points[i][0], points[i][1]);
+    return;
+  }
+
+  List<float> values(bounds.volume());
+  getRegion(bounds, values.ptr());
+  int width = bounds.width();
+  for (size_t i = 0; i < count; ++i)
+    out[i] = values[(points[i][1] - bounds.yMin()) * width + (points[i][0] - bounds.xMin())];
+}
+
 TerrainDatabase::TerrainDatabase() {
   auto assets = Root::singleton().assets();
 
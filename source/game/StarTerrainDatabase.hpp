@@ -3,6 +3,7 @@
 
 #include "StarJson.hpp"
 #include "StarThread.hpp"
+#include "StarRect.hpp"
 
 namespace Star {
 
@@ -34,6 +35,17 @@ struct TerrainSelector {
   // considered solid, < 0.0 should be considered open space.
   virtual float get(int x, int y) const = 0;
 
+  // Fills out with the value of every tile in the region, row by row, so that
+  // the value at (x, y) is at out[(y - yMin) * width + (x - xMin)].  Must give
+  // exactly the same values as get(), but selectors override this to work on
+  // the whole region at once.  The default implementation calls get() for
+  // every tile.
+  virtual void getRegion(RectI const& region, float* out) const;
+
+  // Samples any set of points, through a single getRegion call over their
+  // bounding box if they are close enough together, otherwise one by one.
+  void getPoints(Vec2I const* points, size_t count, float* out) const;
+
   String type;
   Json config;
   TerrainSelectorParameters parameters;
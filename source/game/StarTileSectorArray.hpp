@@ -105,6 +105,8 @@ public:
   void tileEachColumns(RectI const& region, Function&& function) const;
   template <typename Function>
   void tileEvalColumns(RectI const& region, Function&& function);
+  // Like tileEvalColumns, but columns in different sectors may be evaluated
+  // concurrently, see SectorArray2D::evalColumnsParallel.
   template <typename Function>
   void tileEvalColumnsParallel(RectI const& region, Function&& function);
 
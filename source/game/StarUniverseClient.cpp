@@ -139,10 +139,16 @@ Maybe<String> UniverseClient::connect(UniverseConnection connection, bool allowA
   if (jUseNewProtocol.isType(Json::Type::Bool))
     autoForceLegacyConnection = !jUseNewProtocol.toBool();
   bool shouldForceLegacyConnection = forceLegacyConnection || autoForceLegacyConnection;
+  // Stream compression is only understood by xStarbound servers new enough to accept its protocol version.
+  bool useStreamCompression = false;
+  auto jUseStreamCompression = root.configuration()->get("useStreamCompression");
+  if (!shouldForceLegacyConnection && jUseStreamCompression.isType(Json::Type::Bool))
+    useStreamCompression = jUseStreamCompression.toBool();
+  VersionNumber requestProtocolVersion = shouldForceLegacyConnection ? StarProtocolVersion
+      : (useStreamCompression ? xSbStreamProtocolVersion : xSbProtocolVersion);
 
   {
-    auto protocolRequest =
-        make_shared<ProtocolRequestPacket>(shouldForceLegacyConnection ? StarProtocolVersion : xSbProtocolVersion);
+    auto protocolRequest = make_shared<ProtocolRequestPacket>(requestProtocolVersion);
     protocolRequest->setCompressionMode(shouldForceLegacyConnection ? PacketCompressionMode::Disabled : PacketCompressionMode::Enabled);
     // FezzedOne: If we're not forcing legacy connections, signal that we're a modded client.
     connection.pushSingle(protocolRequest);
@@ -154,19 +160,24 @@ Maybe<String> UniverseClient::connect(UniverseConnection connection, bool allowA
   if (!protocolResponsePacket)
     return String("Join failed! Timed out while establishing connection.");
   else if (!protocolResponsePacket->allowed)
-    return String(strf("Join failed! Server does not support {} connections with protocol version {}!{}",
+    return String(strf("Join failed! Server does not support {} connections with protocol version {}!{}{}",
         shouldForceLegacyConnection ? "legacy" : "xStarbound",
-        shouldForceLegacyConnection ? StarProtocolVersion : xSbProtocolVersion,
+        requestProtocolVersion,
         shouldForceLegacyConnection ? "" : strf("\n\nYou're using the new xStarbound protocol."
                                                 " If connecting to a non-xSB server or host (or one not using the new protocol),"
                                                 " set ^orange;\"useNewProtocol\"^reset; to ^orange;false^reset; in ^orange;xclient.config^reset;."
                                                 " You can prepend ^orange;@^reset; to a dedicated server address instead to override the protocol"
                                                 " setting for this session."
                                                 "\n^orange;xStarbound netcode version: v{}",
-                                               xSbNetworkVersionString)));
+                                               xSbNetworkVersionString),
+        useStreamCompression ? "\n\nIf the server runs an older xStarbound version, set ^orange;\"useStreamCompression\"^reset; to"
+                               " ^orange;false^reset; in ^orange;xclient.config^reset;." : ""));
 
   m_legacyServer = protocolResponsePacket->compressionMode() != PacketCompressionMode::Enabled; // True if server is vanilla
   connection.setLegacy(shouldForceLegacyConnection || m_legacyServer);
+  // The server accepted our protocol version, so it has already switched its
+  // side of the connection over.
+  connection.setStreamCompression(useStreamCompression && !m_legacyServer);
   if (shouldForceLegacyConnection && !m_legacyServer)
     Logger::info("UniverseClient: Detected custom server, but forcing legacy protocol");
   connection.pushSingle(make_shared<ClientConnectPacket>(Root::singleton().assets()->digest(), allowAssetsMismatch, m_mainPlayer->uuid(), m_mainPlayer->name(),
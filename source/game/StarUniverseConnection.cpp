@@ -4,6 +4,10 @@
 namespace Star {
 
 static const int PacketSocketPollSleep = 1;
+// Longest the processing loop waits on the poller when no connection has to be
+// polled.  Only bounds how long an idle loop takes to notice a shutdown that
+// somehow missed its wake.
+static const int PacketSocketMaxWait = 100;
 
 UniverseConnection::UniverseConnection(PacketSocketUPtr packetSocket)
   : m_packetSocket(std::move(packetSocket)) {}
@@ -111,6 +115,10 @@ void UniverseConnection::setLegacy(bool legacy) {
   m_packetSocket->setLegacy(legacy);
 }
 
+void UniverseConnection::setStreamCompression(bool streamCompression) {
+  m_packetSocket->setStreamCompression(streamCompression);
+}
+
 Maybe<PacketStats> UniverseConnection::incomingStats() const {
   MutexLocker locker(m_mutex);
   return m_packetSocket->incomingStats();
@@ -127,11 +135,25 @@ UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetR
       RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
       try {
         while (!m_shutdown) {
+          // Polled connections are only serviced once the poller reports
+          // activity on them.  Outgoing packets are written straight away by
+          // sendPackets, and anything that could not be written then is
+          // picked up once the socket reports it is writable again.
           connectionsLocker.lock();
-          auto connections = m_connections.pairs();
+          List<pair<ConnectionId, shared_ptr<Connection>>> connections;
+          for (auto clientId : m_unpolledConnections)
+            connections.append({clientId, m_connections.get(clientId)});
+          for (auto clientId : take(m_readyConnections)) {
+            if (auto connection = m_connections.value(clientId))
+              connections.append({clientId, std::move(connection)});
+          }
+          bool pollingRequired = !m_unpolledConnections.empty();
           connectionsLocker.unlock();
 
           bool dataTransmitted = false;
+          // Connections that have more to read than was read this time, which
+          // the poller will not report again.
+          List<ConnectionId> pendingConnections;
           for (auto& p : connections) {
             MutexLocker connectionLocker(p.second->mutex);
             if (!p.second->packetSocket || !p.second->packetSocket->isOpen())
@@ -139,8 +161,14 @@ UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetR
 
             p.second->packetSocket->sendPackets(take(p.second->sendQueue));
             dataTransmitted |= p.second->packetSocket->writeData();
+            if (p.second->pollSocket)
+              m_poller.setWantWrite(p.second->pollSocket, p.second->packetSocket->sentPacketsPending());
 
             dataTransmitted |= p.second->packetSocket->readData();
+            if (p.second->pollSocket && p.second->packetSocket->receivedDataPending()) {
+              pendingConnections.append(p.first);
+              dataTransmitted = true;
+            }
             List<PacketPtr> receivePackets = p.second->packetSocket->receivePackets();
             if (!receivePackets.empty()) {
               p.second->lastActivityTime = Time::monotonicMilliseconds();
@@ -162,8 +190,26 @@ UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetR
             }
           }
 
+          if (!pendingConnections.empty()) {
+            connectionsLocker.lock();
+            m_readyConnections.addAll(pendingConnections);
+            connectionsLocker.unlock();
+          }
+
+          // Always collect events, even without waiting, since they are
+          // only reported once.
+          unsigned waitTime = 0;
           if (!dataTransmitted)
-            Thread::sleep(PacketSocketPollSleep);
+            waitTime = pollingRequired ? PacketSocketPollSleep : PacketSocketMaxWait;
+          auto events = m_poller.wait(waitTime);
+          if (!events.empty()) {
+            connectionsLocker.lock();
+            for (auto const& event : events) {
+              if (auto clientId = m_polledConnections.maybe(event.socket.get()))
+                m_readyConnections.add(*clientId);
+            }
+            connectionsLocker.unlock();
+          }
         }
       } catch (std::exception const& e) {
         Logger::error("Exception caught in UniverseConnectionServer::remoteProcessLoop, closing all remote connections: {}", e.what());
@@ -176,6 +222,7 @@ UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetR
 
 UniverseConnectionServer::~UniverseConnectionServer() {
   m_shutdown = true;
+  m_poller.wake();
   m_processingLoop.finish();
   removeAllConnections();
 }
@@ -219,7 +266,18 @@ void UniverseConnectionServer::addConnection(ConnectionId clientId, UniverseConn
   connection->sendQueue = std::move(uc.m_sendQueue);
   connection->receiveQueue = std::move(uc.m_receiveQueue);
   connection->lastActivityTime = Time::monotonicMilliseconds();
+  if (auto socket = connection->packetSocket->socket()) {
+    m_poller.add(socket);
+    m_polledConnections.set(socket.get(), clientId);
+    // Serviced once straight away, in case anything arrived before the
+    // socket was registered.
+    m_readyConnections.add(clientId);
+    connection->pollSocket = std::move(socket);
+  } else {
+    m_unpolledConnections.add(clientId);
+  }
   m_connections.add(clientId, std::move(connection));
+  m_poller.wake();
 }
 
 UniverseConnection UniverseConnectionServer::removeConnection(ConnectionId clientId) {
@@ -229,6 +287,13 @@ UniverseConnection UniverseConnectionServer::removeConnection(ConnectionId clien
 
   auto conn = m_connections.take(clientId);
   MutexLocker connectionLocker(conn->mutex);
+  m_unpolledConnections.remove(clientId);
+  m_readyConnections.remove(clientId);
+  if (conn->pollSocket) {
+    m_polledConnections.remove(conn->pollSocket.get());
+    m_poller.remove(conn->pollSocket);
+    conn->pollSocket.reset();
+  }
 
   UniverseConnection uc;
   uc.m_packetSocket = take(conn->packetSocket);
@@ -254,6 +319,8 @@ void UniverseConnectionServer::sendPackets(ConnectionId clientId, List<PacketPtr
     if (conn->packetSocket->isOpen()) {
       conn->packetSocket->sendPackets(take(conn->sendQueue));
       conn->packetSocket->writeData();
+      if (conn->pollSocket)
+        m_poller.setWantWrite(conn->pollSocket, conn->packetSocket->sentPacketsPending());
     }
   } else {
     throw UniverseConnectionException::format("No such client '{}' in UniverseConnectionServer::sendPackets", clientId);
@@ -2,6 +2,7 @@
 #define STAR_UNIVERSE_CONNECTION_HPP
 
 #include "StarNetPacketSocket.hpp"
+#include "StarSocketPoller.hpp"
 
 namespace Star {
 
@@ -50,6 +51,7 @@ public:
   bool receiveAny(unsigned timeout);
 
   void setLegacy(bool legacy);
+  void setStreamCompression(bool streamCompression);
 
   // Packet stats for the most recent one second window of activity incoming
   // and outgoing.  Will only return valid stats if the underlying PacketSocket
@@ -70,6 +72,8 @@ private:
 
 // Manage a set of UniverseConnections cheaply and in an asynchronous way.
 // Uses a single background thread to handle remote sending and receiving.
+// Connections over a single socket are only serviced once a SocketPoller
+// reports activity on them, the rest are polled continuously.
 class UniverseConnectionServer {
 public:
   // The packet receive callback is called asynchronously on every packet group
@@ -100,12 +104,22 @@ private:
     List<PacketPtr> sendQueue;
     Deque<PacketPtr> receiveQueue;
     int64_t lastActivityTime;
+
+    // Set if the connection is registered with the poller.
+    SocketPtr pollSocket;
   };
 
   PacketReceiveCallback const m_packetReceiver;
 
   mutable RecursiveMutex m_connectionsMutex;
   HashMap<ConnectionId, shared_ptr<Connection>> m_connections;
+  // Connections on the poller, and those it has reported since they were
+  // last serviced.  Every other connection is serviced on every pass.
+  HashMap<Socket const*, ConnectionId> m_polledConnections;
+  HashSet<ConnectionId> m_unpolledConnections;
+  HashSet<ConnectionId> m_readyConnections;
+
+  SocketPoller m_poller;
 
   ThreadFunction<void> m_processingLoop;
   atomic<bool> m_shutdown;
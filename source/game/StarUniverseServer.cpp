@@ -196,6 +196,13 @@ UniverseServer::UniverseServer(String const& storageDir, bool isDedicatedServer)
 
   m_pause = make_shared<atomic<bool>>(false);
 
+  if (configuration->get("worldTickScheduler").optBool().value(false)) {
+    unsigned schedulerThreads = configuration->get("worldTickSchedulerThreads").optUInt().value(0);
+    unsigned idleWorldTickDivisor = configuration->get("idleWorldTickDivisor").optUInt().value(4);
+    m_worldTickScheduler = make_shared<WorldTickScheduler>(schedulerThreads, idleWorldTickDivisor);
+    Logger::info("UniverseServer: Ticking worlds on a shared scheduler with {} threads", m_worldTickScheduler->threadCount());
+  }
+
   this->updateSecuritySettings();
 }
 
@@ -503,6 +510,20 @@ bool UniverseServer::executeForClient(ConnectionId clientId, function<void(World
   return success;
 }
 
+size_t UniverseServer::executeForWorlds(function<void(WorldServer*)> action) {
+  RecursiveMutexLocker locker(m_mainLock);
+  size_t count = 0;
+  for (auto const& worldId : m_worlds.keys()) {
+    if (auto world = getWorld(worldId)) {
+      world->executeAction([&action](WorldServerThread*, WorldServer* worldServer) {
+        action(worldServer);
+      });
+      ++count;
+    }
+  }
+  return count;
+}
+
 void UniverseServer::disconnectClient(ConnectionId clientId, String const& reason) {
   RecursiveMutexLocker locker(m_mainLock);
   m_pendingDisconnections.add(clientId, reason);
@@ -1346,7 +1367,7 @@ void UniverseServer::shutdownInactiveWorlds() {
         }
       }
 
-      if (world->isJoined()) {
+      if (world->isStopped()) {
         auto kickClients = world->clients();
         if (!kickClients.empty()) {
           Logger::info("UniverseServer: World {} shutdown, kicking {} players to their own ships", worldId, world->clients().size());
@@ -1972,7 +1993,9 @@ void UniverseServer::acceptConnection(UniverseConnection connection, Maybe<HostA
   // Since xStarbound now changes the networking protocol for xStarbound clients, check the xSB protocol version number if necessary.
   // This kicks OpenStarbound clients!
   protocolResponse->setCompressionMode(forceLegacyConnection ? PacketCompressionMode::Disabled : PacketCompressionMode::Enabled);
-  if (protocolRequest->requestProtocolVersion != (legacyConnection ? StarProtocolVersion : xSbProtocolVersion)) {
+  // xStarbound clients may also ask for stream compression with its own protocol version.
+  bool streamCompression = !legacyConnection && protocolRequest->requestProtocolVersion == xSbStreamProtocolVersion;
+  if (!streamCompression && protocolRequest->requestProtocolVersion != (legacyConnection ? StarProtocolVersion : xSbProtocolVersion)) {
     Logger::warn("UniverseServer: Client connection aborted, unsupported {} protocol version {}, supported version {}",
         legacyConnection ? "legacy" : "xStarbound", protocolRequest->requestProtocolVersion, StarProtocolVersion);
     protocolResponse->allowed = false;
@@ -1986,9 +2009,13 @@ void UniverseServer::acceptConnection(UniverseConnection connection, Maybe<HostA
   protocolResponse->allowed = true;
   connection.pushSingle(protocolResponse);
   connection.sendAll(clientWaitLimit);
+  // The response itself is the last thing sent without the stream, and the
+  // client sends nothing until it has it.
+  connection.setStreamCompression(streamCompression);
 
   String remoteAddressString = remoteAddress ? toString(*remoteAddress) : "local";
-  Logger::info("UniverseServer: Awaiting connection info from {}, {} client", remoteAddressString, legacyClient ? "stock" : "custom");
+  Logger::info("UniverseServer: Awaiting connection info from {}, {} client{}", remoteAddressString, legacyClient ? "stock" : "custom",
+      streamCompression ? " using stream compression" : "");
 
   connection.receiveAny(clientWaitLimit);
   auto clientConnect = as<ClientConnectPacket>(connection.pullSingle());
@@ -2582,6 +2609,7 @@ Maybe<WorkerPoolPromise<WorldServerThreadPtr>> UniverseServer::shipWorldPromise(
 
     auto shipWorldThread = make_shared<WorldServerThread>(shipWorld, ClientShipWorldId(clientShipWorldId));
     shipWorldThread->setPause(m_pause);
+    shipWorldThread->setScheduler(m_worldTickScheduler);
     clientContext->updateShipChunks(shipWorldThread->readChunks());
     shipWorldThread->start();
     shipWorldThread->setUpdateAction(bind(&UniverseServer::worldUpdated, this, _1));
@@ -2628,6 +2656,7 @@ Maybe<WorkerPoolPromise<WorldServerThreadPtr>> UniverseServer::celestialWorldPro
 
     auto worldThread = make_shared<WorldServerThread>(worldServer, celestialWorldId);
     worldThread->setPause(m_pause);
+    worldThread->setScheduler(m_worldTickScheduler);
     worldThread->start();
     worldThread->setUpdateAction(bind(&UniverseServer::worldUpdated, this, _1));
 
@@ -2753,6 +2782,7 @@ Maybe<WorkerPoolPromise<WorldServerThreadPtr>> UniverseServer::instanceWorldProm
 
     auto worldThread = make_shared<WorldServerThread>(worldServer, instanceWorldId);
     worldThread->setPause(m_pause);
+    worldThread->setScheduler(m_worldTickScheduler);
     worldThread->start();
     worldThread->setUpdateAction(bind(&UniverseServer::worldUpdated, this, _1));
 
@@ -101,6 +101,10 @@ public:
   // Returns true if function was called, false if client was not found or in
   // an invalid connection state.
   bool executeForClient(ConnectionId clientId, function<void(WorldServer*, PlayerPtr)> action);
+  // Executes the given function on every active world that has finished
+  // loading, in a thread safe way.  Returns the number of worlds it was called
+  // on.
+  size_t executeForWorlds(function<void(WorldServer*)> action);
   void disconnectClient(ConnectionId clientId, String const& reason);
   void banUser(ConnectionId clientId, String const& reason, pair<bool, bool> banType, Maybe<int> timeout);
   bool unbanIp(String const& addressString);
@@ -269,6 +273,9 @@ private:
 
   shared_ptr<atomic<bool>> m_pause;
   bool m_secureWarps;
+  // If set, world ticks run on this scheduler's shared threads instead of
+  // one thread per world.
+  WorldTickSchedulerPtr m_worldTickScheduler;
   Map<WorldId, Maybe<WorkerPoolPromise<WorldServerThreadPtr>>> m_worlds;
   Map<InstanceWorldId, pair<int64_t, int64_t>> m_tempWorldIndex;
   Map<Vec3I, SystemWorldServerThreadPtr> m_systemWorlds;
@@ -649,6 +649,7 @@ WorldGenerator::WorldGenerator(WorldServer* server) : m_worldServer(server) {
 }
 
 void WorldGenerator::generateSectorLevel(WorldStorage* worldStorage, Sector const& sector, SectorGenerationLevel generationLevel) {
+  m_worldServer->invalidateLightLevels(worldStorage->tileArray()->sectorRegion(sector));
   if (generationLevel == SectorGenerationLevel::BaseTiles) {
     prepareTiles(worldStorage, sector);
   } else if (generationLevel == SectorGenerationLevel::MicroDungeons) {
@@ -667,6 +668,7 @@ void WorldGenerator::generateSectorLevel(WorldStorage* worldStorage, Sector cons
 }
 
 void WorldGenerator::sectorLoadLevelChanged(WorldStorage* worldStorage, Sector const& sector, SectorLoadLevel loadLevel) {
+  m_worldServer->invalidateLightLevels(worldStorage->tileArray()->sectorRegion(sector));
   if (loadLevel == SectorLoadLevel::Loaded) {
     if (worldStorage->sectorGenerationLevel(sector) == SectorGenerationLevel::Complete)
       m_worldServer->activateLiquidRegion(worldStorage->tileArray()->sectorRegion(sector));
@@ -767,6 +769,7 @@ void WorldGenerator::prepareTiles(WorldStorage* worldStorage, ServerTileSectorAr
   // Generate sector.
   auto tileArray = worldStorage->tileArray();
   RectI sectorRegion = tileArray->sectorRegion(sector);
+  auto blockInfos = planet->blockInfo(sectorRegion);
   for (int x = sectorRegion.xMin(); x < sectorRegion.xMax(); ++x) {
     for (int y = sectorRegion.yMin(); y < sectorRegion.yMax(); ++y) {
       Vec2I pos(x, y);
@@ -775,7 +778,7 @@ void WorldGenerator::prepareTiles(WorldStorage* worldStorage, ServerTileSectorAr
       if (!tile)
         continue;
 
-      auto blockInfo = planet->blockInfo(pos[0], pos[1]);
+      auto const& blockInfo = blockInfos[(y - sectorRegion.yMin()) * sectorRegion.width() + (x - sectorRegion.xMin())];
 
       tile->blockBiomeIndex = blockInfo.blockBiomeIndex;
       tile->environmentBiomeIndex = blockInfo.environmentBiomeIndex;
@@ -422,16 +422,30 @@ namespace WorldImpl {
     // tileEach can't handle rects that are WAY out of range.
     pos = worldGeometry.xwrap(pos);
 
-    Vec3F environmentLight = sky->environmentLight().toRgbF();
+    float environmentLight = sky->environmentLight().toRgbF().sum() / 3.0f;
     float undergroundLevel = worldTemplate->undergroundLevel();
     auto materialDatabase = Root::singleton().materialDatabase();
     auto liquidsDatabase = Root::singleton().liquidsDatabase();
 
     lighting.begin(pos);
 
+    for (auto const& entity : entityMap->entityQuery(RectF(lighting.calculationRegion()))) {
+      for (auto const& light : entity->lightSources()) {
+        Vec2F position = worldGeometry.nearestTo(Vec2F(lighting.calculationRegion().min()), light.position);
+        if (light.pointLight)
+          lighting.addPointLight(position, Color::v3bToFloat(light.color).sum() / 3.0f, light.pointBeam, light.beamAngle, light.beamAmbience);
+        else
+          lighting.addSpreadLight(position, Color::v3bToFloat(light.color).sum() / 3.0f);
+      }
+    }
+
+    if (auto cached = lighting.cachedCalculate(environmentLight))
+      return *cached;
+
     // Each column in tileEvalColumns is guaranteed to be no larger than the
     // sector size.
     CellularLightIntensityCalculator::Cell lightingCellColumn[WorldSectorSize];
+    bool environmentLit = false;
     tileSectorArray->tileEvalColumns(lighting.calculationRegion(), [&](Vec2I const& pos, typename TileSectorArray::Tile const* column, size_t ySize) {
       for (size_t y = 0; y < ySize; ++y) {
         auto& tile = column[y];
@@ -444,24 +458,16 @@ namespace WorldImpl {
         cell.light += liquidsDatabase->radiantLight(tile.liquid).sum() / 3.0f;
         if (foregroundTransparent) {
           cell.light += materialDatabase->radiantLight(tile.background, tile.backgroundMod).sum() / 3.0f;
-          if (backgroundTransparent && pos[1] > undergroundLevel)
-            cell.light += environmentLight.sum() / 3.0f;
+          if (backgroundTransparent && pos[1] > undergroundLevel) {
+            cell.light += environmentLight;
+            environmentLit = true;
+          }
         }
       }
       lighting.setCellColumn(pos, lightingCellColumn, ySize);
     });
 
-    for (auto const& entity : entityMap->entityQuery(RectF(lighting.calculationRegion()))) {
-      for (auto const& light : entity->lightSources()) {
-        Vec2F position = worldGeometry.nearestTo(Vec2F(lighting.calculationRegion().min()), light.position);
-        if (light.pointLight)
-          lighting.addPointLight(position, Color::v3bToFloat(light.color).sum() / 3.0f, light.pointBeam, light.beamAngle, light.beamAmbience);
-        else
-          lighting.addSpreadLight(position, Color::v3bToFloat(light.color).sum() / 3.0f);
-      }
-    }
-
-    return lighting.calculate();
+    return lighting.calculate(environmentLit ? environmentLight : Maybe<float>());
   }
 
   inline InteractiveEntityPtr getInteractiveInRange(WorldGeometry const& geometry, EntityMapPtr const& entityMap,
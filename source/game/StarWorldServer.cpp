@@ -18,6 +18,8 @@
 #include "StarPhysicsEntity.hpp"
 #include "StarPlayer.hpp"
 #include "StarProjectile.hpp"
+#include "StarRandom.hpp"
+#include "StarStaticRandom.hpp"
 #include "StarText.hpp"
 #include "StarUniverseServer.hpp"
 #include "StarUniverseServerLuaBindings.hpp"
@@ -47,6 +49,21 @@ EnumMap<WorldServerFidelity> const WorldServerFidelityNames{
     {WorldServerFidelity::Medium, "medium"},
     {WorldServerFidelity::High, "high"}};
 
+// Whether entities of this type are updated in the parallel entity update
+// phase, if it is enabled.  Their updates must not touch anything outside of their island
+// besides reading tiles and non-parallel entities, and may only change the
+// world through addEntity or timer, which are deferred while in the parallel
+// phase.  Global Random functions are redirected to a source seeded from the
+// entity id and step for the duration of the update.  Entities that run
+// scripts can never be on this list, the LuaRoot is shared by the whole world.
+static bool isParallelUpdateEntityType(EntityType type) {
+  return type == EntityType::ItemDrop || type == EntityType::PlantDrop;
+}
+
+// Set while a worker thread is updating an entity island, world changes made
+// from that island are queued here and applied in island order afterwards.
+static thread_local List<WorldAction>* s_deferredIslandActions = nullptr;
+
 WorldServer::WorldServer(WorldTemplatePtr const& worldTemplate, IODevicePtr storage) : m_preUninitialized(false) {
   m_worldTemplate = worldTemplate;
   m_worldStorage = make_shared<WorldStorage>(m_worldTemplate->size(), storage, make_shared<WorldGenerator>(this));
@@ -96,6 +113,7 @@ WorldServer::~WorldServer() {
     m_scriptContexts.clear();
     // FezzedOne: Why wasn't this cleared on uninit?
     m_netStateCache.clear();
+    m_netCreateCache.clear();
     m_spawner.uninit();
     writeMetadata();
     m_worldStorage->unloadAll(true);
@@ -121,6 +139,7 @@ void WorldServer::preUninit() {
   m_scriptContexts.clear();
   // FezzedOne: Why wasn't this cleared on uninit?
   m_netStateCache.clear();
+  m_netCreateCache.clear();
   m_spawner.uninit();
   writeMetadata();
   m_worldStorage->unloadAll(true);
@@ -163,6 +182,7 @@ void WorldServer::initLua(UniverseServer* universe) {
   for (auto& p : assets->json("/worldserver.config:scriptContexts").toObject()) {
     auto scriptComponent = makeObject<ScriptComponent>();
     scriptComponent->setScripts(jsonToStringList(p.second.toArray()));
+    scriptComponent->setUpdateDeferrable(true);
     scriptComponent->addCallbacks("universe", LuaBindings::makeUniverseServerCallbacks(universe));
     scriptComponent->initScriptBindings(scriptComponent.get());
     scriptComponent->initMessageBinding(scriptComponent.get());
@@ -311,7 +331,7 @@ bool WorldServer::addClient(ConnectionId clientId, SpawnTarget const& spawnTarge
 
   tracker.update(m_currentStep);
 
-  auto clientInfo = m_clientInfo.add(clientId, make_shared<ClientInfo>(clientId, tracker, canBeAdmin, clientUuid, accountName, isGuest));
+  auto clientInfo = m_clientInfo.add(clientId, make_shared<ClientInfo>(clientId, tracker, isLocal, canBeAdmin, clientUuid, accountName, isGuest));
 
   auto worldStartPacket = make_shared<WorldStartPacket>();
   worldStartPacket->templateData = m_worldTemplate->store();
@@ -810,34 +830,105 @@ void WorldServer::update(float dt) {
   if (doBreakChecks)
     m_needsGlobalBreakCheck = false;
 
+  // Scripts of entities within view of a player are never put off by the
+  // script scheduler.
+  List<RectF> scriptPriorityRegions;
+  if (m_scriptScheduler) {
+    for (auto const& pair : m_clientInfo)
+      scriptPriorityRegions.append(RectF(pair.second->clientState.window()).padded(m_scriptPriorityPadding));
+  }
+
   List<EntityId> toRemove;
-  m_entityMap->updateAllEntities([&](EntityPtr const& entity) {
-      ZoneScopedN("Server entity update");
+  auto updateEntity = [&](EntityPtr const& entity) {
+    ZoneScopedN("Server entity update");
 #ifdef TRACY_ENABLE
-      const EntityId entityId = entity->entityId();
-      const char* const entityTypeStr = EntityTypeNames.getRight(entity->entityType()).utf8().c_str();
-      ZoneTextF("%s entity %i", entityTypeStr, entityId);
+    const EntityId entityId = entity->entityId();
+    const char* const entityTypeStr = EntityTypeNames.getRight(entity->entityType()).utf8().c_str();
+    ZoneTextF("%s entity %i", entityTypeStr, entityId);
 #endif
-      entity->update(dt, m_currentStep);
+    if (m_scriptScheduler) {
+      bool priority = scriptPriorityRegions.any([&](RectF const& region) { return m_geometry.rectContains(region, entity->position()); });
+      LuaUpdateScheduler::setCurrent(m_scriptScheduler.get(), priority);
+    }
+    auto clearScheduler = finally([]() { LuaUpdateScheduler::setCurrent(nullptr); });
+    entity->update(dt, m_currentStep);
+
+    if (auto tileEntity = as<TileEntity>(entity)) {
+      // Only do break checks on objects if all sectors the object touches
+      // *and surrounding sectors* are active.  Objects that this object
+      // rests on can be up to an entire sector large in any direction.
+      if (doBreakChecks && regionActive(RectI::integral(tileEntity->metaBoundBox().translated(tileEntity->position())).padded(WorldSectorSize)))
+        tileEntity->checkBroken();
+      updateTileEntityTiles(tileEntity);
+    }
 
-      if (auto tileEntity = as<TileEntity>(entity)) {
-        // Only do break checks on objects if all sectors the object touches
-        // *and surrounding sectors* are active.  Objects that this object
-        // rests on can be up to an entire sector large in any direction.
-        if (doBreakChecks && regionActive(RectI::integral(tileEntity->metaBoundBox().translated(tileEntity->position())).padded(WorldSectorSize)))
-          tileEntity->checkBroken();
-        updateTileEntityTiles(tileEntity);
+    if (entity->shouldDestroy() && entity->entityMode() == EntityMode::Master)
+      toRemove.append(entity->entityId());
+  };
+  auto entityUpdateOrder = [](EntityPtr const& a, EntityPtr const& b) { return a->entityType() < b->entityType(); };
+
+  if (m_entityUpdatePool) {
+    List<List<WorldAction>> islandActions;
+    List<List<EntityId>> islandRemovals;
+
+    EntityMap::ParallelUpdate parallelUpdate;
+    parallelUpdate.pool = m_entityUpdatePool.get();
+    parallelUpdate.filter = [](EntityPtr const& entity) { return isParallelUpdateEntityType(entity->entityType()); };
+    parallelUpdate.islandPadding = m_entityIslandPadding;
+    parallelUpdate.minimumRunSize = m_parallelEntityUpdateMinimum;
+    parallelUpdate.prepare = [&](List<List<RectF>> const& islandRegions) {
+      ZoneScopedN("Entity island preparation");
+      islandActions.clear();
+      islandActions.resize(islandRegions.size());
+      islandRemovals.clear();
+      islandRemovals.resize(islandRegions.size());
+      // Collision is generated lazily on query, do it up front so that the
+      // islands only ever read tiles.
+      for (auto const& regions : islandRegions) {
+        for (auto const& region : regions)
+          freshenCollision(RectI::integral(region));
       }
-
+    };
+    parallelUpdate.update = [&](EntityPtr const& entity, size_t island) {
+      ZoneScopedN("Server parallel entity update");
+      s_deferredIslandActions = &islandActions[island];
+      // Give each entity its own random source so that the result does not
+      // depend on which thread ran it, or in what order.
+      RandomSource randSource(staticRandomU64(entity->entityId(), m_currentStep));
+      RandomSource* previousSource = Random::setThreadSource(&randSource);
+      auto clearDeferral = finally([previousSource]() {
+        s_deferredIslandActions = nullptr;
+        Random::setThreadSource(previousSource);
+      });
+      entity->update(dt, m_currentStep);
       if (entity->shouldDestroy() && entity->entityMode() == EntityMode::Master)
-        toRemove.append(entity->entityId()); }, [](EntityPtr const& a, EntityPtr const& b) { return a->entityType() < b->entityType(); });
+        islandRemovals[island].append(entity->entityId());
+    };
+    parallelUpdate.merge = [&](size_t islandCount) {
+      ZoneScopedN("Entity island merge");
+      for (size_t island = 0; island < islandCount; ++island) {
+        for (auto const& action : islandActions[island])
+          action(this);
+        toRemove.appendAll(islandRemovals[island]);
+      }
+    };
+
+    m_entityMap->updateAllEntities(updateEntity, entityUpdateOrder, parallelUpdate);
+  } else {
+    m_entityMap->updateAllEntities(updateEntity, entityUpdateOrder);
+  }
 
   {
     ZoneScopedN("World scripts");
+    LuaUpdateScheduler::setCurrent(m_scriptScheduler.get());
+    auto clearScheduler = finally([]() { LuaUpdateScheduler::setCurrent(nullptr); });
     for (auto& pair : m_scriptContexts)
       pair.second->update(pair.second->updateDt(dt));
   }
 
+  if (m_scriptScheduler)
+    m_scriptScheduler->tick();
+
   updateDamage(dt);
   if (shouldRunThisStep("wiringUpdate"))
     m_wireProcessor->process();
@@ -910,16 +1001,35 @@ void WorldServer::update(float dt) {
 
   {
     ZoneScopedN("Queue for world update packets");
+    List<EntityUpdateQueue> entityUpdateQueues;
     for (auto const& pair : m_clientInfo) {
       ZoneScopedN("Client update");
 #ifdef TRACY_ENABLE
       ZoneTextF("For client %i", (unsigned short)pair.first);
 #endif
-      for (auto const& monitoredRegion : pair.second->monitoringRegions(m_entityMap))
+      for (auto const& monitoredRegion : pair.second->monitoringRegions(m_entityMap)) {
         signalRegion(monitoredRegion.padded(jsonToVec2I(m_serverConfig.get("playerActiveRegionPad"))));
-      queueUpdatePackets(pair.first);
+        // Start reading the sectors just past the active region in the
+        // background, before the client gets close enough to need them.
+        if (m_worldStorage->sectorIoEnabled())
+          m_worldStorage->prefetchSectors(m_worldStorage->sectorsForRegion(
+              monitoredRegion.padded(jsonToVec2I(m_serverConfig.get("playerPrefetchRegionPad", JsonArray{64, 64})))));
+      }
+      entityUpdateQueues.append(queueUpdatePackets(pair.first));
+    }
+
+    if (m_entityUpdatePool && entityUpdateQueues.size() >= m_parallelPacketMinimumClients) {
+      ZoneScopedN("Parallel entity packets");
+      m_entityUpdatePool->parallelFor(entityUpdateQueues.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+          queueEntityUpdatePackets(entityUpdateQueues[i]);
+      });
+    } else {
+      for (auto const& updateQueue : entityUpdateQueues)
+        queueEntityUpdatePackets(updateQueue);
     }
     m_netStateCache.clear();
+    m_netCreateCache.clear();
 
 
     for (auto& pair : m_clientInfo)
@@ -932,6 +1042,13 @@ void WorldServer::update(float dt) {
   LogMap::set(strf("server_{}_time", m_worldId), strf("age = {:4.2f}, day = {:4.2f}/{:4.2f}s", epochTime(), timeOfDay(), dayLength()));
   LogMap::set(strf("server_{}_active_liquid", m_worldId), m_liquidEngine->activeCells());
   LogMap::set(strf("server_{}_lua_mem", m_worldId), m_luaRoot->luaMemoryUsage());
+  if (m_scriptScheduler)
+    LogMap::set(strf("server_{}_script_budget", m_worldId), m_scriptScheduler->statistics());
+  if (m_worldStorage->sectorIoEnabled()) {
+    auto ioStats = m_worldStorage->sectorIoStats();
+    LogMap::set(strf("server_{}_sector_io", m_worldId), strf("{} reads / {} writes queued, {} prefetched / {} missed, {:4.2f}ms stalled",
+        ioStats.pendingReads, ioStats.pendingWrites, ioStats.prefetchHits, ioStats.prefetchMisses, ioStats.stallTime * 1000.0));
+  }
 }
 
 WorldGeometry WorldServer::geometry() const {
@@ -973,6 +1090,11 @@ void WorldServer::addEntity(EntityPtr const& entity, EntityId entityId) {
   if (!entity)
     return;
 
+  if (s_deferredIslandActions) {
+    s_deferredIslandActions->append([this, entity, entityId](World*) { addEntity(entity, entityId); });
+    return;
+  }
+
   GameObjectRegistry::registerGameObject(entity.get(), entity);
   entity->init(this, m_entityMap->reserveEntityId(entityId), EntityMode::Master);
   m_entityMap->addEntity(entity);
@@ -1072,6 +1194,14 @@ void WorldServer::activateLiquidRegion(RectI const& region) {
   m_liquidEngine->visitRegion(region);
 }
 
+void WorldServer::invalidateLightLevels(RectI const& region) {
+  // Light level queries are wrapped into the world, but their calculation
+  // regions can reach past either x edge.
+  int width = m_geometry.width();
+  for (int offset : {-width, 0, width})
+    m_lightIntensityCalculator.invalidate(region.translated(Vec2I(offset, 0)));
+}
+
 void WorldServer::activateLiquidLocation(Vec2I const& location) {
   m_liquidEngine->visitLocation(location);
 }
@@ -1254,25 +1384,28 @@ ItemDescriptor WorldServer::collectLiquid(List<Vec2I> const& tilePositions, Liqu
   float bucketSize = Root::singleton().assets()->json("/items/defaultParameters.config:liquidItems.bucketSize").toFloat();
   unsigned drainedUnits = 0;
   float nextUnit = bucketSize;
-  List<ServerTile*> maybeDrainTiles;
+  List<pair<Vec2I, ServerTile*>> maybeDrainTiles;
 
   for (auto pos : tilePositions) {
     ServerTile* tile = m_tileArray->modifyTile(pos);
     if (tile->liquid.liquid == liquidId && !isTileProtected(pos)) {
       if (tile->liquid.level >= nextUnit) {
         tile->liquid.take(nextUnit);
+        invalidateLightLevels(RectI::withSize(pos, {1, 1}));
         nextUnit = bucketSize;
         drainedUnits++;
 
-        for (auto previousTile : maybeDrainTiles)
-          previousTile->liquid.take(previousTile->liquid.level);
+        for (auto const& previous : maybeDrainTiles) {
+          previous.second->liquid.take(previous.second->liquid.level);
+          invalidateLightLevels(RectI::withSize(previous.first, {1, 1}));
+        }
 
         maybeDrainTiles.clear();
       }
 
       if (tile->liquid.level > 0) {
         nextUnit -= tile->liquid.level;
-        maybeDrainTiles.append(tile);
+        maybeDrainTiles.append({pos, tile});
       }
 
       for (auto const& pair : m_clientInfo) {
@@ -1706,6 +1839,14 @@ void WorldServer::init(bool firstTime) {
   m_serverConfig = assets->json("/worldserver.config");
   setFidelity(WorldServerFidelity::Medium);
 
+  auto parallelUpdateConfig = m_serverConfig.get("parallelEntityUpdate", JsonObject());
+  if (parallelUpdateConfig.getBool("enabled", false))
+    m_entityUpdatePool = make_unique<WorkerPool>("WorldServerEntityUpdate", parallelUpdateConfig.getUInt("threads", 2));
+  m_entityIslandPadding = parallelUpdateConfig.getFloat("islandPadding", 8.0f);
+  m_parallelEntityUpdateMinimum = parallelUpdateConfig.getUInt("minimumEntities", 128);
+  m_parallelPacketMinimumClients = parallelUpdateConfig.getUInt("minimumClients", 8);
+  m_parallelSectorMinimum = parallelUpdateConfig.getUInt("minimumSectors", 4);
+
   m_worldStorage->setFloatingDungeonWorld(isFloatingDungeonWorld());
 
   m_currentStep = 0;
@@ -1720,9 +1861,17 @@ void WorldServer::init(bool firstTime) {
   m_luaRoot->luaEngine().setNullTerminated(false);
   m_luaRoot->tuneAutoGarbageCollection(m_serverConfig.getFloat("luaGcPause"), m_serverConfig.getFloat("luaGcStepMultiplier"));
 
+  auto scriptBudgetConfig = m_serverConfig.get("scriptUpdateBudget", JsonObject());
+  if (scriptBudgetConfig.getBool("enabled", false))
+    m_scriptScheduler = make_unique<LuaUpdateScheduler>(scriptBudgetConfig);
+  else
+    m_scriptScheduler.reset();
+  m_scriptPriorityPadding = scriptBudgetConfig.getFloat("priorityPadding", 16.0f);
+
   m_sky = make_shared<Sky>(m_worldTemplate->skyParameters(), false);
 
   m_lightIntensityCalculator.setParameters(assets->json("/lighting.config:intensity"));
+  m_lightIntensityCalculator.setCacheParameters(m_serverConfig.get("lightLevelCache", JsonObject()));
 
   m_entityMessageResponses = {};
 
@@ -1735,6 +1884,9 @@ void WorldServer::init(bool firstTime) {
   m_liquidEngine = make_shared<LiquidCellEngine<LiquidId>>(liquidsDatabase->liquidEngineParameters(), make_shared<LiquidWorld>(this));
   for (auto liquidSettings : liquidsDatabase->allLiquidSettings())
     m_liquidEngine->setLiquidTickDelta(liquidSettings->id, liquidSettings->tickDelta);
+  auto parallelLiquidConfig = m_serverConfig.get("parallelLiquidUpdate", JsonObject());
+  if (parallelLiquidConfig.getBool("enabled", false))
+    m_liquidEngine->setParallel(&WorkerPool::shared(), parallelLiquidConfig.getUInt("minimumCells", 4096), parallelLiquidConfig.getUInt("regionCells", 1024));
 
   m_fallingBlocksAgent = make_shared<FallingBlocksAgent>(make_shared<FallingBlocksWorld>(this));
 
@@ -2170,6 +2322,7 @@ void WorldServer::setLiquid(Vec2I const& pos, LiquidId liquid, float level, floa
       level = 0;
 
     if (auto netUpdate = tile->liquid.update(liquid, level, pressure)) {
+      invalidateLightLevels(RectI::withSize(pos, {1, 1}));
       for (auto const& pair : m_clientInfo) {
         if (pair.second->activeSectors.contains(m_tileArray->sectorFor(pos)))
           pair.second->pendingLiquidUpdates.add(pos);
@@ -2256,7 +2409,7 @@ List<ItemDescriptor> WorldServer::destroyBlock(TileLayer layer, Vec2I const& pos
   return drops;
 }
 
-void WorldServer::queueUpdatePackets(ConnectionId clientId) {
+auto WorldServer::queueUpdatePackets(ConnectionId clientId) -> EntityUpdateQueue {
   auto const& clientInfo = m_clientInfo.get(clientId);
   clientInfo->outgoingPackets.append(make_shared<StepUpdatePacket>(m_currentStep));
 
@@ -2271,21 +2424,31 @@ void WorldServer::queueUpdatePackets(ConnectionId clientId) {
       clientInfo->outgoingPackets.append(make_shared<EnvironmentUpdatePacket>(std::move(skyDelta), std::move(weatherDelta)));
   }
 
-  for (auto sector : clientInfo->pendingSectors.values()) {
-    if (!m_worldStorage->sectorActive(sector))
-      continue;
-
-    auto tileArrayUpdate = make_shared<TileArrayUpdatePacket>();
-    auto sectorTiles = m_tileArray->sectorRegion(sector);
-    tileArrayUpdate->min = sectorTiles.min();
-    tileArrayUpdate->array.resize(Vec2S(sectorTiles.width(), sectorTiles.height()));
-    for (int x = sectorTiles.xMin(); x < sectorTiles.xMax(); ++x) {
-      for (int y = sectorTiles.yMin(); y < sectorTiles.yMax(); ++y)
-        writeNetTile({x, y}, tileArrayUpdate->array(x - sectorTiles.xMin(), y - sectorTiles.yMin()));
+  auto activeSectors = clientInfo->pendingSectors.values().filtered([this](auto const& sector) { return m_worldStorage->sectorActive(sector); });
+  List<shared_ptr<TileArrayUpdatePacket>> tileArrayUpdates(activeSectors.size());
+  auto encodeSectors = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      auto tileArrayUpdate = make_shared<TileArrayUpdatePacket>();
+      auto sectorTiles = m_tileArray->sectorRegion(activeSectors[i]);
+      tileArrayUpdate->min = sectorTiles.min();
+      tileArrayUpdate->array.resize(Vec2S(sectorTiles.width(), sectorTiles.height()));
+      for (int x = sectorTiles.xMin(); x < sectorTiles.xMax(); ++x) {
+        for (int y = sectorTiles.yMin(); y < sectorTiles.yMax(); ++y)
+          writeNetTile({x, y}, tileArrayUpdate->array(x - sectorTiles.xMin(), y - sectorTiles.yMin()));
+      }
+      tileArrayUpdates[i] = std::move(tileArrayUpdate);
     }
+  };
+  // Encoding only reads tiles, so sectors are encoded in parallel when there
+  // are enough of them, but always sent in the same order.
+  if (m_entityUpdatePool && activeSectors.size() >= m_parallelSectorMinimum)
+    m_entityUpdatePool->parallelFor(activeSectors.size(), 1, encodeSectors);
+  else
+    encodeSectors(0, activeSectors.size());
 
-    clientInfo->outgoingPackets.append(tileArrayUpdate);
-    clientInfo->pendingSectors.remove(sector);
+  for (size_t i = 0; i < activeSectors.size(); ++i) {
+    clientInfo->outgoingPackets.append(std::move(tileArrayUpdates[i]));
+    clientInfo->pendingSectors.remove(activeSectors[i]);
   }
 
   for (auto pos : clientInfo->pendingTileUpdates) {
@@ -2318,7 +2481,6 @@ void WorldServer::queueUpdatePackets(ConnectionId clientId) {
   for (auto const& monitoredRegion : clientInfo->monitoringRegions(m_entityMap))
     monitoredEntities.addAll(m_entityMap->entityQuery(RectF(monitoredRegion)));
 
-  auto entityFactory = Root::singleton().entityFactory();
   auto outOfMonitoredRegionsEntities = HashSet<EntityId>::from(clientInfo->clientSlavesNetVersion.keys());
   for (auto const& monitoredEntity : monitoredEntities)
     outOfMonitoredRegionsEntities.remove(monitoredEntity->entityId());
@@ -2327,37 +2489,79 @@ void WorldServer::queueUpdatePackets(ConnectionId clientId) {
     clientInfo->clientSlavesNetVersion.remove(entityId);
   }
 
-  HashMap<ConnectionId, shared_ptr<EntityUpdateSetPacket>> updateSetPackets;
+  EntityUpdateQueue updateQueue;
+  updateQueue.clientId = clientId;
   if (m_currentStep % clientInfo->interpolationTracker.entityUpdateDelta() == 0)
-    updateSetPackets.add(ServerConnectionId, make_shared<EntityUpdateSetPacket>(ServerConnectionId));
+    updateQueue.updateSetConnections.append(ServerConnectionId);
   for (auto const& p : m_clientInfo) {
     if (p.first != clientId && p.second->pendingForward)
-      updateSetPackets.add(p.first, make_shared<EntityUpdateSetPacket>(p.first));
+      updateQueue.updateSetConnections.append(p.first);
   }
 
+  // Every client monitoring an entity this step shares the one encoding of
+  // its state, from here on only the caches are read.
+  auto entityFactory = Root::singleton().entityFactory();
   for (auto const& monitoredEntity : monitoredEntities) {
     EntityId entityId = monitoredEntity->entityId();
     ConnectionId connectionId = connectionForEntity(entityId);
-    if (connectionId != clientId) {
-      if (auto version = clientInfo->clientSlavesNetVersion.ptr(entityId)) {
-        if (auto updateSetPacket = updateSetPackets.value(connectionId)) {
-          auto pair = make_pair(entityId, *version);
-          auto i = m_netStateCache.find(pair);
-          if (i == m_netStateCache.end())
-            // FezzedOne: That `move` likely had a very good reason to be there.
-            i = m_netStateCache.insert(pair, std::move(monitoredEntity->writeNetState(*version))).first;
-          const auto& netState = i->second;
-          if (!netState.first.empty())
-            updateSetPacket->deltas[entityId] = netState.first;
-          *version = netState.second;
-        }
-      } else if (!monitoredEntity->masterOnly()) {
-        // Client was unaware of this entity until now
+    if (connectionId == clientId)
+      continue;
+
+    if (auto version = clientInfo->clientSlavesNetVersion.ptr(entityId)) {
+      if (!updateQueue.updateSetConnections.contains(connectionId))
+        continue;
+      auto pair = make_pair(entityId, *version);
+      if (!m_netStateCache.contains(pair)) {
+        auto netState = monitoredEntity->writeNetState(*version);
+        m_netStateCache.add(pair, {make_shared<ByteArray const>(std::move(netState.first)), netState.second});
+      }
+    } else if (!monitoredEntity->masterOnly()) {
+      // Client was unaware of this entity until now
+      if (!m_netCreateCache.contains(entityId)) {
         auto firstUpdate = monitoredEntity->writeNetState();
-        clientInfo->clientSlavesNetVersion.add(entityId, firstUpdate.second);
-        clientInfo->outgoingPackets.append(make_shared<EntityCreatePacket>(monitoredEntity->entityType(),
-            entityFactory->netStoreEntity(monitoredEntity), std::move(firstUpdate.first), entityId));
+        m_netCreateCache.add(entityId, EntityCreateSnapshot{monitoredEntity->entityType(),
+            make_shared<ByteArray const>(entityFactory->netStoreEntity(monitoredEntity)),
+            make_shared<ByteArray const>(std::move(firstUpdate.first)), firstUpdate.second});
       }
+    } else {
+      continue;
+    }
+    updateQueue.entities.append(monitoredEntity);
+  }
+
+  return updateQueue;
+}
+
+void WorldServer::queueEntityUpdatePackets(EntityUpdateQueue const& updateQueue) {
+  auto const& clientInfo = m_clientInfo.get(updateQueue.clientId);
+
+  HashMap<ConnectionId, shared_ptr<EntityUpdateSetPacket>> updateSetPackets;
+  for (auto connectionId : updateQueue.updateSetConnections)
+    updateSetPackets.add(connectionId, make_shared<EntityUpdateSetPacket>(connectionId));
+
+  for (auto const& entity : updateQueue.entities) {
+    EntityId entityId = entity->entityId();
+    if (auto version = clientInfo->clientSlavesNetVersion.ptr(entityId)) {
+      auto const& netState = m_netStateCache.get({entityId, *version});
+      if (!netState.first->empty()) {
+        auto& updateSetPacket = updateSetPackets.get(connectionForEntity(entityId));
+        if (clientInfo->isLocal)
+          updateSetPacket->deltas[entityId] = *netState.first;
+        else
+          updateSetPacket->sharedDeltas[entityId] = netState.first;
+      }
+      *version = netState.second;
+    } else {
+      // Packets are consumed in place by a local client, so it gets its own
+      // copy of the encoded state, and packets are never shared.
+      auto const& snapshot = m_netCreateCache.get(entityId);
+      clientInfo->clientSlavesNetVersion.add(entityId, snapshot.version);
+      if (clientInfo->isLocal)
+        clientInfo->outgoingPackets.append(make_shared<EntityCreatePacket>(snapshot.entityType,
+            *snapshot.storeData, *snapshot.firstNetState, entityId));
+      else
+        clientInfo->outgoingPackets.append(make_shared<EntityCreatePacket>(snapshot.entityType,
+            snapshot.storeData, snapshot.firstNetState, entityId));
     }
   }
 
@@ -2465,6 +2669,7 @@ void WorldServer::checkEntityBreaks(RectF const& rect) {
 }
 
 void WorldServer::queueTileUpdates(Vec2I const& pos) {
+  invalidateLightLevels(RectI::withSize(pos, {1, 1}));
   for (auto const& pair : m_clientInfo) {
     if (pair.second->activeSectors.contains(m_tileArray->sectorFor(pos)))
       pair.second->pendingTileUpdates.add(pos);
@@ -2656,6 +2861,10 @@ void WorldServer::setProperty(String const& propertyName, Json const& property)
 }
 
 void WorldServer::timer(int stepsDelay, WorldAction worldAction) {
+  if (s_deferredIslandActions) {
+    s_deferredIslandActions->append([this, stepsDelay, worldAction](World*) { timer(stepsDelay, worldAction); });
+    return;
+  }
   m_timers.append({stepsDelay, worldAction});
 }
 
@@ -2923,9 +3132,9 @@ bool WorldServer::isVisibleToPlayer(RectF const& region) const {
   return false;
 }
 
-WorldServer::ClientInfo::ClientInfo(ConnectionId clientId, InterpolationTracker const trackerInit, bool canBeAdmin, Uuid clientUuid, Maybe<String> accountName, bool isGuest)
+WorldServer::ClientInfo::ClientInfo(ConnectionId clientId, InterpolationTracker const trackerInit, bool isLocal, bool canBeAdmin, Uuid clientUuid, Maybe<String> accountName, bool isGuest)
     : clientId(clientId), skyNetVersion(0), weatherNetVersion(0), pendingForward(false), started(false),
-      canBeAdmin(canBeAdmin), isGuest(isGuest), clientUuid(clientUuid), accountName(accountName), interpolationTracker(trackerInit) {}
+      isLocal(isLocal), canBeAdmin(canBeAdmin), isGuest(isGuest), clientUuid(clientUuid), accountName(accountName), interpolationTracker(trackerInit) {}
 
 List<RectI> WorldServer::ClientInfo::monitoringRegions(EntityMapPtr const& entityMap) const {
   return clientState.monitoringRegions([entityMap](EntityId entityId) -> Maybe<RectI> {
@@ -3015,6 +3224,14 @@ Maybe<LuaValue> WorldServer::evalScript(String const& code) {
   return m_scriptContexts.get("worldEval")->eval<LuaValue>(code);
 }
 
+void WorldServer::setScriptProfiler(LuaSampleProfilerPtr profiler) {
+  m_scriptProfiler = std::move(profiler);
+}
+
+LuaSampleProfilerPtr const& WorldServer::scriptProfiler() const {
+  return m_scriptProfiler;
+}
+
 Maybe<Json> WorldServer::callUniverseCommandScript(String const& function, LuaVariadic<Json> const& args) {
   return m_universe->callCommandScript(function, args);
 }
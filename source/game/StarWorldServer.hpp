@@ -237,6 +237,10 @@ public:
   void activateLiquidRegion(RectI const& region);
   void activateLiquidLocation(Vec2I const& location);
 
+  // Drops cached lightLevel results that depend on tiles in the given region.
+  // Tile changes through modifyServerTile and setLiquid already do this.
+  void invalidateLightLevels(RectI const& region);
+
   // if blocks cascade, we'll need to do a break check across all tile entities
   // when the timer next ticks
   void requestGlobalBreakCheck();
@@ -287,6 +291,11 @@ public:
 
   Maybe<LuaValue> evalScript(String const& code);
 
+  // While set, the lua call stacks of every script run during world updates
+  // are sampled into this profiler.
+  void setScriptProfiler(LuaSampleProfilerPtr profiler);
+  LuaSampleProfilerPtr const& scriptProfiler() const;
+
   Maybe<Json> callUniverseCommandScript(String const& function, LuaVariadic<Json> const& args);
 
   // From Namje's PR to OpenStarbound.
@@ -296,7 +305,7 @@ public:
 
 private:
   struct ClientInfo {
-    ClientInfo(ConnectionId clientId, InterpolationTracker const trackerInit, bool canBeAdmin = false, Uuid clientUuid = Uuid(), Maybe<String> accountName = {}, bool isGuest = false);
+    ClientInfo(ConnectionId clientId, InterpolationTracker const trackerInit, bool isLocal, bool canBeAdmin = false, Uuid clientUuid = Uuid(), Maybe<String> accountName = {}, bool isGuest = false);
 
     List<RectI> monitoringRegions(EntityMapPtr const& entityMap) const;
 
@@ -309,6 +318,9 @@ private:
     bool pendingForward;
     bool started;
 
+    // Local clients receive packet objects as they are, without them being
+    // serialized first.
+    bool isLocal;
     bool canBeAdmin;
     bool isGuest;
     Uuid clientUuid;
@@ -336,6 +348,23 @@ private:
 
   typedef function<ServerTile const&(Vec2I)> ServerTileGetter;
 
+  // Full state of an entity for clients that are seeing it for the first
+  // time, encoded at most once per step and shared by every client.
+  struct EntityCreateSnapshot {
+    EntityType entityType;
+    shared_ptr<ByteArray const> storeData;
+    shared_ptr<ByteArray const> firstNetState;
+    uint64_t version;
+  };
+
+  // The entities a client is to be sent creations or deltas for this step,
+  // along with the connections it gets an update set for.
+  struct EntityUpdateQueue {
+    ConnectionId clientId;
+    List<ConnectionId> updateSetConnections;
+    List<EntityPtr> entities;
+  };
+
   // Returns nothing if the processing defined by the given configuration entry
   // should not run this tick, if it should run this tick, returns the number
   // of ticks since the last run.
@@ -343,8 +372,13 @@ private:
 
   TileModificationList doApplyTileModifications(TileModificationList const& modificationList, bool allowEntityOverlap, bool ignoreTileProtection = false);
 
-  // Queues pending (step based) updates to the given player
-  void queueUpdatePackets(ConnectionId clientId);
+  // Queues pending (step based) updates to the given player, and encodes the
+  // entity state the player needs into the per step net state caches.
+  EntityUpdateQueue queueUpdatePackets(ConnectionId clientId);
+  // Queues entity creations and deltas built purely from the net state
+  // caches.  Touches nothing but the given client's info, so may be called
+  // for different clients in parallel.
+  void queueEntityUpdatePackets(EntityUpdateQueue const& updateQueue);
   void updateDamage(float dt);
 
   void updateDamagedBlocks(float dt);
@@ -398,6 +432,12 @@ private:
   StringMap<ScriptComponentPtr> m_scriptContexts;
   JsonObject m_scriptGlobals;
 
+  // Only created if the script update budget is enabled in the worldserver
+  // config.
+  unique_ptr<LuaUpdateScheduler> m_scriptScheduler;
+  float m_scriptPriorityPadding;
+  LuaSampleProfilerPtr m_scriptProfiler;
+
   WorldGeometry m_geometry;
   uint64_t m_currentStep;
   mutable CellularLightIntensityCalculator m_lightIntensityCalculator;
@@ -408,7 +448,16 @@ private:
   CollisionGenerator m_collisionGenerator;
   List<CollisionBlock> m_workingCollisionBlocks;
 
-  HashMap<pair<EntityId, uint64_t>, pair<ByteArray, uint64_t>> m_netStateCache;
+  // Only created if the parallel entity update phase is enabled in the
+  // worldserver config.  Also used to encode tile sectors for clients.
+  unique_ptr<WorkerPool> m_entityUpdatePool;
+  float m_entityIslandPadding;
+  size_t m_parallelEntityUpdateMinimum;
+  size_t m_parallelPacketMinimumClients;
+  size_t m_parallelSectorMinimum;
+
+  HashMap<pair<EntityId, uint64_t>, pair<shared_ptr<ByteArray const>, uint64_t>> m_netStateCache;
+  HashMap<EntityId, EntityCreateSnapshot> m_netCreateCache;
   OrderedHashMap<ConnectionId, shared_ptr<ClientInfo>> m_clientInfo;
 
   GameTimer m_tileEntityBreakCheckTimer;
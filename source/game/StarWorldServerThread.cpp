@@ -4,7 +4,6 @@
 #include "StarNpc.hpp"
 #include "StarPlayer.hpp"
 #include "StarRoot.hpp"
-#include "StarTickRateMonitor.hpp"
 
 #if defined TRACY_ENABLE
 #include "tracy/Tracy.hpp"
@@ -28,7 +27,10 @@ WorldServerThread::WorldServerThread(WorldServerPtr server, WorldId worldId)
 
 WorldServerThread::~WorldServerThread() {
   m_stop = true;
-  join();
+  if (m_scheduler)
+    m_scheduler->remove(this);
+  else
+    join();
 
   RecursiveMutexLocker locker(m_mutex);
   for (auto clientId : m_worldServer->clientIds())
@@ -39,15 +41,36 @@ WorldId WorldServerThread::worldId() const {
   return m_worldId;
 }
 
+void WorldServerThread::setScheduler(WorldTickSchedulerPtr scheduler) {
+  m_scheduler = std::move(scheduler);
+}
+
 void WorldServerThread::start() {
   m_stop = false;
   m_errorOccurred = false;
-  Thread::start();
+  if (m_scheduler)
+    m_scheduler->add(this);
+  else
+    Thread::start();
 }
 
 void WorldServerThread::stop() {
   m_stop = true;
-  Thread::join();
+  if (m_scheduler) {
+    bool wasScheduled = m_scheduler->contains(this);
+    m_scheduler->remove(this);
+    // Same as at the end of run(), make sure pending messages are answered.
+    if (wasScheduled)
+      passMessages(List<Message>{});
+  } else {
+    Thread::join();
+  }
+}
+
+bool WorldServerThread::isStopped() const {
+  if (m_scheduler)
+    return !m_scheduler->contains(this);
+  return Thread::isJoined();
 }
 
 void WorldServerThread::setPause(shared_ptr<const atomic<bool>> pause) {
@@ -203,7 +226,7 @@ void WorldServerThread::passMessages(List<Message>&& messages) {
     if (m_messages.empty()) return;
   }
 
-  if (handleMessagesNow || !Thread::isRunning() || Thread::isJoined()) {
+  if (handleMessagesNow || !ticking()) {
     ZoneScopedN("WorldServerThread::passMessages");
 #ifdef TRACY_ENABLE
     const char* worldName = printWorldId(m_worldId).utf8().c_str();
@@ -253,76 +276,105 @@ WorldChunks WorldServerThread::readChunks() {
   }
 }
 
-void WorldServerThread::run() {
-  try {
-    auto& root = Root::singleton();
-    double updateMeasureWindow = root.assets()->json("/universe_server.config:updateMeasureWindow").toDouble();
-    double fidelityDecrementScore = root.assets()->json("/universe_server.config:fidelityDecrementScore").toDouble();
-    double fidelityIncrementScore = root.assets()->json("/universe_server.config:fidelityIncrementScore").toDouble();
-
-    GameObjectRegistry::registerGameObject(m_worldServer.get(), m_worldServer);
-
-    String serverFidelityMode = root.configuration()->get("serverFidelity").toString();
-    Maybe<WorldServerFidelity> lockedFidelity;
-    if (!serverFidelityMode.equalsIgnoreCase("automatic"))
-      lockedFidelity = WorldServerFidelityNames.getLeft(serverFidelityMode);
-
-    double storageInterval = root.assets()->json("/universe_server.config:worldStorageInterval").toDouble() / 1000.0;
-    Timer storageTimer = Timer::withTime(storageInterval);
-
-    TickRateApproacher tickApproacher(1.0 / ServerGlobalTimestep, updateMeasureWindow);
-    double fidelityScore = 0.0;
-    WorldServerFidelity automaticFidelity = WorldServerFidelity::Medium;
-
-    while (!m_stop && !m_errorOccurred) {
-      ZoneScopedN("WORLD SERVER TICK");
+double WorldServerThread::tick(double targetTickRate) {
+  ZoneScopedN("WORLD SERVER TICK");
 #ifdef TRACY_ENABLE
-      const char* worldName = printWorldId(m_worldId).utf8().c_str();
-      ZoneTextF("%s", worldName);
+  const char* worldName = printWorldId(m_worldId).utf8().c_str();
+  ZoneTextF("%s", worldName);
 #endif
-      auto fidelity = lockedFidelity.value(automaticFidelity);
-      LogMap::set(strf("server_{}_fidelity", m_worldId), WorldServerFidelityNames.getRight(fidelity));
-      LogMap::set(strf("server_{}_update", m_worldId), strf("{:4.2f}Hz", tickApproacher.rate()));
+  try {
+    if (!m_tickState) {
+      m_tickState = make_unique<TickState>();
+      GameObjectRegistry::registerGameObject(m_worldServer.get(), m_worldServer);
+    }
+    auto& state = *m_tickState;
 
-      update(fidelity);
-      tickApproacher.tick();
+    // Scheduled worlds change rate when they become idle, don't try and
+    // catch up on (or bank) the ticks from the old rate.
+    if (state.tickApproacher.targetTickRate() != targetTickRate) {
+      state.tickApproacher.setTargetTickRate(targetTickRate);
+      state.tickApproacher.reset();
+    }
 
-      if (storageTimer.timeUp()) {
-        sync();
-        storageTimer.restart(storageInterval);
-      }
+    auto fidelity = state.lockedFidelity.value(state.automaticFidelity);
+    LogMap::set(strf("server_{}_fidelity", m_worldId), WorldServerFidelityNames.getRight(fidelity));
+    LogMap::set(strf("server_{}_update", m_worldId), strf("{:4.2f}Hz", state.tickApproacher.rate()));
 
-      double spareTime = tickApproacher.spareTime();
-      fidelityScore += spareTime;
+    update(fidelity);
+    state.tickApproacher.tick();
 
-      if (fidelityScore <= fidelityDecrementScore) {
-        if (automaticFidelity > WorldServerFidelity::Minimum)
-          automaticFidelity = (WorldServerFidelity)((int)automaticFidelity - 1);
-        fidelityScore = 0.0;
-      }
+    if (state.storageTimer.timeUp()) {
+      sync();
+      state.storageTimer.restart(state.storageInterval);
+    }
 
-      if (fidelityScore >= fidelityIncrementScore) {
-        if (automaticFidelity < WorldServerFidelity::High)
-          automaticFidelity = (WorldServerFidelity)((int)automaticFidelity + 1);
-        fidelityScore = 0.0;
-      }
+    double spareTime = state.tickApproacher.spareTime();
+    state.fidelityScore += spareTime;
 
-      int64_t spareMilliseconds = floor(spareTime * 1000);
-      if (spareMilliseconds > 0)
-        Thread::sleepPrecise(spareMilliseconds);
+    if (state.fidelityScore <= state.fidelityDecrementScore) {
+      if (state.automaticFidelity > WorldServerFidelity::Minimum)
+        state.automaticFidelity = (WorldServerFidelity)((int)state.automaticFidelity - 1);
+      state.fidelityScore = 0.0;
     }
+
+    if (state.fidelityScore >= state.fidelityIncrementScore) {
+      if (state.automaticFidelity < WorldServerFidelity::High)
+        state.automaticFidelity = (WorldServerFidelity)((int)state.automaticFidelity + 1);
+      state.fidelityScore = 0.0;
+    }
+
+    return spareTime;
   } catch (std::exception const& e) {
     Logger::error("WorldServerThread exception caught: {}", outputException(e, true));
     m_errorOccurred = true;
+    return 0.0;
+  }
+}
+
+void WorldServerThread::run() {
+  while (!m_stop && !m_errorOccurred) {
+    double spareTime = tick(1.0 / ServerGlobalTimestep);
+    int64_t spareMilliseconds = floor(spareTime * 1000);
+    if (spareMilliseconds > 0)
+      Thread::sleepPrecise(spareMilliseconds);
   }
 
   // FezzedOne: Again, ensure the mail *always* gets through, even if the world thread shuts down before it can ever handle any pending messages during an update tick.
   this->passMessages(List<Message>{});
 }
 
+WorldServerThread::TickState::TickState()
+    : tickApproacher(1.0 / ServerGlobalTimestep, Root::singleton().assets()->json("/universe_server.config:updateMeasureWindow").toDouble()),
+      fidelityScore(0.0),
+      automaticFidelity(WorldServerFidelity::Medium) {
+  auto& root = Root::singleton();
+  fidelityDecrementScore = root.assets()->json("/universe_server.config:fidelityDecrementScore").toDouble();
+  fidelityIncrementScore = root.assets()->json("/universe_server.config:fidelityIncrementScore").toDouble();
+
+  String serverFidelityMode = root.configuration()->get("serverFidelity").toString();
+  if (!serverFidelityMode.equalsIgnoreCase("automatic"))
+    lockedFidelity = WorldServerFidelityNames.getLeft(serverFidelityMode);
+
+  storageInterval = root.assets()->json("/universe_server.config:worldStorageInterval").toDouble() / 1000.0;
+  storageTimer = Timer::withTime(storageInterval);
+}
+
+bool WorldServerThread::ticking() const {
+  if (m_scheduler)
+    return m_scheduler->contains(this) && !m_errorOccurred;
+  return Thread::isRunning() && !Thread::isJoined();
+}
+
 void WorldServerThread::update(WorldServerFidelity fidelity) {
   ZoneScoped;
   RecursiveMutexLocker locker(m_mutex);
+
+  // Samples every script run during this tick, if the world is being
+  // profiled.
+  auto scriptProfiler = m_worldServer->scriptProfiler();
+  LuaSampleProfiler::setCurrent(scriptProfiler.get());
+  auto clearScriptProfiler = finally([]() { LuaSampleProfiler::setCurrent(nullptr); });
+
   auto unerroredClientIds = m_worldServer->clientIds();
   {
     ZoneScopedN("Inbound packet handling");
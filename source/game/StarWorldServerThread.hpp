@@ -3,7 +3,10 @@
 
 #include "StarRpcThreadPromise.hpp"
 #include "StarThread.hpp"
+#include "StarTickRateMonitor.hpp"
+#include "StarTime.hpp"
 #include "StarWorldServer.hpp"
+#include "StarWorldTickScheduler.hpp"
 
 namespace Star {
 
@@ -11,7 +14,9 @@ STAR_CLASS(WorldServerThread);
 
 // Runs a WorldServer in a separate thread and guards exceptions that occur in
 // it.  All methods are designed to not throw exceptions, but will instead log
-// the error and trigger the WorldServerThread error state.
+// the error and trigger the WorldServerThread error state.  If a
+// WorldTickScheduler is set, the world is instead ticked by the scheduler's
+// shared worker threads and no thread of its own is ever started.
 class WorldServerThread : public Thread {
 public:
   struct Message {
@@ -27,9 +32,15 @@ public:
 
   WorldId worldId() const;
 
+  // Must be set before start() is called.
+  void setScheduler(WorldTickSchedulerPtr scheduler);
+
   void start();
-  // Signals the WorldServerThread to stop and then joins it
+  // Signals the WorldServerThread to stop and then joins it, or removes it
+  // from its scheduler
   void stop();
+  // True once the world is no longer being ticked after a call to stop()
+  bool isStopped() const;
   void setPause(shared_ptr<const atomic<bool>> pause);
 
   void preUninit();
@@ -79,10 +90,31 @@ public:
   // into memory, useful for the ship.
   WorldChunks readChunks();
 
+  // Performs a single world tick, approaching the given target tick rate, and
+  // returns the spare time in seconds until the next tick is due.  Called
+  // repeatedly by run() or by the WorldTickScheduler.
+  double tick(double targetTickRate);
+
 protected:
   virtual void run();
 
 private:
+  struct TickState {
+    TickState();
+
+    double fidelityDecrementScore;
+    double fidelityIncrementScore;
+    Maybe<WorldServerFidelity> lockedFidelity;
+    double storageInterval;
+    Timer storageTimer;
+    TickRateApproacher tickApproacher;
+    double fidelityScore;
+    WorldServerFidelity automaticFidelity;
+  };
+
+  // Whether the world is still being actively ticked
+  bool ticking() const;
+
   void update(WorldServerFidelity fidelity);
   void sync();
 
@@ -94,6 +126,9 @@ private:
   WorldId m_worldId;
   WorldServerAction m_updateAction;
 
+  WorldTickSchedulerPtr m_scheduler;
+  unique_ptr<TickState> m_tickState;
+
   mutable RecursiveMutex m_queueMutex;
   Map<ConnectionId, List<PacketPtr>> m_incomingPacketQueue;
   Map<ConnectionId, List<PacketPtr>> m_outgoingPacketQueue;
@@ -11,6 +11,7 @@
 #include "StarLogging.hpp"
 #include "StarMaterialDatabase.hpp"
 #include "StarRoot.hpp"
+#include "StarTime.hpp"
 
 #if defined TRACY_ENABLE
 #include "tracy/Tracy.hpp"
@@ -192,6 +193,7 @@ WorldStorage::WorldStorage(WorldChunks const& chunks, WorldGeneratorFacadePtr co
 WorldStorage::~WorldStorage() {
   if (m_db.isOpen()) {
     unloadAll(true);
+    abortSectorIo();
     m_db.close();
   }
 }
@@ -253,6 +255,7 @@ void WorldStorage::loadSector(Sector sector) {
     loadSectorToLevel(sector, SectorLoadLevel::Loaded);
     setSectorTimeToLive(sector, randomizedSectorTTL());
   } catch (std::exception const& e) {
+    abortSectorIo();
     m_db.rollback();
     m_db.close();
     throw WorldStorageException(strf("Failed to load sector {}", sector), e);
@@ -264,6 +267,7 @@ void WorldStorage::activateSector(Sector sector) {
     generateSectorToLevel(sector, SectorGenerationLevel::Complete);
     setSectorTimeToLive(sector, randomizedSectorTTL());
   } catch (std::exception const& e) {
+    abortSectorIo();
     m_db.rollback();
     m_db.close();
     throw WorldStorageException(strf("Failed to load sector {}", sector), e);
@@ -282,6 +286,43 @@ void WorldStorage::queueSectorActivation(Sector sector) {
   m_generationQueue.toFront(p.first);
 }
 
+void WorldStorage::prefetchSectors(List<Sector> const& sectors) {
+  if (!m_sectorIoPool)
+    return;
+
+  BTreeDatabase* db = &m_db;
+  for (auto const& sector : sectors) {
+    // Reads of sectors that are still wanted are kept alive, rather than
+    // expiring and being read all over again on the next call.
+    if (auto read = m_tileReads.ptr(sector)) {
+      read->timeToLive = m_prefetchTimeToLive;
+      continue;
+    }
+    if (m_tileReads.size() >= m_maxPrefetchedSectors)
+      continue;
+    // A sector with a pending write will be loaded from that write.
+    if (!m_tileArray->sectorValid(sector) || m_tileArray->sectorLoaded(sector) || m_tileWrites.contains(sector))
+      continue;
+
+    auto key = tileSectorKey(sector);
+    auto store = m_sectorIoPool->addProducer<TileSectorStore>([db, key]() {
+      TileSectorStore store;
+      if (auto res = db->find(key))
+        store = readTileSector(*res);
+      return store;
+    });
+    m_tileReads.add(sector, TileSectorRead{std::move(store), m_prefetchTimeToLive});
+  }
+}
+
+bool WorldStorage::sectorIoEnabled() const {
+  return m_sectorIoPool;
+}
+
+auto WorldStorage::sectorIoStats() const -> SectorIoStats {
+  return SectorIoStats{m_tileReads.size(), m_tileWrites.size(), m_prefetchHits, m_prefetchMisses, m_sectorIoStallTime};
+}
+
 void WorldStorage::triggerTerraformSector(Sector sector) {
   try {
     loadSectorToLevel(sector, SectorLoadLevel::Loaded);
@@ -294,6 +335,7 @@ void WorldStorage::triggerTerraformSector(Sector sector) {
       throw WorldStorageException(strf("Couldn't flag sector {} for terraforming; metadata unavailable", sector));
     }
   } catch (std::exception const& e) {
+    abortSectorIo();
     m_db.rollback();
     m_db.close();
     throw WorldStorageException(strf("Failed to terraform sector {}", sector), e);
@@ -367,6 +409,7 @@ void WorldStorage::generateQueue(Maybe<size_t> sectorGenerationLevelLimit, funct
       total += p.second;
     }
   } catch (std::exception const& e) {
+    abortSectorIo();
     m_db.rollback();
     m_db.close();
     throw WorldStorageException("WorldStorage generation failed while generating from queue", e);
@@ -377,6 +420,15 @@ void WorldStorage::tick(float dt) {
   ZoneScoped;
 
   try {
+    flushTileWrites(false);
+
+    // Prefetched sectors that nobody ended up loading are dropped once they
+    // expire, as long as their read has finished.
+    eraseWhere(m_tileReads, [dt](auto& p) {
+      p.second.timeToLive -= dt;
+      return p.second.timeToLive <= 0.0f && p.second.store.done();
+    });
+
     // Tick down generation queue entries, and erase any that are expired.
     eraseWhere(m_generationQueue, [dt](auto& p) {
       p.second -= dt;
@@ -446,12 +498,13 @@ void WorldStorage::tick(float dt) {
               storedUniques.add(*uniqueId, {sector, entity->position()});
             sectorStore.append(entityFactory->storeVersionedEntity(entity));
           }
-          m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore));
+          m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore, m_entityCompression));
           mergeSectorUniques(sector, storedUniques);
         }
       }
     }
   } catch (std::exception const& e) {
+    abortSectorIo();
     m_db.rollback();
     m_db.close();
     throw WorldStorageException("WorldStorage exception during tick", e);
@@ -482,12 +535,14 @@ void WorldStorage::unloadAll(bool force) {
     }
     for (auto sector : sectors)
       unloadSectorToLevel(sector, SectorLoadLevel::None, force);
+    flushTileWrites(true);
 
     // FezzedOne: Commented out since it's apparently resposible for a rare server segfault.
     // m_entityMap.reset();
     // m_tileArray.reset();
 
   } catch (std::exception const& e) {
+    abortSectorIo();
     m_db.rollback();
     m_db.close();
     m_entityMap.reset();
@@ -498,10 +553,10 @@ void WorldStorage::unloadAll(bool force) {
 
 void WorldStorage::sync() {
   try {
-    for (auto const& pair : m_sectorMetadata)
-      syncSector(pair.first);
+    syncAllSectors();
     m_db.commit();
   } catch (std::exception const& e) {
+    abortSectorIo();
     m_db.rollback();
     m_db.close();
     throw WorldStorageException("WorldStorage exception during sync", e);
@@ -510,8 +565,7 @@ void WorldStorage::sync() {
 
 WorldChunks WorldStorage::readChunks() {
   try {
-    for (auto const& pair : m_sectorMetadata)
-      syncSector(pair.first);
+    syncAllSectors();
 
     WorldChunks chunks;
     m_db.forAll([&chunks](ByteArray k, ByteArray v) {
@@ -521,6 +575,7 @@ WorldChunks WorldStorage::readChunks() {
     return WorldChunks(chunks);
 
   } catch (std::exception const& e) {
+    abortSectorIo();
     m_db.rollback();
     m_db.close();
     throw WorldStorageException("WorldStorage exception during readChunks", e);
@@ -578,8 +633,8 @@ WorldStorage::EntitySectorStore WorldStorage::readEntitySector(ByteArray const&
   return DataStreamBuffer::deserialize<EntitySectorStore>(uncompressData(data));
 }
 
-ByteArray WorldStorage::writeEntitySector(EntitySectorStore const& store) {
-  return compressData(DataStreamBuffer::serialize(store));
+ByteArray WorldStorage::writeEntitySector(EntitySectorStore const& store, CompressionSettings const& compression) {
+  return compressData(DataStreamBuffer::serialize(store), compression);
 }
 
 ByteArray WorldStorage::tileSectorKey(Sector const& sector) {
@@ -630,7 +685,7 @@ WorldStorage::TileSectorStore WorldStorage::readTileSector(ByteArray const& data
   return store;
 }
 
-ByteArray WorldStorage::writeTileSector(TileSectorStore const& store) {
+ByteArray WorldStorage::writeTileSector(TileSectorStore const& store, CompressionSettings const& compression) {
   DataStreamBuffer ds;
   ds.vuwrite(store.generationLevel);
   ds.vuwrite(store.tileSerializationVersion);
@@ -639,7 +694,7 @@ ByteArray WorldStorage::writeTileSector(TileSectorStore const& store) {
     for (size_t x = 0; x < WorldSectorSize; ++x)
       (*store.tiles)(x, y).write(ds);
   }
-  return compressData(ds.takeData());
+  return compressData(ds.takeData(), compression);
 }
 
 ByteArray WorldStorage::uniqueIndexKey(String const& uniqueId) {
@@ -701,6 +756,33 @@ WorldStorage::WorldStorage() {
   auto storageConfig = Root::singleton().assets()->json("/worldstorage.config");
   m_sectorTimeToLive = jsonToVec2F(storageConfig.get("sectorTimeToLive"));
   m_generationQueueTimeToLive = storageConfig.getFloat("generationQueueTimeToLive");
+
+  auto sectorIoConfig = storageConfig.get("sectorIo", JsonObject());
+  m_sectorIoPool = nullptr;
+  if (sectorIoConfig.getBool("enabled", false)) {
+    // Shared between every world, so that the number of I/O threads does not
+    // grow with the number of loaded worlds.
+    static WorkerPool sectorIoPool("WorldStorageSectorIO", sectorIoConfig.getUInt("threads", 2));
+    m_sectorIoPool = &sectorIoPool;
+  }
+  m_maxPrefetchedSectors = sectorIoConfig.getUInt("maxPrefetchedSectors", 64);
+  m_prefetchTimeToLive = sectorIoConfig.getFloat("prefetchTimeToLive", 10.0f);
+  m_prefetchHits = 0;
+  m_prefetchMisses = 0;
+  m_sectorIoStallTime = 0.0;
+
+  auto compressionConfig = storageConfig.get("compression", JsonObject());
+  m_entityCompression.codec = CompressionCodecNames.getLeft(compressionConfig.getString("codec", "zlib"));
+  m_entityCompression.level = compressionConfig.getInt("level", MediumCompression);
+  m_tileCompression = m_entityCompression;
+  // The dictionary is registered even if the configured codec is zlib, so
+  // that sectors stored with it stay readable.
+  auto dictionaryPath = compressionConfig.optString("tileSectorDictionary");
+  if (dictionaryPath && compressionCodecAvailable(CompressionCodec::Zstd)) {
+    auto dictionary = CompressionDictionary::registerDictionary(*Root::singleton().assets()->bytes(*dictionaryPath), m_tileCompression.level);
+    if (m_tileCompression.codec == CompressionCodec::Zstd)
+      m_tileCompression.dictionary = std::move(dictionary);
+  }
 }
 
 bool WorldStorage::belongsInSector(Sector const& sector, Vec2F const& position) const {
@@ -776,14 +858,16 @@ void WorldStorage::loadSectorToLevel(Sector const& sector, SectorLoadLevel targe
     SectorLoadLevel stepDownLoad = (SectorLoadLevel)(i - 1);
 
     if (stepDownLoad != SectorLoadLevel::None) {
-      for (auto adjacentSector : adjacentSectors(sector))
+      auto adjacent = adjacentSectors(sector);
+      // Read all of the surrounding sectors at once rather than one by one.
+      prefetchSectors(adjacent);
+      for (auto adjacentSector : adjacent)
         loadSectorToLevel(adjacentSector, stepDownLoad);
     }
 
     if (currentLoad == SectorLoadLevel::Tiles) {
-      if (auto res = m_db.find(tileSectorKey(sector))) {
-        TileSectorStore sectorStore = readTileSector(*res);
-
+      TileSectorStore sectorStore = takeTileSector(sector);
+      if (sectorStore.tiles) {
         m_tileArray->loadSector(sector, std::move(sectorStore.tiles));
 
         metadata.generationLevel = sectorStore.generationLevel;
@@ -892,7 +976,7 @@ void WorldStorage::unloadSectorToLevel(Sector const& sector, SectorLoadLevel tar
         sectorStore.append(entityFactory->storeVersionedEntity(entity));
       }
     }
-    m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore));
+    m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore, m_entityCompression));
     if (metadata.loadLevel < SectorLoadLevel::Entities)
       mergeSectorUniques(sector, storedUniques);
     else
@@ -908,13 +992,13 @@ void WorldStorage::unloadSectorToLevel(Sector const& sector, SectorLoadLevel tar
     TileSectorStore sectorStore;
     sectorStore.tiles = m_tileArray->unloadSector(sector);
     sectorStore.generationLevel = metadata.generationLevel;
-    m_db.insert(tileSectorKey(sector), writeTileSector(sectorStore));
+    storeTileSector(sector, std::move(sectorStore));
     m_sectorMetadata.remove(sector);
     m_generatorFacade->sectorLoadLevelChanged(this, sector, SectorLoadLevel::None);
   }
 }
 
-void WorldStorage::syncSector(Sector const& sector) {
+void WorldStorage::syncSector(Sector const& sector, List<pair<Sector, TileSectorStore>>* tileStores) {
   if (!m_tileArray->sectorValid(sector))
     return;
 
@@ -939,7 +1023,7 @@ void WorldStorage::syncSector(Sector const& sector) {
         sectorStore.append(entityFactory->storeVersionedEntity(entity));
       }
     }
-    m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore));
+    m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore, m_entityCompression));
     updateSectorUniques(sector, storedUniques);
   }
 
@@ -947,8 +1031,101 @@ void WorldStorage::syncSector(Sector const& sector) {
     TileSectorStore sectorStore;
     sectorStore.tiles = m_tileArray->copySector(sector);
     sectorStore.generationLevel = metadata.generationLevel;
-    m_db.insert(tileSectorKey(sector), writeTileSector(sectorStore));
+    if (tileStores)
+      tileStores->append({sector, std::move(sectorStore)});
+    else
+      storeTileSector(sector, std::move(sectorStore));
+  }
+}
+
+void WorldStorage::syncAllSectors() {
+  // Bounds how many copied sectors are held at once.
+  size_t const TileStoreBatchSize = 64;
+
+  List<pair<Sector, TileSectorStore>> tileStores;
+  auto storeBatch = [&]() {
+    List<ByteArray> tileData(tileStores.size());
+    WorkerPool::shared().parallelFor(tileStores.size(), 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+        tileData[i] = writeTileSector(tileStores[i].second, m_tileCompression);
+    });
+    for (size_t i = 0; i < tileStores.size(); ++i)
+      m_db.insert(tileSectorKey(tileStores[i].first), tileData[i]);
+    tileStores.clear();
+  };
+
+  for (auto const& pair : m_sectorMetadata) {
+    syncSector(pair.first, m_sectorIoPool ? nullptr : &tileStores);
+    if (tileStores.size() >= TileStoreBatchSize)
+      storeBatch();
+  }
+  storeBatch();
+  flushTileWrites(true);
+}
+
+auto WorldStorage::takeTileSector(Sector const& sector) -> TileSectorStore {
+  if (auto write = m_tileWrites.maybeTake(sector)) {
+    // The sector is being reloaded before its last store made it to the
+    // database.
+    double waitStart = Time::monotonicTime();
+    m_db.insert(tileSectorKey(sector), write->get());
+    m_sectorIoStallTime += Time::monotonicTime() - waitStart;
+  }
+
+  if (auto read = m_tileReads.maybeTake(sector)) {
+    ++m_prefetchHits;
+    double waitStart = Time::monotonicTime();
+    TileSectorStore sectorStore = std::move(read->store.get());
+    m_sectorIoStallTime += Time::monotonicTime() - waitStart;
+    return sectorStore;
+  }
+
+  if (m_sectorIoPool)
+    ++m_prefetchMisses;
+
+  TileSectorStore sectorStore;
+  if (auto res = m_db.find(tileSectorKey(sector)))
+    sectorStore = readTileSector(*res);
+  return sectorStore;
+}
+
+void WorldStorage::storeTileSector(Sector const& sector, TileSectorStore store) {
+  if (!m_sectorIoPool) {
+    m_db.insert(tileSectorKey(sector), writeTileSector(store, m_tileCompression));
+    return;
+  }
+
+  // Replaces any older write of this sector that has not been flushed yet.
+  auto sharedStore = make_shared<TileSectorStore>(std::move(store));
+  m_tileWrites.set(sector, m_sectorIoPool->addProducer<ByteArray>([sharedStore, compression = m_tileCompression]() {
+    return writeTileSector(*sharedStore, compression);
+  }));
+}
+
+void WorldStorage::flushTileWrites(bool wait) {
+  if (m_tileWrites.empty())
+    return;
+
+  double waitStart = Time::monotonicTime();
+  eraseWhere(m_tileWrites, [&](auto& p) {
+    if (!wait && !p.second.done())
+      return false;
+    m_db.insert(tileSectorKey(p.first), p.second.get());
+    return true;
+  });
+  if (wait)
+    m_sectorIoStallTime += Time::monotonicTime() - waitStart;
+}
+
+void WorldStorage::abortSectorIo() {
+  for (auto& p : m_tileReads) {
+    try {
+      p.second.store.get();
+    } catch (...) {
+    }
   }
+  m_tileReads.clear();
+  m_tileWrites.clear();
 }
 
 List<WorldStorage::Sector> WorldStorage::adjacentSectors(Sector const& sector) const {
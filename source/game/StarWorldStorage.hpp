@@ -8,6 +8,8 @@
 #include "StarWorldTiles.hpp"
 #include "StarRpcPromise.hpp"
 #include "StarBiomePlacement.hpp"
+#include "StarWorkerPool.hpp"
+#include "StarCompression.hpp"
 
 namespace Star {
 
@@ -91,6 +93,20 @@ public:
   typedef ServerTileSectorArray::Array TileArray;
   typedef ServerTileSectorArray::ArrayPtr TileArrayPtr;
 
+  struct SectorIoStats {
+    // Tile sector reads and writes handed to the background pool that the
+    // world thread has not taken up yet.
+    size_t pendingReads;
+    size_t pendingWrites;
+    // Tile sector loads that found their sector already read in the
+    // background, and those that had to read it on the spot.
+    uint64_t prefetchHits;
+    uint64_t prefetchMisses;
+    // Total time the world thread has spent waiting on background sector I/O,
+    // in seconds.
+    double stallTime;
+  };
+
   static void repackWorldFile(String const& fileName, String const& fileType);
 
   static WorldChunks getWorldChunksUpdate(WorldChunks const& oldChunks, WorldChunks const& newChunks);
@@ -132,6 +148,16 @@ public:
   // the sector is loaded at all, also resets the TTL.
   void queueSectorActivation(Sector sector);
 
+  // Starts reading, decompressing and deserializing the tiles of any of the
+  // given sectors that are not loaded on the background I/O pool, so that a
+  // later load of them only has to swap the tiles in.  Sectors already being
+  // prefetched have their TTL reset instead.  Does nothing unless background
+  // sector I/O is enabled in the worldstorage config.
+  void prefetchSectors(List<Sector> const& sectors);
+
+  bool sectorIoEnabled() const;
+  SectorIoStats sectorIoStats() const;
+
   // Immediately (synchronously) fully generates the sector, then flags it as requiring
   // terraforming (biome reapplication) which will be handled by the normal generation process
   void triggerTerraformSector(Sector sector);
@@ -216,6 +242,11 @@ private:
     TileArrayPtr tiles;
   };
 
+  struct TileSectorRead {
+    WorkerPoolPromise<TileSectorStore> store;
+    float timeToLive;
+  };
+
   struct SectorMetadata {
     SectorMetadata();
 
@@ -230,11 +261,11 @@ private:
 
   static ByteArray entitySectorKey(Sector const& sector);
   static EntitySectorStore readEntitySector(ByteArray const& data);
-  static ByteArray writeEntitySector(EntitySectorStore const& store);
+  static ByteArray writeEntitySector(EntitySectorStore const& store, CompressionSettings const& compression);
 
   static ByteArray tileSectorKey(Sector const& sector);
   static TileSectorStore readTileSector(ByteArray const& data);
-  static ByteArray writeTileSector(TileSectorStore const& store);
+  static ByteArray writeTileSector(TileSectorStore const& store, CompressionSettings const& compression);
 
   static ByteArray uniqueIndexKey(String const& uniqueId);
   static UniqueIndexStore readUniqueIndexStore(ByteArray const& data);
@@ -270,8 +301,27 @@ private:
   // given level.
   void unloadSectorToLevel(Sector const& sector, SectorLoadLevel targetLoadLevel, bool force = false);
 
-  // Sync this sector to disk without unloading it.
-  void syncSector(Sector const& sector);
+  // Sync this sector to disk without unloading it.  If tileStores is given,
+  // the tiles are appended there instead of being stored.
+  void syncSector(Sector const& sector, List<pair<Sector, TileSectorStore>>* tileStores = nullptr);
+  // Syncs every loaded sector.  Without background sector I/O, the tile
+  // sectors are compressed a batch at a time on WorkerPool::shared() instead
+  // of one by one.
+  void syncAllSectors();
+
+  // Takes the tiles for the given sector from a background read if there is
+  // one, otherwise reads them on the spot.  The returned store has no tiles if
+  // the sector has never been stored.
+  TileSectorStore takeTileSector(Sector const& sector);
+  // Stores the given tile sector, compressing it on the background I/O pool
+  // if enabled.
+  void storeTileSector(Sector const& sector, TileSectorStore store);
+  // Inserts finished background tile sector writes into the database, or
+  // every pending write if wait is true.
+  void flushTileWrites(bool wait);
+  // Waits out all background I/O and drops its results, must be called before
+  // the database is rolled back and closed.
+  void abortSectorIo();
 
   // Returns the sectors within WorldSectorSize of the given sector.  This is
   // *not exactly the same* as the surrounding 9 sectors in a square pattern,
@@ -294,6 +344,10 @@ private:
   Vec2F m_sectorTimeToLive;
   float m_generationQueueTimeToLive;
 
+  // Tile sectors are small and very alike, so may use a trained dictionary.
+  CompressionSettings m_tileCompression;
+  CompressionSettings m_entityCompression;
+
   ServerTileSectorArrayPtr m_tileArray;
   EntityMapPtr m_entityMap;
   WorldGeneratorFacadePtr m_generatorFacade;
@@ -303,6 +357,18 @@ private:
   StableHashMap<Sector, SectorMetadata> m_sectorMetadata;
   OrderedHashMap<Sector, float> m_generationQueue;
   BTreeDatabase m_db;
+
+  // Null unless background sector I/O is enabled.  Reads only ever touch the
+  // database through its own locking, writes only compress on the pool and
+  // are inserted from the world thread.
+  WorkerPool* m_sectorIoPool;
+  size_t m_maxPrefetchedSectors;
+  float m_prefetchTimeToLive;
+  HashMap<Sector, TileSectorRead> m_tileReads;
+  HashMap<Sector, WorkerPoolPromise<ByteArray>> m_tileWrites;
+  uint64_t m_prefetchHits;
+  uint64_t m_prefetchMisses;
+  double m_sectorIoStallTime;
 };
 
 }
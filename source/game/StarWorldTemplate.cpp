@@ -280,6 +280,81 @@ WorldTemplate::BlockInfo WorldTemplate::blockInfo(int x, int y) const {
   return getBlockInfo(m_geometry.xwrap(x), y);
 }
 
+List<WorldTemplate::BlockInfo> WorldTemplate::blockInfo(RectI const& region) const {
+  List<BlockInfo> blockInfos(region.volume());
+
+  List<pair<size_t, Vector<uint32_t, 2>>> uncached;
+  size_t index = 0;
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x, ++index) {
+      Vector<uint32_t, 2> key(m_geometry.xwrap(x), y);
+      if (auto cached = m_blockCache.ptr(key))
+        blockInfos[index] = *cached;
+      else
+        uncached.append({index, key});
+    }
+  }
+
+  if (uncached.empty())
+    return blockInfos;
+
+  if (!m_layout) {
+    for (auto const& p : uncached)
+      blockInfos[p.first] = getBlockInfo(p.second[0], p.second[1]);
+    return blockInfos;
+  }
+
+  SelectorSamples samples;
+  HashMap<TerrainSelectorIndex, List<Vec2I>> requests;
+  auto sampleRequests = [&]() {
+    List<float> values;
+    for (auto const& p : requests) {
+      values.resize(p.second.size());
+      m_layout->getTerrainSelector(p.first)->getPoints(p.second.ptr(), p.second.size(), values.ptr());
+      for (size_t i = 0; i < values.size(); ++i)
+        samples.set(Vec3I(p.first, p.second[i][0], p.second[i][1]), values[i]);
+    }
+    requests.clear();
+  };
+
+  // Terrain selectors are sampled first, as the cave selectors are only
+  // needed wherever there turns out to be terrain.
+  List<List<WorldLayout::RegionWeighting>> flatWeightings;
+  flatWeightings.reserve(uncached.size());
+  for (auto const& p : uncached) {
+    int x = p.second[0];
+    int y = p.second[1];
+    flatWeightings.append(m_layout->getWeighting(x, y));
+    for (auto const& weighting : flatWeightings.last()) {
+      if (weighting.region->terrainSelectorIndex != NullTerrainSelectorIndex)
+        requests[weighting.region->terrainSelectorIndex].append(Vec2I(weighting.xValue, y));
+    }
+  }
+  sampleRequests();
+
+  for (size_t i = 0; i < uncached.size(); ++i) {
+    int x = uncached[i].second[0];
+    int y = uncached[i].second[1];
+    if (terrainSelect(x, y, flatWeightings[i], &samples) <= 0.0f)
+      continue;
+
+    for (auto const& weighting : flatWeightings[i]) {
+      if (weighting.region->foregroundCaveSelectorIndex != NullTerrainSelectorIndex)
+        requests[weighting.region->foregroundCaveSelectorIndex].append(Vec2I(weighting.xValue, y));
+      if (weighting.region->backgroundCaveSelectorIndex != NullTerrainSelectorIndex)
+        requests[weighting.region->backgroundCaveSelectorIndex].append(Vec2I(weighting.xValue, y));
+    }
+  }
+  sampleRequests();
+
+  for (auto const& p : uncached) {
+    blockInfos[p.first] = computeBlockInfo(p.second[0], p.second[1], &samples);
+    m_blockCache.set(p.second, blockInfos[p.first]);
+  }
+
+  return blockInfos;
+}
+
 WorldTemplate::BlockInfo WorldTemplate::blockBiomeInfo(int x, int y) const {
   BlockInfo blockInfo;
 
@@ -622,160 +697,171 @@ pair<float, float> WorldTemplate::customTerrainWeighting(int x, int y) const {
 
 WorldTemplate::BlockInfo WorldTemplate::getBlockInfo(uint32_t x, uint32_t y) const {
   return m_blockCache.get(Vector<uint32_t, 2>(x, y), [this, x, y](Vector<uint32_t, 2>) {
-    BlockInfo blockInfo;
-
-    if (!m_layout)
-      return blockInfo;
-
-    // The environment biome is calculated with weighting based on the flat coordinates.
-    List<WorldLayout::RegionWeighting> flatWeighting = m_layout->getWeighting(x, y);
-
-    // The block biome is calculated optionally with higher frequency noise
-    // added to prevent straight lines appearing on the boundaries of
-    // regions.
-
-    int blendNoiseOffset = 0;
-    if (auto const& blendNoise = m_layout->blendNoise())
-      blendNoiseOffset = (int)blendNoise->get(x, y);
-
-    Vec2I blockPos;
-    List<WorldLayout::RegionWeighting> blockWeighting;
-    List<WorldLayout::RegionWeighting> transitionWeighting;
-    if (auto const& blockNoise = m_layout->blockNoise()) {
-      blockPos = blockNoise->apply(Vec2I(x, y), m_geometry.size());
-      blockWeighting = m_layout->getWeighting(blockPos[0] + blendNoiseOffset, blockPos[1]);
-      transitionWeighting = m_layout->getWeighting(blockPos[0], blockPos[1]);
-    } else {
-      blockPos = Vec2I(x, y);
-      blockWeighting = flatWeighting;
-      transitionWeighting = flatWeighting;
+    return computeBlockInfo(x, y, nullptr);
+  });
+}
+
+float WorldTemplate::sampleSelector(TerrainSelectorIndex index, int x, int y, SelectorSamples const* samples) const {
+  if (samples) {
+    if (auto value = samples->ptr(Vec3I(index, x, y)))
+      return *value;
+  }
+  return m_layout->getTerrainSelector(index)->get(x, y);
+}
+
+float WorldTemplate::terrainSelect(int x, int y, List<WorldLayout::RegionWeighting> const& flatWeighting, SelectorSamples const* samples) const {
+  float terrainSelect = 0.0f;
+
+  // Terrain weighting uses the flat weighting, and weights each selector
+  // to blend among them.
+  for (auto const& weighting : flatWeighting) {
+    if (weighting.region->terrainSelectorIndex != NullTerrainSelectorIndex) {
+      float select = sampleSelector(weighting.region->terrainSelectorIndex, weighting.xValue, y, samples) * weighting.weight;
+      terrainSelect += select;
     }
+  }
 
-    if (flatWeighting.empty() || blockWeighting.empty())
-      return blockInfo;
+  // This is a bit of a cheat. Since customTerrainWeighting is always flat,
+  // there are some odd effects that come from linearly interpolating from
+  // the generally non-flat terrain sources to flat regions of space.  By
+  // using an interpolator that has an exaggerated S curve between the
+  // points, this hides some of these effects.
+  auto ctweighting = customTerrainWeighting(x, y);
+  return quintic2(ctweighting.second, terrainSelect, ctweighting.first);
+}
 
-    auto const& primaryFlatWeighting = flatWeighting.first();
-    auto const& primaryBlockWeighting = blockWeighting.first();
+WorldTemplate::BlockInfo WorldTemplate::computeBlockInfo(uint32_t x, uint32_t y, SelectorSamples const* samples) const {
+  BlockInfo blockInfo;
 
-    blockInfo.blockBiomeIndex = primaryBlockWeighting.region->blockBiomeIndex;
-    blockInfo.environmentBiomeIndex = primaryFlatWeighting.region->environmentBiomeIndex;
+  if (!m_layout)
+    return blockInfo;
 
-    blockInfo.biomeTransition = transitionWeighting.first().weight < m_templateConfig.getFloat("biomeTransitionThreshold", 0);
+  // The environment biome is calculated with weighting based on the flat coordinates.
+  List<WorldLayout::RegionWeighting> flatWeighting = m_layout->getWeighting(x, y);
 
-    float terrainSelect = 0.0f;
-    float foregroundCaveSelect = 0.0f;
-    float backgroundCaveSelect = 0.0f;
+  // The block biome is calculated optionally with higher frequency noise
+  // added to prevent straight lines appearing on the boundaries of
+  // regions.
 
-    // Terrain weighting uses the flat weighting, and weights each selector
-    // to blend among them.
-    for (auto const& weighting : flatWeighting) {
-      if (weighting.region->terrainSelectorIndex != NullTerrainSelectorIndex) {
-        auto const& terrainSelector = m_layout->getTerrainSelector(weighting.region->terrainSelectorIndex);
-        float select = terrainSelector->get(weighting.xValue, y) * weighting.weight;
-        terrainSelect += select;
-      }
-    }
+  int blendNoiseOffset = 0;
+  if (auto const& blendNoise = m_layout->blendNoise())
+    blendNoiseOffset = (int)blendNoise->get(x, y);
 
-    // This is a bit of a cheat. Since customTerrainWeighting is always flat,
-    // there are some odd effects that come from linearly interpolating from
-    // the generally non-flat terrain sources to flat regions of space.  By
-    // using an interpolator that has an exaggerated S curve between the
-    // points, this hides some of these effects.
-    auto ctweighting = customTerrainWeighting(x, y);
-    terrainSelect = quintic2(ctweighting.second, terrainSelect, ctweighting.first);
-
-    if (terrainSelect > 0.0f) {
-      blockInfo.terrain = true;
-
-      for (auto const& weighting : flatWeighting) {
-        if (weighting.region->foregroundCaveSelectorIndex != NullTerrainSelectorIndex) {
-          auto const& foregroundCaveSelector = m_layout->getTerrainSelector(weighting.region->foregroundCaveSelectorIndex);
-          foregroundCaveSelect += foregroundCaveSelector->get(weighting.xValue, y) * weighting.weight;
-        }
+  Vec2I blockPos;
+  List<WorldLayout::RegionWeighting> blockWeighting;
+  List<WorldLayout::RegionWeighting> transitionWeighting;
+  if (auto const& blockNoise = m_layout->blockNoise()) {
+    blockPos = blockNoise->apply(Vec2I(x, y), m_geometry.size());
+    blockWeighting = m_layout->getWeighting(blockPos[0] + blendNoiseOffset, blockPos[1]);
+    transitionWeighting = m_layout->getWeighting(blockPos[0], blockPos[1]);
+  } else {
+    blockPos = Vec2I(x, y);
+    blockWeighting = flatWeighting;
+    transitionWeighting = flatWeighting;
+  }
 
-        if (weighting.region->backgroundCaveSelectorIndex != NullTerrainSelectorIndex) {
-          auto const& backgroundCaveSelector = m_layout->getTerrainSelector(weighting.region->backgroundCaveSelectorIndex);
-          backgroundCaveSelect += backgroundCaveSelector->get(weighting.xValue, y) * weighting.weight;
-        }
-      }
+  if (flatWeighting.empty() || blockWeighting.empty())
+    return blockInfo;
 
-      auto surfaceCaveAttenuationDist = m_templateConfig.getFloat("surfaceCaveAttenuationDist", 0);
-      if (terrainSelect < surfaceCaveAttenuationDist) {
-        auto surfaceCaveAttenuationFactor = m_templateConfig.getFloat("surfaceCaveAttenuationFactor", 1);
-        foregroundCaveSelect -= (surfaceCaveAttenuationDist - terrainSelect) * surfaceCaveAttenuationFactor;
-        backgroundCaveSelect -= (surfaceCaveAttenuationDist - terrainSelect) * surfaceCaveAttenuationFactor;
-      }
-    }
+  auto const& primaryFlatWeighting = flatWeighting.first();
+  auto const& primaryBlockWeighting = blockWeighting.first();
 
-    blockInfo.foregroundCave = foregroundCaveSelect > 0.0f;
-    blockInfo.backgroundCave = backgroundCaveSelect > 0.0f;
+  blockInfo.blockBiomeIndex = primaryBlockWeighting.region->blockBiomeIndex;
+  blockInfo.environmentBiomeIndex = primaryFlatWeighting.region->environmentBiomeIndex;
+
+  blockInfo.biomeTransition = transitionWeighting.first().weight < m_templateConfig.getFloat("biomeTransitionThreshold", 0);
 
-    auto const& regionLiquids = primaryFlatWeighting.region->regionLiquids;
-    blockInfo.caveLiquid = regionLiquids.caveLiquid;
-    blockInfo.caveLiquidSeedDensity = regionLiquids.caveLiquidSeedDensity;
-    blockInfo.oceanLiquid = regionLiquids.oceanLiquid;
-    blockInfo.oceanLiquidLevel = regionLiquids.oceanLiquidLevel;
-    blockInfo.encloseLiquids = regionLiquids.encloseLiquids;
-    blockInfo.fillMicrodungeons = regionLiquids.fillMicrodungeons;
+  float terrainSelect = this->terrainSelect(x, y, flatWeighting, samples);
+  float foregroundCaveSelect = 0.0f;
+  float backgroundCaveSelect = 0.0f;
 
-    if (!blockInfo.terrain && blockInfo.encloseLiquids && (int)y < blockInfo.oceanLiquidLevel) {
-      blockInfo.terrain = true;
-      blockInfo.foregroundCave = true;
+  if (terrainSelect > 0.0f) {
+    blockInfo.terrain = true;
+
+    for (auto const& weighting : flatWeighting) {
+      if (weighting.region->foregroundCaveSelectorIndex != NullTerrainSelectorIndex)
+        foregroundCaveSelect += sampleSelector(weighting.region->foregroundCaveSelectorIndex, weighting.xValue, y, samples) * weighting.weight;
+
+      if (weighting.region->backgroundCaveSelectorIndex != NullTerrainSelectorIndex)
+        backgroundCaveSelect += sampleSelector(weighting.region->backgroundCaveSelectorIndex, weighting.xValue, y, samples) * weighting.weight;
     }
 
-    if (blockInfo.terrain) {
-      if (auto blockBiome = biome(blockInfo.blockBiomeIndex)) {
-        if (!blockInfo.foregroundCave) {
-          blockInfo.foreground = blockBiome->mainBlock;
-          blockInfo.background = blockInfo.foreground;
-        } else if (!blockInfo.backgroundCave) {
-          blockInfo.background = blockBiome->mainBlock;
-        }
+    auto surfaceCaveAttenuationDist = m_templateConfig.getFloat("surfaceCaveAttenuationDist", 0);
+    if (terrainSelect < surfaceCaveAttenuationDist) {
+      auto surfaceCaveAttenuationFactor = m_templateConfig.getFloat("surfaceCaveAttenuationFactor", 1);
+      foregroundCaveSelect -= (surfaceCaveAttenuationDist - terrainSelect) * surfaceCaveAttenuationFactor;
+      backgroundCaveSelect -= (surfaceCaveAttenuationDist - terrainSelect) * surfaceCaveAttenuationFactor;
+    }
+  }
 
-        // subBlock, foregroundOre, and backgroundOre selectors can be empty
-        // if they are not enabled, otherwise they will always have the
-        // correct count
-
-        if (!primaryBlockWeighting.region->subBlockSelectorIndexes.empty()) {
-          for (size_t i = 0; i < blockBiome->subBlocks.size(); ++i) {
-            auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->subBlockSelectorIndexes.at(i));
-            if (selector->get(primaryBlockWeighting.xValue - blendNoiseOffset, blockPos[1]) > 0.0f) {
-              if (!blockInfo.foregroundCave) {
-                blockInfo.foreground = blockBiome->subBlocks.at(i);
-                blockInfo.background = blockInfo.foreground;
-              } else if (!blockInfo.backgroundCave) {
-                blockInfo.background = blockBiome->subBlocks.at(i);
-              }
-
-              break;
+  blockInfo.foregroundCave = foregroundCaveSelect > 0.0f;
+  blockInfo.backgroundCave = backgroundCaveSelect > 0.0f;
+
+  auto const& regionLiquids = primaryFlatWeighting.region->regionLiquids;
+  blockInfo.caveLiquid = regionLiquids.caveLiquid;
+  blockInfo.caveLiquidSeedDensity = regionLiquids.caveLiquidSeedDensity;
+  blockInfo.oceanLiquid = regionLiquids.oceanLiquid;
+  blockInfo.oceanLiquidLevel = regionLiquids.oceanLiquidLevel;
+  blockInfo.encloseLiquids = regionLiquids.encloseLiquids;
+  blockInfo.fillMicrodungeons = regionLiquids.fillMicrodungeons;
+
+  if (!blockInfo.terrain && blockInfo.encloseLiquids && (int)y < blockInfo.oceanLiquidLevel) {
+    blockInfo.terrain = true;
+    blockInfo.foregroundCave = true;
+  }
+
+  if (blockInfo.terrain) {
+    if (auto blockBiome = biome(blockInfo.blockBiomeIndex)) {
+      if (!blockInfo.foregroundCave) {
+        blockInfo.foreground = blockBiome->mainBlock;
+        blockInfo.background = blockInfo.foreground;
+      } else if (!blockInfo.backgroundCave) {
+        blockInfo.background = blockBiome->mainBlock;
+      }
+
+      // subBlock, foregroundOre, and backgroundOre selectors can be empty
+      // if they are not enabled, otherwise they will always have the
+      // correct count
+
+      if (!primaryBlockWeighting.region->subBlockSelectorIndexes.empty()) {
+        for (size_t i = 0; i < blockBiome->subBlocks.size(); ++i) {
+          auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->subBlockSelectorIndexes.at(i));
+          if (selector->get(primaryBlockWeighting.xValue - blendNoiseOffset, blockPos[1]) > 0.0f) {
+            if (!blockInfo.foregroundCave) {
+              blockInfo.foreground = blockBiome->subBlocks.at(i);
+              blockInfo.background = blockInfo.foreground;
+            } else if (!blockInfo.backgroundCave) {
+              blockInfo.background = blockBiome->subBlocks.at(i);
             }
+
+            break;
           }
         }
+      }
 
-        if (!blockInfo.foregroundCave && !primaryBlockWeighting.region->foregroundOreSelectorIndexes.empty()) {
-          for (size_t i = 0; i < blockBiome->ores.size(); ++i) {
-            auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->foregroundOreSelectorIndexes.at(i));
-            if (selector->get(x, y) > 0.0f) {
-              blockInfo.foregroundMod = blockBiome->ores.at(i).first;
-              break;
-            }
+      if (!blockInfo.foregroundCave && !primaryBlockWeighting.region->foregroundOreSelectorIndexes.empty()) {
+        for (size_t i = 0; i < blockBiome->ores.size(); ++i) {
+          auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->foregroundOreSelectorIndexes.at(i));
+          if (selector->get(x, y) > 0.0f) {
+            blockInfo.foregroundMod = blockBiome->ores.at(i).first;
+            break;
           }
         }
+      }
 
-        if (!blockInfo.backgroundCave && !primaryBlockWeighting.region->backgroundOreSelectorIndexes.empty()) {
-          for (size_t i = 0; i < blockBiome->ores.size(); ++i) {
-            auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->backgroundOreSelectorIndexes.at(i));
-            if (selector->get(x, y) > 0.0f) {
-              blockInfo.backgroundMod = blockBiome->ores.at(i).first;
-              break;
-            }
+      if (!blockInfo.backgroundCave && !primaryBlockWeighting.region->backgroundOreSelectorIndexes.empty()) {
+        for (size_t i = 0; i < blockBiome->ores.size(); ++i) {
+          auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->backgroundOreSelectorIndexes.at(i));
+          if (selector->get(x, y) > 0.0f) {
+            blockInfo.backgroundMod = blockBiome->ores.at(i).first;
+            break;
           }
         }
       }
     }
+  }
 
-    return blockInfo;
-  });
+  return blockInfo;
 }
 
 } // namespace Star
@@ -130,6 +130,10 @@ public:
   bool isOutside(RectI const& region) const;
 
   BlockInfo blockInfo(int x, int y) const;
+  // Same as blockInfo for every tile in the region, row by row as with
+  // TerrainSelector::getRegion.  The terrain and cave selectors are sampled
+  // for the whole region at once, rather than tile by tile.
+  List<BlockInfo> blockInfo(RectI const& region) const;
 
   // partial blockinfo that doesn't use terrain selectors
   BlockInfo blockBiomeInfo(int x, int y) const;
@@ -182,8 +186,17 @@ private:
 
   pair<float, float> customTerrainWeighting(int x, int y) const;
 
+  // Terrain selector values sampled ahead of time, keyed by selector index
+  // and position.
+  typedef HashMap<Vec3I, float> SelectorSamples;
+
+  float sampleSelector(TerrainSelectorIndex index, int x, int y, SelectorSamples const* samples) const;
+  float terrainSelect(int x, int y, List<WorldLayout::RegionWeighting> const& flatWeighting, SelectorSamples const* samples) const;
+
   // Calculates block info and adds to cache
   BlockInfo getBlockInfo(uint32_t x, uint32_t y) const;
+  // Calculates block info, using any selector values already sampled
+  BlockInfo computeBlockInfo(uint32_t x, uint32_t y, SelectorSamples const* samples) const;
 
   Json m_templateConfig;
   float m_customTerrainBlendSize;
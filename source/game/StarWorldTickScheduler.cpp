@@ -0,0 +1,250 @@
+#include "StarWorldTickScheduler.hpp"
+#include "StarLogging.hpp"
+#include "StarTime.hpp"
+#include "StarWorldServerThread.hpp"
+
+#if defined TRACY_ENABLE
+#include "tracy/Tracy.hpp"
+#else
+#define ZoneScoped
+#define ZoneScopedN(name)
+#endif
+
+namespace Star {
+
+// Longest time an idle worker waits before re-checking the schedule.
+static unsigned const MaxWorkerWaitMilliseconds = 100;
+// Smoothing factor for the per-world average tick time.
+static double const TickTimeSmoothing = 0.05;
+// Interval at which the scheduler load is reported to the LogMap.
+static double const LoadReportInterval = 1.0;
+
+WorldTickScheduler::ScheduledWorld::ScheduledWorld(WorldServerThread* world)
+    : world(world), nextTick(0.0), targetTickRate(0.0), lastTickTime(0.0), averageTickTime(0.0), idle(false), removed(false) {}
+
+WorldTickScheduler::WorldTickScheduler(unsigned threadCount, unsigned idleTickDivisor)
+    : m_idleTickDivisor(max(idleTickDivisor, 1u)), m_stop(false), m_queuedWorlds(0) {
+  if (threadCount == 0)
+    threadCount = max(Thread::numberOfProcessors(), 1u);
+
+  m_loadWindowStart = Time::monotonicTime();
+  m_loadBusyTime = 0.0;
+
+  // Workers look at each other's queues, so only start them once they all
+  // exist.
+  for (unsigned i = 0; i < threadCount; ++i)
+    m_workerThreads.append(make_unique<WorkerThread>(this, i));
+  for (auto const& workerThread : m_workerThreads)
+    workerThread->start();
+}
+
+WorldTickScheduler::~WorldTickScheduler() {
+  {
+    MutexLocker locker(m_scheduleMutex);
+    m_stop = true;
+    m_scheduleCondition.broadcast();
+  }
+  for (auto const& workerThread : m_workerThreads)
+    workerThread->join();
+  m_workerThreads.clear();
+}
+
+unsigned WorldTickScheduler::threadCount() const {
+  return m_workerThreads.size();
+}
+
+void WorldTickScheduler::add(WorldServerThread* world) {
+  MutexLocker locker(m_scheduleMutex);
+  if (m_worlds.contains(world))
+    return;
+
+  auto scheduledWorld = make_shared<ScheduledWorld>(world);
+  scheduledWorld->nextTick = Time::monotonicTime();
+  m_worlds.add(world, scheduledWorld);
+  m_schedule.append(scheduledWorld);
+  std::push_heap(m_schedule.begin(), m_schedule.end(), laterTick);
+  m_scheduleCondition.signal();
+}
+
+void WorldTickScheduler::remove(WorldServerThread* world) {
+  ScheduledWorldPtr scheduledWorld;
+  {
+    MutexLocker locker(m_scheduleMutex);
+    scheduledWorld = m_worlds.maybeTake(world).value();
+    if (!scheduledWorld)
+      return;
+    scheduledWorld->removed = true;
+  }
+
+  // Stale entries left in the schedule or in worker queues are discarded when
+  // they are next taken, all that is left is to wait out a tick in progress.
+  MutexLocker tickLocker(scheduledWorld->tickMutex);
+}
+
+bool WorldTickScheduler::contains(WorldServerThread const* world) const {
+  MutexLocker locker(m_scheduleMutex);
+  return m_worlds.contains(world);
+}
+
+List<WorldTickScheduler::WorldTickInfo> WorldTickScheduler::tickInfo() const {
+  List<WorldTickInfo> info;
+  MutexLocker locker(m_scheduleMutex);
+  for (auto const& p : m_worlds) {
+    auto const& scheduledWorld = p.second;
+    info.append(WorldTickInfo{p.first->worldId(), scheduledWorld->targetTickRate,
+        scheduledWorld->lastTickTime, scheduledWorld->averageTickTime, scheduledWorld->idle});
+  }
+  return info;
+}
+
+bool WorldTickScheduler::laterTick(ScheduledWorldPtr const& a, ScheduledWorldPtr const& b) {
+  return a->nextTick > b->nextTick;
+}
+
+auto WorldTickScheduler::takeWork(unsigned workerIndex) -> ScheduledWorldPtr {
+  auto& self = *m_workerThreads[workerIndex];
+  {
+    MutexLocker queueLocker(self.queueMutex);
+    if (!self.queue.empty()) {
+      --m_queuedWorlds;
+      return self.queue.takeFirst();
+    }
+  }
+
+  if (m_queuedWorlds > 0) {
+    // Steal from the back of the other workers' queues, the owner takes from
+    // the front, so the two rarely want the same world.
+    for (size_t i = 1; i < m_workerThreads.size(); ++i) {
+      auto& victim = *m_workerThreads[(workerIndex + i) % m_workerThreads.size()];
+      MutexLocker queueLocker(victim.queueMutex);
+      if (!victim.queue.empty()) {
+        --m_queuedWorlds;
+        return victim.queue.takeLast();
+      }
+    }
+  }
+
+  MutexLocker locker(m_scheduleMutex);
+  if (m_stop)
+    return {};
+
+  double now = Time::monotonicTime();
+  ScheduledWorldPtr first;
+  List<ScheduledWorldPtr> due;
+  while (!m_schedule.empty() && m_schedule.first()->nextTick <= now) {
+    std::pop_heap(m_schedule.begin(), m_schedule.end(), laterTick);
+    auto scheduledWorld = m_schedule.takeLast();
+    if (scheduledWorld->removed)
+      continue;
+    if (!first)
+      first = std::move(scheduledWorld);
+    else
+      due.append(std::move(scheduledWorld));
+  }
+
+  if (!first) {
+    // Somebody queued work after we last looked, go steal it.
+    if (m_queuedWorlds > 0)
+      return {};
+
+    unsigned waitMilliseconds = MaxWorkerWaitMilliseconds;
+    if (!m_schedule.empty())
+      waitMilliseconds = min<unsigned>(waitMilliseconds, ceil((m_schedule.first()->nextTick - now) * 1000.0));
+    if (waitMilliseconds > 0)
+      m_scheduleCondition.wait(m_scheduleMutex, waitMilliseconds);
+    return {};
+  }
+
+  if (!due.empty()) {
+    MutexLocker queueLocker(self.queueMutex);
+    m_queuedWorlds += due.size();
+    self.queue.appendAll(std::move(due));
+    m_scheduleCondition.broadcast();
+  }
+  return first;
+}
+
+void WorldTickScheduler::tickWorld(ScheduledWorldPtr const& scheduledWorld) {
+  MutexLocker tickLocker(scheduledWorld->tickMutex);
+  if (scheduledWorld->removed)
+    return;
+
+  auto world = scheduledWorld->world;
+  bool idle = world->noClients();
+  double targetTickRate = 1.0 / ServerGlobalTimestep;
+  if (idle)
+    targetTickRate /= m_idleTickDivisor;
+
+  double tickStart = Time::monotonicTime();
+  double spareTime = world->tick(targetTickRate);
+  double tickEnd = Time::monotonicTime();
+
+  // Errored worlds are left in place, but not ticked again, until the
+  // UniverseServer notices and removes them.
+  // The world may be destroyed as soon as the tick lock is released.
+  bool errored = world->serverErrorOccurred();
+  WorldId worldId = world->worldId();
+  tickLocker.unlock();
+
+  double tickTime = tickEnd - tickStart;
+  double averageTickTime;
+  {
+    MutexLocker locker(m_scheduleMutex);
+    scheduledWorld->idle = idle;
+    scheduledWorld->targetTickRate = targetTickRate;
+    scheduledWorld->lastTickTime = tickTime;
+    if (scheduledWorld->averageTickTime == 0.0)
+      scheduledWorld->averageTickTime = tickTime;
+    else
+      scheduledWorld->averageTickTime += (tickTime - scheduledWorld->averageTickTime) * TickTimeSmoothing;
+    averageTickTime = scheduledWorld->averageTickTime;
+
+    if (!errored && !scheduledWorld->removed) {
+      scheduledWorld->nextTick = tickEnd + max(spareTime, 0.0);
+      m_schedule.append(scheduledWorld);
+      std::push_heap(m_schedule.begin(), m_schedule.end(), laterTick);
+      // Wake a worker in case this world is due before anything it is
+      // waiting on.
+      m_scheduleCondition.signal();
+    }
+  }
+
+  LogMap::set(strf("server_{}_tick_cost", worldId), strf("{:4.2f}ms", averageTickTime * 1000.0));
+  updateLoad(tickTime);
+}
+
+void WorldTickScheduler::updateLoad(double busyTime) {
+  MutexLocker locker(m_loadMutex);
+  m_loadBusyTime += busyTime;
+  double now = Time::monotonicTime();
+  double elapsed = now - m_loadWindowStart;
+  if (elapsed >= LoadReportInterval) {
+    size_t worldCount;
+    {
+      MutexLocker scheduleLocker(m_scheduleMutex);
+      worldCount = m_worlds.size();
+    }
+    double load = m_loadBusyTime / (elapsed * m_workerThreads.size());
+    LogMap::set("server_world_scheduler", strf("{} worlds on {} threads, {:4.1f}% busy", worldCount, m_workerThreads.size(), load * 100.0));
+    m_loadWindowStart = now;
+    m_loadBusyTime = 0.0;
+  }
+}
+
+WorldTickScheduler::WorkerThread::WorkerThread(WorldTickScheduler* parent, unsigned index)
+    : Thread(strf("WorldTickScheduler worker {}", index)), parent(parent), index(index) {}
+
+WorldTickScheduler::WorkerThread::~WorkerThread() {
+  join();
+}
+
+void WorldTickScheduler::WorkerThread::run() {
+  while (!parent->m_stop) {
+    if (auto scheduledWorld = parent->takeWork(index)) {
+      ZoneScopedN("WorldTickScheduler tick");
+      parent->tickWorld(scheduledWorld);
+    }
+  }
+}
+
+} // namespace Star
@@ -0,0 +1,112 @@
+#ifndef STAR_WORLD_TICK_SCHEDULER_HPP
+#define STAR_WORLD_TICK_SCHEDULER_HPP
+
+#include "StarThread.hpp"
+#include "StarWarping.hpp"
+
+namespace Star {
+
+STAR_CLASS(WorldServerThread);
+STAR_CLASS(WorldTickScheduler);
+
+// Ticks any number of WorldServerThreads as tasks on a fixed size pool of
+// worker threads, rather than giving every world its own OS thread.  Each
+// worker keeps a local queue of due worlds and steals from the other workers
+// once its own queue runs dry, so that one slow world does not hold up the
+// worlds queued behind it.  Worlds without any clients are ticked at a
+// reduced rate.
+class WorldTickScheduler {
+public:
+  struct WorldTickInfo {
+    WorldId worldId;
+    // Tick rate the world is currently being scheduled at
+    double targetTickRate;
+    // Wall clock time spent in the last tick, and a smoothed average, in
+    // seconds.
+    double lastTickTime;
+    double averageTickTime;
+    bool idle;
+  };
+
+  // If threadCount is 0, uses the number of processors.  Worlds with no
+  // clients are ticked at 1 / idleTickDivisor of the normal tick rate.
+  WorldTickScheduler(unsigned threadCount, unsigned idleTickDivisor);
+  ~WorldTickScheduler();
+
+  unsigned threadCount() const;
+
+  // Starts ticking the given world.  The world must be removed from the
+  // scheduler before it is destroyed.
+  void add(WorldServerThread* world);
+  // Stops ticking the given world, blocking until any tick of it that is
+  // currently in progress has finished.  Does nothing if the world is not
+  // scheduled.
+  void remove(WorldServerThread* world);
+  bool contains(WorldServerThread const* world) const;
+
+  List<WorldTickInfo> tickInfo() const;
+
+private:
+  struct ScheduledWorld {
+    ScheduledWorld(WorldServerThread* world);
+
+    WorldServerThread* world;
+    // All of the below are guarded by the schedule mutex.
+    double nextTick;
+    double targetTickRate;
+    double lastTickTime;
+    double averageTickTime;
+    bool idle;
+
+    // Once set, the world is never ticked or rescheduled again.
+    atomic<bool> removed;
+    // Held for the duration of every tick.
+    Mutex tickMutex;
+  };
+  typedef shared_ptr<ScheduledWorld> ScheduledWorldPtr;
+
+  class WorkerThread : public Thread {
+  public:
+    WorkerThread(WorldTickScheduler* parent, unsigned index);
+    ~WorkerThread();
+
+    void run() override;
+
+    WorldTickScheduler* parent;
+    unsigned index;
+
+    Mutex queueMutex;
+    Deque<ScheduledWorldPtr> queue;
+  };
+
+  // Min-heap order on the next tick time.
+  static bool laterTick(ScheduledWorldPtr const& a, ScheduledWorldPtr const& b);
+
+  // Takes a world from this worker's queue, or steals one from another
+  // worker, or pulls every world that is due out of the schedule.  If nothing
+  // is due, waits until something might be and returns nothing.
+  ScheduledWorldPtr takeWork(unsigned workerIndex);
+  void tickWorld(ScheduledWorldPtr const& scheduledWorld);
+  void updateLoad(double busyTime);
+
+  unsigned m_idleTickDivisor;
+  atomic<bool> m_stop;
+
+  mutable Mutex m_scheduleMutex;
+  ConditionVariable m_scheduleCondition;
+  HashMap<WorldServerThread const*, ScheduledWorldPtr> m_worlds;
+  List<ScheduledWorldPtr> m_schedule;
+  // Count of worlds sitting in worker queues, only incremented with the
+  // schedule mutex held, so idle workers never miss stealable work.
+  atomic<size_t> m_queuedWorlds;
+
+  Mutex m_loadMutex;
+  double m_loadWindowStart;
+  double m_loadBusyTime;
+
+  List<unique_ptr<WorkerThread>> m_workerThreads;
+};
+
+} // namespace Star
+
+#endif
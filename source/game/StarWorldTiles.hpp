@@ -45,7 +45,10 @@ public:
   CollisionKind collision;
 
   bool collisionCacheDirty;
-  StaticList<CollisionBlock, CollisionGenerator::MaximumCollisionsPerSpace> collisionCache;
+  // Only filled in for tiles that collision has been queried on, so kept out
+  // of line rather than as an inline list of MaximumCollisionsPerSpace
+  // blocks, which would otherwise make up most of the size of every tile.
+  List<CollisionBlock> collisionCache;
 
   BiomeIndex blockBiomeIndex;
   BiomeIndex environmentBiomeIndex;
@@ -5,6 +5,7 @@
 #include "StarInputLuaBindings.hpp"
 #include "StarListener.hpp"
 #include "StarLogging.hpp"
+#include "StarLuaUpdateScheduler.hpp"
 #include "StarPeriodic.hpp"
 #include "StarRoot.hpp"
 #include "StarWorld.hpp"
@@ -148,6 +149,13 @@ public:
   float updateDt() const;
   void setUpdateDelta(unsigned updateDelta);
 
+  // If set, the LuaUpdateScheduler of the world may put off a due script
+  // update when the world is over its script budget.  The time passed in
+  // between is included in updateDt on the next update that runs.  Defaults
+  // to false.
+  bool updateDeferrable() const;
+  void setUpdateDeferrable(bool updateDeferrable);
+
   // FezzedOne: Due to potential smuggling, these bindings can't be safely instantiated
   // until their lifetime is trackable.
   template <typename Parent>
@@ -179,6 +187,8 @@ private:
   Periodic m_updatePeriodic;
   // FezzedOne: Why was this not initialised to zero, Kae?
   mutable float m_lastDt = 0.0f;
+  bool m_updateDeferrable = false;
+  unsigned m_deferredTicks = 0;
 };
 
 // Wraps a basic lua component so that world callbacks are added on init, and
@@ -328,12 +338,12 @@ unsigned LuaUpdatableComponent<Base>::updateDelta() const {
 template <typename Base>
 float LuaUpdatableComponent<Base>::updateDt(float dt) const {
   m_lastDt = dt;
-  return m_updatePeriodic.stepCount() * dt;
+  return (m_updatePeriodic.stepCount() + m_deferredTicks) * dt;
 }
 
 template <typename Base>
 float LuaUpdatableComponent<Base>::updateDt() const {
-  float retDt = m_updatePeriodic.stepCount() * m_lastDt;
+  float retDt = (m_updatePeriodic.stepCount() + m_deferredTicks) * m_lastDt;
   // FezzedOne: Fix for a bug where this callback returns `0.0f` or a negative number when called before the first `update`.
   if (retDt <= 0.0f) {
     return 0.01666666667f * GlobalTimescale;
@@ -348,17 +358,46 @@ void LuaUpdatableComponent<Base>::setUpdateDelta(unsigned updateDelta) {
   m_updatePeriodic.setStepCount(updateDelta);
 }
 
+template <typename Base>
+bool LuaUpdatableComponent<Base>::updateDeferrable() const {
+  return m_updateDeferrable;
+}
+
+template <typename Base>
+void LuaUpdatableComponent<Base>::setUpdateDeferrable(bool updateDeferrable) {
+  m_updateDeferrable = updateDeferrable;
+}
+
 template <typename Base>
 bool LuaUpdatableComponent<Base>::updateReady() const {
-  return m_updatePeriodic.ready();
+  if (!m_updatePeriodic.ready())
+    return false;
+
+  if (m_updateDeferrable) {
+    if (auto scheduler = LuaUpdateScheduler::current())
+      return scheduler->ready(m_deferredTicks);
+  }
+  return true;
 }
 
 template <typename Base>
 template <typename Ret, typename... V>
 Maybe<Ret> LuaUpdatableComponent<Base>::update(V&&... args) {
-  if (!m_updatePeriodic.tick())
+  if (!updateReady()) {
+    if (m_updatePeriodic.ready()) {
+      // Due, but put off by the scheduler, stays due until it runs.
+      ++m_deferredTicks;
+      LuaUpdateScheduler::current()->defer();
+    } else {
+      m_updatePeriodic.tick();
+    }
     return {};
+  }
 
+  m_updatePeriodic.tick();
+  auto resetDeferral = finally([this]() { m_deferredTicks = 0; });
+  if (auto scheduler = LuaUpdateScheduler::current())
+    return scheduler->update([&]() { return Base::template invoke<Ret>("update", std::forward<V>(args)...); });
   return Base::template invoke<Ret>("update", std::forward<V>(args)...);
 }
 
@@ -52,10 +52,12 @@ void LuaRoot::restart() {
   m_luaEngine->setInstructionLimit(root.configuration()->get("scriptInstructionLimit").toUInt());
   m_luaEngine->setProfilingEnabled(root.configuration()->get("scriptProfilingEnabled").toBool());
   m_luaEngine->setInstructionMeasureInterval(root.configuration()->get("scriptInstructionMeasureInterval").toUInt());
+  m_luaEngine->setJsonProxyMinimumSize(root.configuration()->get("scriptJsonProxyMinimumSize").optUInt());
 }
 
 void LuaRoot::shutdown() {
   clearScriptCache();
+  m_scriptCache->releasePrototypes();
 
   if (!m_luaEngine)
     return;
@@ -183,7 +185,15 @@ LuaEngine& LuaRoot::luaEngine() const {
 void LuaRoot::ScriptCache::loadScript(LuaEngine& engine, String const& assetPath) {
   auto assets = Root::singleton().assets();
   RecursiveMutexLocker locker(mutex);
-  scripts[assetPath] = engine.compile(*assets->bytes(assetPath), assetPath);
+  auto source = assets->bytes(assetPath);
+  if (LuaEngine::isPrecompiled(*source)) {
+    scripts[assetPath] = engine.compile(*source, assetPath);
+    precompiledScripts.add(assetPath);
+  } else {
+    scripts[assetPath] = engine.compilePrototype(*source, assetPath);
+    precompiledScripts.remove(assetPath);
+  }
+  prototypes.remove(assetPath);
 }
 
 bool LuaRoot::ScriptCache::scriptLoaded(String const& assetPath) const {
@@ -194,19 +204,47 @@ bool LuaRoot::ScriptCache::scriptLoaded(String const& assetPath) const {
 void LuaRoot::ScriptCache::unloadScript(String const& assetPath) {
   RecursiveMutexLocker locker(mutex);
   scripts.remove(assetPath);
+  precompiledScripts.remove(assetPath);
+  prototypes.remove(assetPath);
 }
 
 void LuaRoot::ScriptCache::clear() {
   RecursiveMutexLocker locker(mutex);
   scripts.clear();
+  precompiledScripts.clear();
+  prototypesCleared = true;
+}
+
+void LuaRoot::ScriptCache::releasePrototypes() {
+  RecursiveMutexLocker locker(mutex);
+  prototypes.clear();
+  prototypesCleared = false;
 }
 
 void LuaRoot::ScriptCache::loadContextScript(LuaContext& context, String const& assetPath) {
   ZoneScoped;
   RecursiveMutexLocker locker(mutex);
-  if (!scriptLoaded(assetPath))
-    loadScript(context.engine(), assetPath);
-  context.load(scripts.get(assetPath));
+  if (prototypesCleared)
+    releasePrototypes();
+
+  auto prototype = prototypes.ptr(assetPath);
+  if (!prototype) {
+    if (!scriptLoaded(assetPath))
+      loadScript(context.engine(), assetPath);
+    if (precompiledScripts.contains(assetPath)) {
+      ByteArray script = scripts.get(assetPath);
+      locker.unlock();
+      context.load(script);
+      return;
+    }
+    prototype = &prototypes.add(assetPath, context.engine().loadPrototype(scripts.get(assetPath), assetPath));
+  }
+
+  // Copied so that a nested require unloading the script cannot release it
+  // while it is still running.
+  LuaFunction function = *prototype;
+  locker.unlock();
+  context.load(function);
 }
 
 size_t LuaRoot::ScriptCache::memoryUsage() const {
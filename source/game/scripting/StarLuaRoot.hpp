@@ -46,18 +46,30 @@ public:
 
   LuaEngine& luaEngine() const;
 private:
+  // Scripts are compiled into prototypes once, and loaded into the engine the
+  // first time a context runs them, so that every context after that can run
+  // them without loading them again.  Precompiled scripts cannot be made into
+  // prototypes, and are kept as bytecode that is loaded by every context.
   class ScriptCache {
   public:
     void loadScript(LuaEngine& engine, String const& assetPath);
     bool scriptLoaded(String const& assetPath) const;
     void unloadScript(String const& assetPath);
+    // May be called from any thread, the prototypes loaded into the engine
+    // are released on its next use of the cache.
     void clear();
+    // Releases the prototypes loaded into the engine right away, must be
+    // called before the engine is destroyed.
+    void releasePrototypes();
     void loadContextScript(LuaContext& context, String const& assetPath);
     size_t memoryUsage() const;
 
   private:
     mutable RecursiveMutex mutex;
     StringMap<ByteArray> scripts;
+    StringSet precompiledScripts;
+    StringMap<LuaFunction> prototypes;
+    bool prototypesCleared = false;
   };
 
   LuaEnginePtr m_luaEngine;
@@ -0,0 +1,72 @@
+#include "StarLuaUpdateScheduler.hpp"
+#include "StarMathCommon.hpp"
+
+namespace Star {
+
+static thread_local LuaUpdateScheduler* s_currentScheduler = nullptr;
+static thread_local bool s_currentPriority = false;
+
+LuaUpdateScheduler* LuaUpdateScheduler::current() {
+  return s_currentScheduler;
+}
+
+bool LuaUpdateScheduler::currentPriority() {
+  return s_currentPriority;
+}
+
+void LuaUpdateScheduler::setCurrent(LuaUpdateScheduler* scheduler, bool priority) {
+  s_currentScheduler = scheduler;
+  s_currentPriority = priority;
+}
+
+LuaUpdateScheduler::LuaUpdateScheduler(Json const& config) {
+  m_budget = (int64_t)(config.getDouble("budget", 8.0) * 1000.0);
+  m_maxDeferredTicks = config.getUInt("maxDeferredTicks", 10);
+  m_maxSlowdown = clamp<unsigned>(config.getUInt("maxSlowdown", 4), 1, m_maxDeferredTicks + 1);
+
+  m_slowdown = 1;
+  m_updateDepth = 0;
+  m_updateStart = 0;
+
+  m_spent = 0;
+  m_updates = 0;
+  m_deferred = 0;
+
+  m_lastSpent = 0;
+  m_lastUpdates = 0;
+  m_lastDeferred = 0;
+}
+
+bool LuaUpdateScheduler::ready(unsigned deferredTicks) const {
+  if (s_currentPriority || deferredTicks >= m_maxDeferredTicks)
+    return true;
+  return m_spent < m_budget && deferredTicks + 1 >= m_slowdown;
+}
+
+void LuaUpdateScheduler::defer() {
+  ++m_deferred;
+}
+
+void LuaUpdateScheduler::tick() {
+  if (m_spent > m_budget) {
+    m_slowdown = min(m_slowdown + 1, m_maxSlowdown);
+  } else if (m_slowdown > 1 && m_spent * m_slowdown < m_budget * (m_slowdown - 1)) {
+    // The same scripts would still fit in the budget updating a tick sooner.
+    --m_slowdown;
+  }
+
+  m_lastSpent = m_spent;
+  m_lastUpdates = m_updates;
+  m_lastDeferred = m_deferred;
+
+  m_spent = 0;
+  m_updates = 0;
+  m_deferred = 0;
+}
+
+String LuaUpdateScheduler::statistics() const {
+  return strf("{} updates, {} deferred, {:4.2f}ms / {:4.2f}ms, slowdown {}x",
+      m_lastUpdates, m_lastDeferred, m_lastSpent / 1000.0, m_budget / 1000.0, m_slowdown);
+}
+
+}
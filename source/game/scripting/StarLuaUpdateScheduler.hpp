@@ -0,0 +1,93 @@
+#ifndef STAR_LUA_UPDATE_SCHEDULER_HPP
+#define STAR_LUA_UPDATE_SCHEDULER_HPP
+
+#include "StarAlgorithm.hpp"
+#include "StarJson.hpp"
+#include "StarTime.hpp"
+
+namespace Star {
+
+STAR_CLASS(LuaUpdateScheduler);
+
+// Keeps the script updates of a world within a time budget per tick.  Once
+// the budget of a tick is spent, deferrable script updates that come due are
+// put off to a later tick.  While the world stays over budget, every
+// deferrable script is also slowed down to one update every few ticks, so
+// that the budget is shared evenly instead of going to whichever scripts
+// happen to update first each tick.  Updates made with priority (scripts of
+// entities near players) are never deferred but still count against the
+// budget, and no update is put off more than a configured number of ticks in
+// a row.
+//
+// Meant for single threaded access from the world update thread.
+class LuaUpdateScheduler {
+public:
+  // The scheduler deciding script updates made on this thread, if any.
+  static LuaUpdateScheduler* current();
+  // Whether script updates made on this thread are currently priority ones.
+  static bool currentPriority();
+  // Sets the scheduler for script updates made on this thread, pass nullptr
+  // to stop scheduling.
+  static void setCurrent(LuaUpdateScheduler* scheduler, bool priority = false);
+
+  // Reads "budget" (milliseconds per tick), "maxDeferredTicks" and
+  // "maxSlowdown" from the given config.
+  explicit LuaUpdateScheduler(Json const& config);
+
+  // True if a deferrable script update that is due, and has already been put
+  // off for the given number of ticks, should run now.  Gives the same answer
+  // until the next update is made through this scheduler.
+  bool ready(unsigned deferredTicks) const;
+
+  // Calls the given script update, counting the time spent in it against the
+  // budget.  Updates nested inside of another one are only counted once.
+  template <typename Function>
+  decltype(auto) update(Function&& function);
+
+  // Records that a due update was put off to a later tick.
+  void defer();
+
+  // Finishes the current tick, and speeds up or slows down deferrable scripts
+  // depending on how much of the budget it used.
+  void tick();
+
+  // Summary of the last finished tick.
+  String statistics() const;
+
+private:
+  int64_t m_budget;
+  unsigned m_maxDeferredTicks;
+  unsigned m_maxSlowdown;
+
+  // Deferrable scripts only update once they have been put off for
+  // m_slowdown - 1 ticks.
+  unsigned m_slowdown;
+  unsigned m_updateDepth;
+  int64_t m_updateStart;
+
+  int64_t m_spent;
+  unsigned m_updates;
+  unsigned m_deferred;
+
+  int64_t m_lastSpent;
+  unsigned m_lastUpdates;
+  unsigned m_lastDeferred;
+};
+
+template <typename Function>
+decltype(auto) LuaUpdateScheduler::update(Function&& function) {
+  if (m_updateDepth++ == 0) {
+    m_updateStart = Time::monotonicMicroseconds();
+    ++m_updates;
+  }
+
+  auto finishUpdate = finally([this]() {
+    if (--m_updateDepth == 0)
+      m_spent += Time::monotonicMicroseconds() - m_updateStart;
+  });
+  return function();
+}
+
+}
+
+#endif
@@ -12,14 +12,37 @@ CacheSelector::CacheSelector(
   uint64_t seedBias = sourceConfig.getUInt("seedBias", 0);
   TerrainSelectorParameters sourceParameters = parameters;
   sourceParameters.seed += seedBias;
-  m_source = database->createSelectorType(type, sourceConfig, sourceParameters);
+  m_source = database->createSelectorType(sourceType, sourceConfig, sourceParameters);
 
-  m_cache.setMaxSize(config.getUInt("lruCacheSize", 20000));
+  // The configured size is in tiles.
+  m_cache.setMaxSize(max<size_t>(config.getUInt("lruCacheSize", 20000) / square(ChunkSize), 1));
 }
 
 float CacheSelector::get(int x, int y) const {
-  return m_cache.get(Vec2I(x, y), [this](Vec2I const& key) {
-      return m_source->get(key[0], key[1]);
+  Vec2I chunkPosition(x - pmod(x, ChunkSize), y - pmod(y, ChunkSize));
+  return chunk(chunkPosition)[(y - chunkPosition[1]) * ChunkSize + (x - chunkPosition[0])];
+}
+
+void CacheSelector::getRegion(RectI const& region, float* out) const {
+  int width = region.width();
+  for (int cy = region.yMin() - pmod(region.yMin(), ChunkSize); cy < region.yMax(); cy += ChunkSize) {
+    for (int cx = region.xMin() - pmod(region.xMin(), ChunkSize); cx < region.xMax(); cx += ChunkSize) {
+      auto const& values = chunk(Vec2I(cx, cy));
+      int xMin = max(cx, region.xMin());
+      int xMax = min(cx + ChunkSize, region.xMax());
+      int yMax = min(cy + ChunkSize, region.yMax());
+      for (int y = max(cy, region.yMin()); y < yMax; ++y)
+        std::copy(values.ptr() + (y - cy) * ChunkSize + (xMin - cx), values.ptr() + (y - cy) * ChunkSize + (xMax - cx),
+            out + (y - region.yMin()) * width + (xMin - region.xMin()));
+    }
+  }
+}
+
+List<float> const& CacheSelector::chunk(Vec2I const& chunkPosition) const {
+  return m_cache.get(chunkPosition, [this](Vec2I const& chunkPosition) {
+      List<float> values(square(ChunkSize));
+      m_source->getRegion(RectI::withSize(chunkPosition, Vec2I::filled(ChunkSize)), values.ptr());
+      return values;
     });
 }
 
@@ -12,10 +12,17 @@ struct CacheSelector : TerrainSelector {
 
   CacheSelector(Json const& config, TerrainSelectorParameters const& parameters, TerrainDatabase const* database);
 
+  // Values are cached in square chunks of this size, computed with a single
+  // getRegion call on the source, so that overlapping requests share them.
+  static int const ChunkSize = 16;
+
   float get(int x, int y) const override;
+  void getRegion(RectI const& region, float* out) const override;
+
+  List<float> const& chunk(Vec2I const& chunkPosition) const;
 
   TerrainSelectorConstPtr m_source;
-  mutable HashLruCache<Vec2I, float> m_cache;
+  mutable HashLruCache<Vec2I, List<float>> m_cache;
 };
 
 }
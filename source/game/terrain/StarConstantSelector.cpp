@@ -13,4 +13,8 @@ float ConstantSelector::get(int, int) const {
   return m_value;
 }
 
+void ConstantSelector::getRegion(RectI const& region, float* out) const {
+  std::fill_n(out, region.volume(), m_value);
+}
+
 }
@@ -53,6 +53,42 @@ float DisplacementSelector::get(int x, int y) const {
   return m_source->get(x_, y_);
 }
 
+void DisplacementSelector::getRegion(RectI const& region, float* out) const {
+  size_t count = region.volume();
+  List<float> xs(count);
+  List<float> ys(count);
+  List<float> xDisplacement(count);
+  List<float> yDisplacement(count);
+
+  size_t i = 0;
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x, ++i) {
+      xs[i] = x * xXInfluence;
+      ys[i] = y * xYInfluence;
+    }
+  }
+  xDisplacementFunction.get(xs.ptr(), ys.ptr(), count, xDisplacement.ptr());
+
+  i = 0;
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x, ++i) {
+      xs[i] = x * yXInfluence;
+      ys[i] = y * yYInfluence;
+    }
+  }
+  yDisplacementFunction.get(xs.ptr(), ys.ptr(), count, yDisplacement.ptr());
+
+  // Displaced points are still mostly close together, so the source can
+  // usually sample them as one region.
+  List<Vec2I> points(count);
+  i = 0;
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x, ++i)
+      points[i] = Vec2I((int)(x + xDisplacement[i]), (int)(y + clampY(yDisplacement[i])));
+  }
+  m_source->getPoints(points.ptr(), count, out);
+}
+
 float DisplacementSelector::clampY(float v) const {
   if (!yClamp)
     return v;
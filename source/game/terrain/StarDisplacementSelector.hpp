@@ -14,6 +14,7 @@ struct DisplacementSelector : TerrainSelector {
       Json const& config, TerrainSelectorParameters const& parameters, TerrainDatabase const* database);
 
   float get(int x, int y) const override;
+  void getRegion(RectI const& region, float* out) const override;
 
   PerlinF xDisplacementFunction;
   PerlinF yDisplacementFunction;
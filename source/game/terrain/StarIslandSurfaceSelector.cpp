@@ -47,4 +47,19 @@ float IslandSurfaceSelector::get(int x, int y) const {
   return (col.topLevel - col.bottomLevel) / 2 - abs((col.topLevel + col.bottomLevel) / 2 - y);
 }
 
+void IslandSurfaceSelector::getRegion(RectI const& region, float* out) const {
+  int width = region.width();
+  List<IslandColumn> columns(width);
+  for (int i = 0; i < width; ++i) {
+    columns[i] = columnCache.get(region.xMin() + i, [=](int x) {
+        return IslandSurfaceSelector::generateColumn(x);
+      });
+  }
+
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (auto const& col : columns)
+      *out++ = (col.topLevel - col.bottomLevel) / 2 - abs((col.topLevel + col.bottomLevel) / 2 - y);
+  }
+}
+
 }
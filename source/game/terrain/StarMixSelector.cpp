@@ -26,4 +26,41 @@ float MixSelector::get(int x, int y) const {
   return lerp(f * 0.5f + 0.5f, m_aSource->get(x, y), m_bSource->get(x, y));
 }
 
+void MixSelector::getRegion(RectI const& region, float* out) const {
+  size_t count = region.volume();
+  List<float> mix(count);
+  m_mixSource->getRegion(region, mix.ptr());
+
+  // Either source is skipped entirely if no tile in the region uses it.
+  bool needA = false;
+  bool needB = false;
+  for (auto& f : mix) {
+    f = clamp(f, -1.0f, 1.0f);
+    needA |= f != 1;
+    needB |= f != -1;
+  }
+
+  List<float> a;
+  if (needA) {
+    a.resize(count);
+    m_aSource->getRegion(region, a.ptr());
+  }
+
+  List<float> b;
+  if (needB) {
+    b.resize(count);
+    m_bSource->getRegion(region, b.ptr());
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    float f = mix[i];
+    if (f == -1)
+      out[i] = a[i];
+    else if (f == 1)
+      out[i] = b[i];
+    else
+      out[i] = lerp(f * 0.5f + 0.5f, a[i], b[i]);
+  }
+}
+
 }
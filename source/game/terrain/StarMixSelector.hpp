@@ -11,6 +11,7 @@ struct MixSelector : TerrainSelector {
   MixSelector(Json const& config, TerrainSelectorParameters const& parameters, TerrainDatabase const* database);
 
   float get(int x, int y) const override;
+  void getRegion(RectI const& region, float* out) const override;
 
   TerrainSelectorConstPtr m_mixSource;
   TerrainSelectorConstPtr m_aSource;
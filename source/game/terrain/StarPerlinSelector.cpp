@@ -27,4 +27,18 @@ float PerlinSelector::get(int x, int y) const {
   return function.get(x * xInfluence, y * yInfluence);
 }
 
+void PerlinSelector::getRegion(RectI const& region, float* out) const {
+  int width = region.width();
+  List<float> xs(width);
+  List<float> ys(width);
+  for (int i = 0; i < width; ++i)
+    xs[i] = (region.xMin() + i) * xInfluence;
+
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    std::fill(ys.begin(), ys.end(), y * yInfluence);
+    function.get(xs.ptr(), ys.ptr(), width, out);
+    out += width;
+  }
+}
+
 }
@@ -12,6 +12,7 @@ struct PerlinSelector : TerrainSelector {
   PerlinSelector(Json const& config, TerrainSelectorParameters const& parameters);
 
   float get(int x, int y) const override;
+  void getRegion(RectI const& region, float* out) const override;
 
   PerlinF function;
 
@@ -32,4 +32,44 @@ float RidgeBlocksSelector::get(int x, int y) const {
   }
 }
 
+void RidgeBlocksSelector::getRegion(RectI const& region, float* out) const {
+  size_t count = region.volume();
+  if (commonality <= 0.0f) {
+    std::fill_n(out, count, 0.0f);
+    return;
+  }
+
+  // Same steps as get(), each one done for the whole region at once.
+  List<float> xs(count);
+  List<float> ys(count);
+  List<float> noise(count);
+  size_t i = 0;
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x, ++i) {
+      xs[i] = x;
+      ys[i] = y;
+    }
+  }
+
+  noisePerlin.get(xs.ptr(), ys.ptr(), count, noise.ptr());
+  for (i = 0; i < count; ++i) {
+    int x = xs[i];
+    x += noise[i];
+    xs[i] = x;
+  }
+
+  noisePerlin.get(ys.ptr(), xs.ptr(), count, noise.ptr());
+  for (i = 0; i < count; ++i) {
+    int y = ys[i];
+    y += noise[i];
+    ys[i] = y;
+  }
+
+  List<float> ridge(count);
+  ridgePerlin1.get(xs.ptr(), ys.ptr(), count, out);
+  ridgePerlin2.get(xs.ptr(), ys.ptr(), count, ridge.ptr());
+  for (i = 0; i < count; ++i)
+    out[i] = (out[i] - ridge[i]) * commonality + bias;
+}
+
 }
@@ -12,6 +12,7 @@ struct RidgeBlocksSelector : TerrainSelector {
   RidgeBlocksSelector(Json const& config, TerrainSelectorParameters const& parameters);
 
   float get(int x, int y) const override;
+  void getRegion(RectI const& region, float* out) const override;
 
   float commonality;
 
@@ -24,4 +24,16 @@ float RotateSelector::get(int x, int y) const {
   return m_source->get(pos[0], pos[1]);
 }
 
+void RotateSelector::getRegion(RectI const& region, float* out) const {
+  List<Vec2I> points;
+  points.reserve(region.volume());
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x) {
+      auto pos = (Vec2F(x, y) - rotationCenter).rotate(rotation) + rotationCenter;
+      points.append(Vec2I((int)pos[0], (int)pos[1]));
+    }
+  }
+  m_source->getPoints(points.ptr(), points.size(), out);
+}
+
 }
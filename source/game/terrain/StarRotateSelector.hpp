@@ -12,6 +12,7 @@ struct RotateSelector : TerrainSelector {
   RotateSelector(Json const& config, TerrainSelectorParameters const& parameters, TerrainDatabase const* database);
 
   float get(int x, int y) const override;
+  void getRegion(RectI const& region, float* out) const override;
 
   float rotation;
   Vec2F rotationCenter;
@@ -154,4 +154,22 @@ float WormCaveSelector::get(int x, int y) const {
     }).get(x, y);
 }
 
+void WormCaveSelector::getRegion(RectI const& region, float* out) const {
+  int width = region.width();
+  for (int sy = region.yMin() - pmod(region.yMin(), m_sectorSize); sy < region.yMax(); sy += m_sectorSize) {
+    for (int sx = region.xMin() - pmod(region.xMin(), m_sectorSize); sx < region.xMax(); sx += m_sectorSize) {
+      auto& sector = m_cache.get(Vec2I(sx, sy), [=](Vec2I const& sector) {
+          return WormCaveSector(m_sectorSize, sector, config, parameters.seed, parameters.commonality);
+        });
+
+      int xMax = min(sx + m_sectorSize, region.xMax());
+      int yMax = min(sy + m_sectorSize, region.yMax());
+      for (int y = max(sy, region.yMin()); y < yMax; ++y) {
+        for (int x = max(sx, region.xMin()); x < xMax; ++x)
+          out[(y - region.yMin()) * width + (x - region.xMin())] = sector.get(x, y);
+      }
+    }
+  }
+}
+
 }
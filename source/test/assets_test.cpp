@@ -1,4 +1,8 @@
 #include "StarAssets.hpp"
+#include "StarAssetPatchCache.hpp"
+#include "StarFile.hpp"
+#include "StarPackedAssetSource.hpp"
+#include "StarThread.hpp"
 
 #include "gtest/gtest.h"
 
@@ -22,3 +26,157 @@ TEST(AssetsTest, All) {
   EXPECT_EQ(
       AssetPath::relativeTo("/foo/bar/baz:baf?whoa?there", "thing:sub?directive"), "/foo/bar/thing:sub?directive");
 }
+
+TEST(AssetsTest, PackedAssetSource) {
+  auto directory = File::temporaryDirectory();
+  auto removeDirectory = finally([&]() { File::removeDirectoryRecursive(directory); });
+
+  File::makeDirectory(File::relativeTo(directory, "assets"));
+  File::writeFile(String("{\"a\" : 1}"), File::relativeTo(directory, "assets/thing.config"));
+  File::writeFile(String("print('hi')"), File::relativeTo(directory, "assets/thing.lua"));
+  File::writeFile(String(""), File::relativeTo(directory, "assets/empty.config"));
+
+  DirectoryAssetSource directorySource(File::relativeTo(directory, "assets"));
+  String packedFile = File::relativeTo(directory, "assets.pak");
+  PackedAssetSource::build(directorySource, packedFile, {"config"});
+
+  PackedAssetSource packedSource(packedFile);
+  EXPECT_EQ(sorted(packedSource.assetPaths()), StringList({"/empty.config", "/thing.config", "/thing.lua"}));
+  EXPECT_EQ(packedSource.read("/thing.config"), ByteArray::fromCString("{\"a\" : 1}"));
+  EXPECT_EQ(packedSource.read("/empty.config"), ByteArray());
+  packedSource.prefetchExtension("config");
+
+  auto device = packedSource.open("/thing.lua");
+  EXPECT_EQ(device->size(), 11);
+  device->seek(6);
+  EXPECT_EQ(device->readBytes(4), ByteArray::fromCString("'hi'"));
+  EXPECT_THROW(packedSource.read("/missing.lua"), AssetSourceException);
+}
+
+TEST(AssetsTest, PatchCache) {
+  auto directory = File::temporaryDirectory();
+  auto removeDirectory = finally([&]() { File::removeDirectoryRecursive(directory); });
+  String cacheFile = File::relativeTo(directory, "assets.patchcache");
+  auto keepAll = [](String const&) { return true; };
+
+  {
+    AssetPatchCache cache(cacheFile);
+    EXPECT_FALSE(cache.get("/a.config", 1));
+    cache.set("/a.config", 1, JsonObject{{"a", 1}});
+    cache.set("/b.config", 2, JsonArray{1, 2, 3});
+    cache.set("/removed.config", 3, Json(true));
+    EXPECT_EQ(cache.get("/a.config", 1), Json(JsonObject{{"a", 1}}));
+    cache.save([](String const& path) { return path != "/removed.config"; });
+
+    // Entries are read back from the saved file.
+    EXPECT_EQ(cache.get("/b.config", 2), Json(JsonArray{1, 2, 3}));
+    EXPECT_FALSE(cache.get("/removed.config", 3));
+  }
+
+  {
+    AssetPatchCache cache(cacheFile);
+    EXPECT_EQ(cache.get("/a.config", 1), Json(JsonObject{{"a", 1}}));
+    EXPECT_FALSE(cache.get("/a.config", 2));
+    EXPECT_EQ(cache.get("/b.config", 2), Json(JsonArray{1, 2, 3}));
+    cache.set("/c.config", 4, Json("c"));
+    cache.save(keepAll);
+  }
+
+  {
+    AssetPatchCache cache(cacheFile);
+    EXPECT_EQ(cache.get("/c.config", 4), Json("c"));
+  }
+
+  File::writeFile(String("garbage"), cacheFile);
+  AssetPatchCache cache(cacheFile);
+  EXPECT_FALSE(cache.get("/a.config", 1));
+}
+
+TEST(AssetsTest, PatchCacheSkipsScriptedPatches) {
+  auto directory = File::temporaryDirectory();
+  auto removeDirectory = finally([&]() { File::removeDirectoryRecursive(directory); });
+
+  String base = File::relativeTo(directory, "base");
+  String mod = File::relativeTo(directory, "mod");
+  File::makeDirectory(base);
+  File::makeDirectory(mod);
+  File::writeFile(String("{\"a\" : 1}"), File::relativeTo(base, "thing.config"));
+  File::writeFile(String("{\"v\" : 1}"), File::relativeTo(base, "dep.config"));
+  File::writeFile(String("function patch(json, path) json.v = assets.json(\"/dep.config:v\") return json end"),
+      File::relativeTo(mod, "thing.config.patch.lua"));
+
+  Assets::Settings settings;
+  settings.patchCacheFile = File::relativeTo(directory, "assets.patchcache");
+
+  {
+    Assets assets(settings, {base, mod});
+    EXPECT_EQ(assets.json("/thing.config"), Json(JsonObject{{"a", 1}, {"v", 1}}));
+  }
+
+  // A same size edit to an asset the script reads leaves the digest and the
+  // patch itself unchanged, but must still be seen.
+  File::writeFile(String("{\"v\" : 2}"), File::relativeTo(base, "dep.config"));
+  Assets assets(settings, {base, mod});
+  EXPECT_EQ(assets.json("/thing.config"), Json(JsonObject{{"a", 1}, {"v", 2}}));
+}
+
+TEST(AssetsTest, PreloadPatchedJson) {
+  auto directory = File::temporaryDirectory();
+  auto removeDirectory = finally([&]() { File::removeDirectoryRecursive(directory); });
+
+  String base = File::relativeTo(directory, "base");
+  String mod = File::relativeTo(directory, "mod");
+  File::makeDirectory(base);
+  File::makeDirectory(mod);
+  File::writeFile(String("{\"a\" : 1}"), File::relativeTo(base, "thing.config"));
+  File::writeFile(String("{\"c\" : 3}"), File::relativeTo(base, "other.config"));
+  File::writeFile(String("[{\"op\" : \"add\", \"path\" : \"/b\", \"value\" : 2}]"), File::relativeTo(mod, "thing.config.patch"));
+
+  Assets::Settings settings;
+
+  Assets lazy(settings, {base, mod});
+  settings.preloadPatchedJson = true;
+  Assets preloaded(settings, {base, mod});
+
+  EXPECT_EQ(lazy.digest(), preloaded.digest());
+  EXPECT_EQ(lazy.json("/thing.config"), Json(JsonObject{{"a", 1}, {"b", 2}}));
+  EXPECT_EQ(preloaded.json("/thing.config"), Json(JsonObject{{"a", 1}, {"b", 2}}));
+  EXPECT_EQ(preloaded.json("/other.config:c"), Json(3));
+}
+
+TEST(AssetsTest, ConcurrentLoadAndCleanup) {
+  auto directory = File::temporaryDirectory();
+  auto removeDirectory = finally([&]() { File::removeDirectoryRecursive(directory); });
+
+  File::writeFile(String("{\"v\" : 1}"), File::relativeTo(directory, "transient.config"));
+  File::writeFile(String("{\"v\" : 1}"), File::relativeTo(directory, "persistent.config"));
+
+  Assets::Settings settings;
+  settings.assetTimeToLive = 0;
+  Assets assets(settings, {directory});
+
+  // Every thread hits the same loaded asset entries at once.
+  List<ThreadFunction<bool>> loaders;
+  for (size_t i = 0; i < 8; ++i) {
+    loaders.append(Thread::invoke("AssetsTest", [&assets]() {
+      bool consistent = true;
+      for (size_t j = 0; j < 200; ++j) {
+        consistent &= assets.json("/transient.config:v") == Json(1);
+        consistent &= assets.json("/persistent.config:v", true) == Json(1);
+      }
+      return consistent;
+    }));
+  }
+  for (auto& loader : loaders)
+    EXPECT_TRUE(loader.finish());
+
+  // Assets that are not persistent are reloaded from the source after cleanup,
+  // forced persistent ones keep their loaded value.
+  File::writeFile(String("{\"v\" : 2}"), File::relativeTo(directory, "transient.config"));
+  File::writeFile(String("{\"v\" : 2}"), File::relativeTo(directory, "persistent.config"));
+  Thread::sleep(10);
+  assets.cleanup();
+
+  EXPECT_EQ(assets.json("/transient.config:v"), Json(2));
+  EXPECT_EQ(assets.json("/persistent.config:v"), Json(1));
+}
@@ -0,0 +1,92 @@
+#include "StarByteChain.hpp"
+#include "StarTcp.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+static ByteArray sequentialBytes(size_t size, size_t start = 0) {
+  ByteArray bytes(size, 0);
+  for (size_t i = 0; i < size; ++i)
+    bytes[i] = (char)(start + i);
+  return bytes;
+}
+
+TEST(ByteChainTest, AppendAndTrim) {
+  ByteArray large = sequentialBytes(10000);
+  char const* largePtr = large.ptr();
+
+  ByteChain chain;
+  chain.append("ab", 2);
+  chain.append("cd", 2);
+  chain.append(std::move(large));
+  chain.append(ByteArray("ef", 2));
+
+  // Small pieces are joined together, large arrays are taken over as they are.
+  EXPECT_EQ(chain.size(), 10006u);
+  ASSERT_EQ(chain.slices().size(), 3u);
+  EXPECT_EQ(chain.slices()[0].size, 4u);
+  EXPECT_EQ(chain.slices()[1].ptr(), largePtr);
+
+  ByteArray expected("abcd", 4);
+  expected.append(sequentialBytes(10000));
+  expected.append("ef", 2);
+  EXPECT_EQ(chain.toByteArray(), expected);
+
+  chain.trimLeft(3);
+  EXPECT_EQ(chain.size(), 10003u);
+  EXPECT_EQ(chain.slices().size(), 3u);
+
+  chain.trimLeft(1001);
+  EXPECT_EQ(chain.slices().size(), 2u);
+  EXPECT_EQ(chain.slices()[0].ptr(), largePtr + 1000);
+  EXPECT_EQ(chain.toByteArray(), ByteArray(expected.ptr() + 1004, expected.size() - 1004));
+
+  chain.trimLeft(100000);
+  EXPECT_TRUE(chain.empty());
+  EXPECT_TRUE(chain.slices().empty());
+}
+
+TEST(ByteChainTest, SharedSlices) {
+  ByteChain first;
+  first.append("header", 6);
+
+  ByteChain second;
+  second.append(first);
+  // Shared storage is never appended to, so the two chains stay independent.
+  second.append("more", 4);
+  first.append("!", 1);
+
+  EXPECT_EQ(first.toByteArray(), ByteArray("header!", 7));
+  EXPECT_EQ(second.toByteArray(), ByteArray("headermore", 10));
+}
+
+TEST(ByteChainTest, SocketTransfer) {
+  uint16_t const TestPort = 55557;
+
+  auto listenSocket = TcpSocket::listen({HostAddress::localhost(), TestPort});
+  auto clientSocket = TcpSocket::connectTo({HostAddress::localhost(), TestPort});
+  auto serverSocket = listenSocket->accept();
+  ASSERT_TRUE(serverSocket);
+  clientSocket->setNonBlocking(true);
+  serverSocket->setNonBlocking(true);
+
+  ByteChain chain;
+  ByteArray expected;
+  for (size_t i = 0; i < 100; ++i) {
+    ByteArray bytes = sequentialBytes(i % 2 ? 1000 : 10, i);
+    expected.append(bytes);
+    chain.append(std::move(bytes));
+  }
+
+  ByteArray received;
+  for (size_t i = 0; i < 10000 && (!chain.empty() || received.size() < expected.size()); ++i) {
+    if (!chain.empty())
+      chain.trimLeft(clientSocket->send(chain));
+    serverSocket->receive(received, 4096);
+    Thread::yield();
+  }
+
+  EXPECT_TRUE(chain.empty());
+  EXPECT_EQ(received, expected);
+}
@@ -0,0 +1,190 @@
+#include "StarCellularLighting.hpp"
+#include "StarRandom.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+template <typename LightArray, typename MakeLight>
+static void fillLightArray(LightArray& lightArray, size_t width, size_t height, MakeLight makeLight) {
+  RandomSource random(1234);
+
+  lightArray.setParameters(3, 8.0f, 2.0f, 10.0f, 3.0f, 0.5f);
+  lightArray.begin(width, height);
+  for (size_t x = 0; x < width; ++x) {
+    for (size_t y = 0; y < height; ++y) {
+      bool obstacle = random.randf() < 0.4f;
+      float level = random.randf() < 0.05f ? random.randf() : 0.0f;
+      lightArray.setLight(x, y, makeLight(random, level));
+      lightArray.setObstacle(x, y, obstacle);
+    }
+  }
+
+  for (size_t i = 0; i < 20; ++i) {
+    Vec2F position(random.randf(0, width), random.randf(0, height));
+    lightArray.addSpreadLight({position, makeLight(random, 1.0f)});
+    lightArray.addPointLight({position + Vec2F(0.3f, 0.7f), makeLight(random, 1.5f), random.randf() < 0.5f ? 0.0f : 2.0f, random.randf(0, 6), 0.2f});
+  }
+}
+
+TEST(CellularLightArrayTest, ParallelMatchesSerial) {
+  size_t const width = 157;
+  size_t const height = 131;
+  WorkerPool pool("CellularLightArrayTest", 3);
+
+  auto makeColored = [](RandomSource& random, float level) {
+    return Vec3F(random.randf(), random.randf(), random.randf()) * level;
+  };
+
+  for (size_t tileSize : {2, 7, 32}) {
+    ColoredCellularLightArray serial;
+    fillLightArray(serial, width, height, makeColored);
+    serial.calculate(10, 10, width - 10, height - 10);
+
+    ColoredCellularLightArray parallel;
+    fillLightArray(parallel, width, height, makeColored);
+    parallel.setParallel(&pool, tileSize);
+    parallel.calculate(10, 10, width - 10, height - 10);
+
+    for (size_t x = 0; x < width; ++x) {
+      for (size_t y = 0; y < height; ++y)
+        ASSERT_EQ(serial.getLight(x, y), parallel.getLight(x, y)) << "tile size " << tileSize << " at " << x << ", " << y;
+    }
+  }
+
+  auto makeScalar = [](RandomSource& random, float level) {
+    return random.randf() * level;
+  };
+
+  ScalarCellularLightArray serial;
+  fillLightArray(serial, width, height, makeScalar);
+  serial.calculate(0, 0, width, height);
+
+  ScalarCellularLightArray parallel;
+  fillLightArray(parallel, width, height, makeScalar);
+  parallel.setParallel(&pool, 16);
+  parallel.calculate(0, 0, width, height);
+
+  for (size_t x = 0; x < width; ++x) {
+    for (size_t y = 0; y < height; ++y)
+      ASSERT_EQ(serial.getLight(x, y), parallel.getLight(x, y)) << x << ", " << y;
+  }
+}
+
+TEST(CellularLightArrayTest, Incremental) {
+  size_t const width = 157;
+  size_t const height = 131;
+  size_t const border = 10;
+
+  auto makeColored = [](RandomSource& random, float level) {
+    return Vec3F(random.randf(), random.randf(), random.randf()) * level;
+  };
+
+  // The world as a whole, some of which is copied into the light array.
+  ColoredCellularLightArray world;
+  fillLightArray(world, width + 20, height, makeColored);
+
+  auto setup = [&](ColoredCellularLightArray& lightArray, size_t offset) {
+    lightArray.begin(width, height);
+    for (size_t x = 0; x < width; ++x) {
+      for (size_t y = 0; y < height; ++y)
+        lightArray.cell(x, y) = world.cell(x + offset, y);
+    }
+    lightArray.addPointLight({Vec2F(60.5f - offset, 40.5f), Vec3F(1, 0.5f, 0.2f), 0.0f, 0.0f, 0.0f});
+  };
+
+  auto expectMatches = [&](ColoredCellularLightArray& incremental, size_t offset) {
+    ColoredCellularLightArray full;
+    full.setParameters(3, 8.0f, 2.0f, 10.0f, 3.0f, 0.5f);
+    setup(full, offset);
+    full.calculate(border, border, width - border, height - border);
+
+    for (size_t x = border; x < width - border; ++x) {
+      for (size_t y = border; y < height - border; ++y) {
+        Vec3F difference = incremental.getLight(x, y) - full.getLight(x, y);
+        ASSERT_LT(difference.magnitude(), 0.001f) << "at " << x << ", " << y;
+      }
+    }
+  };
+
+  ColoredCellularLightArray incremental;
+  incremental.setParameters(3, 8.0f, 2.0f, 10.0f, 3.0f, 0.5f);
+  setup(incremental, 0);
+  incremental.calculateIncremental(border, border, width - border, height - border, Vec2I(), {});
+  expectMatches(incremental, 0);
+
+  // Nothing has changed.
+  setup(incremental, 0);
+  incremental.calculateIncremental(border, border, width - border, height - border, Vec2I(), {});
+  expectMatches(incremental, 0);
+
+  // A cell changes and the view moves.
+  world.cell(30, 70).obstacle = !world.cell(30, 70).obstacle;
+  world.cell(30, 70).light = Vec3F(1, 1, 1);
+  setup(incremental, 3);
+  incremental.calculateIncremental(border, border, width - border, height - border, Vec2I(-3, 0), {});
+  expectMatches(incremental, 3);
+
+  // The point light moved along with the view, so it is in a new place.
+  setup(incremental, 5);
+  incremental.calculateIncremental(border, border, width - border, height - border, Vec2I(-2, 0),
+      {RectI::withSize(Vec2I(55, 40), Vec2I(3, 3)), RectI::withSize(Vec2I(57, 40), Vec2I(3, 3))});
+  expectMatches(incremental, 5);
+}
+
+TEST(CellularLightArrayTest, IntensityCache) {
+  CellularLightIntensityCalculator lighting;
+  lighting.setParameters(JsonObject{{"spreadPasses", 3}, {"spreadMaxAir", 8.0f}, {"spreadMaxObstacle", 2.0f},
+      {"pointMaxAir", 10.0f}, {"pointMaxObstacle", 3.0f}, {"pointObstacleBoost", 0.5f}});
+  lighting.setCacheParameters(JsonObject{{"enabled", true}, {"environmentTolerance", 0.01f}});
+
+  Vec2F lightPosition(52.5f, 40.5f);
+  bool obstacles = false;
+  Maybe<float> cached;
+  auto lightLevel = [&](Vec2F const& position, float environmentLight) {
+    lighting.begin(position);
+    lighting.addPointLight(lightPosition, 1.0f, 0.0f, 0.0f, 0.0f);
+    cached = lighting.cachedCalculate(environmentLight);
+    if (cached)
+      return *cached;
+
+    RectI region = lighting.calculationRegion();
+    for (int x = region.xMin(); x < region.xMax(); ++x) {
+      for (int y = region.yMin(); y < region.yMax(); ++y)
+        lighting.setCell({x, y}, {y > 45 ? environmentLight : 0.0f, obstacles && x == 51});
+    }
+    return lighting.calculate(environmentLight);
+  };
+
+  float level = lightLevel({50.2f, 40.7f}, 0.5f);
+  EXPECT_FALSE(cached);
+  EXPECT_GT(level, 0.0f);
+
+  // Anywhere between the same four cells is served from the cache.
+  EXPECT_EQ(lightLevel({50.2f, 40.7f}, 0.5f), level);
+  EXPECT_TRUE(cached);
+  EXPECT_NE(lightLevel({50.4f, 40.9f}, 0.5f), level);
+  EXPECT_TRUE(cached);
+  EXPECT_EQ(lightLevel({50.2f, 40.7f}, 0.505f), level);
+  EXPECT_TRUE(cached);
+
+  // Changes far away leave it alone, changes nearby or to the lights do not.
+  lighting.invalidate(RectI::withSize({200, 40}, {1, 1}));
+  lightLevel({50.2f, 40.7f}, 0.5f);
+  EXPECT_TRUE(cached);
+
+  obstacles = true;
+  lighting.invalidate(RectI::withSize({51, 40}, {1, 1}));
+  float blockedLevel = lightLevel({50.2f, 40.7f}, 0.5f);
+  EXPECT_FALSE(cached);
+  EXPECT_LT(blockedLevel, level);
+  EXPECT_EQ(lightLevel({50.2f, 40.7f}, 0.5f), blockedLevel);
+  EXPECT_TRUE(cached);
+
+  lightPosition = Vec2F(53.5f, 40.5f);
+  lightLevel({50.2f, 40.7f}, 0.5f);
+  EXPECT_FALSE(cached);
+
+  lightLevel({50.2f, 40.7f}, 0.8f);
+  EXPECT_FALSE(cached);
+}
@@ -0,0 +1,105 @@
+#include "StarCellularLiquid.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+// Two separate pools of water and a pool of lava pouring from a source into
+// one of them, all in a small wrapping world with scattered blocks.
+class TestLiquidWorld : public CellularLiquidWorld<uint8_t> {
+public:
+  static int const Width = 96;
+  static int const Height = 48;
+
+  TestLiquidWorld() {
+    RandomSource random(1234);
+    for (int x = 0; x < Width; ++x) {
+      for (int y = 0; y < Height; ++y) {
+        bool wall = x == 0 || x == Width / 2;
+        solid[x][y] = y == 0 || wall || random.randf() < 0.05f;
+        if (!solid[x][y] && y < 20)
+          flows[x][y] = {uint8_t(1), 1.0f, 0.0f};
+      }
+    }
+    solid[Width / 4][Height - 2] = false;
+  }
+
+  Vec2I uniqueLocation(Vec2I const& location) const override {
+    return {pmod(location[0], Width), location[1]};
+  }
+
+  CellularLiquidCell<uint8_t> cell(Vec2I const& location) const override {
+    if (location[1] < 0 || location[1] >= Height)
+      return CellularLiquidCollisionCell();
+    Vec2I p = uniqueLocation(location);
+    if (p == Vec2I(Width / 4, Height - 2))
+      return CellularLiquidSourceCell<uint8_t>{2, 1.0f};
+    if (solid[p[0]][p[1]])
+      return CellularLiquidCollisionCell();
+    return flows[p[0]][p[1]];
+  }
+
+  float drainLevel(Vec2I const& location) const override {
+    return location == Vec2I(Width * 3 / 4, 1) ? 0.5f : 0.0f;
+  }
+
+  void setFlow(Vec2I const& location, CellularLiquidFlowCell<uint8_t> const& flow) override {
+    flows[location[0]][location[1]] = flow;
+  }
+
+  void liquidInteraction(Vec2I const& a, uint8_t, Vec2I const& b, uint8_t) override {
+    solid[a[0]][a[1]] = true;
+    events.append(strf("interaction {} {}", a, b));
+  }
+
+  void liquidCollision(Vec2I const& pos, uint8_t liquid, Vec2I const& collisionPos) override {
+    events.append(strf("collision {} {} {}", pos, liquid, collisionPos));
+  }
+
+  bool solid[Width][Height];
+  CellularLiquidFlowCell<uint8_t> flows[Width][Height] = {};
+  List<String> events;
+};
+
+TEST(CellularLiquidTest, ParallelIndependentOfThreads) {
+  LiquidCellEngineParameters parameters{0.4f, 0.5f, 0.2f, 0.3f, 0.2f, 0.2f, 0.1f, 0.01f, 0.001f, 0.001f, 0.1f};
+
+  auto simulate = [&](WorkerPool& pool) {
+    auto world = make_shared<TestLiquidWorld>();
+    LiquidCellEngine<uint8_t> engine(parameters, world);
+    engine.setParallel(&pool, 0, 16);
+    engine.visitRegion(RectI(0, 0, TestLiquidWorld::Width, TestLiquidWorld::Height));
+    for (size_t i = 0; i < 100; ++i)
+      engine.update();
+    return world;
+  };
+
+  WorkerPool serialPool("CellularLiquidTest", 0);
+  WorkerPool parallelPool("CellularLiquidTest", 3);
+  auto serial = simulate(serialPool);
+  auto parallel = simulate(parallelPool);
+
+  EXPECT_FALSE(serial->events.empty());
+  EXPECT_EQ(serial->events, parallel->events);
+
+  float water = 0.0f;
+  float lava = 0.0f;
+  for (int x = 0; x < TestLiquidWorld::Width; ++x) {
+    for (int y = 0; y < TestLiquidWorld::Height; ++y) {
+      auto const& a = serial->flows[x][y];
+      auto const& b = parallel->flows[x][y];
+      ASSERT_EQ(a.liquid, b.liquid) << x << ", " << y;
+      ASSERT_EQ(a.level, b.level) << x << ", " << y;
+      ASSERT_EQ(a.pressure, b.pressure) << x << ", " << y;
+      ASSERT_EQ(serial->solid[x][y], parallel->solid[x][y]) << x << ", " << y;
+      if (a.liquid == uint8_t(1))
+        water += a.level;
+      else if (a.liquid == uint8_t(2))
+        lava += a.level;
+    }
+  }
+
+  // Lava has poured in from the source.
+  EXPECT_GT(water, 0.0f);
+  EXPECT_GT(lava, 0.0f);
+}
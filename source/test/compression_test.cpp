@@ -0,0 +1,100 @@
+#include "StarCompression.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+static ByteArray testData() {
+  ByteArray data;
+  for (size_t i = 0; i < 100000; ++i)
+    data.appendByte((char)(i % 251 < 120 ? i % 7 : i % 13));
+  return data;
+}
+
+TEST(CompressionTest, Zlib) {
+  ByteArray data = testData();
+  ByteArray compressed = compressData(data, CompressionSettings{CompressionCodec::Zlib, HighCompression, {}});
+  EXPECT_LT(compressed.size(), data.size());
+  EXPECT_EQ(uncompressData(compressed), data);
+  EXPECT_EQ(uncompressData(compressData(data)), data);
+
+  ByteArray uncompressed;
+  uncompressData(compressed.ptr(), compressed.size(), uncompressed);
+  EXPECT_EQ(uncompressed, data);
+}
+
+TEST(CompressionTest, Zstd) {
+  ByteArray data = testData();
+  // Falls back to zlib when zstd is unavailable, either way must round trip.
+  ByteArray compressed = compressData(data, CompressionSettings{CompressionCodec::Zstd, 3, {}});
+  EXPECT_LT(compressed.size(), data.size());
+  EXPECT_EQ(uncompressData(compressed), data);
+
+  if (!compressionCodecAvailable(CompressionCodec::Zstd))
+    return;
+
+  List<ByteArray> samples;
+  for (size_t i = 0; i < 200; ++i)
+    samples.append(ByteArray(data.ptr() + i * 400, 2000));
+  auto dictionary = CompressionDictionary::registerDictionary(CompressionDictionary::train(samples, 4096), 3);
+  EXPECT_EQ(CompressionDictionary::registeredDictionary(dictionary->id()), dictionary);
+
+  ByteArray sample(data.ptr() + 1000, 2000);
+  ByteArray withDictionary = compressData(sample, CompressionSettings{CompressionCodec::Zstd, 3, dictionary});
+  EXPECT_EQ(uncompressData(withDictionary), sample);
+
+  ByteArray truncated = compressed.sub(0, compressed.size() / 2);
+  EXPECT_THROW(uncompressData(truncated), IOException);
+}
+
+TEST(CompressionTest, Stream) {
+  ByteArray data = testData();
+  CompressionStream compressor;
+  DecompressionStream decompressor;
+
+  ByteArray received;
+  size_t compressedSize = 0;
+  for (size_t pos = 0; pos < data.size(); pos += 1000) {
+    ByteArray compressed = compressor.compress(ByteArray(data.ptr() + pos, 1000));
+    compressedSize += compressed.size();
+    // Everything compressed so far must be readable, however it is split up.
+    for (size_t i = 0; i < compressed.size(); i += 7)
+      decompressor.decompress(compressed.ptr() + i, min<size_t>(7, compressed.size() - i), received);
+    EXPECT_EQ(received, data.left(pos + 1000));
+  }
+  EXPECT_LT(compressedSize, data.size());
+
+  // Pieces compressed without flushing only have to be readable once flushed.
+  ByteArray compressed;
+  compressor.compress(data.ptr(), 10, compressed, false);
+  compressor.compress(data.ptr() + 10, 990, compressed, false);
+  compressor.compress(nullptr, 0, compressed, true);
+  received.clear();
+  decompressor.decompress(compressed.ptr(), compressed.size(), received);
+  EXPECT_EQ(received, data.left(1000));
+
+  ByteArray garbage(64, (char)0xff);
+  EXPECT_THROW(decompressor.decompress(garbage), IOException);
+}
+
+TEST(CompressionTest, StreamLimit) {
+  CompressionStream compressor;
+  ByteArray compressed = compressor.compress(ByteArray(1 << 20, 0));
+
+  // Highly compressed input is decompressed a bounded piece at a time, with
+  // the unused input given again until everything has been read.
+  DecompressionStream decompressor;
+  size_t decompressedSize = 0;
+  size_t used = 0;
+  do {
+    ByteArray out;
+    used += decompressor.decompress(compressed.ptr() + used, compressed.size() - used, out, 65536);
+    EXPECT_LT(out.size(), 2 * 65536);
+    EXPECT_EQ(out, ByteArray(out.size(), 0));
+    decompressedSize += out.size();
+    if (out.empty())
+      break;
+  } while (true);
+  EXPECT_EQ(used, compressed.size());
+  EXPECT_EQ(decompressedSize, 1 << 20);
+}
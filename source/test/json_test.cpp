@@ -1,4 +1,5 @@
 #include "StarJson.hpp"
+#include "StarJsonBuilder.hpp"
 #include "StarFile.hpp"
 #include "StarJsonPatch.hpp"
 #include "StarJsonPath.hpp"
@@ -119,6 +120,62 @@ TEST(JsonTest, JsonParsingEdge) {
   EXPECT_TRUE(isValidJson(" {} "));
 }
 
+TEST(JsonTest, Utf8Parser) {
+  // Parses through the UTF-32 JsonParser, returning the error message instead
+  // on failure.
+  auto parseUtf32 = [](String const& json, bool fragment) -> Json {
+    try {
+      return inputUtf32Json<String::const_iterator>(json.begin(), json.end(), fragment);
+    } catch (JsonParsingException const& e) {
+      return String(e.what());
+    }
+  };
+
+  auto parseUtf8 = [](String const& json, bool fragment) -> Json {
+    try {
+      return inputUtf8Json(json.utf8Ptr(), json.utf8Ptr() + json.utf8Size(), fragment);
+    } catch (JsonParsingException const& e) {
+      return String(e.what());
+    }
+  };
+
+  StringList documents = {
+    "{\"a\" : [1, -2, 3.5, -0.0, 1e3, 2.5E-3, 1., 123456789.123456789, 0.1, 9007199254740993.0], \"b\" : null}",
+    "[true, false, null, 9223372036854775807, -9223372036854775808, 1e-400, 1.7976931348623157e308]",
+    "\xEF\xBB\xBF  // leading comment\n{ /* block\n comment */ \"key with a long plain run\" : \"value\" }",
+    "{\"escapes\" : \"a long string before the escapes \\\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9\\ud83d\\ude00 and after\"}",
+    "{\"unicode\" : \"日本語 and then a long ASCII tail past sixteen bytes\", \"日本\" : \"é\"}",
+    "[\n  1,\n  2\n  3\n]",
+    "{\"a\" : 1,\n \"日本語\" : tru }",
+    "{\"a\" : 1, \"a\" : 2}",
+    "[99999999999999999999]",
+    "[1e]",
+    "[-x]",
+    "[\"unterminated",
+    "[\"bad \\q escape\"]",
+    "[1] extra",
+    "[1] /* unterminated",
+    "[1] /* trailing star *",
+    "[1] / bad comment",
+    "{\"a\" 1}",
+    "{\"a\" : 1",
+    "[1, 2",
+    "",
+    "5",
+    "\t\r\n    [                                            ]    \t\r\n",
+  };
+
+  for (auto const& document : documents) {
+    EXPECT_EQ(parseUtf8(document, false), parseUtf32(document, false)) << document;
+    EXPECT_EQ(parseUtf8(document, true), parseUtf32(document, true)) << document;
+  }
+
+  ByteArray bytes = ByteArray::fromCString("{\"a\" : [1, 2, {\"b\" : \"c\"}]}");
+  EXPECT_EQ(inputUtf8Json(bytes.begin(), bytes.end(), false), Json::parseJson("{\"a\" : [1, 2, {\"b\" : \"c\"}]}"));
+  EXPECT_EQ(Json::parse("2.5").toDouble(), 2.5);
+  EXPECT_EQ(Json::parse("-12").type(), Json::Type::Int);
+}
+
 TEST(JsonTest, Types) {
   Json v;
   EXPECT_EQ(v.type(), Json::Type::Null);
@@ -412,3 +412,84 @@ TEST(LuaJsonTest, IntFloat) {
   EXPECT_EQ(context.invokePath<String>("printNumber", 1.0), "1.0");
   EXPECT_EQ(context.invokePath<String>("printNumber", 1), "1");
 }
+
+TEST(LuaJsonTest, JsonProxy) {
+  auto engine = LuaEngine::create();
+  engine->setJsonProxyMinimumSize(3);
+  auto context = engine->createContext();
+
+  context.load(
+      R"SCRIPT(
+        function describe(config)
+          local keys = {}
+          for k, v in pairs(config) do
+            table.insert(keys, k)
+          end
+          table.sort(keys)
+          local list = {}
+          for i, v in ipairs(config.list) do
+            table.insert(list, v)
+          end
+          return {type(config), table.concat(keys, ","), #config.list, table.concat(list, ","), config.missing == nil,
+            config.small[2], config.nested.inner == config.nested.inner}
+        end
+
+        function modify(config)
+          config.name = "changed"
+          config.empty = nil
+          config.added = {1, 2}
+          config.list[5] = 5
+          config.list[2] = nil
+          config.nested.inner.value = 7
+          return config
+        end
+
+        function passThrough(config)
+          return config.nested
+        end
+
+        function readNested(config)
+          local value = config.nested.inner.value + config.list[1]
+          return config
+        end
+
+        function modifyNestedTable(config)
+          config.small[1] = "z"
+          return config
+        end
+      )SCRIPT");
+
+  JsonObject config = {
+    {"name", "config"},
+    {"empty", Json()},
+    {"list", JsonArray{1, 2, 3, 4}},
+    {"small", JsonArray{"a", "b"}},
+    {"nested", JsonObject{{"inner", JsonObject{{"value", 1}, {"other", 2}, {"third", 3}}}, {"b", 1}, {"c", 2}}}
+  };
+
+  Json description = context.invokePath<Json>("describe", config);
+  EXPECT_EQ(description, JsonArray({"userdata", "list,name,nested,small", 4, "1,2,3,4", true, "b", true}));
+
+  Json modified = context.invokePath<Json>("modify", config);
+  Json expected = JsonObject{
+    {"name", "changed"},
+    {"empty", Json()},
+    {"added", JsonArray{1, 2}},
+    {"list", JsonArray{1, Json(), 3, 4, 5}},
+    {"small", JsonArray{"a", "b"}},
+    {"nested", JsonObject{{"inner", JsonObject{{"value", 7}, {"other", 2}, {"third", 3}}}, {"b", 1}, {"c", 2}}}
+  };
+  EXPECT_EQ(modified, expected);
+
+  // Unmodified proxies hand back the original Json.
+  Json nested = config.get("nested");
+  EXPECT_TRUE(context.invokePath<Json>("passThrough", config).objectPtr() == nested.objectPtr());
+
+  // Reading nested containers does not count as modifying them, but writing
+  // into a nested table converted from the Json does.
+  Json original = config;
+  EXPECT_TRUE(context.invokePath<Json>("readNested", original).objectPtr() == original.objectPtr());
+  Json modifiedNested = context.invokePath<Json>("modifyNestedTable", original);
+  EXPECT_EQ(modifiedNested.query("small"), JsonArray({"z", "b"}));
+  EXPECT_EQ(modifiedNested.query("nested"), original.get("nested"));
+}
@@ -836,3 +836,82 @@ TEST(LuaTest, ProfilingTest) {
   EXPECT_TRUE(names.contains("function2"));
   EXPECT_TRUE(names.contains("function3"));
 }
+
+TEST(LuaTest, SampleProfilerTest) {
+  auto luaEngine = LuaEngine::create();
+  auto context = luaEngine->createContext();
+  context.set("wait", luaEngine->createFunction([]() { Thread::sleep(5); }));
+  context.load(R"SCRIPT(
+      function outer()
+        for i = 1, 4 do
+          wait()
+        end
+      end
+    )SCRIPT", "sampled");
+
+  LuaSampleProfiler profiler(1000);
+  context.invokePath("outer");
+  EXPECT_EQ(profiler.sampleCount(), 0u);
+
+  LuaSampleProfiler::setCurrent(&profiler);
+  auto clearProfiler = finally([]() { LuaSampleProfiler::setCurrent(nullptr); });
+  context.invokePath("outer");
+
+  // Each wait is long enough for several samples, all of them taken while
+  // the callback is on the stack.  Functions called directly from C++ have no
+  // name to give.
+  EXPECT_GE(profiler.sampleCount(), 16u);
+  for (auto const& line : profiler.foldedStacks().splitLines())
+    EXPECT_TRUE(line.beginsWith("<anonymous> ([string \"sampled\"]:2);[C] wait ")) << line;
+
+  auto scripts = profiler.scriptTotals();
+  ASSERT_EQ(scripts.size(), 1u);
+  EXPECT_EQ(scripts[0].first, "[string \"sampled\"]");
+  EXPECT_EQ(scripts[0].second, profiler.sampleCount());
+}
+
+TEST(LuaTest, PrototypeTest) {
+  auto luaEngine = LuaEngine::create();
+  auto prototype = luaEngine->loadPrototype(luaEngine->compilePrototype(ByteArray::fromCString(R"SCRIPT(
+      local count = 0
+      values = {}
+
+      function add(value)
+        count = count + 1
+        values[count] = value
+        return count
+      end
+    )SCRIPT"), "prototype"));
+
+  // Every context gets its own globals and top level locals.
+  auto context1 = luaEngine->createContext();
+  auto context2 = luaEngine->createContext();
+  context1.load(prototype);
+  context2.load(prototype);
+
+  EXPECT_EQ(context1.invokePath<int>("add", 1), 1);
+  EXPECT_EQ(context1.invokePath<int>("add", 2), 2);
+  EXPECT_EQ(context2.invokePath<int>("add", 3), 1);
+  EXPECT_EQ(context1.get<LuaTable>("values").get<int>(2), 2);
+  EXPECT_EQ(context2.get<LuaTable>("values").get<LuaValue>(2), LuaNil);
+  EXPECT_NE(context1.get<LuaFunction>("add"), context2.get<LuaFunction>("add"));
+
+  // Line numbers are the same as in the original source.
+  auto broken = luaEngine->loadPrototype(luaEngine->compilePrototype(ByteArray::fromCString("\n\nerror('broken')"), "broken"));
+  try {
+    luaEngine->createContext().load(broken);
+    FAIL();
+  } catch (LuaException const& e) {
+    EXPECT_TRUE(String(e.what()).contains("broken\"]:3:")) << e.what();
+  }
+
+  // Bytecode can only be loaded into each context on its own.
+  auto source = ByteArray::fromCString("value = 3");
+  auto bytecode = luaEngine->compile(source, "bytecode");
+  EXPECT_FALSE(LuaEngine::isPrecompiled(source));
+  EXPECT_TRUE(LuaEngine::isPrecompiled(bytecode));
+  EXPECT_THROW(luaEngine->compilePrototype(bytecode, "bytecode"), LuaException);
+  auto context = luaEngine->createContext();
+  context.load(bytecode);
+  EXPECT_EQ(context.get<int>("value"), 3);
+}
@@ -0,0 +1,43 @@
+#include "StarLuaUpdateScheduler.hpp"
+#include "StarThread.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(LuaUpdateSchedulerTest, Deferral) {
+  LuaUpdateScheduler scheduler(JsonObject{{"budget", 0.0}, {"maxDeferredTicks", 3}});
+
+  // With no budget at all, updates only run once they have waited long
+  // enough, or if they are priority updates.
+  EXPECT_FALSE(scheduler.ready(0));
+  EXPECT_FALSE(scheduler.ready(2));
+  EXPECT_TRUE(scheduler.ready(3));
+
+  LuaUpdateScheduler::setCurrent(&scheduler, true);
+  EXPECT_TRUE(scheduler.ready(0));
+  LuaUpdateScheduler::setCurrent(nullptr);
+  EXPECT_FALSE(scheduler.ready(0));
+}
+
+TEST(LuaUpdateSchedulerTest, Slowdown) {
+  LuaUpdateScheduler scheduler(JsonObject{{"budget", 1.0}, {"maxDeferredTicks", 10}, {"maxSlowdown", 2}});
+  EXPECT_TRUE(scheduler.ready(0));
+
+  EXPECT_EQ(scheduler.update([]() {
+    Thread::sleep(3);
+    return 42;
+  }), 42);
+  scheduler.defer();
+  EXPECT_FALSE(scheduler.ready(0));
+  scheduler.tick();
+  EXPECT_TRUE(scheduler.statistics().beginsWith("1 updates, 1 deferred"));
+
+  // Over budget last tick, so scripts now wait a tick between updates.
+  EXPECT_FALSE(scheduler.ready(0));
+  EXPECT_TRUE(scheduler.ready(1));
+
+  // Back to updating every tick once there is room in the budget again.
+  scheduler.tick();
+  EXPECT_TRUE(scheduler.ready(0));
+}
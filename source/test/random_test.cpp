@@ -1,4 +1,5 @@
 #include "StarRandom.hpp"
+#include "StarThread.hpp"
 
 #include "gtest/gtest.h"
 
@@ -155,6 +156,21 @@ TEST(RandTest, All) {
   EXPECT_EQ(rand.stochasticRound(0.1), 0);
 }
 
+TEST(RandTest, ThreadSource) {
+  RandomSource expected(27182818);
+  RandomSource source(27182818);
+  EXPECT_EQ(Random::setThreadSource(&source), nullptr);
+  for (size_t i = 0; i < 16; ++i)
+    EXPECT_EQ(Random::randu32(), expected.randu32());
+  EXPECT_EQ(Random::randInt(10, 1000), expected.randInt(10, 1000));
+
+  // Other threads keep using the shared source
+  Thread::invoke("RandTest", [&]() { Random::randu32(); }).finish();
+  EXPECT_EQ(source.randu32(), expected.randu32());
+
+  EXPECT_EQ(Random::setThreadSource(nullptr), &source);
+}
+
 TEST(StaticRandomTest, All) {
   EXPECT_EQ(staticRandomU64("test1", 999, "test2"), 17057684957748924255u);
   EXPECT_EQ(staticRandomU64("test1", 1000, "test2"), 17136762056491983648u);
@@ -0,0 +1,73 @@
+#include "StarSocketPoller.hpp"
+#include "StarTcp.hpp"
+#include "StarTime.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+static uint16_t const PollerTestPort = 55556;
+
+static bool hasEvent(List<SocketPoller::Event> const& events, SocketPtr const& socket, bool readable) {
+  for (auto const& event : events) {
+    if (event.socket == socket && (!readable || event.readable))
+      return true;
+  }
+  return false;
+}
+
+TEST(SocketPollerTest, Events) {
+  SocketPoller poller;
+
+  auto listenSocket = TcpSocket::listen({HostAddress::localhost(), PollerTestPort});
+  listenSocket->setNonBlocking(true);
+  poller.add(listenSocket);
+  EXPECT_TRUE(poller.contains(listenSocket));
+
+  auto clientSocket = TcpSocket::connectTo({HostAddress::localhost(), PollerTestPort});
+  EXPECT_TRUE(hasEvent(poller.wait(5000), listenSocket, true));
+
+  auto serverSocket = listenSocket->accept();
+  ASSERT_TRUE(serverSocket);
+  serverSocket->setNonBlocking(true);
+  poller.add(serverSocket);
+  // Newly added sockets report that they are writable.
+  poller.wait(0);
+
+  clientSocket->send("hello", 5);
+  EXPECT_TRUE(hasEvent(poller.wait(5000), serverSocket, true));
+
+  char buffer[16];
+  size_t received = 0;
+  while (size_t amount = serverSocket->receive(buffer + received, sizeof(buffer) - received))
+    received += amount;
+  EXPECT_EQ(String(buffer, received), "hello");
+
+  // Nothing new has happened since the socket was drained.
+  EXPECT_FALSE(hasEvent(poller.wait(0), serverSocket, false));
+
+  poller.remove(serverSocket);
+  EXPECT_FALSE(poller.contains(serverSocket));
+  clientSocket->send("again", 5);
+  EXPECT_FALSE(hasEvent(poller.wait(100), serverSocket, false));
+}
+
+TEST(SocketPollerTest, Wake) {
+  SocketPoller poller;
+
+  auto waker = Thread::invoke("SocketPollerTest::wake", [&poller]() {
+      Thread::sleep(50);
+      poller.wake();
+    });
+
+  int64_t start = Time::monotonicMilliseconds();
+  EXPECT_TRUE(poller.wait(10000).empty());
+  EXPECT_LT(Time::monotonicMilliseconds() - start, 5000);
+  waker.finish();
+
+  // A wake before the wait returns from it straight away.
+  poller.wake();
+  start = Time::monotonicMilliseconds();
+  poller.wait(10000);
+  EXPECT_LT(Time::monotonicMilliseconds() - start, 5000);
+}
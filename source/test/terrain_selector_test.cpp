@@ -0,0 +1,60 @@
+#include "StarRoot.hpp"
+#include "StarTerrainDatabase.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+static void checkRegion(TerrainSelector const& selector, RectI const& region) {
+  List<float> values(region.volume());
+  selector.getRegion(region, values.ptr());
+
+  size_t i = 0;
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x)
+      ASSERT_EQ(values[i++], selector.get(x, y)) << selector.type << " at " << x << ", " << y;
+  }
+
+  List<Vec2I> points;
+  for (int i = 0; i < 64; ++i)
+    points.append(Vec2I(region.xMin() + i * 7 % region.width(), region.yMin() + i * 5 % region.height()));
+  List<float> pointValues(points.size());
+  selector.getPoints(points.ptr(), points.size(), pointValues.ptr());
+  for (size_t i = 0; i < points.size(); ++i)
+    ASSERT_EQ(pointValues[i], selector.get(points[i][0], points[i][1])) << selector.type << " at " << points[i];
+}
+
+TEST(TerrainSelectorTest, RegionMatchesPoints) {
+  auto terrainDatabase = Root::singleton().terrainDatabase();
+
+  TerrainSelectorParameters parameters;
+  parameters.worldWidth = 3000;
+  parameters.baseHeight = 500;
+  parameters.seed = 1234;
+
+  Json perlin = Json::parse(R"({"type" : "perlin", "function" : "perlin", "octaves" : 3, "freq" : 0.02, "amp" : 30, "xInfluence" : 1.5})");
+  Json ridged = Json::parse(R"({"type" : "perlin", "function" : "ridgedMulti", "octaves" : 2, "freq" : 0.05, "amp" : 10})");
+  Json displacement = JsonObject{
+    {"type", "displacement"},
+    {"xType", "perlin"}, {"xOctaves", 2}, {"xFreq", 0.1}, {"xAmp", 4},
+    {"yType", "billow"}, {"yOctaves", 2}, {"yFreq", 0.1}, {"yAmp", 4},
+    {"source", ridged}
+  };
+
+  List<Json> configs = {
+    perlin,
+    ridged,
+    displacement,
+    JsonObject{{"type", "mix"}, {"mixSource", perlin}, {"aSource", ridged}, {"bSource", displacement}},
+    JsonObject{{"type", "max"}, {"sources", JsonArray{perlin, ridged}}},
+    JsonObject{{"type", "minmax"}, {"sources", JsonArray{perlin, ridged}}},
+    JsonObject{{"type", "rotate"}, {"rotation", 0.3}, {"source", perlin}},
+    JsonObject{{"type", "cache"}, {"source", displacement}}
+  };
+
+  for (auto const& config : configs) {
+    auto selector = terrainDatabase->createSelectorType(config.getString("type"), config, parameters);
+    checkRegion(*selector, RectI::withSize(Vec2I(-20, 480), Vec2I(37, 29)));
+    checkRegion(*selector, RectI::withSize(Vec2I(2990, -3), Vec2I(5, 70)));
+  }
+}
@@ -97,3 +97,36 @@ TEST(TileSectorArrayTest, All) {
   EXPECT_TRUE(res3.size() == res3comp.size());
   res3.forEach([](Array2S const&, int elem) { EXPECT_TRUE(elem == 1); });
 }
+
+TEST(TileSectorArrayTest, ParallelColumns) {
+  typedef TileSectorArray<int, 32> TileArray;
+  TileArray tileSectorArray({200, 100}, -1);
+
+  for (size_t x = 0; x < 7; ++x) {
+    for (size_t y = 0; y < 4; ++y) {
+      if ((x + y) % 3 != 0)
+        tileSectorArray.loadSector({x, y}, make_unique<TileArray::Array>((int)(x * 4 + y)));
+    }
+  }
+
+  // Wraps around the x edge of the world and reaches past the top.
+  RectI region(-45, 10, 130, 120);
+  MultiArray<int, 2> serial(Vec2S(region.size()), 0);
+  MultiArray<int, 2> parallel(Vec2S(region.size()), 0);
+
+  auto record = [&](MultiArray<int, 2>& results) {
+    return [&results, &region](Vec2I const& pos, int* column, size_t size) {
+      EXPECT_LE(size, 32u);
+      for (size_t i = 0; i < size; ++i)
+        results(pos[0] - region.xMin(), pos[1] + i - region.yMin()) += column[i] + 1;
+    };
+  };
+
+  tileSectorArray.tileEvalColumns(region, record(serial));
+  tileSectorArray.tileEvalColumnsParallel(region, record(parallel));
+
+  serial.forEach([&](Array2S const& index, int count) { EXPECT_EQ(count, parallel(index)); });
+  EXPECT_EQ(serial(0, 0), 4 * 4 + 1);
+  EXPECT_EQ(serial(45, 0), 0);
+  EXPECT_EQ(serial(45, 100), 0);
+}
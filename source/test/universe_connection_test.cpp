@@ -1,5 +1,7 @@
 #include "StarUniverseConnection.hpp"
 #include "StarTcp.hpp"
+#include "StarCompression.hpp"
+#include "StarDataStreamDevices.hpp"
 
 #include "gtest/gtest.h"
 
@@ -7,6 +9,7 @@ using namespace Star;
 
 unsigned const PacketCount = 20;
 uint16_t const ServerPort = 55555;
+uint16_t const CompressionBombPort = 55558;
 
 unsigned const NumLocalASyncConnections = 5;
 unsigned const NumRemoteASyncConnections = 5;
@@ -150,3 +153,39 @@ TEST(UniverseConnections, All) {
 
   server.removeAllConnections();
 }
+
+TEST(UniverseConnections, StreamCompressionBomb) {
+  TcpServer tcpServer(HostAddressWithPort(HostAddress::localhost(), CompressionBombPort));
+  auto clientSocket = TcpSocket::connectTo({HostAddress::localhost(), CompressionBombPort});
+  auto serverSocket = tcpServer.accept(SyncWaitMillis);
+  ASSERT_TRUE(serverSocket);
+  serverSocket->setNonBlocking(true);
+  auto packetSocket = TcpPacketSocket::open(std::move(serverSocket));
+  packetSocket->setStreamCompression(true);
+
+  // A packet header followed by far more zeroes than a packet may hold, which
+  // the stream compresses down to about a thousandth of its size.
+  CompressionStream compressor;
+  DataStreamBuffer header;
+  header.write(PacketType::ProtocolRequest);
+  header.writeVlqI(1 << 30);
+  ByteArray zeroes(1 << 20, 0);
+  ByteArray compressed;
+  compressor.compress(header.ptr(), header.size(), compressed, false);
+  for (size_t i = 0; i < 128; ++i)
+    compressor.compress(zeroes.ptr(), zeroes.size(), compressed, false);
+  compressor.compress(nullptr, 0, compressed, true);
+  for (size_t sent = 0; sent < compressed.size();)
+    sent += clientSocket->send(compressed.ptr() + sent, compressed.size() - sent);
+
+  // Decompression stops well short of the whole bomb, and the socket is closed
+  // once the oversized packet is seen.
+  auto timer = Timer::withMilliseconds(SyncWaitMillis);
+  while (!packetSocket->receivedDataPending() && !timer.timeUp()) {
+    packetSocket->readData();
+    Thread::sleep(1);
+  }
+  EXPECT_TRUE(packetSocket->receivedDataPending());
+  EXPECT_TRUE(packetSocket->receivePackets().empty());
+  EXPECT_FALSE(packetSocket->isOpen());
+}
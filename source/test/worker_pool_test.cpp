@@ -32,3 +32,45 @@ TEST(WorkerPoolTest, All) {
 
   EXPECT_EQ(counter, 100);
 }
+
+TEST(WorkerPoolTest, ParallelFor) {
+  WorkerPool workerPool("WorkerPoolTest", 4);
+
+  for (size_t chunkSize : {1, 3, 64, 1000}) {
+    List<int> visits(257, 0);
+    List<pair<size_t, size_t>> chunks;
+    Mutex chunksMutex;
+    workerPool.parallelFor(visits.size(), chunkSize, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+        visits[i] += 1;
+      MutexLocker locker(chunksMutex);
+      chunks.append({begin, end});
+    });
+
+    EXPECT_EQ(visits, List<int>(257, 1));
+
+    // Chunks are always cut the same way, whichever thread runs them.
+    sort(chunks);
+    ASSERT_EQ(chunks.size(), (257 + chunkSize - 1) / chunkSize);
+    for (size_t i = 0; i < chunks.size(); ++i)
+      EXPECT_EQ(chunks[i], make_pair(i * chunkSize, min((i + 1) * chunkSize, visits.size())));
+  }
+
+  // Nested loops on the same pool do not wait on each other forever.
+  atomic<int> total(0);
+  workerPool.parallelFor(8, 1, [&](size_t, size_t) {
+    workerPool.parallelFor(100, 10, [&](size_t begin, size_t end) { total += end - begin; });
+  });
+  EXPECT_EQ(total, 800);
+
+  EXPECT_THROW(workerPool.parallelFor(100, 1, [&](size_t begin, size_t) {
+    if (begin == 50)
+      throw WorkerPoolException("failed");
+  }), WorkerPoolException);
+
+  // A pool with no threads runs everything on the calling thread.
+  WorkerPool stoppedPool("WorkerPoolTest");
+  size_t count = 0;
+  stoppedPool.parallelFor(10, 3, [&](size_t begin, size_t end) { count += end - begin; });
+  EXPECT_EQ(count, 10u);
+}
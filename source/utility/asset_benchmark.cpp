@@ -0,0 +1,92 @@
+#include "StarAssets.hpp"
+#include "StarFile.hpp"
+#include "StarImage.hpp"
+#include "StarTime.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarVersionOptionParser.hpp"
+
+using namespace Star;
+
+// Writes a directory of small JSON and image assets for the benchmark to read.
+static void writeAssets(String const& directory, size_t count) {
+  Image image = Image::filled({16, 16}, {255, 128, 0, 255});
+  for (size_t i = 0; i < count; ++i) {
+    File::writeFile(Json(JsonObject{{"index", i}, {"name", strf("asset{}", i)}}).repr(), File::relativeTo(directory, strf("asset{}.config", i)));
+    image.writePng(File::open(File::relativeTo(directory, strf("asset{}.png", i)), IOMode::Write | IOMode::Truncate));
+  }
+}
+
+int main(int argc, char** argv) {
+  try {
+    unsigned workerPoolSize = 2;
+    unsigned threads = 4;
+    size_t count = 256;
+    size_t reads = 200000;
+
+    VersionOptionParser optParse;
+    optParse.setSummary("Times lookups of already loaded assets from many threads at once, to measure contention on the assets cache");
+    optParse.addParameter("workerPoolSize", "count", OptionParser::Optional, strf("Asset worker threads, default {}", workerPoolSize));
+    optParse.addParameter("threads", "count", OptionParser::Optional, strf("Threads reading assets at once, default {}", threads));
+    optParse.addParameter("assets", "count", OptionParser::Optional, strf("JSON and image assets each read in turn, default {}", count));
+    optParse.addParameter("reads", "count", OptionParser::Optional, strf("Asset reads made by each thread, default {}", reads));
+
+    auto opts = optParse.commandParseOrDie(argc, argv);
+
+    if (auto option = opts.parameters.maybe("workerPoolSize"))
+      workerPoolSize = lexicalCast<unsigned>(option->first());
+    if (auto option = opts.parameters.maybe("threads"))
+      threads = max(lexicalCast<unsigned>(option->first()), 1u);
+    if (auto option = opts.parameters.maybe("assets"))
+      count = max(lexicalCast<size_t>(option->first()), (size_t)1);
+    if (auto option = opts.parameters.maybe("reads"))
+      reads = lexicalCast<size_t>(option->first());
+
+    auto directory = File::temporaryDirectory();
+    auto removeDirectory = finally([&]() { File::removeDirectoryRecursive(directory); });
+    writeAssets(directory, count);
+
+    Assets::Settings settings;
+    settings.workerPoolSize = workerPoolSize;
+    Assets assets(settings, {directory});
+
+    StringList jsonPaths;
+    StringList imagePaths;
+    for (size_t i = 0; i < count; ++i) {
+      jsonPaths.append(strf("/asset{}.config:name", i));
+      imagePaths.append(strf("/asset{}.png", i));
+      assets.json(jsonPaths.last());
+      assets.image(imagePaths.last());
+    }
+
+    coutf("{} reader threads, {} asset workers, {} assets, {} reads per thread\n", threads, workerPoolSize, count * 2, reads);
+
+    // Mimics a mix of world threads reading configs and the renderer polling
+    // for images.
+    auto readAssets = [&](size_t offset) {
+      for (size_t i = 0; i < reads; ++i) {
+        size_t index = (offset + i) % count;
+        if (i % 2 == 0)
+          assets.json(jsonPaths[index]);
+        else
+          assets.tryImage(imagePaths[index]);
+      }
+    };
+
+    double start = Time::monotonicTime();
+    List<ThreadFunction<void>> readers;
+    for (unsigned i = 1; i < threads; ++i)
+      readers.append(Thread::invoke("AssetBenchmark", readAssets, i * count / threads));
+    readAssets(0);
+    for (auto& reader : readers)
+      reader.finish();
+    double time = Time::monotonicTime() - start;
+
+    coutf("{:8.3f}ms total, {:8.1f}ns per read, {:.0f} reads per second\n", time * 1000,
+        time * 1e9 / max<size_t>(reads, 1), threads * reads / max(time, 1e-9));
+
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -0,0 +1,251 @@
+#include "StarCellularLiquid.hpp"
+#include "StarTime.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarVersionOptionParser.hpp"
+
+#ifdef STAR_USE_RPMALLOC
+#include "rpmalloc.h"
+#endif
+
+using namespace Star;
+
+enum class BenchmarkTile : uint8_t {
+  Empty,
+  Solid,
+  Source
+};
+
+uint8_t const Water = 1;
+uint8_t const Lava = 2;
+
+// A wrapping world of plain arrays, with a floor at the bottom.  Water and
+// lava turn into solid tiles wherever they meet, and drained cells lose
+// liquid, so both scenarios keep changing shape as they run.
+class BenchmarkWorld : public CellularLiquidWorld<uint8_t> {
+public:
+  BenchmarkWorld(int width, int height)
+    : m_width(width), m_height(height), m_tiles(width * height, BenchmarkTile::Empty), m_flows(width * height, {{}, 0.0f, 0.0f}),
+      m_interactions(0), m_collisions(0) {}
+
+  int width() const {
+    return m_width;
+  }
+
+  int height() const {
+    return m_height;
+  }
+
+  BenchmarkTile& tile(Vec2I const& p) {
+    return m_tiles[index(p)];
+  }
+
+  CellularLiquidFlowCell<uint8_t>& flow(Vec2I const& p) {
+    return m_flows[index(p)];
+  }
+
+  void addDrain(RectI const& region) {
+    m_drains.append(region);
+  }
+
+  Vec2I uniqueLocation(Vec2I const& location) const override {
+    return {pmod(location[0], m_width), location[1]};
+  }
+
+  CellularLiquidCell<uint8_t> cell(Vec2I const& location) const override {
+    if (location[1] < 0 || location[1] >= m_height)
+      return CellularLiquidCollisionCell();
+
+    size_t i = index(location);
+    if (m_tiles[i] == BenchmarkTile::Solid)
+      return CellularLiquidCollisionCell();
+    if (m_tiles[i] == BenchmarkTile::Source)
+      return CellularLiquidSourceCell<uint8_t>{m_flows[i].liquid.value(Lava), 1.0f};
+    return m_flows[i];
+  }
+
+  float drainLevel(Vec2I const& location) const override {
+    for (auto const& drain : m_drains) {
+      if (drain.contains(location))
+        return 0.5f;
+    }
+    return 0.0f;
+  }
+
+  void setFlow(Vec2I const& location, CellularLiquidFlowCell<uint8_t> const& flow) override {
+    m_flows[index(location)] = flow;
+  }
+
+  void liquidInteraction(Vec2I const& a, uint8_t, Vec2I const&, uint8_t) override {
+    m_tiles[index(a)] = BenchmarkTile::Solid;
+    m_flows[index(a)] = {{}, 0.0f, 0.0f};
+    ++m_interactions;
+  }
+
+  void liquidCollision(Vec2I const&, uint8_t, Vec2I const&) override {
+    ++m_collisions;
+  }
+
+  // Adds up the liquid in the world, so that runs with different engine
+  // implementations can be compared.
+  String summary() const {
+    double water = 0.0;
+    double lava = 0.0;
+    for (auto const& flow : m_flows) {
+      if (flow.liquid == Water)
+        water += flow.level;
+      else if (flow.liquid == Lava)
+        lava += flow.level;
+    }
+    return strf("water {:.4f}, lava {:.4f}, {} interactions, {} collisions", water, lava, m_interactions, m_collisions);
+  }
+
+private:
+  size_t index(Vec2I const& p) const {
+    return pmod(p[0], m_width) * m_height + p[1];
+  }
+
+  int m_width;
+  int m_height;
+  List<BenchmarkTile> m_tiles;
+  List<CellularLiquidFlowCell<uint8_t>> m_flows;
+  List<RectI> m_drains;
+  size_t m_interactions;
+  size_t m_collisions;
+};
+
+typedef shared_ptr<BenchmarkWorld> BenchmarkWorldPtr;
+
+// Roughly the stock liquid engine configuration.
+static LiquidCellEngineParameters engineParameters() {
+  LiquidCellEngineParameters parameters;
+  parameters.lateralMoveFactor = 0.4f;
+  parameters.spreadOverfillUpFactor = 0.5f;
+  parameters.spreadOverfillLateralFactor = 0.2f;
+  parameters.spreadOverfillDownFactor = 0.3f;
+  parameters.pressureEqualizeFactor = 0.2f;
+  parameters.pressureMoveFactor = 0.2f;
+  parameters.maximumPressureLevelImbalance = 0.1f;
+  parameters.minimumLivenPressureChange = 0.01f;
+  parameters.minimumLivenLevelChange = 0.001f;
+  parameters.minimumLiquidLevel = 0.001f;
+  parameters.interactTransformationLevel = 0.1f;
+  return parameters;
+}
+
+// A full ocean over rough terrain with the floor opened up beneath it.
+static BenchmarkWorldPtr oceanDrain(int width, int height, RandomSource& random) {
+  auto world = make_shared<BenchmarkWorld>(width, height);
+  int seaLevel = height * 3 / 4;
+  for (int x = 0; x < width; ++x) {
+    int ground = height / 8 + random.randInt(height / 16);
+    for (int y = 0; y < height; ++y) {
+      if (y < ground)
+        world->tile({x, y}) = BenchmarkTile::Solid;
+      else if (y < seaLevel)
+        world->flow({x, y}) = {Water, 1.0f, (float)(seaLevel - y)};
+    }
+  }
+
+  for (int x = 0; x < width; x += width / 8 + 1) {
+    for (int y = 0; y < height / 4; ++y) {
+      world->tile({x, y}) = BenchmarkTile::Empty;
+      if (y >= height / 8)
+        world->flow({x, y}) = {Water, 1.0f, (float)(seaLevel - y)};
+    }
+    world->addDrain(RectI::withSize(Vec2I(x, 0), Vec2I(1, 2)));
+  }
+  return world;
+}
+
+// Lava pouring from sources into an open cave system, over a shallow lake of
+// water.
+static BenchmarkWorldPtr lavaFlood(int width, int height, RandomSource& random) {
+  auto world = make_shared<BenchmarkWorld>(width, height);
+  for (int x = 0; x < width; ++x) {
+    for (int y = 0; y < height; ++y) {
+      if (y == 0 || (y < height * 7 / 8 && random.randf() < 0.08f))
+        world->tile({x, y}) = BenchmarkTile::Solid;
+      else if (y < height / 8)
+        world->flow({x, y}) = {Water, 1.0f, 0.0f};
+    }
+  }
+
+  for (int x = 0; x < width; x += 16) {
+    world->tile({x, height / 3}) = BenchmarkTile::Source;
+    world->flow({x, height / 3}) = {Lava, 1.0f, 0.0f};
+  }
+  return world;
+}
+
+int main(int argc, char** argv) {
+#ifdef STAR_USE_RPMALLOC
+  ::rpmalloc_initialize(0);
+#endif
+  try {
+    int width = 1000;
+    int height = 200;
+    size_t steps = 200;
+    uint64_t seed = 1234;
+    unsigned threads = 1;
+    size_t regionCells = 1024;
+
+    VersionOptionParser optParse;
+    optParse.setSummary("Times the cellular liquid engine on large synthetic ocean drain and lava flood scenarios");
+    optParse.addParameter("width", "tiles", OptionParser::Optional, strf("Width of the wrapping world, default {}", width));
+    optParse.addParameter("height", "tiles", OptionParser::Optional, strf("Height of the world, default {}", height));
+    optParse.addParameter("steps", "count", OptionParser::Optional, strf("Engine updates run per scenario, default {}", steps));
+    optParse.addParameter("seed", "seed", OptionParser::Optional, strf("Seed for the generated terrain, default {}", seed));
+    optParse.addParameter("threads", "count", OptionParser::Optional, "Update independent regions on this many threads, default 1");
+    optParse.addParameter("regionCells", "count", OptionParser::Optional, strf("Smallest batch of active cells in one region, default {}", regionCells));
+
+    auto opts = optParse.commandParseOrDie(argc, argv);
+
+    if (auto option = opts.parameters.maybe("width"))
+      width = max(lexicalCast<int>(option->first()), 16);
+    if (auto option = opts.parameters.maybe("height"))
+      height = max(lexicalCast<int>(option->first()), 16);
+    if (auto option = opts.parameters.maybe("steps"))
+      steps = lexicalCast<size_t>(option->first());
+    if (auto option = opts.parameters.maybe("seed"))
+      seed = lexicalCast<uint64_t>(option->first());
+    if (auto option = opts.parameters.maybe("threads"))
+      threads = max(lexicalCast<unsigned>(option->first()), 1u);
+    if (auto option = opts.parameters.maybe("regionCells"))
+      regionCells = lexicalCast<size_t>(option->first());
+
+    coutf("{}x{} tiles, {} steps, {} threads\n", width, height, steps, threads);
+
+    // The calling thread always takes part, so the pool needs one less.
+    WorkerPool workerPool("LiquidBenchmark", threads - 1);
+
+    auto runScenario = [&](String const& name, function<BenchmarkWorldPtr(int, int, RandomSource&)> const& makeWorld) {
+      RandomSource random(seed);
+      auto world = makeWorld(width, height, random);
+      LiquidCellEngine<uint8_t> engine(engineParameters(), world);
+      engine.setLiquidTickDelta(Lava, 3);
+      if (threads > 1)
+        engine.setParallel(&workerPool, regionCells, regionCells);
+      engine.visitRegion(RectI(0, 0, width, height));
+
+      size_t peakActive = 0;
+      double start = Time::monotonicTime();
+      for (size_t i = 0; i < steps; ++i) {
+        engine.update();
+        peakActive = max(peakActive, engine.activeCells());
+      }
+      double time = Time::monotonicTime() - start;
+
+      coutf("{:>12}: {:8.3f}ms per step, {} peak active cells, {} active at the end\n", name,
+          time * 1000 / max<size_t>(steps, 1), peakActive, engine.activeCells());
+      coutf("{:>12}  {}\n", "", world->summary());
+    };
+
+    runScenario("ocean drain", oceanDrain);
+    runScenario("lava flood", lavaFlood);
+
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
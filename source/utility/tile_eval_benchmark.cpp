@@ -0,0 +1,125 @@
+#include "StarSectorArray2D.hpp"
+#include "StarRandom.hpp"
+#include "StarTime.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarVersionOptionParser.hpp"
+
+#ifdef STAR_USE_RPMALLOC
+#include "rpmalloc.h"
+#endif
+
+using namespace Star;
+
+// Roughly the shape and per tile cost of the client lighting gather.
+struct BenchmarkTile {
+  uint16_t foreground;
+  uint16_t background;
+  uint8_t liquidLevel;
+  bool foregroundTransparent;
+  bool backgroundTransparent;
+};
+
+typedef SectorArray2D<BenchmarkTile, 32> BenchmarkTileArray;
+
+static Vec3F tileLight(BenchmarkTile const& tile, size_t y) {
+  Vec3F light;
+  if (tile.foreground % 7 == 0)
+    light += Vec3F(tile.foreground % 5, tile.foreground % 3, 1) * 0.1f;
+  if (tile.liquidLevel != 0)
+    light += Vec3F(0, 0.2f, 0.5f) * (tile.liquidLevel / 255.0f);
+  if (tile.foregroundTransparent) {
+    if (tile.background % 11 == 0)
+      light += Vec3F(0.3f, 0.3f, 0.1f);
+    if (tile.backgroundTransparent && y > 100)
+      light += Vec3F(0.8f, 0.8f, 0.9f);
+  }
+  return light;
+}
+
+// Evaluates every column of the region into results, one chunk per column of
+// sectors, the same way as SectorArray2D::evalColumnsParallel.
+static void gather(WorkerPool& workerPool, BenchmarkTileArray& tileArray, size_t width, size_t height, List<Vec3F>& results) {
+  size_t sectorColumns = (width + 31) / 32;
+  workerPool.parallelFor(sectorColumns, 1, [&](size_t begin, size_t) {
+    size_t minX = begin * 32;
+    tileArray.evalColumns(minX, 0, min<size_t>(32, width - minX), height, [&](size_t x, size_t y, BenchmarkTile* column, size_t columnSize) {
+        for (size_t i = 0; i < columnSize; ++i)
+          results[x * height + y + i] = tileLight(column[i], y + i);
+        return true;
+      });
+  });
+}
+
+int main(int argc, char** argv) {
+#ifdef STAR_USE_RPMALLOC
+  ::rpmalloc_initialize(0);
+#endif
+  try {
+    size_t width = 512;
+    size_t height = 256;
+    size_t runs = 100;
+    unsigned maxThreads = max(Thread::numberOfProcessors(), 1u);
+
+    VersionOptionParser optParse;
+    optParse.setSummary("Times parallel tile column evaluation over a synthetic tile array at increasing thread counts");
+    optParse.addParameter("width", "tiles", OptionParser::Optional, strf("Width of the evaluated region, default {}", width));
+    optParse.addParameter("height", "tiles", OptionParser::Optional, strf("Height of the evaluated region, default {}", height));
+    optParse.addParameter("runs", "count", OptionParser::Optional, strf("Evaluations timed per thread count, default {}", runs));
+    optParse.addParameter("threads", "count", OptionParser::Optional, strf("Highest thread count tried, default {}", maxThreads));
+
+    auto opts = optParse.commandParseOrDie(argc, argv);
+
+    if (auto option = opts.parameters.maybe("width"))
+      width = lexicalCast<size_t>(option->first());
+    if (auto option = opts.parameters.maybe("height"))
+      height = lexicalCast<size_t>(option->first());
+    if (auto option = opts.parameters.maybe("runs"))
+      runs = max<size_t>(lexicalCast<size_t>(option->first()), 1);
+    if (auto option = opts.parameters.maybe("threads"))
+      maxThreads = max(lexicalCast<unsigned>(option->first()), 1u);
+
+    BenchmarkTileArray tileArray((width + 31) / 32, (height + 31) / 32);
+    RandomSource random(1234);
+    for (size_t x = 0; x < tileArray.width() / 32; ++x) {
+      for (size_t y = 0; y < tileArray.height() / 32; ++y) {
+        auto array = make_unique<BenchmarkTileArray::Array>();
+        for (auto& tile : array->elements)
+          tile = {(uint16_t)random.randu32(), (uint16_t)random.randu32(), (uint8_t)random.randu32(), random.randb(), random.randb()};
+        tileArray.loadSector({x, y}, std::move(array));
+      }
+    }
+
+    List<Vec3F> expected;
+    double serialTime = 0.0;
+    List<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+      threadCounts.append(threads);
+    threadCounts.append(maxThreads);
+
+    coutf("{}x{} tiles, {} runs\n", width, height, runs);
+    for (unsigned threads : threadCounts) {
+      // The calling thread always takes part, so the pool needs one less.
+      WorkerPool workerPool("TileEvalBenchmark", threads - 1);
+      List<Vec3F> results(width * height);
+
+      gather(workerPool, tileArray, width, height, results);
+      double start = Time::monotonicTime();
+      for (size_t i = 0; i < runs; ++i)
+        gather(workerPool, tileArray, width, height, results);
+      double time = (Time::monotonicTime() - start) / runs;
+
+      if (expected.empty()) {
+        expected = results;
+        serialTime = time;
+      }
+
+      coutf("{:3} threads: {:8.3f}ms per run, {:5.2f}x{}\n", threads, time * 1000, serialTime / time,
+          results == expected ? "" : ", results differ from one thread!");
+    }
+
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -0,0 +1,84 @@
+#include "StarBTreeDatabase.hpp"
+#include "StarCompression.hpp"
+#include "StarTime.hpp"
+#include "StarFile.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarVersionOptionParser.hpp"
+
+#ifdef STAR_USE_RPMALLOC
+#include "rpmalloc.h"
+#endif
+
+using namespace Star;
+
+// Matches WorldStorage::StoreType::TileSector
+static uint8_t const TileSectorStoreType = 1;
+
+int main(int argc, char** argv) {
+#ifdef STAR_USE_RPMALLOC
+  ::rpmalloc_initialize(0);
+#endif
+  try {
+    double startTime = Time::monotonicTime();
+
+    size_t maxSize = 112 * 1024;
+    size_t maxSamples = 100000;
+
+    VersionOptionParser optParse;
+    optParse.setSummary("Trains a Zstandard tile sector dictionary from existing world files, for use as "
+                        "'tileSectorDictionary' in worldstorage.config");
+    optParse.addParameter("size", "bytes", OptionParser::Optional, strf("Maximum dictionary size, default {}", maxSize));
+    optParse.addParameter("samples", "count", OptionParser::Optional, strf("Maximum number of sectors sampled, default {}", maxSamples));
+    optParse.addArgument("output file path", OptionParser::Required, "Path to write the dictionary to");
+    optParse.addArgument("world files", OptionParser::Multiple, "World files to sample tile sectors from");
+
+    auto opts = optParse.commandParseOrDie(argc, argv);
+
+    if (auto sizeOption = opts.parameters.maybe("size"))
+      maxSize = lexicalCast<size_t>(sizeOption->first());
+    if (auto samplesOption = opts.parameters.maybe("samples"))
+      maxSamples = lexicalCast<size_t>(samplesOption->first());
+
+    String outputFilename = opts.arguments.at(0);
+    List<ByteArray> samples;
+    size_t sampleBytes = 0;
+    for (auto const& worldPath : opts.arguments.slice(1)) {
+      if (samples.size() >= maxSamples)
+        break;
+
+      BTreeDatabase db;
+      db.setIODevice(File::open(worldPath, IOMode::Read));
+      db.open();
+      if (db.contentIdentifier() != "World4" || db.keySize() != 5) {
+        cerrf("Skipping {}, not a world file\n", worldPath);
+        continue;
+      }
+
+      size_t count = 0;
+      db.forAll([&](ByteArray key, ByteArray data) {
+        if (samples.size() >= maxSamples || key[0] != (char)TileSectorStoreType)
+          return;
+        // Dictionaries are trained on the uncompressed sector data.
+        samples.append(uncompressData(data));
+        sampleBytes += samples.last().size();
+        ++count;
+      });
+      db.close();
+      coutf("Sampled {} tile sectors from {}\n", count, worldPath);
+    }
+
+    if (samples.empty())
+      throw StarException("No tile sectors found to train on");
+
+    coutf("Training on {} sectors ({} bytes)...\n", samples.size(), sampleBytes);
+    auto dictionary = CompressionDictionary::train(samples, maxSize);
+    File::writeFile(dictionary, outputFilename);
+
+    coutf("Wrote {} byte dictionary to {} in {}s\n", dictionary.size(), outputFilename, Time::monotonicTime() - startTime);
+    return 0;
+
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
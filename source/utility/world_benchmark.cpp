@@ -26,6 +26,7 @@ int main(int argc, char** argv) {
     rootLoader.addParameter("reportevery", "report steps", OptionParser::Optional, "number of steps between each progress report, default 0 (do not report progress)");
     rootLoader.addParameter("fidelity", "server fidelity", OptionParser::Optional, "fidelity to run the server with, default high");
     rootLoader.addSwitch("profiling", "whether to use lua profiling, prints the profile with info logging");
+    rootLoader.addSwitch("tilescan", "after each run, reports the tile memory footprint and times a scan over every tile in the world");
     rootLoader.addSwitch("unsafe", "enables unsafe lua libraries");
     RootUPtr root;
     OptionParser::Options options;
@@ -96,6 +97,25 @@ int main(int argc, char** argv) {
       coutf("Finished run of running dungeon world '{}' with seed {} for {} steps in {} seconds, average FPS: {}\n",
             dungeon, worldSeed, steps, totalTime, steps / totalTime);
       sumTime += totalTime;
+
+      if (options.switches.contains("tilescan")) {
+        Vec2U worldSize = worldServer.geometry().size();
+        double scanStart = Time::monotonicTime();
+        uint64_t collidingTiles = 0;
+        for (unsigned x = 0; x < worldSize[0]; ++x) {
+          for (unsigned y = 0; y < worldSize[1]; ++y) {
+            auto const& tile = worldServer.getServerTile(Vec2I(x, y));
+            if (tile.getCollision() != CollisionKind::None || tile.liquid.liquid != EmptyLiquidId)
+              ++collidingTiles;
+          }
+        }
+        double scanTime = Time::monotonicTime() - scanStart;
+        uint64_t tileCount = (uint64_t)worldSize[0] * worldSize[1];
+        coutf("Tile footprint: {} bytes per tile, {} KiB per sector\n",
+              sizeof(ServerTile), sizeof(ServerTile) * WorldSectorSize * WorldSectorSize / 1024);
+        coutf("Scanned {} tiles ({} colliding or liquid) in {} seconds, {} million tiles per second\n",
+              tileCount, collidingTiles, scanTime, tileCount / scanTime / 1000000.0);
+      }
     }
 
     if (times != 1) {